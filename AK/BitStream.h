@@ -31,6 +31,9 @@
 
 namespace AK {
 
+// Reads bits least significant bit first, as in DEFLATE (RFC 1951). Bits are buffered up to
+// 64 at a time, so this may read up to seven bytes past the last bit that was asked for; any
+// whole bytes left in the buffer are handed out first by read().
 class InputBitStream final : public InputStream {
 public:
     explicit InputBitStream(InputStream& stream)
@@ -38,19 +41,18 @@ public:
     {
     }
 
+    // Bytes are always read starting at the next byte boundary.
     size_t read(Bytes bytes) override
     {
         if (has_any_error())
             return 0;
 
-        size_t nread = 0;
-        if (bytes.size() >= 1) {
-            if (m_next_byte.has_value()) {
-                bytes[0] = m_next_byte.value();
-                m_next_byte.clear();
+        align_to_byte_boundary();
 
-                ++nread;
-            }
+        size_t nread = 0;
+        while (nread < bytes.size() && m_bit_count > 0) {
+            bytes[nread++] = static_cast<u8>(m_bit_buffer);
+            discard_bits(8);
         }
 
         return nread + m_stream.read(bytes.slice(nread));
@@ -66,44 +68,53 @@ public:
         return true;
     }
 
-    bool unreliable_eof() const override { return !m_next_byte.has_value() && m_stream.unreliable_eof(); }
+    bool unreliable_eof() const override { return m_bit_count == 0 && m_stream.unreliable_eof(); }
 
     bool discard_or_error(size_t count) override
     {
-        if (count >= 1) {
-            if (m_next_byte.has_value()) {
-                m_next_byte.clear();
-                --count;
-            }
+        align_to_byte_boundary();
+
+        while (count > 0 && m_bit_count > 0) {
+            discard_bits(8);
+            --count;
         }
 
         return m_stream.discard_or_error(count);
     }
 
-    u32 read_bits(size_t count)
+    // Tries to have at least count (up to 57) bits buffered, returns false if the underlying stream ran out first.
+    ALWAYS_INLINE bool ensure_bits(size_t count)
     {
-        u32 result = 0;
+        if (m_bit_count >= count)
+            return true;
+        return refill(count);
+    }
 
-        size_t nread = 0;
-        while (nread < count) {
-            if (m_stream.has_any_error()) {
-                set_fatal_error();
-                return 0;
-            }
+    size_t buffered_bit_count() const { return m_bit_count; }
 
-            if (m_next_byte.has_value()) {
-                const auto bit = (m_next_byte.value() >> m_bit_offset) & 1;
-                result |= bit << nread;
-                ++nread;
+    // The next count bits without consuming them. Bits beyond the end of the stream read as zero.
+    ALWAYS_INLINE u32 peek_bits(size_t count) const
+    {
+        ASSERT(count <= 32);
+        return m_bit_buffer & ((static_cast<u64>(1) << count) - 1);
+    }
 
-                if (m_bit_offset++ == 7)
-                    m_next_byte.clear();
-            } else {
-                m_stream >> m_next_byte;
-                m_bit_offset = 0;
-            }
+    ALWAYS_INLINE void discard_bits(size_t count)
+    {
+        ASSERT(count <= m_bit_count);
+        m_bit_buffer >>= count;
+        m_bit_count -= count;
+    }
+
+    ALWAYS_INLINE u32 read_bits(size_t count)
+    {
+        if (!ensure_bits(count)) {
+            set_fatal_error();
+            return 0;
         }
 
+        auto result = peek_bits(count);
+        discard_bits(count);
         return result;
     }
 
@@ -111,16 +122,102 @@ public:
 
     void align_to_byte_boundary()
     {
-        if (m_next_byte.has_value())
-            m_next_byte.clear();
+        discard_bits(m_bit_count % 8);
     }
 
 private:
-    Optional<u8> m_next_byte;
-    size_t m_bit_offset { 0 };
+    bool refill(size_t count)
+    {
+        ASSERT(count <= 57);
+
+        while (m_bit_count < count) {
+            if (m_stream.has_any_error())
+                return false;
+
+            u8 bytes[sizeof(m_bit_buffer)];
+            const auto nread = m_stream.read({ bytes, (64 - m_bit_count) / 8 });
+            if (nread == 0)
+                return false;
+
+            for (size_t i = 0; i < nread; ++i) {
+                m_bit_buffer |= static_cast<u64>(bytes[i]) << m_bit_count;
+                m_bit_count += 8;
+            }
+        }
+
+        return true;
+    }
+
+    u64 m_bit_buffer { 0 };
+    size_t m_bit_count { 0 };
     InputStream& m_stream;
 };
 
+// Packs bits least significant bit first, as in DEFLATE (RFC 1951).
+class OutputBitStream final : public OutputStream {
+public:
+    explicit OutputBitStream(OutputStream& stream)
+        : m_stream(stream)
+    {
+    }
+
+    // Raw bytes can only be written on a byte boundary, see align_to_byte_boundary().
+    size_t write(ReadonlyBytes bytes) override
+    {
+        if (has_any_error())
+            return 0;
+
+        ASSERT(m_bit_count == 0);
+        return m_stream.write(bytes);
+    }
+
+    bool write_or_error(ReadonlyBytes bytes) override
+    {
+        if (write(bytes) < bytes.size()) {
+            set_fatal_error();
+            return false;
+        }
+
+        return true;
+    }
+
+    void write_bits(u32 value, size_t count)
+    {
+        ASSERT(count <= 32);
+        m_bit_buffer |= (value & ((static_cast<u64>(1) << count) - 1)) << m_bit_count;
+        m_bit_count += count;
+
+        if (m_bit_count >= 32) {
+            u8 bytes[4] { static_cast<u8>(m_bit_buffer), static_cast<u8>(m_bit_buffer >> 8), static_cast<u8>(m_bit_buffer >> 16), static_cast<u8>(m_bit_buffer >> 24) };
+            if (!m_stream.write_or_error({ bytes, sizeof(bytes) }))
+                set_fatal_error();
+            m_bit_buffer >>= 32;
+            m_bit_count -= 32;
+        }
+    }
+
+    void write_bit(bool bit) { write_bits(bit, 1); }
+
+    // Pads the current byte with zero bits and passes all buffered bits on to the underlying stream.
+    void align_to_byte_boundary()
+    {
+        while (m_bit_count > 0) {
+            u8 byte = static_cast<u8>(m_bit_buffer);
+            if (!m_stream.write_or_error({ &byte, sizeof(byte) }))
+                set_fatal_error();
+            m_bit_buffer >>= 8;
+            m_bit_count = m_bit_count > 8 ? m_bit_count - 8 : 0;
+        }
+        m_bit_buffer = 0;
+    }
+
+private:
+    u64 m_bit_buffer { 0 };
+    size_t m_bit_count { 0 };
+    OutputStream& m_stream;
+};
+
 }
 
 using AK::InputBitStream;
+using AK::OutputBitStream;
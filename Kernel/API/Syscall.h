@@ -37,6 +37,7 @@ constexpr int syscall_vector = 0x82;
 
 extern "C" {
 struct pollfd;
+struct epoll_event;
 struct timeval;
 struct timespec;
 struct sockaddr;
@@ -189,7 +190,11 @@ namespace Kernel {
     S(mremap)                 \
     S(set_coredump_metadata)  \
     S(abort)                  \
-    S(anon_create)
+    S(anon_create)            \
+    S(sendfile)               \
+    S(epoll_create)           \
+    S(epoll_ctl)              \
+    S(epoll_wait)
 
 namespace Syscall {
 
@@ -440,6 +445,27 @@ struct SC_set_coredump_metadata_params {
     StringArgument value;
 };
 
+struct SC_epoll_ctl_params {
+    int epfd;
+    int op;
+    int fd;
+    struct epoll_event* event;
+};
+
+struct SC_epoll_wait_params {
+    int epfd;
+    struct epoll_event* events;
+    int max_events;
+    const struct timespec* timeout;
+};
+
+struct SC_sendfile_params {
+    int out_fd;
+    int in_fd;
+    ssize_t* offset;
+    size_t count;
+};
+
 void initialize();
 int sync();
 
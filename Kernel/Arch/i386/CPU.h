@@ -830,6 +830,11 @@ public:
         return *m_scheduler_data;
     }
 
+    ALWAYS_INLINE bool has_scheduler_data() const
+    {
+        return m_scheduler_data != nullptr;
+    }
+
     ALWAYS_INLINE void set_mm_data(MemoryManagerData& mm_data)
     {
         m_mm_data = &mm_data;
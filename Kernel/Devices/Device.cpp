@@ -87,10 +87,19 @@ void Device::process_next_queued_request(Badge<AsyncDeviceRequest>, const AsyncD
     {
         ScopedSpinLock lock(m_requests_lock);
         ASSERT(!m_requests.is_empty());
-        ASSERT(m_requests.first().ptr() == &completed_request);
-        m_requests.remove(m_requests.begin());
-        if (!m_requests.is_empty())
-            next_request = m_requests.first().ptr();
+        if (schedules_own_requests()) {
+            // Requests may complete in any order, and have all been started already.
+            auto it = m_requests.begin();
+            while (it != m_requests.end() && (*it).ptr() != &completed_request)
+                ++it;
+            ASSERT(it != m_requests.end());
+            m_requests.remove(it);
+        } else {
+            ASSERT(m_requests.first().ptr() == &completed_request);
+            m_requests.remove(m_requests.begin());
+            if (!m_requests.is_empty())
+                next_request = m_requests.first().ptr();
+        }
     }
 
     if (next_request)
@@ -67,17 +67,21 @@ public:
 
     void process_next_queued_request(Badge<AsyncDeviceRequest>, const AsyncDeviceRequest&);
 
+    // Devices that schedule their own requests are handed every request as soon as it's made,
+    // instead of one at a time in the order they were made.
+    virtual bool schedules_own_requests() const { return false; }
+
     template<typename AsyncRequestType, typename... Args>
     NonnullRefPtr<AsyncRequestType> make_request(Args&&... args)
     {
         auto request = adopt(*new AsyncRequestType(*this, forward<Args>(args)...));
-        bool was_empty;
+        bool should_start;
         {
             ScopedSpinLock lock(m_requests_lock);
-            was_empty = m_requests.is_empty();
+            should_start = m_requests.is_empty() || schedules_own_requests();
             m_requests.append(request);
         }
-        if (was_empty)
+        if (should_start)
             request->do_start({});
         return request;
     }
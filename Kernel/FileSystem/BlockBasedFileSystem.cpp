@@ -25,8 +25,13 @@
  */
 
 #include <AK/IntrusiveList.h>
+#include <AK/QuickSort.h>
+#include <AK/ScopeGuard.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/Process.h>
+#include <Kernel/Tasks/SyncTask.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/WaitQueue.h>
 
 //#define BBFS_DEBUG
 
@@ -37,99 +42,288 @@ struct CacheEntry {
     u32 block_index { 0 };
     u8* data { nullptr };
     bool has_data { false };
+    bool is_dirty { false };
+    // Set while the entry's data is being written out with the bucket lock
+    // dropped. Such an entry must not be handed out for another block, and
+    // its data must not change, until the write is done.
+    bool in_writeback { false };
+    u32 dirty_generation { 0 };
 };
 
+struct CacheSegment {
+    static constexpr size_t entry_count = 64;
+
+    OwnPtr<KBuffer> data;
+    OwnPtr<KBuffer> entries;
+
+    CacheEntry* entry_array() { return (CacheEntry*)entries->data(); }
+};
+
+// The cache is split into buckets by block index, each with its own lock,
+// so that unrelated block lookups don't contend with each other. Every bucket
+// grows on demand in fixed-size segments up to its share of a budget derived
+// from the amount of physical memory, and gives segments back when the
+// system runs low on memory.
 class DiskCache {
 public:
+    static constexpr size_t bucket_count = 16;
+
+    struct Bucket {
+        mutable Lock lock { "DiskCacheBucket" };
+        HashMap<u32, CacheEntry*> hash;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> clean_list;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> dirty_list;
+        Vector<CacheSegment> segments;
+        WaitQueue writeback_queue;
+    };
+
     explicit DiskCache(BlockBasedFS& fs)
         : m_fs(fs)
-        , m_cached_block_data(KBuffer::create_with_size(m_entry_count * m_fs.block_size()))
-        , m_entries(KBuffer::create_with_size(m_entry_count * sizeof(CacheEntry)))
     {
-        for (size_t i = 0; i < m_entry_count; ++i) {
-            entries()[i].data = m_cached_block_data.data() + i * m_fs.block_size();
-            m_clean_list.append(entries()[i]);
+        auto budget_in_blocks = budget_in_bytes() / m_fs.block_size();
+        m_max_segments_per_bucket = max((size_t)1, budget_in_blocks / CacheSegment::entry_count / bucket_count);
+        for (auto& bucket : m_buckets) {
+            bool success = grow(bucket);
+            ASSERT(success);
         }
     }
 
     ~DiskCache() { }
 
-    bool is_dirty() const { return m_dirty; }
-    void set_dirty(bool b) { m_dirty = b; }
+    bool is_dirty() const { return m_dirty_count.load(AK::MemoryOrder::memory_order_relaxed) != 0; }
+
+    Bucket& bucket_for(u32 block_index) { return m_buckets[block_index % bucket_count]; }
 
-    void mark_all_clean()
+    void mark_dirty(Bucket& bucket, CacheEntry& entry)
     {
-        while (auto* entry = m_dirty_list.first())
-            m_clean_list.prepend(*entry);
-        m_dirty = false;
+        ASSERT(bucket.lock.is_locked());
+        bucket.dirty_list.prepend(entry);
+        ++entry.dirty_generation;
+        if (!entry.is_dirty) {
+            entry.is_dirty = true;
+            auto dirty_count = m_dirty_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) + 1;
+            // Don't wait for the next periodic sync if a good chunk of the cache is waiting to be written.
+            if (dirty_count == capacity() / 4)
+                SyncTask::wake();
+        }
     }
 
-    void mark_dirty(CacheEntry& entry)
+    void mark_clean(Bucket& bucket, CacheEntry& entry)
     {
-        m_dirty_list.prepend(entry);
-        m_dirty = true;
+        ASSERT(bucket.lock.is_locked());
+        bucket.clean_list.prepend(entry);
+        if (entry.is_dirty) {
+            entry.is_dirty = false;
+            m_dirty_count.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+        }
     }
 
-    void mark_clean(CacheEntry& entry)
+    CacheEntry* find(Bucket& bucket, u32 block_index)
     {
-        m_clean_list.prepend(entry);
+        ASSERT(bucket.lock.is_locked());
+        auto it = bucket.hash.find(block_index);
+        if (it == bucket.hash.end())
+            return nullptr;
+        ASSERT(it->value->block_index == block_index);
+        return it->value;
     }
 
-    CacheEntry& get(u32 block_index) const
+    // Returns nullptr if no entry could be freed up for the block.
+    CacheEntry* get(Bucket& bucket, u32 block_index)
     {
-        if (auto it = m_hash.find(block_index); it != m_hash.end()) {
-            auto& entry = const_cast<CacheEntry&>(*it->value);
-            ASSERT(entry.block_index == block_index);
-            return entry;
-        }
-
-        if (m_clean_list.is_empty()) {
-            // Not a single clean entry! Flush writes and try again.
-            // NOTE: We want to make sure we only call FileBackedFS flush here,
-            //       not some FileBackedFS subclass flush!
-            m_fs.flush_writes_impl();
-            return get(block_index);
+        ASSERT(bucket.lock.is_locked());
+        for (;;) {
+            // Look again on every iteration, write_back_one_dirty_entry() drops the bucket lock.
+            if (auto* entry = find(bucket, block_index))
+                return entry;
+            if (!bucket.clean_list.is_empty())
+                break;
+            if (bucket.segments.size() < m_max_segments_per_bucket && grow(bucket))
+                continue;
+            if (!write_back_one_dirty_entry(bucket))
+                return nullptr;
         }
 
-        ASSERT(m_clean_list.last());
-        auto& new_entry = *m_clean_list.last();
-        m_clean_list.prepend(new_entry);
+        ASSERT(bucket.clean_list.last());
+        auto& new_entry = *bucket.clean_list.last();
+        bucket.clean_list.prepend(new_entry);
 
-        m_hash.remove(new_entry.block_index);
-        m_hash.set(block_index, &new_entry);
+        if (new_entry.has_data)
+            bucket.hash.remove(new_entry.block_index);
+        bucket.hash.set(block_index, &new_entry);
 
         new_entry.block_index = block_index;
         new_entry.has_data = false;
 
-        return new_entry;
+        return &new_entry;
     }
 
-    const CacheEntry* entries() const { return (const CacheEntry*)m_entries.data(); }
-    CacheEntry* entries() { return (CacheEntry*)m_entries.data(); }
+    // Like get(), but waits until the entry isn't being written back anymore,
+    // so that the caller may modify its data.
+    CacheEntry* get_for_writing(Bucket& bucket, u32 block_index)
+    {
+        for (;;) {
+            auto* entry = get(bucket, block_index);
+            if (!entry || !entry->in_writeback)
+                return entry;
+            wait_for_writeback(bucket);
+        }
+    }
 
-    template<typename Callback>
-    void for_each_clean_entry(Callback callback)
+    // Like find(), but waits until the entry isn't being written back anymore.
+    CacheEntry* find_not_in_writeback(Bucket& bucket, u32 block_index)
+    {
+        for (;;) {
+            auto* entry = find(bucket, block_index);
+            if (!entry || !entry->in_writeback)
+                return entry;
+            wait_for_writeback(bucket);
+        }
+    }
+
+    void finish_writeback(Bucket& bucket, CacheEntry& entry, u32 dirty_generation)
     {
-        for (auto& entry : m_clean_list)
-            callback(entry);
+        ASSERT(bucket.lock.is_locked());
+        ASSERT(entry.in_writeback);
+        entry.in_writeback = false;
+        // If the block was modified while it was being written, leave it dirty for the next round.
+        if (entry.dirty_generation == dirty_generation)
+            mark_clean(bucket, entry);
+        bucket.writeback_queue.wake_all();
+    }
+
+    // Drops a cached block without writing it back. Used when the block is
+    // about to be overwritten on disk behind the cache's back.
+    void invalidate(Bucket& bucket, CacheEntry& entry)
+    {
+        ASSERT(bucket.lock.is_locked());
+        ASSERT(!entry.in_writeback);
+        mark_clean(bucket, entry);
+        bucket.clean_list.append(entry);
+        bucket.hash.remove(entry.block_index);
+        entry.has_data = false;
     }
 
     template<typename Callback>
-    void for_each_dirty_entry(Callback callback)
+    void for_each_bucket(Callback callback)
     {
-        for (auto& entry : m_dirty_list)
-            callback(entry);
+        for (auto& bucket : m_buckets)
+            callback(bucket);
+    }
+
+    void shrink_if_under_memory_pressure()
+    {
+        if (!is_under_memory_pressure())
+            return;
+        size_t released = 0;
+        for (auto& bucket : m_buckets) {
+            LOCKER(bucket.lock);
+            while (bucket.segments.size() > 1 && try_release_last_segment(bucket))
+                ++released;
+        }
+        if (released)
+            dbgln("{}: Released {} disk cache segments due to memory pressure", m_fs.class_name(), released);
     }
 
 private:
+    static size_t budget_in_bytes()
+    {
+        // Let the cache use up to 1/8 of physical memory, within sane bounds.
+        size_t bytes = (size_t)MM.user_physical_pages() * PAGE_SIZE / 8;
+        return clamp(bytes, (size_t)4 * MiB, (size_t)64 * MiB);
+    }
+
+    static bool is_under_memory_pressure()
+    {
+        size_t total = MM.user_physical_pages();
+        size_t in_use = MM.user_physical_pages_used() + MM.user_physical_pages_committed();
+        return in_use >= total - total / 16;
+    }
+
+    size_t capacity() const { return bucket_count * m_max_segments_per_bucket * CacheSegment::entry_count; }
+
+    bool grow(Bucket& bucket)
+    {
+        if (!bucket.segments.is_empty() && is_under_memory_pressure())
+            return false;
+        CacheSegment segment;
+        // Committed up front, so the disk controller can DMA straight into the cache.
+        segment.data = KBuffer::try_create_with_size(CacheSegment::entry_count * m_fs.block_size(), Region::Access::Read | Region::Access::Write, "DiskCache", AllocationStrategy::AllocateNow);
+        segment.entries = KBuffer::try_create_with_size(CacheSegment::entry_count * sizeof(CacheEntry), Region::Access::Read | Region::Access::Write, "DiskCache");
+        if (!segment.data || !segment.entries)
+            return false;
+        for (size_t i = 0; i < CacheSegment::entry_count; ++i) {
+            auto* entry = new (&segment.entry_array()[i]) CacheEntry;
+            entry->data = segment.data->data() + i * m_fs.block_size();
+            bucket.clean_list.append(*entry);
+        }
+        bucket.segments.append(move(segment));
+        return true;
+    }
+
+    bool write_back_one_dirty_entry(Bucket& bucket)
+    {
+        // Write back the least recently dirtied block that the flusher isn't
+        // already busy with, so it can be reused. This only ever costs a
+        // single block write, never a full flush.
+        CacheEntry* victim = nullptr;
+        for (auto& entry : bucket.dirty_list) {
+            if (!entry.in_writeback)
+                victim = &entry;
+        }
+        if (!victim) {
+            // Everything is being written back right now, temporarily go
+            // over budget rather than waiting for the flusher.
+            return grow(bucket);
+        }
+
+        // Don't keep every other user of the bucket waiting on the disk.
+        // Marking the entry as in writeback keeps it from being reused or
+        // invalidated while the lock is dropped.
+        victim->in_writeback = true;
+        auto dirty_generation = victim->dirty_generation;
+        bucket.lock.unlock();
+        m_fs.write_back_entry(*victim);
+        bucket.lock.lock();
+        finish_writeback(bucket, *victim, dirty_generation);
+        SyncTask::wake();
+        return true;
+    }
+
+    void wait_for_writeback(Bucket& bucket)
+    {
+        ASSERT(bucket.lock.is_locked());
+        bucket.lock.unlock();
+        // A wakeup can slip in between dropping the lock and blocking if
+        // someone else is already waiting on the queue, so don't rely on it.
+        timespec timeout { 0, 10'000'000 };
+        [[maybe_unused]] auto result = bucket.writeback_queue.wait_on(Thread::BlockTimeout(false, &timeout), "DiskCache");
+        bucket.lock.lock();
+    }
+
+    bool try_release_last_segment(Bucket& bucket)
+    {
+        auto& segment = bucket.segments.last();
+        for (size_t i = 0; i < CacheSegment::entry_count; ++i) {
+            auto& entry = segment.entry_array()[i];
+            if (entry.is_dirty || entry.in_writeback)
+                return false;
+        }
+        for (size_t i = 0; i < CacheSegment::entry_count; ++i) {
+            auto& entry = segment.entry_array()[i];
+            if (entry.has_data)
+                bucket.hash.remove(entry.block_index);
+            bucket.clean_list.remove(entry);
+            entry.~CacheEntry();
+        }
+        bucket.segments.take_last();
+        return true;
+    }
+
     BlockBasedFS& m_fs;
-    size_t m_entry_count { 10000 };
-    mutable HashMap<u32, CacheEntry*> m_hash;
-    mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_clean_list;
-    mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_dirty_list;
-    KBuffer m_cached_block_data;
-    KBuffer m_entries;
-    bool m_dirty { false };
+    size_t m_max_segments_per_bucket { 1 };
+    Bucket m_buckets[bucket_count];
+    Atomic<size_t> m_dirty_count { 0 };
 };
 
 BlockBasedFS::BlockBasedFS(FileDescription& file_description)
@@ -142,6 +336,53 @@ BlockBasedFS::~BlockBasedFS()
 {
 }
 
+KResult BlockBasedFS::write_to_device(u32 index, const u8* data, size_t block_count)
+{
+    // Like FileDescription::write(), but at an explicit offset so that
+    // concurrent cache users don't fight over the description's seek offset.
+    size_t offset = static_cast<size_t>(index) * block_size();
+    size_t remaining = block_count * block_size();
+    while (remaining) {
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(const_cast<u8*>(data));
+        auto nwritten = file().write(file_description(), offset, buffer, remaining);
+        if (nwritten.is_error())
+            return nwritten.error();
+        if (nwritten.value() == 0)
+            return KResult(-EIO);
+        offset += nwritten.value();
+        data += nwritten.value();
+        remaining -= nwritten.value();
+    }
+    return KSuccess;
+}
+
+KResult BlockBasedFS::read_from_device(u32 index, u8* data, size_t block_count) const
+{
+    size_t offset = static_cast<size_t>(index) * block_size();
+    size_t remaining = block_count * block_size();
+    while (remaining) {
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(data);
+        auto nread = const_cast<File&>(file()).read(file_description(), offset, buffer, remaining);
+        if (nread.is_error())
+            return nread.error();
+        if (nread.value() == 0)
+            return KResult(-EIO);
+        offset += nread.value();
+        data += nread.value();
+        remaining -= nread.value();
+    }
+    return KSuccess;
+}
+
+void BlockBasedFS::write_back_entry(CacheEntry& entry)
+{
+    // All write-backs go through m_writeback_lock so that an older copy of a
+    // block can never land on disk after a newer one.
+    LOCKER(m_writeback_lock);
+    // FIXME: Should this error path be surfaced somehow?
+    [[maybe_unused]] auto result = write_to_device(entry.block_index, entry.data, 1);
+}
+
 int BlockBasedFS::write_block(unsigned index, const UserOrKernelBuffer& data, size_t count, size_t offset, bool allow_cache)
 {
     ASSERT(m_logical_block_size);
@@ -151,6 +392,11 @@ int BlockBasedFS::write_block(unsigned index, const UserOrKernelBuffer& data, si
 #endif
 
     if (!allow_cache) {
+        ++m_uncached_writes_in_progress;
+        ScopeGuard guard([&] {
+            ++m_uncached_write_generation;
+            --m_uncached_writes_in_progress;
+        });
         flush_specific_block_if_needed(index);
         u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size()) + offset;
         file_description().seek(base_offset, SEEK_SET);
@@ -161,16 +407,22 @@ int BlockBasedFS::write_block(unsigned index, const UserOrKernelBuffer& data, si
         return 0;
     }
 
-    auto& entry = cache().get(index);
-    if (count < block_size()) {
+    auto& bucket = cache().bucket_for(index);
+    LOCKER(bucket.lock);
+    auto* entry = cache().get_for_writing(bucket, index);
+    if (!entry)
+        return -ENOMEM;
+    if (count < block_size() && !entry->has_data) {
         // Fill the cache first.
-        read_block(index, nullptr, block_size());
+        if (read_from_device(index, entry->data).is_error())
+            return -EIO;
+        entry->has_data = true;
     }
-    if (!data.read(entry.data + offset, count))
+    if (!data.read(entry->data + offset, count))
         return -EFAULT;
 
-    cache().mark_dirty(entry);
-    entry.has_data = true;
+    cache().mark_dirty(bucket, *entry);
+    entry->has_data = true;
     return 0;
 }
 
@@ -244,18 +496,17 @@ int BlockBasedFS::read_block(unsigned index, UserOrKernelBuffer* buffer, size_t
         return 0;
     }
 
-    auto& entry = cache().get(index);
-    if (!entry.has_data) {
-        u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size());
-        file_description().seek(base_offset, SEEK_SET);
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-        auto nread = file_description().read(entry_data_buffer, block_size());
-        if (nread.is_error())
+    auto& bucket = cache().bucket_for(index);
+    LOCKER(bucket.lock);
+    auto* entry = cache().get(bucket, index);
+    if (!entry)
+        return -ENOMEM;
+    if (!entry->has_data) {
+        if (read_from_device(index, entry->data).is_error())
             return -EIO;
-        ASSERT(nread.value() == block_size());
-        entry.has_data = true;
+        entry->has_data = true;
     }
-    if (buffer && !buffer->write(entry.data + offset, count))
+    if (buffer && !buffer->write(entry->data + offset, count))
         return -EFAULT;
     return 0;
 }
@@ -278,44 +529,151 @@ int BlockBasedFS::read_blocks(unsigned index, unsigned count, UserOrKernelBuffer
     return 0;
 }
 
+void BlockBasedFS::read_ahead_blocks(Span<const unsigned> indices) const
+{
+    static constexpr size_t max_blocks_per_read = 64;
+    OwnPtr<KBuffer> staging_buffer;
+
+    for (size_t run_start = 0; run_start < indices.size();) {
+        // Skip over blocks that are already cached.
+        {
+            auto& bucket = cache().bucket_for(indices[run_start]);
+            LOCKER(bucket.lock);
+            auto* entry = cache().find(bucket, indices[run_start]);
+            if (entry && entry->has_data) {
+                ++run_start;
+                continue;
+            }
+        }
+
+        size_t run_length = 1;
+        while (run_start + run_length < indices.size()
+            && run_length < max_blocks_per_read
+            && indices[run_start + run_length] == indices[run_start] + run_length) {
+            auto& bucket = cache().bucket_for(indices[run_start + run_length]);
+            LOCKER(bucket.lock);
+            auto* entry = cache().find(bucket, indices[run_start + run_length]);
+            if (entry && entry->has_data)
+                break;
+            ++run_length;
+        }
+
+        if (!staging_buffer) {
+            staging_buffer = KBuffer::try_create_with_size(max_blocks_per_read * block_size(), Region::Access::Read | Region::Access::Write, "DiskCache readahead", AllocationStrategy::AllocateNow);
+            if (!staging_buffer)
+                return;
+        }
+        // Callers may not hold the file system lock, so a block can be written to
+        // disk behind the cache's back while we read it. Don't cache what we
+        // read if that happened, it may be older than what's on disk now.
+        auto uncached_write_generation = m_uncached_write_generation.load();
+        if (m_uncached_writes_in_progress.load())
+            return;
+        if (read_from_device(indices[run_start], staging_buffer->data(), run_length).is_error())
+            return;
+
+        for (size_t i = 0; i < run_length; ++i) {
+            auto& bucket = cache().bucket_for(indices[run_start + i]);
+            LOCKER(bucket.lock);
+            auto* entry = cache().get(bucket, indices[run_start + i]);
+            if (!entry)
+                return;
+            // Checked under the bucket lock, so that an uncached write that starts
+            // now will find and invalidate the entry we're about to fill.
+            if (m_uncached_writes_in_progress.load() || m_uncached_write_generation.load() != uncached_write_generation)
+                return;
+            // Someone may have read or written the block while we weren't looking.
+            if (entry->has_data || entry->in_writeback)
+                continue;
+            memcpy(entry->data, staging_buffer->data() + i * block_size(), block_size());
+            entry->has_data = true;
+        }
+
+        run_start += run_length;
+    }
+}
+
 void BlockBasedFS::flush_specific_block_if_needed(unsigned index)
 {
-    LOCKER(m_lock);
-    if (!cache().is_dirty())
+    // The caller is about to access this block on disk directly, so make
+    // sure the disk has the latest data and that we don't keep serving a
+    // copy that's about to go stale.
+    auto& bucket = cache().bucket_for(index);
+    LOCKER(bucket.lock);
+    // An entry that's being written back can't be dropped, and its write
+    // could otherwise land on disk after the caller's.
+    auto* entry = cache().find_not_in_writeback(bucket, index);
+    if (!entry)
         return;
-    Vector<CacheEntry*, 32> cleaned_entries;
-    cache().for_each_dirty_entry([&](CacheEntry& entry) {
-        if (entry.block_index != index) {
-            u32 base_offset = static_cast<u32>(entry.block_index) * static_cast<u32>(block_size());
-            file_description().seek(base_offset, SEEK_SET);
-            // FIXME: Should this error path be surfaced somehow?
-            auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-            [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
-            cleaned_entries.append(&entry);
-        }
-    });
-    // NOTE: We make a separate pass to mark entries clean since marking them clean
-    //       moves them out of the dirty list which would disturb the iteration above.
-    for (auto* entry : cleaned_entries)
-        cache().mark_clean(*entry);
+    if (entry->is_dirty)
+        write_back_entry(*entry);
+    cache().invalidate(bucket, *entry);
 }
 
 void BlockBasedFS::flush_writes_impl()
 {
-    LOCKER(m_lock);
     if (!cache().is_dirty())
         return;
-    u32 count = 0;
-    cache().for_each_dirty_entry([&](CacheEntry& entry) {
-        u32 base_offset = static_cast<u32>(entry.block_index) * static_cast<u32>(block_size());
-        file_description().seek(base_offset, SEEK_SET);
-        // FIXME: Should this error path be surfaced somehow?
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-        [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
-        ++count;
+
+    struct PendingWrite {
+        DiskCache::Bucket* bucket;
+        CacheEntry* entry;
+        u32 dirty_generation;
+    };
+
+    // Snapshot every dirty entry, then write them out in block order so
+    // that adjacent blocks can be coalesced into a single device write.
+    Vector<PendingWrite> pending_writes;
+    cache().for_each_bucket([&](DiskCache::Bucket& bucket) {
+        LOCKER(bucket.lock);
+        for (auto& entry : bucket.dirty_list) {
+            if (entry.in_writeback)
+                continue;
+            entry.in_writeback = true;
+            pending_writes.append({ &bucket, &entry, entry.dirty_generation });
+        }
     });
-    cache().mark_all_clean();
-    dbgln("{}: Flushed {} blocks to disk", class_name(), count);
+    quick_sort(pending_writes, [](auto& a, auto& b) { return a.entry->block_index < b.entry->block_index; });
+
+    static constexpr size_t max_blocks_per_write = 64;
+    auto staging_buffer = KBuffer::try_create_with_size(max_blocks_per_write * block_size(), Region::Access::Read | Region::Access::Write, "DiskCache writeback", AllocationStrategy::AllocateNow);
+
+    size_t write_count = 0;
+    for (size_t run_start = 0; run_start < pending_writes.size();) {
+        size_t run_length = 1;
+        if (staging_buffer) {
+            while (run_start + run_length < pending_writes.size()
+                && run_length < max_blocks_per_write
+                && pending_writes[run_start + run_length].entry->block_index == pending_writes[run_start].entry->block_index + run_length)
+                ++run_length;
+        }
+
+        {
+            LOCKER(m_writeback_lock);
+            // FIXME: Should this error path be surfaced somehow?
+            if (run_length == 1) {
+                auto& entry = *pending_writes[run_start].entry;
+                [[maybe_unused]] auto result = write_to_device(entry.block_index, entry.data, 1);
+            } else {
+                for (size_t i = 0; i < run_length; ++i)
+                    memcpy(staging_buffer->data() + i * block_size(), pending_writes[run_start + i].entry->data, block_size());
+                [[maybe_unused]] auto result = write_to_device(pending_writes[run_start].entry->block_index, staging_buffer->data(), run_length);
+            }
+        }
+
+        for (size_t i = 0; i < run_length; ++i) {
+            auto& pending_write = pending_writes[run_start + i];
+            LOCKER(pending_write.bucket->lock);
+            cache().finish_writeback(*pending_write.bucket, *pending_write.entry, pending_write.dirty_generation);
+        }
+
+        ++write_count;
+        run_start += run_length;
+    }
+
+    dbgln("{}: Flushed {} blocks to disk in {} writes", class_name(), pending_writes.size(), write_count);
+
+    cache().shrink_if_under_memory_pressure();
 }
 
 void BlockBasedFS::flush_writes()
@@ -325,8 +683,11 @@ void BlockBasedFS::flush_writes()
 
 DiskCache& BlockBasedFS::cache() const
 {
-    if (!m_cache)
-        m_cache = make<DiskCache>(const_cast<BlockBasedFS&>(*this));
+    if (!m_cache) {
+        LOCKER(m_lock);
+        if (!m_cache)
+            m_cache = make<DiskCache>(const_cast<BlockBasedFS&>(*this));
+    }
     return *m_cache;
 }
 
@@ -30,7 +30,11 @@
 
 namespace Kernel {
 
+struct CacheEntry;
+
 class BlockBasedFS : public FileBackedFS {
+    friend class DiskCache;
+
 public:
     virtual ~BlockBasedFS() override;
 
@@ -45,6 +49,9 @@ protected:
     int read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset = 0, bool allow_cache = true) const;
     int read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache = true) const;
 
+    // Brings the given blocks into the cache, reading runs of adjacent blocks from the device in one go.
+    void read_ahead_blocks(Span<const unsigned> indices) const;
+
     bool raw_read(unsigned index, UserOrKernelBuffer& buffer);
     bool raw_write(unsigned index, const UserOrKernelBuffer& buffer);
 
@@ -60,7 +67,15 @@ private:
     DiskCache& cache() const;
     void flush_specific_block_if_needed(unsigned index);
 
+    KResult read_from_device(u32 index, u8* data, size_t block_count = 1) const;
+    KResult write_to_device(u32 index, const u8* data, size_t block_count);
+    void write_back_entry(CacheEntry&);
+
     mutable OwnPtr<DiskCache> m_cache;
+    // Lets read_ahead_blocks() notice uncached writes that overlap with it.
+    Atomic<u32> m_uncached_writes_in_progress { 0 };
+    Atomic<u32> m_uncached_write_generation { 0 };
+    Lock m_writeback_lock { "BlockBasedFSWriteback" };
 };
 
 }
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Singleton.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
+#include <Kernel/FileSystem/Inode.h>
+
+namespace Kernel {
+
+static AK::Singleton<DirectoryEntryCache> s_the;
+
+DirectoryEntryCache& DirectoryEntryCache::the()
+{
+    return *s_the;
+}
+
+DirectoryEntryCache::DirectoryEntryCache()
+{
+}
+
+DirectoryEntryCache::~DirectoryEntryCache()
+{
+}
+
+DirectoryEntryCache::EntryMap::IteratorType DirectoryEntryCache::find(InodeIdentifier directory, const StringView& name)
+{
+    ASSERT(m_lock.is_locked());
+    return m_entries.find(KeyTraits::hash(directory, name), [&](auto& entry) {
+        return entry.key.directory == directory && entry.key.name == name;
+    });
+}
+
+NonnullOwnPtr<DirectoryEntryCache::Entry> DirectoryEntryCache::take(EntryMap::IteratorType it)
+{
+    ASSERT(m_lock.is_locked());
+    auto entry = move(it->value);
+    m_entries.remove(it);
+    m_lru_list.remove(*entry);
+
+    auto count_it = m_entry_count_by_directory.find(entry->key.directory);
+    ASSERT(count_it != m_entry_count_by_directory.end());
+    if (--count_it->value == 0)
+        m_entry_count_by_directory.remove(count_it);
+    return entry;
+}
+
+auto DirectoryEntryCache::lookup(Inode& directory, const StringView& name) -> LookupResult
+{
+    if (!directory.fs().supports_directory_entry_cache())
+        return { directory.lookup(name), nullptr };
+
+    auto directory_id = directory.identifier();
+    u32 generation;
+    {
+        LOCKER(m_lock);
+        auto it = find(directory_id, name);
+        if (it != m_entries.end()) {
+            auto& entry = *it->value;
+            m_lru_list.prepend(entry);
+            return { entry.inode, entry.custody };
+        }
+        generation = m_generation;
+    }
+
+    auto inode = directory.lookup(name);
+
+    // Whatever we evict has to go away after we've let go of the lock, since
+    // that may drop the last reference to an inode.
+    OwnPtr<Entry> evicted_entry;
+    LOCKER(m_lock);
+    if (generation != m_generation || find(directory_id, name) != m_entries.end())
+        return { move(inode), nullptr };
+
+    if (m_entries.size() >= max_entry_count) {
+        auto& least_recently_used = *m_lru_list.last();
+        evicted_entry = take(find(least_recently_used.key.directory, least_recently_used.key.name));
+    }
+
+    auto entry = make<Entry>();
+    entry->key = { directory_id, name };
+    entry->inode = inode;
+    m_lru_list.prepend(*entry);
+    ++m_entry_count_by_directory.ensure(directory_id);
+    m_entries.set(entry->key, move(entry));
+    return { move(inode), nullptr };
+}
+
+void DirectoryEntryCache::remember_custody(Custody& custody)
+{
+    ASSERT(custody.parent());
+    auto& directory = custody.parent()->inode();
+    if (!directory.fs().supports_directory_entry_cache())
+        return;
+
+    RefPtr<Custody> previous_custody;
+    LOCKER(m_lock);
+    auto it = find(directory.identifier(), custody.name());
+    if (it == m_entries.end())
+        return;
+    previous_custody = move(it->value->custody);
+    it->value->custody = custody;
+}
+
+void DirectoryEntryCache::invalidate(InodeIdentifier directory, const StringView& name, InodeIdentifier child)
+{
+    Vector<NonnullOwnPtr<Entry>> removed_entries;
+    LOCKER(m_lock);
+    ++m_generation;
+
+    auto it = find(directory, name);
+    if (it != m_entries.end())
+        removed_entries.append(take(it));
+
+    // If the child was a directory, it may be gone for good and its inode number
+    // handed out again, so nothing we know about its entries can be trusted anymore.
+    if (!m_entry_count_by_directory.contains(child))
+        return;
+    for (auto entry_it = m_lru_list.begin(); entry_it != m_lru_list.end();) {
+        auto& entry = *entry_it;
+        ++entry_it;
+        if (entry.key.directory == child)
+            removed_entries.append(take(find(entry.key.directory, entry.key.name)));
+    }
+    ASSERT(!m_entry_count_by_directory.contains(child));
+}
+
+void DirectoryEntryCache::invalidate_all()
+{
+    EntryMap entries;
+    LOCKER(m_lock);
+    ++m_generation;
+    m_lru_list.clear();
+    m_entry_count_by_directory.clear();
+    swap(entries, m_entries);
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/RefPtr.h>
+#include <AK/String.h>
+#include <Kernel/FileSystem/FileSystem.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Lock.h>
+
+namespace Kernel {
+
+// Remembers what names in a directory resolve to, including names that don't
+// exist, so that path resolution doesn't have to ask the filesystem again.
+// Only filesystems that report every change to their directories through
+// Inode::did_add_child() and did_remove_child() are cached.
+class DirectoryEntryCache {
+public:
+    static DirectoryEntryCache& the();
+
+    DirectoryEntryCache();
+    ~DirectoryEntryCache();
+
+    struct LookupResult {
+        // Null if there's no such entry.
+        RefPtr<Inode> inode;
+        // The last custody handed out for the entry. It may belong to another
+        // parent custody or predate a mount, so callers have to check it.
+        RefPtr<Custody> custody;
+    };
+
+    LookupResult lookup(Inode& directory, const StringView& name);
+    void remember_custody(Custody&);
+
+    void invalidate(InodeIdentifier directory, const StringView& name, InodeIdentifier child);
+    void invalidate_all();
+
+private:
+    static constexpr size_t max_entry_count = 4096;
+
+    struct Key {
+        InodeIdentifier directory;
+        String name;
+
+        bool operator==(const Key& other) const { return directory == other.directory && name == other.name; }
+    };
+
+    struct KeyTraits : public GenericTraits<Key> {
+        static unsigned hash(const Key& key) { return hash(key.directory, key.name); }
+        static unsigned hash(InodeIdentifier directory, const StringView& name) { return pair_int_hash(Traits<InodeIdentifier>::hash(directory), name.hash()); }
+    };
+
+    struct Entry {
+        IntrusiveListNode lru_list_node;
+        Key key;
+        RefPtr<Inode> inode;
+        RefPtr<Custody> custody;
+    };
+
+    using EntryMap = HashMap<Key, NonnullOwnPtr<Entry>, KeyTraits>;
+
+    EntryMap::IteratorType find(InodeIdentifier directory, const StringView& name);
+    NonnullOwnPtr<Entry> take(EntryMap::IteratorType);
+
+    Lock m_lock { "DirectoryEntryCache" };
+    EntryMap m_entries;
+    // Most recently used entries come first.
+    IntrusiveList<Entry, &Entry::lru_list_node> m_lru_list;
+    // How many entries there are for each directory, so we know when a removed
+    // directory takes entries with it.
+    HashMap<InodeIdentifier, size_t> m_entry_count_by_directory;
+    // Bumped on every invalidation, so that lookups which raced with one don't
+    // put a stale answer into the cache.
+    u32 m_generation { 0 };
+};
+
+}
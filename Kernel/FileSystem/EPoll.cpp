@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FileSystem/EPoll.h>
+#include <Kernel/FileSystem/FileDescription.h>
+
+//#define EPOLL_DEBUG
+
+namespace Kernel {
+
+NonnullRefPtr<EPoll> EPoll::create()
+{
+    return adopt(*new EPoll);
+}
+
+EPoll::EPoll()
+{
+}
+
+EPoll::~EPoll()
+{
+    // Unregister everything before the ready list goes away.
+    m_interests.clear();
+}
+
+EPoll::Interest::Interest(EPoll& epoll, int fd, FileDescription& description, u32 events, epoll_data_t data)
+    : m_epoll(epoll)
+    , m_fd(fd)
+    , m_file(description.file())
+    , m_description(&description)
+    , m_events(events)
+    , m_data(data)
+{
+    // We stay registered with the description until one of us goes away. If it's
+    // ready right away, unblock() puts us on the ready list from in here.
+    m_file->block_condition().add_blocker(*this, nullptr);
+}
+
+EPoll::Interest::~Interest()
+{
+    m_file->block_condition().remove_blocker(*this, nullptr);
+    ScopedSpinLock lock(m_epoll.m_ready_lock);
+    if (m_ready_list_node.is_in_list())
+        m_epoll.m_ready_list.remove(*this);
+}
+
+void EPoll::Interest::update(u32 events, epoll_data_t data)
+{
+    m_file->block_condition().remove_blocker(*this, nullptr);
+    m_events = events;
+    m_data = data;
+    m_file->block_condition().add_blocker(*this, nullptr);
+}
+
+RefPtr<FileDescription> EPoll::Interest::description() const
+{
+    ScopedSpinLock lock(m_epoll.m_ready_lock);
+    // The description may already be on its way out, in which case we can't have it anymore.
+    if (!m_description || !m_description->try_ref())
+        return nullptr;
+    return adopt(*m_description);
+}
+
+bool EPoll::Interest::is_watching(const FileDescription& description) const
+{
+    ScopedSpinLock lock(m_epoll.m_ready_lock);
+    return m_description == &description;
+}
+
+bool EPoll::Interest::is_detached() const
+{
+    ScopedSpinLock lock(m_epoll.m_ready_lock);
+    return !m_description;
+}
+
+bool EPoll::Interest::description_will_be_destroyed(const FileDescription& description)
+{
+    if (m_description != &description)
+        return false;
+    {
+        ScopedSpinLock lock(m_epoll.m_ready_lock);
+        m_description = nullptr;
+        if (m_ready_list_node.is_in_list())
+            m_epoll.m_ready_list.remove(*this);
+    }
+    m_epoll.m_has_detached_interests = true;
+    return true;
+}
+
+Thread::FileBlocker::BlockFlags EPoll::Interest::block_flags() const
+{
+    u32 block_flags = (u32)BlockFlags::None;
+    if (m_events & EPOLLIN)
+        block_flags |= (u32)BlockFlags::Read;
+    if (m_events & EPOLLOUT)
+        block_flags |= (u32)BlockFlags::Write;
+    if (m_events & EPOLLPRI)
+        block_flags |= (u32)BlockFlags::ReadPriority;
+    return (BlockFlags)block_flags;
+}
+
+bool EPoll::Interest::unblock(bool, void*)
+{
+    // Called with the block condition locked, so the description can't be detached under us.
+    if (m_description && m_description->should_unblock(block_flags()) != BlockFlags::None)
+        m_epoll.did_become_ready(*this);
+
+    // Unlike a regular blocker, we never want to be removed from the block condition.
+    return false;
+}
+
+void EPoll::did_become_ready(Interest& interest)
+{
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (interest.m_ready_list_node.is_in_list())
+            return;
+        m_ready_list.append(interest);
+    }
+#ifdef EPOLL_DEBUG
+    dbgln("EPoll: fd {} became ready", interest.fd());
+#endif
+    m_wait_queue.wake_all();
+    evaluate_block_conditions();
+}
+
+KResult EPoll::add(int fd, FileDescription& description, u32 events, epoll_data_t data)
+{
+    // Nesting could create a cycle between block conditions, so don't allow it.
+    if (description.file().is_epoll())
+        return KResult(-EINVAL);
+
+    LOCKER(m_lock);
+    remove_detached_interests();
+    if (auto it = m_interests.find(fd); it != m_interests.end()) {
+        // The fd may have been closed and reused without telling us. In that
+        // case, the old entry is stale and gets replaced.
+        if (it->value->is_watching(description))
+            return KResult(-EEXIST);
+        m_interests.remove(it);
+    }
+    m_interests.set(fd, make<Interest>(*this, fd, description, events, data));
+    return KSuccess;
+}
+
+KResult EPoll::modify(int fd, FileDescription& description, u32 events, epoll_data_t data)
+{
+    LOCKER(m_lock);
+    auto it = m_interests.find(fd);
+    if (it == m_interests.end() || !it->value->is_watching(description))
+        return KResult(-ENOENT);
+    it->value->update(events, data);
+    return KSuccess;
+}
+
+KResult EPoll::remove(int fd)
+{
+    LOCKER(m_lock);
+    remove_detached_interests();
+    if (!m_interests.remove(fd))
+        return KResult(-ENOENT);
+    return KSuccess;
+}
+
+void EPoll::remove_detached_interests()
+{
+    ASSERT(m_lock.is_locked());
+    if (!m_has_detached_interests.exchange(false))
+        return;
+    Vector<int> detached_fds;
+    for (auto& it : m_interests) {
+        if (it.value->is_detached())
+            detached_fds.append(it.key);
+    }
+    for (auto fd : detached_fds)
+        m_interests.remove(fd);
+}
+
+KResultOr<size_t> EPoll::wait(Vector<epoll_event>& events, size_t max_events, const Thread::BlockTimeout& timeout)
+{
+    ASSERT(max_events > 0);
+    for (;;) {
+        {
+            LOCKER(m_lock);
+            remove_detached_interests();
+            Vector<Interest*, 32> candidates;
+            {
+                ScopedSpinLock lock(m_ready_lock);
+                while (!m_ready_list.is_empty() && candidates.size() < max_events)
+                    candidates.append(m_ready_list.take_first());
+            }
+
+            for (auto* interest : candidates) {
+                auto description = interest->description();
+                if (!description)
+                    continue;
+                // The readiness may have been consumed since the entry was queued.
+                auto unblocked_flags = (u32)description->should_unblock(interest->block_flags());
+                if (unblocked_flags == (u32)Thread::FileBlocker::BlockFlags::None)
+                    continue;
+
+                u32 revents = 0;
+                if (unblocked_flags & (u32)Thread::FileBlocker::BlockFlags::Read)
+                    revents |= EPOLLIN;
+                if (unblocked_flags & (u32)Thread::FileBlocker::BlockFlags::Write)
+                    revents |= EPOLLOUT;
+                if (unblocked_flags & (u32)Thread::FileBlocker::BlockFlags::ReadPriority)
+                    revents |= EPOLLPRI;
+                events.append({ revents, interest->data() });
+
+                // Level-triggered entries stay ready until the condition goes away,
+                // edge-triggered ones have to wait for the next state change.
+                if (!(interest->events() & EPOLLET)) {
+                    ScopedSpinLock lock(m_ready_lock);
+                    if (!interest->m_ready_list_node.is_in_list())
+                        m_ready_list.append(*interest);
+                }
+            }
+
+            if (!events.is_empty())
+                return events.size();
+        }
+
+        if (!timeout.should_block())
+            return 0;
+
+        auto result = m_wait_queue.wait_on(timeout, "EPoll");
+        if (result.was_interrupted())
+            return KResult(-EINTR);
+        if (result == Thread::BlockResult::InterruptedByTimeout)
+            return 0;
+    }
+}
+
+bool EPoll::can_read(const FileDescription&, size_t) const
+{
+    ScopedSpinLock lock(m_ready_lock);
+    return !m_ready_list.is_empty();
+}
+
+}
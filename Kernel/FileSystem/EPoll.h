@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtr.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/UnixTypes.h>
+#include <Kernel/WaitQueue.h>
+
+namespace Kernel {
+
+// EPoll keeps a persistent set of file descriptions a process is interested in.
+// Rather than re-scanning all of them on every wait like select() and poll() do,
+// it stays registered with each description's block condition and collects the
+// ones that become ready on a list, so a wait only ever looks at ready entries.
+//
+// An interest doesn't keep its description alive. When the description goes away,
+// the interest is detached from it and dropped the next time the set is used.
+class EPoll final : public File {
+public:
+    static NonnullRefPtr<EPoll> create();
+    virtual ~EPoll() override;
+
+    KResult add(int fd, FileDescription&, u32 events, epoll_data_t);
+    KResult modify(int fd, FileDescription&, u32 events, epoll_data_t);
+    KResult remove(int fd);
+
+    // Collects up to max_events ready entries, blocking until there is at least one
+    // or the timeout expires. Returns the number of events written to the buffer.
+    KResultOr<size_t> wait(Vector<epoll_event>&, size_t max_events, const Thread::BlockTimeout&);
+
+    virtual bool can_read(const FileDescription&, size_t) const override;
+    virtual bool can_write(const FileDescription&, size_t) const override { return false; }
+    virtual KResultOr<size_t> read(FileDescription&, size_t, UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+    virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+    virtual String absolute_path(const FileDescription&) const override { return "epoll"; }
+    virtual const char* class_name() const override { return "EPoll"; }
+    virtual bool is_epoll() const override { return true; }
+
+private:
+    class Interest final : public Thread::FileBlocker {
+    public:
+        Interest(EPoll&, int fd, FileDescription&, u32 events, epoll_data_t);
+        virtual ~Interest() override;
+
+        void update(u32 events, epoll_data_t);
+
+        virtual bool unblock(bool, void*) override;
+        virtual void not_blocking(bool) override { }
+        virtual bool description_will_be_destroyed(const FileDescription&) override;
+        virtual const char* state_string() const override { return "EPoll"; }
+
+        int fd() const { return m_fd; }
+        // Returns nullptr once the description is gone or about to go.
+        RefPtr<FileDescription> description() const;
+        bool is_watching(const FileDescription&) const;
+        bool is_detached() const;
+        u32 events() const { return m_events; }
+        epoll_data_t data() const { return m_data; }
+        BlockFlags block_flags() const;
+
+        IntrusiveListNode m_ready_list_node;
+
+    private:
+        EPoll& m_epoll;
+        int m_fd { -1 };
+        // Keeps the block condition we're registered with around after the description is gone.
+        NonnullRefPtr<File> m_file;
+        // Guarded by the block condition's lock and m_epoll.m_ready_lock, and cleared
+        // (with both held) when the description is destroyed.
+        FileDescription* m_description { nullptr };
+        u32 m_events { 0 };
+        epoll_data_t m_data;
+    };
+
+    EPoll();
+
+    void did_become_ready(Interest&);
+    void remove_detached_interests();
+
+    mutable Lock m_lock { "EPoll" };
+    HashMap<int, NonnullOwnPtr<Interest>> m_interests;
+    Atomic<bool> m_has_detached_interests { false };
+
+    mutable SpinLock<u8> m_ready_lock;
+    IntrusiveList<Interest, &Interest::m_ready_list_node> m_ready_list;
+    WaitQueue m_wait_queue;
+};
+
+}
@@ -26,7 +26,9 @@
 
 #include <AK/Bitmap.h>
 #include <AK/HashMap.h>
+#include <AK/IterationDecision.h>
 #include <AK/MemoryStream.h>
+#include <AK/QuickSort.h>
 #include <AK/StdLibExtras.h>
 #include <AK/StringView.h>
 #include <Kernel/Devices/BlockDevice.h>
@@ -753,6 +755,38 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
     return nread;
 }
 
+void Ext2FSInode::read_ahead(off_t offset, size_t count) const
+{
+    ASSERT(offset >= 0);
+    Vector<unsigned> block_indices;
+    {
+        Locker inode_locker(m_lock);
+        if (is_symlink() || (off_t)size() <= offset)
+            return;
+
+        Locker fs_locker(fs().m_lock);
+
+        if (m_block_list.is_empty())
+            m_block_list = fs().block_list_for_inode(m_raw_inode);
+        if (m_block_list.is_empty())
+            return;
+
+        const size_t block_size = fs().block_size();
+        size_t first_block_logical_index = offset / block_size;
+        size_t last_block_logical_index = min((size_t)(offset + count - 1) / block_size, m_block_list.size() - 1);
+        if (first_block_logical_index > last_block_logical_index)
+            return;
+
+        block_indices.append(m_block_list.data() + first_block_logical_index, last_block_logical_index - first_block_logical_index + 1);
+    }
+
+    // Don't hold up every other file system operation while we wait for the disk.
+    // The blocks may have been freed and reused by the time we read them, but
+    // read_ahead_blocks() never replaces what's already in the cache, so the
+    // worst that can happen is caching data nobody asks for.
+    fs().read_ahead_blocks(block_indices.span());
+}
+
 KResult Ext2FSInode::resize(u64 new_size)
 {
     u64 old_size = size();
@@ -1011,10 +1045,796 @@ bool Ext2FSInode::write_directory(const Vector<Ext2FSDirectoryEntry>& entries)
     ssize_t nwritten = write_bytes(0, stream.size(), buffer, nullptr);
     if (nwritten < 0)
         return false;
+    // Whatever index the directory had is gone now.
+    m_raw_inode.i_flags &= ~EXT2_INDEX_FL;
     set_metadata_dirty(true);
     return static_cast<size_t>(nwritten) == directory_data.size();
 }
 
+// Hashed directory indexes ("htree"), as introduced by ext3.
+//
+// An indexed directory keeps "." and ".." at the start of its first block, followed by
+// a dx_root_info and a sorted array of (hash, block) entries. Entry 0 has no hash, its
+// hash field holds the count and limit of the array instead. If indirect_levels is 1,
+// the root entries point at index nodes (blocks made of a single empty directory record
+// followed by another entry array), otherwise they point straight at the leaf blocks.
+// Leaf blocks are ordinary directory blocks, so a linear scan still sees every entry.
+
+static const size_t directory_index_root_info_offset = 24;
+static const size_t directory_index_node_entries_offset = 8;
+static const size_t max_directory_index_levels = 2;
+
+static u32 directory_hash_char(char ch, bool is_unsigned)
+{
+    if (is_unsigned)
+        return static_cast<u8>(ch);
+    return static_cast<u32>(static_cast<i32>(static_cast<i8>(ch)));
+}
+
+static u32 directory_hash_legacy(const StringView& name, bool is_unsigned)
+{
+    u32 hash0 = 0x12a3fe2d;
+    u32 hash1 = 0x37abe8f9;
+    for (auto ch : name) {
+        u32 hash = hash1 + (hash0 ^ (directory_hash_char(ch, is_unsigned) * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+static void directory_hash_string_to_buffer(const char* characters, size_t length, u32* buffer, int word_count, bool is_unsigned)
+{
+    u32 pad = static_cast<u32>(length) | (static_cast<u32>(length) << 8);
+    pad |= pad << 16;
+
+    u32 value = pad;
+    length = min(length, static_cast<size_t>(word_count) * 4);
+    for (size_t i = 0; i < length; ++i) {
+        value = directory_hash_char(characters[i], is_unsigned) + (value << 8);
+        if ((i % 4) == 3) {
+            *buffer++ = value;
+            value = pad;
+            --word_count;
+        }
+    }
+    if (--word_count >= 0)
+        *buffer++ = value;
+    while (--word_count >= 0)
+        *buffer++ = pad;
+}
+
+static inline u32 rotate_left(u32 value, u32 shift)
+{
+    return (value << shift) | (value >> (32 - shift));
+}
+
+static void directory_hash_half_md4_transform(u32 buffer[4], const u32 input[8])
+{
+    auto f = [](u32 x, u32 y, u32 z) { return z ^ (x & (y ^ z)); };
+    auto g = [](u32 x, u32 y, u32 z) { return (x & y) + ((x ^ y) & z); };
+    auto h = [](u32 x, u32 y, u32 z) { return x ^ y ^ z; };
+    const u32 k2 = 013240474631;
+    const u32 k3 = 015666365641;
+
+    u32 a = buffer[0], b = buffer[1], c = buffer[2], d = buffer[3];
+
+#define ROUND(function, a, b, c, d, x, s) (a += function(b, c, d) + (x), a = rotate_left(a, s))
+    ROUND(f, a, b, c, d, input[0], 3);
+    ROUND(f, d, a, b, c, input[1], 7);
+    ROUND(f, c, d, a, b, input[2], 11);
+    ROUND(f, b, c, d, a, input[3], 19);
+    ROUND(f, a, b, c, d, input[4], 3);
+    ROUND(f, d, a, b, c, input[5], 7);
+    ROUND(f, c, d, a, b, input[6], 11);
+    ROUND(f, b, c, d, a, input[7], 19);
+
+    ROUND(g, a, b, c, d, input[1] + k2, 3);
+    ROUND(g, d, a, b, c, input[3] + k2, 5);
+    ROUND(g, c, d, a, b, input[5] + k2, 9);
+    ROUND(g, b, c, d, a, input[7] + k2, 13);
+    ROUND(g, a, b, c, d, input[0] + k2, 3);
+    ROUND(g, d, a, b, c, input[2] + k2, 5);
+    ROUND(g, c, d, a, b, input[4] + k2, 9);
+    ROUND(g, b, c, d, a, input[6] + k2, 13);
+
+    ROUND(h, a, b, c, d, input[3] + k3, 3);
+    ROUND(h, d, a, b, c, input[7] + k3, 9);
+    ROUND(h, c, d, a, b, input[2] + k3, 11);
+    ROUND(h, b, c, d, a, input[6] + k3, 15);
+    ROUND(h, a, b, c, d, input[1] + k3, 3);
+    ROUND(h, d, a, b, c, input[5] + k3, 9);
+    ROUND(h, c, d, a, b, input[0] + k3, 11);
+    ROUND(h, b, c, d, a, input[4] + k3, 15);
+#undef ROUND
+
+    buffer[0] += a;
+    buffer[1] += b;
+    buffer[2] += c;
+    buffer[3] += d;
+}
+
+static void directory_hash_tea_transform(u32 buffer[4], const u32 input[4])
+{
+    u32 sum = 0;
+    u32 b0 = buffer[0], b1 = buffer[1];
+    u32 a = input[0], b = input[1], c = input[2], d = input[3];
+    for (int i = 0; i < 16; ++i) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+    buffer[0] += b0;
+    buffer[1] += b1;
+}
+
+u32 Ext2FS::directory_hash(const StringView& name, u8 hash_version) const
+{
+    bool is_unsigned = super_block().s_flags & EXT2_FLAGS_UNSIGNED_HASH;
+
+    u32 buffer[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    for (size_t i = 0; i < 4; ++i) {
+        if (super_block().s_hash_seed[i]) {
+            memcpy(buffer, super_block().s_hash_seed, sizeof(buffer));
+            break;
+        }
+    }
+
+    u32 hash = 0;
+    switch (hash_version) {
+    case EXT2_HASH_LEGACY:
+        hash = directory_hash_legacy(name, is_unsigned);
+        break;
+    case EXT2_HASH_HALF_MD4:
+        for (size_t offset = 0; offset < name.length(); offset += 32) {
+            u32 input[8];
+            directory_hash_string_to_buffer(name.characters_without_null_termination() + offset, name.length() - offset, input, 8, is_unsigned);
+            directory_hash_half_md4_transform(buffer, input);
+        }
+        hash = buffer[1];
+        break;
+    case EXT2_HASH_TEA:
+        for (size_t offset = 0; offset < name.length(); offset += 16) {
+            u32 input[4];
+            directory_hash_string_to_buffer(name.characters_without_null_termination() + offset, name.length() - offset, input, 4, is_unsigned);
+            directory_hash_tea_transform(buffer, input);
+        }
+        hash = buffer[0];
+        break;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+
+    // The lowest bit marks hash collisions that continue into the next block, and the
+    // highest hash is reserved as an end-of-directory marker for readdir() cookies.
+    hash &= ~1u;
+    if (hash == (0x7fffffffu << 1))
+        hash = 0x7ffffffeu << 1;
+    return hash;
+}
+
+struct Ext2FSDirectoryIndexFrame {
+    size_t block_index { 0 };
+    ByteBuffer block;
+    size_t entries_offset { 0 };
+    size_t position { 0 };
+
+    ext2_dx_countlimit& count_limit() { return *reinterpret_cast<ext2_dx_countlimit*>(block.data() + entries_offset); }
+    ext2_dx_entry* entries() { return reinterpret_cast<ext2_dx_entry*>(block.data() + entries_offset); }
+    size_t count() { return count_limit().count; }
+    size_t limit() { return count_limit().limit; }
+    u32 hash_at(size_t index) { return index ? entries()[index].hash : 0; }
+    u32 block_at(size_t index) { return entries()[index].block & 0x00ffffff; }
+
+    void insert(size_t index, u32 hash, u32 block_index)
+    {
+        ASSERT(index >= 1 && index <= count());
+        ASSERT(count() < limit());
+        memmove(&entries()[index + 1], &entries()[index], (count() - index) * sizeof(ext2_dx_entry));
+        entries()[index] = { hash, block_index };
+        ++count_limit().count;
+    }
+};
+
+struct Ext2FSDirectoryIndexPath {
+    Vector<Ext2FSDirectoryIndexFrame, max_directory_index_levels> frames;
+    u8 hash_version { 0 };
+    u32 hash { 0 };
+
+    size_t leaf_block_index() { return frames.last().block_at(frames.last().position); }
+};
+
+struct Ext2FSDirectoryRecord {
+    u32 hash { 0 };
+    size_t offset { 0 };
+    size_t length { 0 };
+};
+
+static size_t directory_index_root_limit(size_t block_size)
+{
+    return (block_size - directory_index_root_info_offset - sizeof(ext2_dx_root_info)) / sizeof(ext2_dx_entry);
+}
+
+static size_t directory_index_node_limit(size_t block_size)
+{
+    return (block_size - directory_index_node_entries_offset) / sizeof(ext2_dx_entry);
+}
+
+static ext2_dir_entry_2& directory_record_at(ByteBuffer& block, size_t offset)
+{
+    return *reinterpret_cast<ext2_dir_entry_2*>(block.data() + offset);
+}
+
+template<typename Callback>
+static KResult for_each_directory_record(ByteBuffer& block, Callback callback)
+{
+    size_t offset = 0;
+    while (offset < block.size()) {
+        if (block.size() - offset < 8)
+            return KResult(-EIO);
+        auto& record = directory_record_at(block, offset);
+        if (record.rec_len < 8 || record.rec_len % 4 || record.rec_len > block.size() - offset || record.name_len + 8u > record.rec_len)
+            return KResult(-EIO);
+        if (callback(record, offset) == IterationDecision::Break)
+            break;
+        offset += record.rec_len;
+    }
+    return KSuccess;
+}
+
+static KResult insert_directory_record(ByteBuffer& block, const StringView& name, unsigned inode_index, u8 file_type)
+{
+    size_t needed_length = EXT2_DIR_REC_LEN(name.length());
+    Optional<size_t> slot_offset;
+    auto result = for_each_directory_record(block, [&](auto& record, size_t offset) {
+        size_t used_length = record.inode ? EXT2_DIR_REC_LEN(record.name_len) : 0;
+        if (record.rec_len - used_length >= needed_length) {
+            slot_offset = offset;
+            return IterationDecision::Break;
+        }
+        return IterationDecision::Continue;
+    });
+    if (result.is_error())
+        return result;
+    if (!slot_offset.has_value())
+        return KResult(-ENOSPC);
+
+    size_t offset = slot_offset.value();
+    size_t record_length = directory_record_at(block, offset).rec_len;
+    if (auto& record = directory_record_at(block, offset); record.inode) {
+        size_t used_length = EXT2_DIR_REC_LEN(record.name_len);
+        record.rec_len = used_length;
+        offset += used_length;
+        record_length -= used_length;
+    }
+
+    auto& record = directory_record_at(block, offset);
+    record.inode = inode_index;
+    record.rec_len = record_length;
+    record.name_len = name.length();
+    record.file_type = file_type;
+    memcpy(record.name, name.characters_without_null_termination(), name.length());
+    return KSuccess;
+}
+
+static void remove_directory_record(ByteBuffer& block, size_t offset, Optional<size_t> previous_offset)
+{
+    auto& record = directory_record_at(block, offset);
+    if (previous_offset.has_value())
+        directory_record_at(block, previous_offset.value()).rec_len += record.rec_len;
+    else
+        record.inode = 0;
+}
+
+// Lays out the given records (sorted by hash) in a fresh block, with the last one taking up the slack.
+static ByteBuffer pack_directory_records(ByteBuffer& source, const Vector<Ext2FSDirectoryRecord>& records, size_t begin, size_t end)
+{
+    auto block = ByteBuffer::create_zeroed(source.size());
+    size_t offset = 0;
+    for (size_t i = begin; i < end; ++i) {
+        auto& source_record = directory_record_at(source, records[i].offset);
+        memcpy(block.data() + offset, &source_record, 8 + source_record.name_len);
+        directory_record_at(block, offset).rec_len = i == end - 1 ? block.size() - offset : records[i].length;
+        offset += records[i].length;
+    }
+    if (begin == end)
+        directory_record_at(block, 0).rec_len = block.size();
+    return block;
+}
+
+// Splits records sorted by hash so that both halves take up about the same space, leaving at least one record on each side.
+static size_t directory_split_point(const Vector<Ext2FSDirectoryRecord>& records)
+{
+    ASSERT(records.size() >= 2);
+    size_t total_length = 0;
+    for (auto& record : records)
+        total_length += record.length;
+
+    size_t kept_length = 0;
+    for (size_t i = 1; i < records.size(); ++i) {
+        kept_length += records[i - 1].length;
+        if (kept_length + records[i].length > total_length / 2)
+            return i;
+    }
+    return records.size() - 1;
+}
+
+size_t Ext2FSInode::directory_block_count() const
+{
+    return size() / fs().block_size();
+}
+
+KResultOr<ByteBuffer> Ext2FSInode::read_directory_block(size_t block_index) const
+{
+    auto block_size = fs().block_size();
+    auto block = ByteBuffer::create_uninitialized(block_size);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(block.data());
+    ssize_t nread = read_bytes(block_index * block_size, block_size, buffer, nullptr);
+    if (nread < 0)
+        return KResult(nread);
+    if (static_cast<size_t>(nread) != block_size)
+        return KResult(-EIO);
+    return block;
+}
+
+KResult Ext2FSInode::write_directory_block(size_t block_index, ByteBuffer& block)
+{
+    auto block_size = fs().block_size();
+    ASSERT(block.size() == block_size);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(block.data());
+    ssize_t nwritten = write_bytes(block_index * block_size, block_size, buffer, nullptr);
+    if (nwritten < 0)
+        return KResult(nwritten);
+    if (static_cast<size_t>(nwritten) != block_size)
+        return KResult(-EIO);
+    return KSuccess;
+}
+
+KResultOr<size_t> Ext2FSInode::append_directory_block(ByteBuffer& block)
+{
+    size_t block_index = directory_block_count();
+    auto result = write_directory_block(block_index, block);
+    if (result.is_error())
+        return result;
+    return block_index;
+}
+
+KResultOr<Ext2FSInode::DirectoryEntryLocation> Ext2FSInode::find_directory_entry_in_block(size_t block_index, const StringView& name) const
+{
+    auto block_or_error = read_directory_block(block_index);
+    if (block_or_error.is_error())
+        return block_or_error.error();
+    auto block = block_or_error.release_value();
+
+    Optional<DirectoryEntryLocation> location;
+    Optional<size_t> previous_offset;
+    auto result = for_each_directory_record(block, [&](auto& record, size_t offset) {
+        if (record.inode != 0 && name == StringView(record.name, record.name_len)) {
+            location = DirectoryEntryLocation { block_index, offset, previous_offset, record.inode };
+            return IterationDecision::Break;
+        }
+        previous_offset = offset;
+        return IterationDecision::Continue;
+    });
+    if (result.is_error())
+        return result;
+    if (!location.has_value())
+        return KResult(-ENOENT);
+    return location.value();
+}
+
+KResultOr<Ext2FSInode::DirectoryEntryLocation> Ext2FSInode::find_directory_entry(const StringView& name) const
+{
+    LOCKER(m_lock);
+
+    if (has_directory_index()) {
+        // "." and ".." are kept in the root block and aren't part of the index.
+        if (name == "." || name == "..")
+            return find_directory_entry_in_block(0, name);
+
+        Ext2FSDirectoryIndexPath path;
+        if (!probe_directory_index(name, path).is_error()) {
+            for (;;) {
+                auto location = find_directory_entry_in_block(path.leaf_block_index(), name);
+                if (!location.is_error() || location.error() != -ENOENT)
+                    return location;
+                auto advanced = advance_directory_index(path);
+                if (advanced.is_error())
+                    break;
+                if (!advanced.value())
+                    return KResult(-ENOENT);
+            }
+        }
+        dbgln("Ext2FS: Directory index of inode {} is corrupt, falling back to a linear search", index());
+    }
+
+    for (size_t block_index = 0; block_index < directory_block_count(); ++block_index) {
+        auto location = find_directory_entry_in_block(block_index, name);
+        if (!location.is_error() || location.error() != -ENOENT)
+            return location;
+    }
+    return KResult(-ENOENT);
+}
+
+KResult Ext2FSInode::add_directory_entry(const StringView& name, unsigned inode_index, u8 file_type)
+{
+    LOCKER(m_lock);
+
+    if (has_directory_index()) {
+        auto added = add_indexed_directory_entry(name, inode_index, file_type);
+        if (added.is_error())
+            return added.error();
+        if (added.value())
+            return KSuccess;
+        dbgln("Ext2FS: Can't use the directory index of inode {}, dropping it", index());
+        drop_directory_index();
+    }
+
+    size_t block_count = directory_block_count();
+    for (size_t block_index = 0; block_index < block_count; ++block_index) {
+        auto block_or_error = read_directory_block(block_index);
+        if (block_or_error.is_error())
+            return block_or_error.error();
+        auto block = block_or_error.release_value();
+        auto result = insert_directory_record(block, name, inode_index, file_type);
+        if (!result.is_error())
+            return write_directory_block(block_index, block);
+        if (result != -ENOSPC)
+            return result;
+    }
+
+    // Like ext3, we start indexing a directory once it outgrows its first block.
+    if (block_count == 1 && (fs().super_block().s_feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX) && !has_directory_index()) {
+        auto built = build_directory_index();
+        if (built.is_error())
+            return built.error();
+        if (built.value()) {
+            auto added = add_indexed_directory_entry(name, inode_index, file_type);
+            if (added.is_error())
+                return added.error();
+            if (added.value())
+                return KSuccess;
+            drop_directory_index();
+        }
+    }
+
+    auto block = ByteBuffer::create_zeroed(fs().block_size());
+    directory_record_at(block, 0).rec_len = block.size();
+    auto result = insert_directory_record(block, name, inode_index, file_type);
+    ASSERT(result.is_success());
+    auto appended = append_directory_block(block);
+    if (appended.is_error())
+        return appended.error();
+    return KSuccess;
+}
+
+bool Ext2FSInode::has_directory_index() const
+{
+    return (m_raw_inode.i_flags & EXT2_INDEX_FL) && (fs().super_block().s_feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX);
+}
+
+void Ext2FSInode::drop_directory_index()
+{
+    // The index blocks look like empty directory blocks, so the directory stays valid without the flag.
+    m_raw_inode.i_flags &= ~EXT2_INDEX_FL;
+    set_metadata_dirty(true);
+}
+
+KResult Ext2FSInode::probe_directory_index(const StringView& name, Ext2FSDirectoryIndexPath& path) const
+{
+    auto block_size = fs().block_size();
+    size_t block_count = directory_block_count();
+
+    auto root_or_error = read_directory_block(0);
+    if (root_or_error.is_error())
+        return root_or_error.error();
+
+    Ext2FSDirectoryIndexFrame frame;
+    frame.block = root_or_error.release_value();
+    auto& info = *reinterpret_cast<ext2_dx_root_info*>(frame.block.data() + directory_index_root_info_offset);
+    if (info.reserved_zero != 0 || info.hash_version > EXT2_HASH_TEA || info.info_length != sizeof(ext2_dx_root_info)
+        || info.indirect_levels >= max_directory_index_levels || (info.unused_flags & EXT2_HASH_FLAG_INCOMPAT))
+        return KResult(-EIO);
+
+    path.hash_version = info.hash_version;
+    path.hash = fs().directory_hash(name, info.hash_version);
+    size_t levels = info.indirect_levels + 1;
+    frame.entries_offset = directory_index_root_info_offset + info.info_length;
+    size_t expected_limit = directory_index_root_limit(block_size);
+
+    for (;;) {
+        if (frame.limit() != expected_limit || frame.count() == 0 || frame.count() > frame.limit())
+            return KResult(-EIO);
+
+        // Find the last entry whose hash isn't above ours.
+        size_t low = 1;
+        size_t high = frame.count() - 1;
+        while (low <= high) {
+            size_t middle = (low + high) / 2;
+            if (frame.hash_at(middle) > path.hash)
+                high = middle - 1;
+            else
+                low = middle + 1;
+        }
+        frame.position = low - 1;
+
+        size_t next_block_index = frame.block_at(frame.position);
+        if (next_block_index == 0 || next_block_index >= block_count)
+            return KResult(-EIO);
+        path.frames.append(move(frame));
+        if (path.frames.size() == levels)
+            return KSuccess;
+
+        auto node_or_error = read_directory_block(next_block_index);
+        if (node_or_error.is_error())
+            return node_or_error.error();
+        frame = {};
+        frame.block_index = next_block_index;
+        frame.block = node_or_error.release_value();
+        frame.entries_offset = directory_index_node_entries_offset;
+        expected_limit = directory_index_node_limit(block_size);
+    }
+}
+
+// Moves on to the next leaf if the entries we're looking for may continue there because of a hash collision.
+KResultOr<bool> Ext2FSInode::advance_directory_index(Ext2FSDirectoryIndexPath& path) const
+{
+    auto& frames = path.frames;
+    size_t level = frames.size();
+    while (level > 0 && frames[level - 1].position + 1 >= frames[level - 1].count())
+        --level;
+    if (level == 0)
+        return false;
+
+    auto& frame = frames[level - 1];
+    ++frame.position;
+    if ((frame.hash_at(frame.position) & ~1u) != path.hash)
+        return false;
+
+    for (; level < frames.size(); ++level) {
+        auto& parent = frames[level - 1];
+        size_t block_index = parent.block_at(parent.position);
+        if (block_index == 0 || block_index >= directory_block_count())
+            return KResult(-EIO);
+        auto node_or_error = read_directory_block(block_index);
+        if (node_or_error.is_error())
+            return node_or_error.error();
+        auto& node = frames[level];
+        node.block_index = block_index;
+        node.block = node_or_error.release_value();
+        node.position = 0;
+        if (node.limit() != directory_index_node_limit(fs().block_size()) || node.count() == 0 || node.count() > node.limit())
+            return KResult(-EIO);
+    }
+    return true;
+}
+
+KResult Ext2FSInode::collect_directory_records(ByteBuffer& block, size_t records_to_skip, u8 hash_version, Vector<Ext2FSDirectoryRecord>& records) const
+{
+    return for_each_directory_record(block, [&](auto& record, size_t offset) {
+        if (records_to_skip) {
+            --records_to_skip;
+            return IterationDecision::Continue;
+        }
+        if (record.inode != 0) {
+            u32 hash = fs().directory_hash({ record.name, record.name_len }, hash_version);
+            records.append({ hash, offset, static_cast<size_t>(EXT2_DIR_REC_LEN(record.name_len)) });
+        }
+        return IterationDecision::Continue;
+    });
+}
+
+// Returns false if the entry can't go through the index, in which case the caller should drop it.
+KResultOr<bool> Ext2FSInode::add_indexed_directory_entry(const StringView& name, unsigned inode_index, u8 file_type)
+{
+    Ext2FSDirectoryIndexPath path;
+    if (probe_directory_index(name, path).is_error())
+        return false;
+
+    size_t leaf_index = path.leaf_block_index();
+    auto leaf_or_error = read_directory_block(leaf_index);
+    if (leaf_or_error.is_error())
+        return leaf_or_error.error();
+    auto leaf = leaf_or_error.release_value();
+
+    auto result = insert_directory_record(leaf, name, inode_index, file_type);
+    if (result.is_success()) {
+        result = write_directory_block(leaf_index, leaf);
+        if (result.is_error())
+            return result;
+        return true;
+    }
+    if (result != -ENOSPC)
+        return false;
+
+    // The leaf is full, so split it in two around the median hash.
+    auto made_room = make_room_in_directory_index(path);
+    if (made_room.is_error() || !made_room.value())
+        return made_room;
+
+    Vector<Ext2FSDirectoryRecord> records;
+    if (collect_directory_records(leaf, 0, path.hash_version, records).is_error() || records.size() < 2)
+        return false;
+    quick_sort(records, [](auto& a, auto& b) { return a.hash < b.hash; });
+
+    size_t split = directory_split_point(records);
+    u32 split_hash = records[split].hash;
+    // Tell lookups to keep going into the new block if the split falls between colliding hashes.
+    bool continued = records[split - 1].hash == split_hash;
+
+    auto lower_leaf = pack_directory_records(leaf, records, 0, split);
+    auto upper_leaf = pack_directory_records(leaf, records, split, records.size());
+    auto upper_leaf_index = append_directory_block(upper_leaf);
+    if (upper_leaf_index.is_error())
+        return upper_leaf_index.error();
+    result = write_directory_block(leaf_index, lower_leaf);
+    if (result.is_error())
+        return result;
+
+    auto& parent = path.frames.last();
+    parent.insert(parent.position + 1, split_hash | continued, upper_leaf_index.value());
+    result = write_directory_block(parent.block_index, parent.block);
+    if (result.is_error())
+        return result;
+
+    bool goes_in_upper_leaf = path.hash >= split_hash;
+    auto& target_leaf = goes_in_upper_leaf ? upper_leaf : lower_leaf;
+    if (insert_directory_record(target_leaf, name, inode_index, file_type).is_error())
+        return false;
+    result = write_directory_block(goes_in_upper_leaf ? upper_leaf_index.value() : leaf_index, target_leaf);
+    if (result.is_error())
+        return result;
+    return true;
+}
+
+// Makes sure the index node above the leaf in `path` has room for another entry, growing the tree if needed.
+KResultOr<bool> Ext2FSInode::make_room_in_directory_index(Ext2FSDirectoryIndexPath& path)
+{
+    auto& frames = path.frames;
+    if (frames.last().count() < frames.last().limit())
+        return true;
+
+    auto block_size = fs().block_size();
+    auto node = ByteBuffer::create_zeroed(block_size);
+    directory_record_at(node, 0).rec_len = block_size;
+    auto& node_count_limit = *reinterpret_cast<ext2_dx_countlimit*>(node.data() + directory_index_node_entries_offset);
+    auto* node_entries = reinterpret_cast<ext2_dx_entry*>(node.data() + directory_index_node_entries_offset);
+
+    if (frames.size() == 1) {
+        // The root is full, so move all of its entries into a new node below it.
+        auto& root = frames[0];
+        size_t count = root.count();
+        memcpy(node_entries, root.entries(), count * sizeof(ext2_dx_entry));
+        node_count_limit.limit = directory_index_node_limit(block_size);
+        node_count_limit.count = count;
+        auto node_index = append_directory_block(node);
+        if (node_index.is_error())
+            return node_index.error();
+
+        root.count_limit().count = 1;
+        root.entries()[0].block = node_index.value();
+        reinterpret_cast<ext2_dx_root_info*>(root.block.data() + directory_index_root_info_offset)->indirect_levels = 1;
+        auto result = write_directory_block(0, root.block);
+        if (result.is_error())
+            return result;
+
+        Ext2FSDirectoryIndexFrame frame;
+        frame.block_index = node_index.value();
+        frame.block = node;
+        frame.entries_offset = directory_index_node_entries_offset;
+        frame.position = root.position;
+        root.position = 0;
+        frames.append(move(frame));
+        return true;
+    }
+
+    auto& parent = frames[frames.size() - 2];
+    if (parent.count() >= parent.limit())
+        return false;
+
+    // Move the upper half of the full node into a new node next to it.
+    auto& full_node = frames.last();
+    size_t kept_count = full_node.count() / 2;
+    size_t moved_count = full_node.count() - kept_count;
+    u32 split_hash = full_node.hash_at(kept_count);
+    memcpy(node_entries, &full_node.entries()[kept_count], moved_count * sizeof(ext2_dx_entry));
+    node_count_limit.limit = directory_index_node_limit(block_size);
+    node_count_limit.count = moved_count;
+    auto node_index = append_directory_block(node);
+    if (node_index.is_error())
+        return node_index.error();
+
+    full_node.count_limit().count = kept_count;
+    auto result = write_directory_block(full_node.block_index, full_node.block);
+    if (result.is_error())
+        return result;
+    parent.insert(parent.position + 1, split_hash, node_index.value());
+    result = write_directory_block(parent.block_index, parent.block);
+    if (result.is_error())
+        return result;
+
+    if (full_node.position >= kept_count) {
+        full_node.block_index = node_index.value();
+        full_node.block = node;
+        full_node.position -= kept_count;
+        ++parent.position;
+    }
+    return true;
+}
+
+// Turns a directory that has outgrown its single block into an indexed one with two leaves.
+KResultOr<bool> Ext2FSInode::build_directory_index()
+{
+    ASSERT(!has_directory_index());
+    ASSERT(directory_block_count() == 1);
+
+    auto block_size = fs().block_size();
+    auto old_root_or_error = read_directory_block(0);
+    if (old_root_or_error.is_error())
+        return old_root_or_error.error();
+    auto old_root = old_root_or_error.release_value();
+
+    auto& dot = directory_record_at(old_root, 0);
+    auto& dot_dot = directory_record_at(old_root, 12);
+    if (dot.rec_len != 12 || dot.name_len != 1 || dot.name[0] != '.')
+        return false;
+    if (dot_dot.name_len != 2 || dot_dot.name[0] != '.' || dot_dot.name[1] != '.')
+        return false;
+
+    u8 hash_version = fs().super_block().s_def_hash_version;
+    if (hash_version > EXT2_HASH_TEA)
+        hash_version = EXT2_HASH_HALF_MD4;
+
+    Vector<Ext2FSDirectoryRecord> records;
+    auto result = collect_directory_records(old_root, 2, hash_version, records);
+    if (result.is_error())
+        return result;
+    if (records.size() < 2)
+        return false;
+    quick_sort(records, [](auto& a, auto& b) { return a.hash < b.hash; });
+
+    size_t split = directory_split_point(records);
+    u32 split_hash = records[split].hash;
+    bool continued = records[split - 1].hash == split_hash;
+
+    auto lower_leaf = pack_directory_records(old_root, records, 0, split);
+    auto upper_leaf = pack_directory_records(old_root, records, split, records.size());
+    auto lower_leaf_index = append_directory_block(lower_leaf);
+    if (lower_leaf_index.is_error())
+        return lower_leaf_index.error();
+    auto upper_leaf_index = append_directory_block(upper_leaf);
+    if (upper_leaf_index.is_error())
+        return upper_leaf_index.error();
+
+    auto root = ByteBuffer::create_zeroed(block_size);
+    memcpy(root.data(), &dot, 8 + dot.name_len);
+    directory_record_at(root, 0).rec_len = 12;
+    memcpy(root.data() + 12, &dot_dot, 8 + dot_dot.name_len);
+    directory_record_at(root, 12).rec_len = block_size - 12;
+
+    auto& info = *reinterpret_cast<ext2_dx_root_info*>(root.data() + directory_index_root_info_offset);
+    info.hash_version = hash_version;
+    info.info_length = sizeof(ext2_dx_root_info);
+
+    Ext2FSDirectoryIndexFrame frame;
+    frame.block = root;
+    frame.entries_offset = directory_index_root_info_offset + sizeof(ext2_dx_root_info);
+    frame.count_limit().limit = directory_index_root_limit(block_size);
+    frame.count_limit().count = 1;
+    frame.entries()[0].block = lower_leaf_index.value();
+    frame.insert(1, split_hash | continued, upper_leaf_index.value());
+
+    result = write_directory_block(0, root);
+    if (result.is_error())
+        return result;
+
+    m_raw_inode.i_flags |= EXT2_INDEX_FL;
+    set_metadata_dirty(true);
+    return true;
+}
+
 KResultOr<NonnullRefPtr<Inode>> Ext2FSInode::create_child(const String& name, mode_t mode, dev_t dev, uid_t uid, gid_t gid)
 {
     if (mode & S_IFDIR)
@@ -1034,35 +1854,29 @@ KResult Ext2FSInode::add_child(Inode& child, const StringView& name, mode_t mode
     dbgln("Ext2FSInode::add_child: Adding inode {} with name '{}' and mode {:o} to directory {}", child.index(), name, mode, index());
 #endif
 
-    Vector<Ext2FSDirectoryEntry> entries;
-    bool name_already_exists = false;
-    KResult result = traverse_as_directory([&](auto& entry) {
-        if (name == entry.name) {
-            name_already_exists = true;
-            return false;
-        }
-        entries.append({ entry.name, entry.inode, entry.file_type });
-        return true;
-    });
-
-    if (result.is_error())
-        return result;
-
-    if (name_already_exists) {
+    auto existing_entry = find_directory_entry(name);
+    if (!existing_entry.is_error()) {
         dbgln("Ext2FSInode::add_child: Name '{}' already exists in inode {}", name, index());
         return KResult(-EEXIST);
     }
+    if (existing_entry.error() != -ENOENT)
+        return existing_entry.error();
 
-    result = child.increment_link_count();
+    KResult result = child.increment_link_count();
     if (result.is_error())
         return result;
 
-    entries.empend(name, child.identifier(), to_ext2_file_type(mode));
-    bool success = write_directory(entries);
-    if (success)
+    result = add_directory_entry(name, child.index(), to_ext2_file_type(mode));
+    if (result.is_error()) {
+        (void)child.decrement_link_count();
+        return result;
+    }
+
+    // Only keep the lookup cache up to date if something has populated it already.
+    if (!m_lookup_cache.is_empty())
         m_lookup_cache.set(name, child.index());
 
-    did_add_child(child.identifier());
+    did_add_child(child.identifier(), name);
     return KSuccess;
 }
 
@@ -1074,40 +1888,36 @@ KResult Ext2FSInode::remove_child(const StringView& name)
 #endif
     ASSERT(is_directory());
 
-    auto it = m_lookup_cache.find(name);
-    if (it == m_lookup_cache.end())
-        return KResult(-ENOENT);
-    auto child_inode_index = (*it).value;
+    auto location_or_error = find_directory_entry(name);
+    if (location_or_error.is_error())
+        return location_or_error.error();
+    auto& location = location_or_error.value();
 
-    InodeIdentifier child_id { fsid(), child_inode_index };
+    InodeIdentifier child_id { fsid(), location.inode_index };
 
 #ifdef EXT2_DEBUG
     dbgln("Ext2FSInode::remove_child(): Removing '{}' in directory {}", name, index());
 #endif
 
-    Vector<Ext2FSDirectoryEntry> entries;
-    KResult result = traverse_as_directory([&](auto& entry) {
-        if (name != entry.name)
-            entries.append({ entry.name, entry.inode, entry.file_type });
-        return true;
-    });
+    auto block_or_error = read_directory_block(location.block_index);
+    if (block_or_error.is_error())
+        return block_or_error.error();
+    auto block = block_or_error.release_value();
+    remove_directory_record(block, location.offset, location.previous_offset);
+    KResult result = write_directory_block(location.block_index, block);
     if (result.is_error())
         return result;
 
-    bool success = write_directory(entries);
-    if (!success) {
-        // FIXME: Plumb error from write_directory().
-        return KResult(-EIO);
-    }
-
     m_lookup_cache.remove(name);
+    // This drops the directory entry cache's reference to the child, which
+    // has to happen before we look at whether the child is still in use.
+    did_remove_child(child_id, name);
 
     auto child_inode = fs().get_inode(child_id);
     result = child_inode->decrement_link_count();
     if (result.is_error())
         return result;
 
-    did_remove_child(child_id);
     return KSuccess;
 }
 
@@ -1556,6 +2366,12 @@ bool Ext2FSInode::populate_lookup_cache() const
 RefPtr<Inode> Ext2FSInode::lookup(StringView name)
 {
     ASSERT(is_directory());
+    if (has_directory_index()) {
+        auto location = find_directory_entry(name);
+        if (location.is_error())
+            return {};
+        return fs().get_inode({ fsid(), location.value().inode_index });
+    }
     if (!populate_lookup_cache())
         return {};
     LOCKER(m_lock);
@@ -1635,6 +2451,17 @@ KResultOr<size_t> Ext2FSInode::directory_entry_count() const
 {
     ASSERT(is_directory());
     LOCKER(m_lock);
+    if (has_directory_index()) {
+        // Indexed directories can be huge, don't pull all of them into the lookup cache just to count them.
+        size_t count = 0;
+        auto result = traverse_as_directory([&](auto&) {
+            ++count;
+            return true;
+        });
+        if (result.is_error())
+            return result;
+        return count;
+    }
     populate_lookup_cache();
     return m_lookup_cache.size();
 }
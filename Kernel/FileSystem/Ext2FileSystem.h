@@ -28,6 +28,7 @@
 
 #include <AK/Bitmap.h>
 #include <AK/HashMap.h>
+#include <AK/Optional.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/ext2_fs.h>
@@ -42,6 +43,8 @@ namespace Kernel {
 
 class Ext2FS;
 struct Ext2FSDirectoryEntry;
+struct Ext2FSDirectoryIndexPath;
+struct Ext2FSDirectoryRecord;
 
 class Ext2FSInode final : public Inode {
     friend class Ext2FS;
@@ -59,6 +62,7 @@ public:
 private:
     // ^Inode
     virtual ssize_t read_bytes(off_t, ssize_t, UserOrKernelBuffer& buffer, FileDescription*) const override;
+    virtual void read_ahead(off_t, size_t) const override;
     virtual InodeMetadata metadata() const override;
     virtual KResult traverse_as_directory(Function<bool(const FS::DirectoryEntryView&)>) const override;
     virtual RefPtr<Inode> lookup(StringView name) override;
@@ -79,6 +83,30 @@ private:
 
     bool write_directory(const Vector<Ext2FSDirectoryEntry>&);
     bool populate_lookup_cache() const;
+
+    struct DirectoryEntryLocation {
+        size_t block_index { 0 };
+        size_t offset { 0 };
+        Optional<size_t> previous_offset;
+        unsigned inode_index { 0 };
+    };
+
+    size_t directory_block_count() const;
+    KResultOr<ByteBuffer> read_directory_block(size_t block_index) const;
+    KResult write_directory_block(size_t block_index, ByteBuffer&);
+    KResultOr<size_t> append_directory_block(ByteBuffer&);
+    KResultOr<DirectoryEntryLocation> find_directory_entry(const StringView& name) const;
+    KResultOr<DirectoryEntryLocation> find_directory_entry_in_block(size_t block_index, const StringView& name) const;
+    KResult add_directory_entry(const StringView& name, unsigned inode_index, u8 file_type);
+
+    bool has_directory_index() const;
+    void drop_directory_index();
+    KResult probe_directory_index(const StringView& name, Ext2FSDirectoryIndexPath&) const;
+    KResultOr<bool> advance_directory_index(Ext2FSDirectoryIndexPath&) const;
+    KResult collect_directory_records(ByteBuffer&, size_t records_to_skip, u8 hash_version, Vector<Ext2FSDirectoryRecord>&) const;
+    KResultOr<bool> add_indexed_directory_entry(const StringView& name, unsigned inode_index, u8 file_type);
+    KResultOr<bool> make_room_in_directory_index(Ext2FSDirectoryIndexPath&);
+    KResultOr<bool> build_directory_index();
     KResult resize(u64);
 
     static u8 file_type_for_directory_entry(const ext2_dir_entry_2&);
@@ -109,6 +137,7 @@ public:
     virtual KResult prepare_to_unmount() const override;
 
     virtual bool supports_watchers() const override { return true; }
+    virtual bool supports_directory_entry_cache() const override { return true; }
 
     virtual u8 internal_file_type_to_directory_entry_type(const DirectoryEntryView& entry) const override;
 
@@ -129,6 +158,7 @@ private:
     unsigned inode_size() const;
 
     bool write_ext2_inode(InodeIndex, const ext2_inode&);
+    u32 directory_hash(const StringView& name, u8 hash_version) const;
     bool find_block_containing_inode(InodeIndex inode, BlockIndex& block_index, unsigned& offset) const;
 
     bool flush_super_block();
@@ -65,6 +65,16 @@ public:
         });
     }
 
+    void description_will_be_destroyed(const FileDescription& description)
+    {
+        ScopedSpinLock lock(m_lock);
+        do_unblock([&](auto& b, void*, bool&) {
+            ASSERT(b.blocker_type() == Thread::Blocker::Type::File);
+            auto& blocker = static_cast<Thread::FileBlocker&>(b);
+            return blocker.description_will_be_destroyed(description);
+        });
+    }
+
 private:
     File& m_file;
 };
@@ -135,6 +145,7 @@ public:
     virtual bool is_block_device() const { return false; }
     virtual bool is_character_device() const { return false; }
     virtual bool is_socket() const { return false; }
+    virtual bool is_epoll() const { return false; }
 
     virtual FileBlockCondition& block_condition() { return m_block_condition; }
 
@@ -82,6 +82,8 @@ FileDescription::FileDescription(File& file)
 
 FileDescription::~FileDescription()
 {
+    // Anything still watching us (like an epoll set) has to let go first.
+    block_condition().description_will_be_destroyed(*this);
     m_file->detach(*this);
     if (is_fifo())
         static_cast<FIFO*>(m_file.ptr())->detach(m_fifo_direction);
@@ -32,6 +32,7 @@
 #include <Kernel/FileSystem/FIFO.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeMetadata.h>
+#include <Kernel/FileSystem/ReadaheadState.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/VirtualAddress.h>
@@ -139,6 +140,14 @@ public:
 
     FileBlockCondition& block_condition();
 
+    ReadaheadState& readahead_state()
+    {
+        // Allocated on first use, since FileDescription has to fit in a slab.
+        if (!m_readahead_state)
+            m_readahead_state = make<ReadaheadState>();
+        return *m_readahead_state;
+    }
+
 private:
     friend class VFS;
     explicit FileDescription(File&);
@@ -158,6 +167,8 @@ private:
 
     OwnPtr<FileDescriptionData> m_data;
 
+    OwnPtr<ReadaheadState> m_readahead_state;
+
     u32 m_file_flags { 0 };
 
     bool m_readable : 1 { false };
@@ -60,6 +60,9 @@ public:
     virtual const char* class_name() const = 0;
     virtual NonnullRefPtr<Inode> root_inode() const = 0;
     virtual bool supports_watchers() const { return false; }
+    // Only filesystems that report every change to a directory through Inode::did_add_child()
+    // and did_remove_child() may have their lookups cached by the DirectoryEntryCache.
+    virtual bool supports_directory_entry_cache() const { return false; }
 
     bool is_readonly() const { return m_readonly; }
 
@@ -30,6 +30,7 @@
 #include <AK/StringView.h>
 #include <Kernel/API/InodeWatcherEvent.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
@@ -249,17 +250,21 @@ void Inode::set_metadata_dirty(bool metadata_dirty)
     }
 }
 
-void Inode::did_add_child(const InodeIdentifier& child_id)
+void Inode::did_add_child(const InodeIdentifier& child_id, const StringView& name)
 {
     LOCKER(m_lock);
+    if (fs().supports_directory_entry_cache())
+        DirectoryEntryCache::the().invalidate(identifier(), name, child_id);
     for (auto& watcher : m_watchers) {
         watcher->notify_child_added({}, child_id);
     }
 }
 
-void Inode::did_remove_child(const InodeIdentifier& child_id)
+void Inode::did_remove_child(const InodeIdentifier& child_id, const StringView& name)
 {
     LOCKER(m_lock);
+    if (fs().supports_directory_entry_cache())
+        DirectoryEntryCache::the().invalidate(identifier(), name, child_id);
     for (auto& watcher : m_watchers) {
         watcher->notify_child_removed({}, child_id);
     }
@@ -73,6 +73,7 @@ public:
     virtual void detach(FileDescription&) { }
     virtual void did_seek(FileDescription&, off_t) { }
     virtual ssize_t read_bytes(off_t, ssize_t, UserOrKernelBuffer& buffer, FileDescription*) const = 0;
+    virtual void read_ahead(off_t, size_t) const { }
     virtual KResult traverse_as_directory(Function<bool(const FS::DirectoryEntryView&)>) const = 0;
     virtual RefPtr<Inode> lookup(StringView name) = 0;
     virtual ssize_t write_bytes(off_t, ssize_t, const UserOrKernelBuffer& data, FileDescription*) = 0;
@@ -131,8 +132,8 @@ protected:
     void inode_size_changed(size_t old_size, size_t new_size);
     KResult prepare_to_write_data();
 
-    void did_add_child(const InodeIdentifier&);
-    void did_remove_child(const InodeIdentifier&);
+    void did_add_child(const InodeIdentifier& child_id, const StringView& name);
+    void did_remove_child(const InodeIdentifier& child_id, const StringView& name);
 
     mutable Lock m_lock { "Inode" };
 
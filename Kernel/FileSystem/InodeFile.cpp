@@ -46,6 +46,12 @@ InodeFile::~InodeFile()
 
 KResultOr<size_t> InodeFile::read(FileDescription& description, size_t offset, UserOrKernelBuffer& buffer, size_t count)
 {
+    if (!description.is_direct()) {
+        auto readahead = description.readahead_state().did_access(offset, count);
+        if (readahead.size)
+            m_inode->read_ahead(readahead.offset, readahead.size);
+    }
+
     ssize_t nread = m_inode->read_bytes(offset, count, buffer, &description);
     if (nread > 0) {
         Thread::current()->did_file_read(nread);
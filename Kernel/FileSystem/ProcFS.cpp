@@ -489,6 +489,7 @@ static bool procfs$net_adapters(InodeIdentifier, KBufferBuilder& builder)
         obj.add("bytes_in", adapter.bytes_in());
         obj.add("packets_out", adapter.packets_out());
         obj.add("bytes_out", adapter.bytes_out());
+        obj.add("packets_dropped", adapter.packets_dropped());
         obj.add("link_up", adapter.link_up());
         obj.add("mtu", adapter.mtu());
     });
@@ -525,6 +526,12 @@ static bool procfs$net_tcp(InodeIdentifier, KBufferBuilder& builder)
         obj.add("bytes_in", socket.bytes_in());
         obj.add("packets_out", socket.packets_out());
         obj.add("bytes_out", socket.bytes_out());
+        obj.add("congestion_window", socket.congestion_window());
+        obj.add("slow_start_threshold", socket.slow_start_threshold());
+        obj.add("send_window", socket.send_window());
+        obj.add("smoothed_rtt_us", socket.smoothed_rtt_in_microseconds());
+        obj.add("retransmission_timeout_us", socket.retransmission_timeout_in_microseconds());
+        obj.add("retransmissions", socket.retransmissions());
     });
     array.finish();
     return true;
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+#include <Kernel/UnixTypes.h>
+
+namespace Kernel {
+
+// Detects sequential access to a file (or a file mapping) and tells the
+// caller how much to read ahead. The window starts small and doubles with
+// every sequential access, and collapses as soon as the access pattern
+// turns random.
+class ReadaheadState {
+public:
+    static constexpr size_t initial_window = 16 * KiB;
+    static constexpr size_t max_window = 256 * KiB;
+
+    struct Range {
+        off_t offset { 0 };
+        size_t size { 0 };
+    };
+
+    // Returns the range that should be brought in ahead of time, which is
+    // empty if there is nothing (more) to read ahead.
+    Range did_access(off_t offset, size_t size)
+    {
+        bool is_sequential = offset == m_next_offset || (offset == 0 && m_next_offset == -1);
+        m_next_offset = offset + size;
+        if (!is_sequential) {
+            m_window = 0;
+            m_read_ahead_until = 0;
+            return {};
+        }
+
+        m_window = m_window ? min(m_window * 2, max_window) : initial_window;
+
+        // Only issue more readahead once the reader has made its way through
+        // the first half of what we already read ahead, so that we read in
+        // large batches instead of topping up on every access.
+        off_t end = offset + size;
+        if (m_read_ahead_until >= end + (off_t)(m_window / 2))
+            return {};
+
+        off_t start = max(offset, m_read_ahead_until);
+        off_t new_end = end + m_window;
+        m_read_ahead_until = new_end;
+        return { start, (size_t)(new_end - start) };
+    }
+
+    size_t window() const { return m_window; }
+
+private:
+    off_t m_next_offset { -1 };
+    off_t m_read_ahead_until { 0 };
+    size_t m_window { 0 };
+};
+
+}
@@ -29,6 +29,7 @@
 #include <AK/StringBuilder.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/FileSystem/FileSystem.h>
@@ -121,6 +122,8 @@ KResult VFS::unmount(Inode& guest_inode)
     for (size_t i = 0; i < m_mounts.size(); ++i) {
         auto& mount = m_mounts.at(i);
         if (&mount.guest() == &guest_inode) {
+            // The cache holds on to inodes and custodies, which would keep the filesystem busy.
+            DirectoryEntryCache::the().invalidate_all();
             auto result = mount.guest_fs().prepare_to_unmount();
             if (result.is_error()) {
                 dbgln("VFS: Failed to unmount!");
@@ -1003,7 +1006,8 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path
         }
 
         // Okay, let's look up this part.
-        auto child_inode = parent.inode().lookup(part);
+        auto cached_lookup = DirectoryEntryCache::the().lookup(parent.inode(), part);
+        auto child_inode = move(cached_lookup.inode);
         if (!child_inode) {
             if (out_parent) {
                 // ENOENT with a non-null parent custody signals to caller that
@@ -1023,7 +1027,15 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path
             mount_flags_for_child = mount->flags();
         }
 
-        custody = Custody::create(&parent, part, *child_inode, mount_flags_for_child);
+        // Reuse the custody we handed out the last time this entry was resolved,
+        // as long as it was resolved the same way.
+        auto& cached_custody = cached_lookup.custody;
+        if (cached_custody && cached_custody->parent() == &parent && &cached_custody->inode() == child_inode && cached_custody->mount_flags() == mount_flags_for_child) {
+            custody = cached_custody.release_nonnull();
+        } else {
+            custody = Custody::create(&parent, part, *child_inode, mount_flags_for_child);
+            DirectoryEntryCache::the().remember_custody(custody);
+        }
 
         if (child_inode->metadata().is_symlink()) {
             if (!have_more_parts) {
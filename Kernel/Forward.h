@@ -41,6 +41,7 @@ class FutexQueue;
 class IPv4Socket;
 class Inode;
 class InodeIdentifier;
+class InodeVMObject;
 class SharedInodeVMObject;
 class InodeWatcher;
 class KBuffer;
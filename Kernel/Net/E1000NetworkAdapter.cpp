@@ -252,8 +252,12 @@ void E1000NetworkAdapter::handle_irq(const RegisterState&)
         u32 flags = in32(REG_CTRL);
         out32(REG_CTRL, flags | ECTRL_SLU);
     }
-    if (status & 0x80) {
-        receive();
+    if (status & (INTERRUPT_RXT0 | INTERRUPT_RXO)) {
+        // Don't pull packets off the ring here. Keep receive interrupts masked
+        // and let NetworkTask poll the ring until it's empty instead, so that
+        // a burst of packets doesn't cost us one interrupt each.
+        m_receive_interrupts_masked = true;
+        request_receive_poll();
     }
     if (status & 0x10) {
         // Threshold OK?
@@ -261,7 +265,23 @@ void E1000NetworkAdapter::handle_irq(const RegisterState&)
 
     m_wait_queue.wake_all();
 
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0 | INTERRUPT_RXO);
+    u32 interrupt_mask = INTERRUPT_LSC;
+    if (!m_receive_interrupts_masked)
+        interrupt_mask |= INTERRUPT_RXT0 | INTERRUPT_RXO;
+    out32(REG_INTERRUPT_MASK_SET, interrupt_mask);
+}
+
+size_t E1000NetworkAdapter::poll_receive(size_t budget)
+{
+    size_t received = receive(budget);
+    if (received < budget) {
+        // The ring is empty, go back to being interrupt driven.
+        m_receive_interrupts_masked = false;
+        out32(REG_INTERRUPT_MASK_SET, INTERRUPT_RXT0 | INTERRUPT_RXO);
+    } else {
+        request_receive_poll();
+    }
+    return received;
 }
 
 void E1000NetworkAdapter::detect_eeprom()
@@ -464,14 +484,15 @@ void E1000NetworkAdapter::send_raw(ReadonlyBytes payload)
 #endif
 }
 
-void E1000NetworkAdapter::receive()
+size_t E1000NetworkAdapter::receive(size_t budget)
 {
     auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
     u32 rx_current;
-    for (;;) {
+    size_t received = 0;
+    while (received < budget) {
         rx_current = in32(REG_RXDESCTAIL) % number_of_rx_descriptors;
         if (rx_current == (in32(REG_RXDESCHEAD) % number_of_rx_descriptors))
-            return;
+            break;
         rx_current = (rx_current + 1) % number_of_rx_descriptors;
         if (!(rx_descriptors[rx_current].status & 1))
             break;
@@ -484,7 +505,9 @@ void E1000NetworkAdapter::receive()
         did_receive({ buffer, length });
         rx_descriptors[rx_current].status = 0;
         out32(REG_RXDESCTAIL, rx_current);
+        ++received;
     }
+    return received;
 }
 
 }
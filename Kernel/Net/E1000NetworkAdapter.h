@@ -47,6 +47,7 @@ public:
 
     virtual void send_raw(ReadonlyBytes) override;
     virtual bool link_up() override;
+    virtual size_t poll_receive(size_t budget) override;
 
     virtual const char* purpose() const override { return class_name(); }
 
@@ -90,7 +91,7 @@ private:
     u16 in16(u16 address);
     u32 in32(u16 address);
 
-    void receive();
+    size_t receive(size_t budget);
 
     IOAddress m_io_base;
     VirtualAddress m_mmio_base;
@@ -102,6 +103,7 @@ private:
     u8 m_interrupt_line { 0 };
     bool m_has_eeprom { false };
     bool m_use_mmio { false };
+    Atomic<bool> m_receive_interrupts_masked { false };
     EntropySource m_entropy_source;
 
     static const size_t number_of_rx_descriptors = 32;
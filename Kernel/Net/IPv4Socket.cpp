@@ -195,9 +195,9 @@ int IPv4Socket::allocate_local_port_if_needed()
     return port;
 }
 
-KResultOr<size_t> IPv4Socket::sendto(FileDescription&, const UserOrKernelBuffer& data, size_t data_length, [[maybe_unused]] int flags, Userspace<const sockaddr*> addr, socklen_t addr_length)
+KResultOr<size_t> IPv4Socket::sendto(FileDescription& description, const UserOrKernelBuffer& data, size_t data_length, [[maybe_unused]] int flags, Userspace<const sockaddr*> addr, socklen_t addr_length)
 {
-    LOCKER(lock());
+    Locker locker(lock());
 
     if (addr && addr_length != sizeof(sockaddr_in))
         return KResult(-EINVAL);
@@ -238,10 +238,41 @@ KResultOr<size_t> IPv4Socket::sendto(FileDescription&, const UserOrKernelBuffer&
         return data_length;
     }
 
-    auto nsent_or_error = protocol_send(data, data_length);
-    if (!nsent_or_error.is_error())
-        Thread::current()->did_ipv4_socket_write(nsent_or_error.value());
-    return nsent_or_error;
+    size_t total_nsent = 0;
+    for (;;) {
+        auto nsent_or_error = protocol_send(data.offset(total_nsent), data_length - total_nsent);
+        if (nsent_or_error.is_error()) {
+            if (total_nsent)
+                break;
+            return nsent_or_error;
+        }
+        total_nsent += nsent_or_error.value();
+
+        // Stream protocols only take as much data as they have buffer space for,
+        // so a blocking send has to wait for room to free up.
+        if (total_nsent == data_length || type() != SOCK_STREAM)
+            break;
+        if (!description.is_blocking()) {
+            if (!total_nsent)
+                return KResult(-EAGAIN);
+            break;
+        }
+
+        locker.unlock();
+        auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        auto res = Thread::current()->block<Thread::WriteBlocker>({}, description, unblock_flags);
+        locker.lock();
+        if (res.was_interrupted()) {
+            if (!total_nsent)
+                return KResult(-EINTR);
+            break;
+        }
+        if (protocol_is_disconnected())
+            break;
+    }
+
+    Thread::current()->did_ipv4_socket_write(total_nsent);
+    return total_nsent;
 }
 
 KResultOr<size_t> IPv4Socket::receive_byte_buffered(FileDescription& description, UserOrKernelBuffer& buffer, size_t buffer_length, int, Userspace<sockaddr*>, Userspace<socklen_t*>)
@@ -273,6 +304,8 @@ KResultOr<size_t> IPv4Socket::receive_byte_buffered(FileDescription& description
         Thread::current()->did_ipv4_socket_read((size_t)nreceived);
 
     set_can_read(!m_receive_buffer.is_empty());
+    if (nreceived > 0)
+        protocol_did_consume_received_data();
     return nreceived;
 }
 
@@ -392,16 +425,17 @@ bool IPv4Socket::did_receive(const IPv4Address& source_address, u16 source_port,
     auto packet_size = packet.size();
 
     if (buffer_mode() == BufferMode::Bytes) {
+        auto scratch_buffer = UserOrKernelBuffer::for_kernel_buffer(m_scratch_buffer.value().data());
+        auto nreceived_or_error = protocol_receive(ReadonlyBytes { packet.data(), packet.size() }, scratch_buffer, m_scratch_buffer.value().size(), 0);
+        if (nreceived_or_error.is_error())
+            return false;
+        // Only the payload has to fit, the peer doesn't know about our packet headers when it fills up our advertised window.
         size_t space_in_receive_buffer = m_receive_buffer.space_for_writing();
-        if (packet_size > space_in_receive_buffer) {
+        if (nreceived_or_error.value() > space_in_receive_buffer) {
             dbgln("IPv4Socket({}): did_receive refusing packet since buffer is full.", this);
             ASSERT(m_can_read);
             return false;
         }
-        auto scratch_buffer = UserOrKernelBuffer::for_kernel_buffer(m_scratch_buffer.value().data());
-        auto nreceived_or_error = protocol_receive(ReadonlyBytes { packet.data(), packet.size() }, scratch_buffer, m_scratch_buffer.value().size(), 0);
-        if (nreceived_or_error.is_error())
-            return false;
         ssize_t nwritten = m_receive_buffer.write(scratch_buffer, nreceived_or_error.value());
         if (nwritten < 0)
             return false;
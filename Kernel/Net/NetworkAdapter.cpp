@@ -174,18 +174,23 @@ int NetworkAdapter::send_ipv4_fragmented(const MACAddress& destination_mac, cons
 
 void NetworkAdapter::did_receive(ReadonlyBytes payload)
 {
-    InterruptDisabler disabler;
+    ScopedSpinLock lock(m_packet_queue_lock);
     m_packets_in++;
     m_bytes_in += payload.size();
 
+    if (m_packet_queue.size() == m_packet_queue.capacity()) {
+        // NetworkTask isn't keeping up, so drop the packet like a NIC with a full ring would.
+        m_packets_dropped++;
+        return;
+    }
+
     Optional<KBuffer> buffer;
 
     if (m_unused_packet_buffers.is_empty()) {
         buffer = KBuffer::copy(payload.data(), payload.size());
     } else {
-        buffer = m_unused_packet_buffers.take_first();
-        --m_unused_packet_buffers_count;
-        if (payload.size() <= buffer.value().size()) {
+        buffer = m_unused_packet_buffers.take_last();
+        if (payload.size() <= buffer.value().capacity()) {
             memcpy(buffer.value().data(), payload.data(), payload.size());
             buffer.value().set_size(payload.size());
         } else {
@@ -193,28 +198,33 @@ void NetworkAdapter::did_receive(ReadonlyBytes payload)
         }
     }
 
-    m_packet_queue.append({ buffer.value(), kgettimeofday() });
+    m_packet_queue.enqueue({ buffer.release_value(), kgettimeofday() });
+    lock.unlock();
 
     if (on_receive)
         on_receive();
 }
 
-size_t NetworkAdapter::dequeue_packet(u8* buffer, size_t buffer_size, timeval& packet_timestamp)
+void NetworkAdapter::request_receive_poll()
 {
-    InterruptDisabler disabler;
+    m_receive_poll_requested = true;
+    if (on_receive)
+        on_receive();
+}
+
+Optional<NetworkAdapter::PacketWithTimestamp> NetworkAdapter::dequeue_packet()
+{
+    ScopedSpinLock lock(m_packet_queue_lock);
     if (m_packet_queue.is_empty())
-        return 0;
-    auto packet_with_timestamp = m_packet_queue.take_first();
-    packet_timestamp = packet_with_timestamp.timestamp;
-    auto packet = move(packet_with_timestamp.packet);
-    size_t packet_size = packet.size();
-    ASSERT(packet_size <= buffer_size);
-    memcpy(buffer, packet.data(), packet_size);
-    if (m_unused_packet_buffers_count < 100) {
-        m_unused_packet_buffers.append(packet);
-        ++m_unused_packet_buffers_count;
-    }
-    return packet_size;
+        return {};
+    return m_packet_queue.dequeue();
+}
+
+void NetworkAdapter::release_packet_buffer(KBuffer&& buffer)
+{
+    ScopedSpinLock lock(m_packet_queue_lock);
+    if (m_unused_packet_buffers.size() < max_unused_packet_buffers)
+        m_unused_packet_buffers.append(move(buffer));
 }
 
 void NetworkAdapter::set_ipv4_address(const IPv4Address& address)
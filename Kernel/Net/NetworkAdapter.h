@@ -26,10 +26,11 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
 #include <AK/ByteBuffer.h>
+#include <AK/CircularQueue.h>
 #include <AK/Function.h>
 #include <AK/MACAddress.h>
-#include <AK/SinglyLinkedList.h>
 #include <AK/Types.h>
 #include <AK/WeakPtr.h>
 #include <AK/Weakable.h>
@@ -37,6 +38,7 @@
 #include <Kernel/Net/ARP.h>
 #include <Kernel/Net/ICMP.h>
 #include <Kernel/Net/IPv4.h>
+#include <Kernel/SpinLock.h>
 #include <Kernel/UserOrKernelBuffer.h>
 
 namespace Kernel {
@@ -67,10 +69,24 @@ public:
     int send_ipv4(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
     int send_ipv4_fragmented(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
 
-    size_t dequeue_packet(u8* buffer, size_t buffer_size, timeval& packet_timestamp);
+    struct PacketWithTimestamp {
+        KBuffer packet;
+        timeval timestamp;
+    };
+
+    // Received packets are handed out without copying them. Once the caller is
+    // done with a packet, its buffer should be given back for reuse.
+    Optional<PacketWithTimestamp> dequeue_packet();
+    void release_packet_buffer(KBuffer&&);
 
     bool has_queued_packets() const { return !m_packet_queue.is_empty(); }
 
+    // Adapters that support polling (NAPI-style) leave their receive interrupts
+    // masked after requesting a poll, and only unmask them again once a poll
+    // comes up with less than the budget. Returns the number of frames received.
+    virtual size_t poll_receive(size_t /* budget */) { return 0; }
+    bool take_receive_poll_request() { return m_receive_poll_requested.exchange(false); }
+
     u32 mtu() const { return m_mtu; }
     void set_mtu(u32 mtu) { m_mtu = mtu; }
 
@@ -78,6 +94,7 @@ public:
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 packets_dropped() const { return m_packets_dropped; }
 
     Function<void()> on_receive;
 
@@ -87,6 +104,7 @@ protected:
     void set_mac_address(const MACAddress& mac_address) { m_mac_address = mac_address; }
     virtual void send_raw(ReadonlyBytes) = 0;
     void did_receive(ReadonlyBytes);
+    void request_receive_poll();
 
 private:
     MACAddress m_mac_address;
@@ -94,19 +112,19 @@ private:
     IPv4Address m_ipv4_netmask;
     IPv4Address m_ipv4_gateway;
 
-    struct PacketWithTimestamp {
-        KBuffer packet;
-        timeval timestamp;
-    };
+    static constexpr size_t receive_ring_size = 256;
+    static constexpr size_t max_unused_packet_buffers = 64;
 
-    SinglyLinkedList<PacketWithTimestamp> m_packet_queue;
-    SinglyLinkedList<KBuffer> m_unused_packet_buffers;
-    size_t m_unused_packet_buffers_count { 0 };
+    SpinLock<u8> m_packet_queue_lock;
+    CircularQueue<PacketWithTimestamp, receive_ring_size> m_packet_queue;
+    Vector<KBuffer, max_unused_packet_buffers> m_unused_packet_buffers;
+    Atomic<bool> m_receive_poll_requested { false };
     String m_name;
     u32 m_packets_in { 0 };
     u32 m_bytes_in { 0 };
     u32 m_packets_out { 0 };
     u32 m_bytes_out { 0 };
+    u32 m_packets_dropped { 0 };
     u32 m_mtu { 1500 };
 };
 
@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/NonnullRefPtrVector.h>
 #include <Kernel/Lock.h>
 #include <Kernel/Net/ARP.h>
 #include <Kernel/Net/EtherType.h>
@@ -39,6 +40,8 @@
 #include <Kernel/Net/UDP.h>
 #include <Kernel/Net/UDPSocket.h>
 #include <Kernel/Process.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/Time/TimeManagement.h>
 
 //#define NETWORK_TASK_DEBUG
 //#define ETHERNET_DEBUG
@@ -56,8 +59,28 @@ static void handle_ipv4(const EthernetFrameHeader&, size_t frame_size, const tim
 static void handle_icmp(const EthernetFrameHeader&, const IPv4Packet&, const timeval& packet_timestamp);
 static void handle_udp(const IPv4Packet&, const timeval& packet_timestamp);
 static void handle_tcp(const IPv4Packet&, const timeval& packet_timestamp);
+static void retransmit_tcp_packets();
+
+static void handle_ethernet_frame(ReadonlyBytes frame, const timeval& packet_timestamp);
 
 [[noreturn]] static void NetworkTask_main(void*);
+[[noreturn]] static void NetworkTask_receive_poller(void*);
+
+// How many packets we take off an adapter's receive ring before moving on to the next adapter.
+static constexpr size_t receive_batch_size = 64;
+
+// The protocol handlers and everything they touch (the ARP table, the socket
+// tables and the sockets themselves) assume that only NetworkTask runs them,
+// so packets are always processed on NetworkTask itself. On SMP machines,
+// draining the adapters' hardware receive rings into their packet queues is
+// moved to a thread per adapter instead, which can run alongside the protocol
+// processing on another CPU.
+struct ReceivePoller {
+    NonnullRefPtr<NetworkAdapter> adapter;
+    WaitQueue wait_queue;
+};
+
+static WaitQueue* s_packet_wait_queue;
 
 void NetworkTask::spawn()
 {
@@ -65,13 +88,23 @@ void NetworkTask::spawn()
     Process::create_kernel_process(thread, "NetworkTask", NetworkTask_main, nullptr);
 }
 
+void NetworkTask::retransmit_timer_armed()
+{
+    // NetworkTask may be sleeping without a timeout, wake it up so it starts checking the timers.
+    if (s_packet_wait_queue)
+        s_packet_wait_queue->wake_all();
+}
+
 void NetworkTask_main(void*)
 {
-    WaitQueue packet_wait_queue;
+    static WaitQueue packet_wait_queue;
+    s_packet_wait_queue = &packet_wait_queue;
+    bool use_receive_pollers = Processor::processor_count() > 1;
+    size_t receive_poller_count = 0;
     u8 octet = 15;
-    int pending_packets = 0;
     NetworkAdapter::for_each([&](auto& adapter) {
-        if (String(adapter.class_name()) == "LoopbackAdapter") {
+        bool is_loopback = String(adapter.class_name()) == "LoopbackAdapter";
+        if (is_loopback) {
             adapter.set_ipv4_address({ 127, 0, 0, 1 });
             adapter.set_ipv4_netmask({ 255, 0, 0, 0 });
             adapter.set_ipv4_gateway({ 0, 0, 0, 0 });
@@ -83,83 +116,130 @@ void NetworkTask_main(void*)
 
         klog() << "NetworkTask: " << adapter.class_name() << " network adapter found: hw=" << adapter.mac_address().to_string().characters() << " address=" << adapter.ipv4_address().to_string().characters() << " netmask=" << adapter.ipv4_netmask().to_string().characters() << " gateway=" << adapter.ipv4_gateway().to_string().characters();
 
-        adapter.on_receive = [&]() {
-            pending_packets++;
+        // The loopback adapter receives its packets as they are sent, there's no ring to poll.
+        if (!use_receive_pollers || is_loopback) {
+            adapter.on_receive = [&]() {
+                packet_wait_queue.wake_all();
+            };
+            return;
+        }
+
+        auto* poller = new ReceivePoller { adapter, {} };
+        adapter.on_receive = [&, poller]() {
+            poller->wait_queue.wake_all();
             packet_wait_queue.wake_all();
         };
+        Process::current()->create_kernel_thread(NetworkTask_receive_poller, poller, THREAD_PRIORITY_NORMAL, String::format("NetworkTask poller #%zu", receive_poller_count++), THREAD_AFFINITY_DEFAULT, false);
     });
 
-    auto dequeue_packet = [&pending_packets](u8* buffer, size_t buffer_size, timeval& packet_timestamp) -> size_t {
-        if (pending_packets == 0)
-            return 0;
-        size_t packet_size = 0;
+    // How often we check the TCP sockets for expired retransmission timers.
+    const timespec retransmit_interval { 0, 100 * 1000 * 1000 };
+    timespec next_retransmit_check = TimeManagement::the().monotonic_time();
+
+    klog() << "NetworkTask: Enter main loop with " << receive_poller_count << " receive poller(s).";
+    for (;;) {
+        bool has_retransmit_timers = TCPSocket::has_sockets_waiting_to_retransmit();
+        auto now = TimeManagement::the().monotonic_time();
+        if (has_retransmit_timers && now >= next_retransmit_check) {
+            retransmit_tcp_packets();
+            timespec_add(now, retransmit_interval, next_retransmit_check);
+        }
+
+        size_t packet_count = 0;
         NetworkAdapter::for_each([&](auto& adapter) {
-            if (packet_size || !adapter.has_queued_packets())
-                return;
-            packet_size = adapter.dequeue_packet(buffer, buffer_size, packet_timestamp);
-            pending_packets--;
+            // Without a poller thread, we poll the adapter ourselves. With one, the
+            // request stays pending until the poller takes it.
+            if (receive_poller_count == 0 && adapter.take_receive_poll_request())
+                adapter.poll_receive(receive_batch_size);
+
+            for (size_t i = 0; i < receive_batch_size; ++i) {
+                auto packet_with_timestamp = adapter.dequeue_packet();
+                if (!packet_with_timestamp.has_value())
+                    break;
 #ifdef NETWORK_TASK_DEBUG
-            klog() << "NetworkTask: Dequeued packet from " << adapter.name().characters() << " (" << packet_size << " bytes)";
+                klog() << "NetworkTask: Dequeued packet from " << adapter.name().characters() << " (" << packet_with_timestamp.value().packet.size() << " bytes)";
 #endif
+                auto& packet = packet_with_timestamp.value().packet;
+                handle_ethernet_frame({ packet.data(), packet.size() }, packet_with_timestamp.value().timestamp);
+                adapter.release_packet_buffer(move(packet));
+                ++packet_count;
+            }
         });
-        return packet_size;
-    };
 
-    size_t buffer_size = 64 * KiB;
-    auto buffer_region = MM.allocate_kernel_region(buffer_size, "Kernel Packet Buffer", Region::Access::Read | Region::Access::Write);
-    auto buffer = (u8*)buffer_region->vaddr().get();
-    timeval packet_timestamp;
+        if (packet_count)
+            continue;
 
-    klog() << "NetworkTask: Enter main loop.";
-    for (;;) {
-        size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
-        if (!packet_size) {
-            packet_wait_queue.wait_on({}, "NetworkTask");
+        // Don't wake up just to walk the sockets if none of them is waiting for an ACK.
+        // A socket that starts waiting wakes us through NetworkTask::retransmit_timer_armed().
+        if (!TCPSocket::has_sockets_waiting_to_retransmit()) {
+            [[maybe_unused]] auto result = packet_wait_queue.wait_on({}, "NetworkTask");
             continue;
         }
-        if (packet_size < sizeof(EthernetFrameHeader)) {
-            klog() << "NetworkTask: Packet is too small to be an Ethernet packet! (" << packet_size << ")";
+        timespec timeout = retransmit_interval;
+        [[maybe_unused]] auto result = packet_wait_queue.wait_on(Thread::BlockTimeout(false, &timeout), "NetworkTask");
+    }
+}
+
+void NetworkTask_receive_poller(void* data)
+{
+    auto& poller = *static_cast<ReceivePoller*>(data);
+    for (;;) {
+        // poll_receive() requests another poll if it used up the whole budget.
+        if (poller.adapter->take_receive_poll_request()) {
+            poller.adapter->poll_receive(receive_batch_size);
             continue;
         }
-        auto& eth = *(const EthernetFrameHeader*)buffer;
+        // We're the only one ever waiting on this queue, so a wakeup that comes
+        // in before we block is remembered by the queue and not lost.
+        [[maybe_unused]] auto result = poller.wait_queue.wait_on({}, "NetworkTask");
+    }
+}
+
+void handle_ethernet_frame(ReadonlyBytes frame, const timeval& packet_timestamp)
+{
+    size_t packet_size = frame.size();
+    if (packet_size < sizeof(EthernetFrameHeader)) {
+        klog() << "NetworkTask: Packet is too small to be an Ethernet packet! (" << packet_size << ")";
+        return;
+    }
+    auto& eth = *(const EthernetFrameHeader*)frame.data();
 #ifdef ETHERNET_DEBUG
-        dbgln("NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), packet_size);
+    dbgln("NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), packet_size);
 #endif
 
 #ifdef ETHERNET_VERY_DEBUG
-        for (size_t i = 0; i < packet_size; i++) {
-            klog() << String::format("%#02x", buffer[i]);
-
-            switch (i % 16) {
-            case 7:
-                klog() << "  ";
-                break;
-            case 15:
-                klog() << "";
-                break;
-            default:
-                klog() << " ";
-                break;
-            }
-        }
-
-        klog() << "";
-#endif
+    for (size_t i = 0; i < packet_size; i++) {
+        klog() << String::format("%#02x", frame[i]);
 
-        switch (eth.ether_type()) {
-        case EtherType::ARP:
-            handle_arp(eth, packet_size);
-            break;
-        case EtherType::IPv4:
-            handle_ipv4(eth, packet_size, packet_timestamp);
+        switch (i % 16) {
+        case 7:
+            klog() << "  ";
             break;
-        case EtherType::IPv6:
-            // ignore
+        case 15:
+            klog() << "";
             break;
         default:
-            klog() << "NetworkTask: Unknown ethernet type 0x" << String::format("%x", eth.ether_type());
+            klog() << " ";
+            break;
         }
     }
+
+    klog() << "";
+#endif
+
+    switch (eth.ether_type()) {
+    case EtherType::ARP:
+        handle_arp(eth, packet_size);
+        break;
+    case EtherType::IPv4:
+        handle_ipv4(eth, packet_size, packet_timestamp);
+        break;
+    case EtherType::IPv6:
+        // ignore
+        break;
+    default:
+        klog() << "NetworkTask: Unknown ethernet type 0x" << String::format("%x", eth.ether_type());
+    }
 }
 
 void handle_arp(const EthernetFrameHeader& eth, size_t frame_size)
@@ -434,6 +514,7 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
 #endif
             client->set_sequence_number(1000);
             client->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            client->process_syn_options(tcp_packet);
             [[maybe_unused]] auto rc2 = client->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
             client->set_state(TCPSocket::State::SynReceived);
             return;
@@ -447,11 +528,13 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
         switch (tcp_packet.flags()) {
         case TCPFlags::SYN:
             socket->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            socket->process_syn_options(tcp_packet);
             unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
             socket->set_state(TCPSocket::State::SynReceived);
             return;
         case TCPFlags::ACK | TCPFlags::SYN:
             socket->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            socket->process_syn_options(tcp_packet);
             unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
             socket->set_state(TCPSocket::State::Established);
             socket->set_setup_state(Socket::SetupState::Completed);
@@ -518,6 +601,9 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
         }
     case TCPSocket::State::CloseWait:
         switch (tcp_packet.flags()) {
+        case TCPFlags::ACK:
+            // We may still be sending data, the acknowledgment itself has already been processed.
+            return;
         default:
             klog() << "handle_tcp: unexpected flags in CloseWait state";
             unused_rc = socket->send_tcp_packet(TCPFlags::RST);
@@ -540,6 +626,9 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
         switch (tcp_packet.flags()) {
         case TCPFlags::ACK:
             socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
+            // Data that was queued before the FIN may still be getting acknowledged.
+            if (socket->has_unacked_packets())
+                return;
             socket->set_state(TCPSocket::State::FinWait2);
             return;
         case TCPFlags::FIN:
@@ -580,6 +669,17 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
             return;
         }
     case TCPSocket::State::Established:
+        if (tcp_packet.sequence_number() != socket->ack_number()) {
+            // We don't keep out-of-order segments around. Acknowledge what we have
+            // instead, so that the peer can tell what needs to be retransmitted.
+#ifdef TCP_DEBUG
+            klog() << "handle_tcp: out-of-order segment with seq_no=" << tcp_packet.sequence_number() << ", expected " << socket->ack_number();
+#endif
+            if (payload_size || tcp_packet.has_fin())
+                unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+            return;
+        }
+
         if (tcp_packet.has_fin()) {
             if (payload_size != 0)
                 socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp);
@@ -591,17 +691,33 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
             return;
         }
 
-        socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
+        if (payload_size) {
+            // If the segment doesn't fit into the receive buffer, the ACK
+            // tells the peer that it has to send it again.
+            if (socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp))
+                socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
+            unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+        }
 
 #ifdef TCP_DEBUG
         klog() << "Got packet with ack_no=" << tcp_packet.ack_number() << ", seq_no=" << tcp_packet.sequence_number() << ", payload_size=" << payload_size << ", acking it with new ack_no=" << socket->ack_number() << ", seq_no=" << socket->sequence_number();
 #endif
+    }
+}
 
-        if (payload_size) {
-            if (socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp))
-                unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
-        }
+void retransmit_tcp_packets()
+{
+    // Keep the sockets alive while we work on them, but don't hold on to the
+    // socket table while sending packets.
+    NonnullRefPtrVector<TCPSocket, 16> sockets;
+    {
+        LOCKER(TCPSocket::sockets_by_tuple().lock(), Lock::Mode::Shared);
+        for (auto& it : TCPSocket::sockets_by_tuple().resource())
+            sockets.append(*it.value);
     }
+
+    for (auto& socket : sockets)
+        socket.retransmit_packets();
 }
 
 }
@@ -30,5 +30,6 @@ namespace Kernel {
 class NetworkTask {
 public:
     static void spawn();
+    static void retransmit_timer_armed();
 };
 }
@@ -41,6 +41,50 @@ struct TCPFlags {
     };
 };
 
+enum class TCPOptionKind : u8 {
+    End = 0,
+    NoOperation = 1,
+    MaximumSegmentSize = 2,
+    WindowScale = 3,
+};
+
+class [[gnu::packed]] TCPOptionMSS {
+public:
+    explicit TCPOptionMSS(u16 value)
+        : m_value(value)
+    {
+    }
+
+    u16 value() const { return m_value; }
+
+private:
+    TCPOptionKind m_option_kind { TCPOptionKind::MaximumSegmentSize };
+    u8 m_length { sizeof(TCPOptionMSS) };
+    NetworkOrdered<u16> m_value;
+};
+
+static_assert(sizeof(TCPOptionMSS) == 4);
+
+class [[gnu::packed]] TCPOptionWindowScale {
+public:
+    explicit TCPOptionWindowScale(u8 shift_count)
+        : m_shift_count(shift_count)
+    {
+    }
+
+    u8 shift_count() const { return m_shift_count; }
+
+private:
+    // Window scale is the only option we send with an odd size, so it carries
+    // its own NOP to keep the options that follow it aligned.
+    TCPOptionKind m_padding { TCPOptionKind::NoOperation };
+    TCPOptionKind m_option_kind { TCPOptionKind::WindowScale };
+    u8 m_length { 3 };
+    u8 m_shift_count { 0 };
+};
+
+static_assert(sizeof(TCPOptionWindowScale) == 4);
+
 class [[gnu::packed]] TCPPacket {
 public:
     TCPPacket() = default;
@@ -80,6 +124,10 @@ public:
     u16 urgent() const { return m_urgent; }
     void set_urgent(u16 urgent) { m_urgent = urgent; }
 
+    const u8* options() const { return ((const u8*)this) + sizeof(TCPPacket); }
+    u8* options() { return ((u8*)this) + sizeof(TCPPacket); }
+    size_t options_size() const { return header_size() - sizeof(TCPPacket); }
+
     const void* payload() const { return ((const u8*)this) + header_size(); }
     void* payload() { return ((u8*)this) + header_size(); }
 
@@ -29,11 +29,13 @@
 #include <Kernel/Devices/RandomDevice.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/Net/NetworkAdapter.h>
+#include <Kernel/Net/NetworkTask.h>
 #include <Kernel/Net/Routing.h>
 #include <Kernel/Net/TCP.h>
 #include <Kernel/Net/TCPSocket.h>
 #include <Kernel/Process.h>
 #include <Kernel/Random.h>
+#include <Kernel/Time/TimeManagement.h>
 
 //#define TCP_SOCKET_DEBUG
 
@@ -156,6 +158,7 @@ TCPSocket::~TCPSocket()
 {
     LOCKER(sockets_by_tuple().lock());
     sockets_by_tuple().resource().remove(tuple());
+    set_retransmit_deadline(0);
 
 #ifdef TCP_SOCKET_DEBUG
     dbg() << "~TCPSocket in state " << to_string(state());
@@ -181,133 +184,434 @@ KResultOr<size_t> TCPSocket::protocol_receive(ReadonlyBytes raw_ipv4_packet, Use
     return payload_size;
 }
 
+static u64 current_time_in_microseconds()
+{
+    auto now = TimeManagement::the().monotonic_time();
+    return (u64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Sequence numbers wrap around, so they have to be compared relative to each other.
+static bool sequence_number_less_than(u32 a, u32 b)
+{
+    return (i32)(a - b) < 0;
+}
+
+static Atomic<size_t> s_sockets_with_retransmit_deadline;
+
+bool TCPSocket::has_sockets_waiting_to_retransmit()
+{
+    return s_sockets_with_retransmit_deadline.load(AK::MemoryOrder::memory_order_relaxed) != 0;
+}
+
+void TCPSocket::set_retransmit_deadline(u64 deadline)
+{
+    if (!m_retransmit_deadline && deadline) {
+        // NetworkTask only checks for expired timers while some socket has one.
+        if (s_sockets_with_retransmit_deadline.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) == 0)
+            NetworkTask::retransmit_timer_armed();
+    } else if (m_retransmit_deadline && !deadline) {
+        s_sockets_with_retransmit_deadline.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+    }
+    m_retransmit_deadline = deadline;
+}
+
+static constexpr u64 minimum_retransmission_timeout = 200000;
+static constexpr u64 maximum_retransmission_timeout = 60000000;
+
 KResultOr<size_t> TCPSocket::protocol_send(const UserOrKernelBuffer& data, size_t data_length)
 {
-    int err = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &data, data_length);
-    if (err < 0)
-        return KResult(err);
-    return data_length;
+    size_t total_queued = 0;
+    while (total_queued < data_length) {
+        size_t space_in_send_buffer;
+        {
+            LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+            space_in_send_buffer = send_buffer_size - min(send_buffer_size, m_send_buffer_used);
+        }
+        if (!space_in_send_buffer)
+            break;
+        size_t segment_size = min(data_length - total_queued, min((size_t)m_send_mss, space_in_send_buffer));
+        auto segment = data.offset(total_queued);
+        int err = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &segment, segment_size);
+        if (err < 0) {
+            if (total_queued)
+                break;
+            return KResult(err);
+        }
+        total_queued += segment_size;
+    }
+    return total_queued;
+}
+
+bool TCPSocket::can_write(const FileDescription& description, size_t offset) const
+{
+    if (!IPv4Socket::can_write(description, offset))
+        return false;
+    LOCKER(const_cast<Lock&>(m_not_acked_lock), Lock::Mode::Shared);
+    return m_send_buffer_used < send_buffer_size;
+}
+
+u16 TCPSocket::local_mss() const
+{
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    if (routing_decision.is_zero())
+        return default_mss;
+    size_t mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+    // Make sure that a few full-sized segments fit into our receive window at once,
+    // otherwise the peer would end up sending one segment per round trip.
+    mss = min(mss, receive_buffer().capacity() / 4);
+    return min(mss, (size_t)NumericLimits<u16>::max());
+}
+
+u8 TCPSocket::local_window_scale() const
+{
+    u8 shift = 0;
+    while (shift < 14 && (receive_buffer().capacity() >> shift) > NumericLimits<u16>::max())
+        ++shift;
+    return shift;
+}
+
+u32 TCPSocket::advertised_window(bool is_syn) const
+{
+    // The window in a SYN is never scaled.
+    size_t window = receive_buffer().space_for_writing();
+    if (!is_syn && m_window_scaling_enabled)
+        window >>= local_window_scale();
+    return min(window, (size_t)NumericLimits<u16>::max());
+}
+
+u32 TCPSocket::send_unacked() const
+{
+    if (m_not_acked.is_empty())
+        return m_sequence_number;
+    return m_not_acked.first().sequence_number;
+}
+
+void TCPSocket::process_syn_options(const TCPPacket& packet)
+{
+    ASSERT(packet.has_syn());
+    u16 peer_mss = default_mss;
+    Optional<u8> peer_window_scale;
+
+    auto* options = packet.options();
+    size_t options_size = packet.options_size();
+    for (size_t i = 0; i < options_size;) {
+        auto kind = (TCPOptionKind)options[i];
+        if (kind == TCPOptionKind::End)
+            break;
+        if (kind == TCPOptionKind::NoOperation) {
+            ++i;
+            continue;
+        }
+        if (i + 1 >= options_size || options[i + 1] < 2 || i + options[i + 1] > options_size)
+            break;
+        u8 length = options[i + 1];
+        if (kind == TCPOptionKind::MaximumSegmentSize && length == 4)
+            peer_mss = (options[i + 2] << 8) | options[i + 3];
+        else if (kind == TCPOptionKind::WindowScale && length == 3)
+            peer_window_scale = min(options[i + 2], (u8)14);
+        i += length;
+    }
+
+    LOCKER(m_not_acked_lock);
+    m_send_mss = max((u16)1, min(peer_mss, local_mss()));
+    m_window_scaling_enabled = peer_window_scale.has_value();
+    m_send_window_scale = peer_window_scale.value_or(0);
+    m_send_window = packet.window_size();
+    m_send_window_update_sequence_number = packet.sequence_number();
+    m_send_window_update_ack_number = packet.ack_number();
+    // RFC 3390 initial window
+    m_congestion_window = min(4u * m_send_mss, max(2u * m_send_mss, 4380u));
+
+#ifdef TCP_SOCKET_DEBUG
+    dbgln("TCPSocket: SYN options: mss={}, window_scale={}, using mss={}", peer_mss, m_send_window_scale, m_send_mss);
+#endif
 }
 
 int TCPSocket::send_tcp_packet(u16 flags, const UserOrKernelBuffer* payload, size_t payload_size)
 {
-    const size_t buffer_size = sizeof(TCPPacket) + payload_size;
-    alignas(TCPPacket) u8 buffer[buffer_size];
-    new (buffer) TCPPacket;
-    auto& tcp_packet = *(TCPPacket*)(buffer);
+    if (!(flags & (TCPFlags::SYN | TCPFlags::FIN)) && payload_size == 0) {
+        u32 sequence_number;
+        {
+            LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+            sequence_number = m_sequence_number;
+        }
+        return transmit(flags, sequence_number, nullptr, 0);
+    }
+
+    // Anything that occupies sequence space has to be delivered reliably,
+    // so it goes through the retransmission queue.
+    OutgoingPacket packet;
+    packet.flags = flags;
+    if (payload_size) {
+        packet.payload = ByteBuffer::create_uninitialized(payload_size);
+        if (!payload->read(packet.payload.data(), payload_size))
+            return -EFAULT;
+    }
+
+    // Concurrent senders must not end up with the same sequence number.
+    LOCKER(m_not_acked_lock);
+    packet.sequence_number = m_sequence_number;
+    if (flags & TCPFlags::SYN)
+        m_congestion_window = min(4u * m_send_mss, max(2u * m_send_mss, 4380u));
+    m_sequence_number += packet.sequence_space();
+    m_send_buffer_used += payload_size;
+    m_not_acked.append(move(packet));
+    send_outgoing_packets();
+    return 0;
+}
+
+int TCPSocket::transmit(u16 flags, u32 sequence_number, const u8* payload, size_t payload_size)
+{
+    bool is_syn = flags & TCPFlags::SYN;
+    // Our SYN always offers window scaling, our SYN/ACK only if the peer offered it.
+    bool include_window_scale = is_syn && (!(flags & TCPFlags::ACK) || m_window_scaling_enabled);
+    size_t options_size = is_syn ? sizeof(TCPOptionMSS) : 0;
+    if (include_window_scale)
+        options_size += sizeof(TCPOptionWindowScale);
+
+    const size_t buffer_size = sizeof(TCPPacket) + options_size + payload_size;
+    auto buffer = ByteBuffer::create_zeroed(buffer_size);
+    new (buffer.data()) TCPPacket;
+    auto& tcp_packet = *(TCPPacket*)(buffer.data());
     ASSERT(local_port());
     tcp_packet.set_source_port(local_port());
     tcp_packet.set_destination_port(peer_port());
-    tcp_packet.set_window_size(1024);
-    tcp_packet.set_sequence_number(m_sequence_number);
-    tcp_packet.set_data_offset(sizeof(TCPPacket) / sizeof(u32));
+    auto window = advertised_window(is_syn);
+    tcp_packet.set_window_size(window);
+    tcp_packet.set_sequence_number(sequence_number);
+    tcp_packet.set_data_offset((sizeof(TCPPacket) + options_size) / sizeof(u32));
     tcp_packet.set_flags(flags);
 
     if (flags & TCPFlags::ACK)
         tcp_packet.set_ack_number(m_ack_number);
 
-    if (payload && !payload->read(tcp_packet.payload(), payload_size))
-        return -EFAULT;
-
-    if (flags & TCPFlags::SYN) {
-        ++m_sequence_number;
-    } else {
-        m_sequence_number += payload_size;
+    if (is_syn) {
+        auto* options = tcp_packet.options();
+        new (options) TCPOptionMSS(local_mss());
+        if (include_window_scale)
+            new (options + sizeof(TCPOptionMSS)) TCPOptionWindowScale(local_window_scale());
     }
 
-    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+    if (payload_size)
+        memcpy(tcp_packet.payload(), payload, payload_size);
 
-    if (tcp_packet.has_syn() || payload_size > 0) {
-        LOCKER(m_not_acked_lock);
-        m_not_acked.append({ m_sequence_number, ByteBuffer::copy(buffer, buffer_size) });
-        send_outgoing_packets();
-        return 0;
-    }
+    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
 
     auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
-    ASSERT(!routing_decision.is_zero());
+    if (routing_decision.is_zero())
+        return -EHOSTUNREACH;
+
+#ifdef TCP_SOCKET_DEBUG
+    klog() << "sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", window=" << window;
+#endif
 
-    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer);
+    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer.data());
     int err = routing_decision.adapter->send_ipv4(
         routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
         packet_buffer, buffer_size, ttl());
-    if (err < 0)
+    if (err < 0) {
+        klog() << "Error (" << err << ") sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number();
         return err;
+    }
 
+    if (!is_syn)
+        m_last_advertised_window = m_window_scaling_enabled ? window << local_window_scale() : window;
     m_packets_out++;
     m_bytes_out += buffer_size;
     return 0;
 }
 
-void TCPSocket::send_outgoing_packets()
+void TCPSocket::transmit_packet(OutgoingPacket& packet)
 {
-    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
-    ASSERT(!routing_decision.is_zero());
-
-    auto now = kgettimeofday();
+    ASSERT(m_not_acked_lock.is_locked());
+    packet.tx_time = current_time_in_microseconds();
+    packet.tx_counter++;
+    if (packet.tx_counter > 1)
+        m_retransmissions++;
+    if (!packet.is_in_flight) {
+        packet.is_in_flight = true;
+        m_bytes_in_flight += packet.sequence_space();
+    }
+    // If this fails, the retransmission timer will take care of it.
+    [[maybe_unused]] auto rc = transmit(packet.flags, packet.sequence_number, packet.payload.data(), packet.payload.size());
+}
 
-    LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+void TCPSocket::send_outgoing_packets()
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    size_t window = min(m_congestion_window, m_send_window);
     for (auto& packet : m_not_acked) {
-        timeval diff;
-        timeval_sub(packet.tx_time, now, diff);
-        if (diff.tv_sec == 0 && diff.tv_usec <= 500000)
+        if (packet.is_in_flight)
             continue;
-        packet.tx_time = now;
-        packet.tx_counter++;
+        // SYN and FIN (without data) are always allowed through, they don't take up space in the peer's buffer.
+        if (packet.payload.size() && m_bytes_in_flight + packet.payload.size() > window)
+            break;
+        transmit_packet(packet);
+    }
 
-#ifdef TCP_SOCKET_DEBUG
-        auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
-        klog() << "sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
-#endif
-        auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(packet.buffer.data());
-        int err = routing_decision.adapter->send_ipv4(
-            routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
-            packet_buffer, packet.buffer.size(), ttl());
-        if (err < 0) {
-            auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
-            klog() << "Error (" << err << ") sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
-        } else {
-            m_packets_out++;
-            m_bytes_out += packet.buffer.size();
-        }
+    if (!m_retransmit_deadline && !m_not_acked.is_empty()) {
+        // Either waiting for an ACK or for the peer to open its window, so
+        // make sure we'll try again if neither happens.
+        set_retransmit_deadline(current_time_in_microseconds() + m_retransmission_timeout);
     }
 }
 
-void TCPSocket::receive_tcp_packet(const TCPPacket& packet, u16 size)
+void TCPSocket::retransmit_packets()
 {
-    if (packet.has_ack()) {
-        u32 ack_number = packet.ack_number();
+    LOCKER(m_not_acked_lock);
+    if (!m_retransmit_deadline)
+        return;
+    auto now = current_time_in_microseconds();
+    if (now < m_retransmit_deadline)
+        return;
+
+    if (m_not_acked.is_empty() || state() == State::Closed) {
+        set_retransmit_deadline(0);
+        return;
+    }
+
+    if (m_bytes_in_flight) {
+        // Retransmission timeout: assume everything in flight was lost and
+        // restart from slow start (RFC 5681, section 3.1).
+        m_slow_start_threshold = max(m_bytes_in_flight / 2, 2 * (size_t)m_send_mss);
+        m_congestion_window = m_send_mss;
+        m_in_fast_recovery = false;
+        m_duplicate_ack_count = 0;
+        for (auto& packet : m_not_acked)
+            packet.is_in_flight = false;
+        m_bytes_in_flight = 0;
+    }
 
 #ifdef TCP_SOCKET_DEBUG
-        dbg() << "TCPSocket: receive_tcp_packet: " << ack_number;
+    dbgln("TCPSocket: retransmission timeout ({} us), ssthresh={}", m_retransmission_timeout, m_slow_start_threshold);
 #endif
 
-        int removed = 0;
-        LOCKER(m_not_acked_lock);
-        while (!m_not_acked.is_empty()) {
-            auto& packet = m_not_acked.first();
+    // Send the first segment regardless of the window. If the peer's window
+    // is closed, this doubles as a window probe.
+    transmit_packet(m_not_acked.first());
+    m_retransmission_timeout = min(m_retransmission_timeout * 2, maximum_retransmission_timeout);
+    set_retransmit_deadline(now + m_retransmission_timeout);
+    send_outgoing_packets();
+}
+
+void TCPSocket::update_rtt(u64 sample)
+{
+    // RFC 6298, section 2
+    if (!m_smoothed_rtt) {
+        m_smoothed_rtt = max(sample, (u64)1);
+        m_rtt_variance = sample / 2;
+    } else {
+        u64 delta = m_smoothed_rtt > sample ? m_smoothed_rtt - sample : sample - m_smoothed_rtt;
+        m_rtt_variance = (3 * m_rtt_variance + delta) / 4;
+        m_smoothed_rtt = (7 * m_smoothed_rtt + sample) / 8;
+    }
+    m_retransmission_timeout = clamp(m_smoothed_rtt + max((u64)1000, 4 * m_rtt_variance), minimum_retransmission_timeout, maximum_retransmission_timeout);
+}
+
+void TCPSocket::process_ack(u32 sequence_number, u32 ack_number, u32 window, bool is_duplicate_ack_candidate)
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    auto now = current_time_in_microseconds();
+
+    bool is_duplicate_ack = is_duplicate_ack_candidate && m_bytes_in_flight && ack_number == send_unacked() && window == m_send_window;
+
+    // Only take the window from segments that are newer than the one we last took it from,
+    // so that an old, reordered segment can't shrink or grow it again (RFC 793, SND.WL1/SND.WL2).
+    if (sequence_number_less_than(m_send_window_update_sequence_number, sequence_number)
+        || (m_send_window_update_sequence_number == sequence_number && !sequence_number_less_than(ack_number, m_send_window_update_ack_number))) {
+        m_send_window = window;
+        m_send_window_update_sequence_number = sequence_number;
+        m_send_window_update_ack_number = ack_number;
+    }
+
+    size_t acked_bytes = 0;
+    bool have_rtt_sample = false;
+    while (!m_not_acked.is_empty()) {
+        auto& packet = m_not_acked.first();
+        // Don't take the peer's word for data that we haven't even sent yet.
+        if (!packet.tx_counter || sequence_number_less_than(ack_number, packet.sequence_number + packet.sequence_space()))
+            break;
+        // Karn's algorithm: retransmitted segments give ambiguous samples.
+        if (packet.tx_counter == 1 && !have_rtt_sample) {
+            update_rtt(now - packet.tx_time);
+            have_rtt_sample = true;
+        }
+        if (packet.is_in_flight)
+            m_bytes_in_flight -= packet.sequence_space();
+        acked_bytes += packet.sequence_space();
+        m_send_buffer_used -= packet.payload.size();
+        m_not_acked.take_first();
+    }
 
 #ifdef TCP_SOCKET_DEBUG
-            dbg() << "TCPSocket: iterate: " << packet.ack_number;
+    dbgln("TCPSocket: ack={} acknowledged {} bytes, {} in flight, cwnd={}, window={}", ack_number, acked_bytes, m_bytes_in_flight, m_congestion_window, m_send_window);
 #endif
 
-            if (packet.ack_number <= ack_number) {
-                m_not_acked.take_first();
-                removed++;
+    if (acked_bytes) {
+        m_duplicate_ack_count = 0;
+        if (m_in_fast_recovery) {
+            if (!sequence_number_less_than(ack_number, m_recovery_point)) {
+                // Full acknowledgment, deflate the window (RFC 6582, section 3.2, step 3).
+                m_congestion_window = m_slow_start_threshold;
+                m_in_fast_recovery = false;
             } else {
-                break;
+                // Partial acknowledgment: the next segment was lost as well.
+                if (!m_not_acked.is_empty())
+                    transmit_packet(m_not_acked.first());
+                m_congestion_window = (m_congestion_window > acked_bytes ? m_congestion_window - acked_bytes : 0) + m_send_mss;
             }
+        } else if (m_congestion_window < m_slow_start_threshold) {
+            m_congestion_window += min(acked_bytes, (size_t)m_send_mss);
+        } else {
+            m_congestion_window += max(1u, (u32)m_send_mss * m_send_mss / m_congestion_window);
         }
+        set_retransmit_deadline(m_bytes_in_flight ? now + m_retransmission_timeout : 0);
+        evaluate_block_conditions();
+    } else if (is_duplicate_ack) {
+        ++m_duplicate_ack_count;
+        if (m_duplicate_ack_count == 3 && !m_in_fast_recovery) {
+            // Fast retransmit (RFC 5681, section 3.2)
+            m_slow_start_threshold = max(m_bytes_in_flight / 2, 2 * (size_t)m_send_mss);
+            m_recovery_point = send_unacked() + m_bytes_in_flight;
+            transmit_packet(m_not_acked.first());
+            m_congestion_window = m_slow_start_threshold + 3 * m_send_mss;
+            m_in_fast_recovery = true;
+        } else if (m_in_fast_recovery) {
+            m_congestion_window += m_send_mss;
+        }
+    }
 
-#ifdef TCP_SOCKET_DEBUG
-        dbg() << "TCPSocket: receive_tcp_packet acknowledged " << removed << " packets";
-#endif
+    send_outgoing_packets();
+}
+
+void TCPSocket::receive_tcp_packet(const TCPPacket& packet, u16 size)
+{
+    if (packet.has_ack()) {
+        u32 window = packet.window_size();
+        if (!packet.has_syn() && m_window_scaling_enabled)
+            window <<= m_send_window_scale;
+        bool has_payload = size > packet.header_size();
+
+        LOCKER(m_not_acked_lock);
+        process_ack(packet.sequence_number(), packet.ack_number(), window, !has_payload && !packet.has_syn() && !packet.has_fin());
     }
 
     m_packets_in++;
     m_bytes_in += packet.header_size() + size;
 }
 
+void TCPSocket::protocol_did_consume_received_data()
+{
+    if (state() != State::Established)
+        return;
+    // Tell the peer about the freed up buffer space once it's significant, so
+    // that it doesn't have to wait for its retransmission timer to probe us.
+    auto space = receive_buffer().space_for_writing();
+    if (space < m_last_advertised_window + max(2 * (size_t)m_send_mss, receive_buffer().capacity() / 2))
+        return;
+    [[maybe_unused]] auto rc = send_tcp_packet(TCPFlags::ACK);
+}
+
 NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, const IPv4Address& destination, const TCPPacket& packet, u16 payload_size)
 {
     struct [[gnu::packed]] PseudoHeader {
@@ -318,7 +622,7 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
         NetworkOrdered<u16> payload_size;
     };
 
-    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, sizeof(TCPPacket) + payload_size };
+    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, (u16)(packet.header_size() + payload_size) };
 
     u32 checksum = 0;
     auto* w = (const NetworkOrdered<u16>*)&pseudo_header;
@@ -328,12 +632,11 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
     w = (const NetworkOrdered<u16>*)&packet;
-    for (size_t i = 0; i < sizeof(packet) / sizeof(u16); ++i) {
+    for (size_t i = 0; i < packet.header_size() / sizeof(u16); ++i) {
         checksum += w[i];
         if (checksum > 0xffff)
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
-    ASSERT(packet.data_offset() * 4 == sizeof(TCPPacket));
     w = (const NetworkOrdered<u16>*)packet.payload();
     for (size_t i = 0; i < payload_size / sizeof(u16); ++i) {
         checksum += w[i];
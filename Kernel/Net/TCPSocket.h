@@ -28,9 +28,11 @@
 
 #include <AK/Function.h>
 #include <AK/HashMap.h>
+#include <AK/NumericLimits.h>
 #include <AK/SinglyLinkedList.h>
 #include <AK/WeakPtr.h>
 #include <Kernel/Net/IPv4Socket.h>
+#include <Kernel/Net/TCP.h>
 
 namespace Kernel {
 
@@ -148,9 +150,21 @@ public:
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
 
+    u32 congestion_window() const { return m_congestion_window; }
+    u32 slow_start_threshold() const { return m_slow_start_threshold; }
+    u32 send_window() const { return m_send_window; }
+    u64 smoothed_rtt_in_microseconds() const { return m_smoothed_rtt; }
+    u64 retransmission_timeout_in_microseconds() const { return m_retransmission_timeout; }
+    u32 retransmissions() const { return m_retransmissions; }
+
     [[nodiscard]] int send_tcp_packet(u16 flags, const UserOrKernelBuffer* = nullptr, size_t = 0);
-    void send_outgoing_packets();
     void receive_tcp_packet(const TCPPacket&, u16 size);
+    void process_syn_options(const TCPPacket&);
+    void retransmit_packets();
+    bool has_unacked_packets() const { return !m_not_acked.is_empty(); }
+    static bool has_sockets_waiting_to_retransmit();
+
+    virtual bool can_write(const FileDescription&, size_t) const override;
 
     static Lockable<HashMap<IPv4SocketTuple, TCPSocket*>>& sockets_by_tuple();
     static RefPtr<TCPSocket> from_tuple(const IPv4SocketTuple& tuple);
@@ -177,6 +191,7 @@ private:
 
     virtual void shut_down_for_writing() override;
 
+    virtual void protocol_did_consume_received_data() override;
     virtual KResultOr<size_t> protocol_receive(ReadonlyBytes raw_ipv4_packet, UserOrKernelBuffer& buffer, size_t buffer_size, int flags) override;
     virtual KResultOr<size_t> protocol_send(const UserOrKernelBuffer&, size_t) override;
     virtual KResult protocol_connect(FileDescription&, ShouldBlock) override;
@@ -199,14 +214,58 @@ private:
     u32 m_bytes_out { 0 };
 
     struct OutgoingPacket {
-        u32 ack_number { 0 };
-        ByteBuffer buffer;
+        u32 sequence_number { 0 };
+        u16 flags { 0 };
+        ByteBuffer payload;
         int tx_counter { 0 };
-        timeval tx_time { 0, 0 };
+        u64 tx_time { 0 };
+        bool is_in_flight { false };
+
+        // SYN and FIN occupy one unit of sequence space each.
+        size_t sequence_space() const { return payload.size() + ((flags & (TCPFlags::SYN | TCPFlags::FIN)) ? 1 : 0); }
     };
 
+    static constexpr size_t send_buffer_size = 128 * KiB;
+    static constexpr u16 default_mss = 536;
+
+    int transmit(u16 flags, u32 sequence_number, const u8* payload, size_t payload_size);
+    void transmit_packet(OutgoingPacket&);
+    void send_outgoing_packets();
+    void process_ack(u32 sequence_number, u32 ack_number, u32 window, bool is_duplicate_ack_candidate);
+    void update_rtt(u64 sample);
+    u16 local_mss() const;
+    u8 local_window_scale() const;
+    u32 advertised_window(bool is_syn) const;
+    u32 send_unacked() const;
+
     Lock m_not_acked_lock { "TCPSocket unacked packets" };
     SinglyLinkedList<OutgoingPacket> m_not_acked;
+    size_t m_send_buffer_used { 0 };
+    size_t m_bytes_in_flight { 0 };
+
+    u16 m_send_mss { default_mss };
+    u32 m_send_window { 0 };
+    // The sequence and ack numbers of the segment m_send_window was last taken from.
+    u32 m_send_window_update_sequence_number { 0 };
+    u32 m_send_window_update_ack_number { 0 };
+    u8 m_send_window_scale { 0 };
+    bool m_window_scaling_enabled { false };
+    u32 m_last_advertised_window { 0 };
+
+    // Congestion control (NewReno, RFC 5681 and RFC 6582)
+    u32 m_congestion_window { 0 };
+    u32 m_slow_start_threshold { NumericLimits<u32>::max() };
+    u32 m_duplicate_ack_count { 0 };
+    bool m_in_fast_recovery { false };
+    u32 m_recovery_point { 0 };
+
+    // Retransmission timer (RFC 6298), all in microseconds
+    u64 m_smoothed_rtt { 0 };
+    u64 m_rtt_variance { 0 };
+    u64 m_retransmission_timeout { 1000000 };
+    void set_retransmit_deadline(u64);
+    u64 m_retransmit_deadline { 0 };
+    u32 m_retransmissions { 0 };
 };
 
 }
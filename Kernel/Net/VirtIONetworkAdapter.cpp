@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/MACAddress.h>
+#include <Kernel/Net/VirtIONetworkAdapter.h>
+#include <Kernel/VM/MemoryManager.h>
+
+//#define VIRTIO_NET_DEBUG
+
+namespace Kernel {
+
+#define VIRTIO_NET_F_MAC (1 << 5)
+#define VIRTIO_NET_F_STATUS (1 << 16)
+
+#define VIRTIO_NET_CONFIG_MAC 0
+#define VIRTIO_NET_CONFIG_STATUS 6
+
+#define VIRTIO_NET_S_LINK_UP 1
+
+void VirtIONetworkAdapter::detect()
+{
+    PCI::enumerate([&](const PCI::Address& address, PCI::ID id) {
+        if (address.is_null())
+            return;
+        if (id.vendor_id != VIRTIO_PCI_VENDOR_ID || id.device_id != VIRTIO_PCI_DEVICE_ID_NETWORK)
+            return;
+        [[maybe_unused]] auto& unused = adopt(*new VirtIONetworkAdapter(address)).leak_ref();
+    });
+}
+
+VirtIONetworkAdapter::VirtIONetworkAdapter(PCI::Address address)
+    : VirtIODevice(address, "VirtIO Network Adapter")
+{
+    set_interface_name("virtio");
+
+    negotiate_features(VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS);
+    if (!setup_queues(2)) {
+        klog() << "VirtIONetworkAdapter: Failed to set up the queues";
+        fail_initialization();
+        return;
+    }
+
+    // Every buffer takes two descriptors, one for the header and one for the packet.
+    m_receive_buffer_count = min<size_t>(queue(receive_queue).size() / 2, max_receive_buffers);
+    m_transmit_buffer_count = min<size_t>(queue(transmit_queue).size() / 2, max_transmit_buffers);
+    m_header_region = MM.allocate_contiguous_kernel_region(PAGE_SIZE, "VirtIO Net Headers", Region::Access::Read | Region::Access::Write);
+    m_receive_buffer_region = MM.allocate_contiguous_kernel_region(PAGE_ROUND_UP(m_receive_buffer_count * buffer_size), "VirtIO Net RX", Region::Access::Read | Region::Access::Write);
+    m_transmit_buffer_region = MM.allocate_contiguous_kernel_region(PAGE_ROUND_UP(m_transmit_buffer_count * buffer_size), "VirtIO Net TX", Region::Access::Read | Region::Access::Write);
+    if (!m_header_region || !m_receive_buffer_region || !m_transmit_buffer_region) {
+        klog() << "VirtIONetworkAdapter: Failed to allocate memory";
+        fail_initialization();
+        return;
+    }
+
+    if (is_feature_accepted(VIRTIO_NET_F_MAC)) {
+        set_mac_address({ config_read8(VIRTIO_NET_CONFIG_MAC + 0),
+            config_read8(VIRTIO_NET_CONFIG_MAC + 1),
+            config_read8(VIRTIO_NET_CONFIG_MAC + 2),
+            config_read8(VIRTIO_NET_CONFIG_MAC + 3),
+            config_read8(VIRTIO_NET_CONFIG_MAC + 4),
+            config_read8(VIRTIO_NET_CONFIG_MAC + 5) });
+    }
+    klog() << "VirtIONetworkAdapter: MAC address: " << mac_address().to_string() << ", RX buffers: " << m_receive_buffer_count << ", TX buffers: " << m_transmit_buffer_count;
+
+    for (size_t i = 0; i < m_receive_buffer_count; ++i) {
+        bool supplied = supply_receive_buffer(i);
+        ASSERT(supplied);
+    }
+
+    // We only want to hear about finished transmissions when we run out of buffers.
+    queue(transmit_queue).disable_interrupts();
+
+    m_is_initialized = true;
+    finish_initialization();
+    notify_queue(receive_queue);
+}
+
+VirtIONetworkAdapter::~VirtIONetworkAdapter()
+{
+}
+
+VirtIONetworkAdapter::PacketHeader& VirtIONetworkAdapter::packet_header(size_t index)
+{
+    return reinterpret_cast<PacketHeader*>(m_header_region->vaddr().as_ptr())[index];
+}
+
+PhysicalAddress VirtIONetworkAdapter::packet_header_paddr(size_t index) const
+{
+    return m_header_region->physical_page(0)->paddr().offset(index * sizeof(PacketHeader));
+}
+
+bool VirtIONetworkAdapter::link_up()
+{
+    if (!m_is_initialized)
+        return false;
+    if (!is_feature_accepted(VIRTIO_NET_F_STATUS))
+        return true;
+    return config_read16(VIRTIO_NET_CONFIG_STATUS) & VIRTIO_NET_S_LINK_UP;
+}
+
+bool VirtIONetworkAdapter::supply_receive_buffer(size_t index)
+{
+    VirtIOQueue::Buffer buffers[] = {
+        { packet_header_paddr(index), sizeof(PacketHeader), true },
+        { m_receive_buffer_region->physical_page(0)->paddr().offset(index * buffer_size), buffer_size, true },
+    };
+    return queue(receive_queue).supply_buffers(buffers, 2, &packet_header(index));
+}
+
+void VirtIONetworkAdapter::handle_queue_update(u16 queue_index)
+{
+    if (queue_index == receive_queue) {
+        ScopedSpinLock lock(m_receive_lock);
+        if (!queue(receive_queue).has_used_buffers())
+            return;
+        // Like the E1000, we leave receive interrupts off and let NetworkTask
+        // poll the queue until it's empty instead.
+        queue(receive_queue).disable_interrupts();
+        request_receive_poll();
+    } else if (queue_index == transmit_queue) {
+        m_transmit_wait_queue.wake_all();
+    }
+}
+
+void VirtIONetworkAdapter::handle_config_change()
+{
+    klog() << "VirtIONetworkAdapter: Link is " << (link_up() ? "up" : "down");
+}
+
+size_t VirtIONetworkAdapter::poll_receive(size_t budget)
+{
+    if (!m_is_initialized)
+        return 0;
+
+    size_t received = 0;
+    while (received < budget) {
+        Optional<VirtIOQueue::UsedBuffers> used_buffers;
+        {
+            ScopedSpinLock lock(m_receive_lock);
+            used_buffers = queue(receive_queue).take_used_buffers();
+        }
+        if (!used_buffers.has_value())
+            break;
+
+        size_t index = static_cast<PacketHeader*>(used_buffers->token) - &packet_header(0);
+        ASSERT(index < m_receive_buffer_count);
+        // The length the device reports includes the packet header.
+        if (used_buffers->length > sizeof(PacketHeader)) {
+            size_t length = min<size_t>(used_buffers->length - sizeof(PacketHeader), buffer_size);
+#ifdef VIRTIO_NET_DEBUG
+            dbg() << "VirtIONetworkAdapter: Received " << length << " bytes in buffer " << index;
+#endif
+            did_receive({ m_receive_buffer_region->vaddr().offset(index * buffer_size).as_ptr(), length });
+        }
+
+        ScopedSpinLock lock(m_receive_lock);
+        bool supplied = supply_receive_buffer(index);
+        ASSERT(supplied);
+        ++received;
+    }
+
+    ScopedSpinLock lock(m_receive_lock);
+    if (received)
+        notify_queue(receive_queue);
+    if (received < budget) {
+        // The queue is empty, go back to being interrupt driven. A packet that
+        // came in before the interrupts were enabled again won't raise one though.
+        queue(receive_queue).enable_interrupts();
+        if (!queue(receive_queue).has_used_buffers())
+            return received;
+        queue(receive_queue).disable_interrupts();
+    }
+    request_receive_poll();
+    return received;
+}
+
+Optional<size_t> VirtIONetworkAdapter::reclaim_transmit_buffers()
+{
+    ASSERT(m_transmit_lock.is_locked());
+    for (;;) {
+        auto used_buffers = queue(transmit_queue).take_used_buffers();
+        if (!used_buffers.has_value())
+            break;
+        size_t index = static_cast<PacketHeader*>(used_buffers->token) - &packet_header(max_receive_buffers);
+        ASSERT(index < m_transmit_buffer_count);
+        m_used_transmit_buffers &= ~(1u << index);
+    }
+
+    for (size_t i = 0; i < m_transmit_buffer_count; ++i) {
+        if (!(m_used_transmit_buffers & (1u << i)))
+            return i;
+    }
+    return {};
+}
+
+void VirtIONetworkAdapter::send_raw(ReadonlyBytes payload)
+{
+    if (!m_is_initialized)
+        return;
+    ASSERT(payload.size() <= buffer_size);
+
+    LOCKER(m_send_lock);
+    Optional<size_t> index;
+    for (;;) {
+        {
+            ScopedSpinLock lock(m_transmit_lock);
+            index = reclaim_transmit_buffers();
+            if (index.has_value()) {
+                queue(transmit_queue).disable_interrupts();
+                break;
+            }
+            // Every buffer is still in flight, so ask the device to tell us when one is done.
+            queue(transmit_queue).enable_interrupts();
+            if (queue(transmit_queue).has_used_buffers())
+                continue;
+        }
+        m_transmit_wait_queue.wait_on({}, "VirtIONetworkAdapter");
+    }
+
+    // Nobody else touches a buffer until it's marked as used.
+    auto& header = packet_header(max_receive_buffers + index.value());
+    memset(&header, 0, sizeof(header));
+    memcpy(m_transmit_buffer_region->vaddr().offset(index.value() * buffer_size).as_ptr(), payload.data(), payload.size());
+#ifdef VIRTIO_NET_DEBUG
+    dbg() << "VirtIONetworkAdapter: Sending " << payload.size() << " bytes from buffer " << index.value();
+#endif
+
+    VirtIOQueue::Buffer buffers[] = {
+        { packet_header_paddr(max_receive_buffers + index.value()), sizeof(PacketHeader), false },
+        { m_transmit_buffer_region->physical_page(0)->paddr().offset(index.value() * buffer_size), (u32)payload.size(), false },
+    };
+    ScopedSpinLock lock(m_transmit_lock);
+    bool supplied = queue(transmit_queue).supply_buffers(buffers, 2, &header);
+    ASSERT(supplied);
+    m_used_transmit_buffers |= 1u << index.value();
+    notify_queue(transmit_queue);
+}
+
+}
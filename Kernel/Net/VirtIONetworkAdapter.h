@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/OwnPtr.h>
+#include <Kernel/Lock.h>
+#include <Kernel/Net/NetworkAdapter.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/VirtIO/VirtIO.h>
+#include <Kernel/WaitQueue.h>
+
+namespace Kernel {
+
+class VirtIONetworkAdapter final : public NetworkAdapter
+    , public VirtIODevice {
+public:
+    static void detect();
+
+    explicit VirtIONetworkAdapter(PCI::Address);
+    virtual ~VirtIONetworkAdapter() override;
+
+    virtual void send_raw(ReadonlyBytes) override;
+    virtual bool link_up() override;
+    virtual size_t poll_receive(size_t budget) override;
+
+private:
+    virtual const char* class_name() const override { return "VirtIONetworkAdapter"; }
+
+    //^ VirtIODevice
+    virtual void handle_queue_update(u16 queue_index) override;
+    virtual void handle_config_change() override;
+
+    // Without VIRTIO_F_ANY_LAYOUT, legacy devices want this in a descriptor of its own.
+    struct [[gnu::packed]] PacketHeader {
+        u8 flags;
+        u8 gso_type;
+        u16 header_length;
+        u16 gso_size;
+        u16 checksum_start;
+        u16 checksum_offset;
+    };
+
+    static constexpr u16 receive_queue = 0;
+    static constexpr u16 transmit_queue = 1;
+
+    static constexpr size_t max_receive_buffers = 128;
+    static constexpr size_t max_transmit_buffers = 32;
+    static constexpr size_t buffer_size = 2048;
+
+    // Both rings' headers share one page, the transmit headers follow the receive ones.
+    PacketHeader& packet_header(size_t index);
+    PhysicalAddress packet_header_paddr(size_t index) const;
+
+    bool supply_receive_buffer(size_t index);
+    Optional<size_t> reclaim_transmit_buffers();
+
+    OwnPtr<Region> m_header_region;
+    OwnPtr<Region> m_receive_buffer_region;
+    OwnPtr<Region> m_transmit_buffer_region;
+    size_t m_receive_buffer_count { 0 };
+    size_t m_transmit_buffer_count { 0 };
+    bool m_is_initialized { false };
+
+    SpinLock<u8> m_receive_lock;
+
+    Lock m_send_lock { "VirtIONetworkAdapter" };
+    SpinLock<u8> m_transmit_lock;
+    u32 m_used_transmit_buffers { 0 };
+    WaitQueue m_transmit_wait_queue;
+};
+
+}
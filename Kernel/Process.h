@@ -361,6 +361,10 @@ public:
     int sys$set_coredump_metadata(Userspace<const Syscall::SC_set_coredump_metadata_params*>);
     void sys$abort();
     int sys$anon_create(size_t, int options);
+    ssize_t sys$sendfile(Userspace<const Syscall::SC_sendfile_params*>);
+    int sys$epoll_create(int flags);
+    int sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*>);
+    int sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*>);
 
     template<bool sockname, typename Params>
     int get_sock_or_peer_name(const Params&);
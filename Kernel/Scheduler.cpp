@@ -25,7 +25,6 @@
  */
 
 #include <AK/Debug.h>
-#include <AK/QuickSort.h>
 #include <AK/ScopeGuard.h>
 #include <AK/TemporaryChange.h>
 #include <AK/Time.h>
@@ -42,16 +41,120 @@
 
 namespace Kernel {
 
+static constexpr u32 g_ready_queue_buckets = sizeof(u32) * 8;
+static constexpr u32 g_priority_points_per_bucket = (THREAD_PRIORITY_MAX - THREAD_PRIORITY_MIN + g_ready_queue_buckets - 2) / (g_ready_queue_buckets - 1);
+
+// Every this many ticks, the longest waiting thread of each bucket moves up
+// by one bucket, see SchedulerPerProcessorData::age().
+static constexpr u32 g_ready_queue_aging_ticks = 4;
+
+static inline u32 thread_priority_to_bucket(u32 thread_priority)
+{
+    // Maps THREAD_PRIORITY_MIN...THREAD_PRIORITY_MAX onto the run queue
+    // buckets, where bucket 0 holds the highest priority threads.
+    ASSERT(thread_priority >= THREAD_PRIORITY_MIN && thread_priority <= THREAD_PRIORITY_MAX);
+    constexpr u32 priority_range = THREAD_PRIORITY_MAX - THREAD_PRIORITY_MIN;
+    auto bucket = ((THREAD_PRIORITY_MAX - thread_priority) * (g_ready_queue_buckets - 1)) / priority_range;
+    ASSERT(bucket < g_ready_queue_buckets);
+    return bucket;
+}
+
+static inline bool can_pull_thread(Thread& thread, u32 affinity_mask)
+{
+    if (!(thread.affinity() & affinity_mask))
+        return false;
+    // The thread may still be in the middle of being switched away from
+    // on another processor.
+    if (thread.is_active())
+        return false;
+    if (thread.process().exec_tid() && thread.process().exec_tid() != thread.tid())
+        return false;
+    return true;
+}
+
 class SchedulerPerProcessorData {
     AK_MAKE_NONCOPYABLE(SchedulerPerProcessorData);
     AK_MAKE_NONMOVABLE(SchedulerPerProcessorData);
 
 public:
+    typedef IntrusiveList<Thread, &Thread::m_ready_queue_node> ThreadList;
+
     SchedulerPerProcessorData() = default;
 
+    void enqueue(Thread& thread, u32 cpu)
+    {
+        ASSERT(thread.m_runnable_priority < 0);
+        auto bucket = thread_priority_to_bucket(thread.priority());
+        thread.m_runnable_priority = (int)bucket;
+        thread.m_extra_priority = 0;
+        thread.m_ready_queue_cpu = cpu;
+        m_ready_queues[bucket].append(thread);
+        m_ready_queues_mask |= 1u << bucket;
+        m_ready_thread_count++;
+    }
+
+    void remove(Thread& thread)
+    {
+        ASSERT(thread.m_runnable_priority >= 0);
+        auto bucket = (u32)thread.m_runnable_priority;
+        auto& queue = m_ready_queues[bucket];
+        queue.remove(thread);
+        if (queue.is_empty())
+            m_ready_queues_mask &= ~(1u << bucket);
+        thread.m_runnable_priority = -1;
+        ASSERT(m_ready_thread_count > 0);
+        m_ready_thread_count--;
+    }
+
+    // Returns the first thread in the highest priority non-empty bucket
+    // that is allowed to run on the given processor, without removing it.
+    Thread* find_next_for(u32 cpu)
+    {
+        auto affinity_mask = 1u << cpu;
+        auto priority_mask = m_ready_queues_mask;
+        while (priority_mask != 0) {
+            auto bucket = __builtin_ctz(priority_mask);
+            for (auto& thread : m_ready_queues[bucket]) {
+                ASSERT(thread.m_runnable_priority == bucket);
+                if (can_pull_thread(thread, affinity_mask))
+                    return &thread;
+            }
+            priority_mask &= ~(1u << bucket);
+        }
+        return nullptr;
+    }
+
+    // Moves the longest waiting thread of every bucket up by one bucket, so
+    // that busy high priority threads can't starve the others forever.
+    void age()
+    {
+        // Walk from the top so that no thread moves up more than once.
+        auto priority_mask = m_ready_queues_mask & ~1u;
+        while (priority_mask != 0) {
+            auto bucket = (u32)__builtin_ctz(priority_mask);
+            priority_mask &= ~(1u << bucket);
+            auto& queue = m_ready_queues[bucket];
+            auto& thread = *queue.take_first();
+            if (queue.is_empty())
+                m_ready_queues_mask &= ~(1u << bucket);
+            thread.m_runnable_priority = (int)bucket - 1;
+            thread.m_extra_priority += g_priority_points_per_bucket;
+            m_ready_queues[bucket - 1].append(thread);
+            m_ready_queues_mask |= 1u << (bucket - 1);
+        }
+    }
+
+    u32 ready_thread_count() const { return m_ready_thread_count; }
+
     WeakPtr<Thread> m_pending_beneficiary;
     const char* m_pending_donate_reason { nullptr };
     bool m_in_scheduler { true };
+    u32 m_ticks_since_aging { 0 };
+
+private:
+    ThreadList m_ready_queues[g_ready_queue_buckets];
+    u32 m_ready_queues_mask { 0 };
+    u32 m_ready_thread_count { 0 };
 };
 
 SchedulerData* g_scheduler_data;
@@ -76,6 +179,106 @@ WaitQueue* g_finalizer_wait_queue;
 Atomic<bool> g_finalizer_has_work { false };
 static Process* s_colonel_process;
 
+static inline bool is_scheduling_processor(Processor& processor)
+{
+    if (!processor.has_scheduler_data())
+        return false;
+    // FIXME: Only the BSP receives scheduler ticks (see Scheduler::timer_tick),
+    //        so don't hand out threads to the APs' run queues until they do.
+    return processor.id() == 0;
+}
+
+static Processor& select_processor_for(const Thread& thread)
+{
+    // Prefer the processor the thread last ran on, as its caches are likely
+    // still warm, unless another processor has noticeably less work queued.
+    auto affinity = thread.affinity();
+    auto last_cpu = thread.cpu();
+    Processor* last_processor = nullptr;
+    Processor* least_loaded = nullptr;
+    Processor::for_each([&](Processor& processor) {
+        if (!(affinity & (1u << processor.id())) || !is_scheduling_processor(processor))
+            return IterationDecision::Continue;
+        if (processor.id() == last_cpu)
+            last_processor = &processor;
+        if (!least_loaded || processor.get_scheduler_data().ready_thread_count() < least_loaded->get_scheduler_data().ready_thread_count())
+            least_loaded = &processor;
+        return IterationDecision::Continue;
+    });
+
+    if (!least_loaded) {
+        // None of the processors the thread may run on are scheduling yet,
+        // park it on the BSP until one of them steals it.
+        return Processor::by_id(0);
+    }
+    if (last_processor && last_processor->get_scheduler_data().ready_thread_count() <= least_loaded->get_scheduler_data().ready_thread_count() + 1)
+        return *last_processor;
+    return *least_loaded;
+}
+
+void Scheduler::queue_runnable_thread(Thread& thread)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    ASSERT(thread.state() == Thread::Runnable);
+    auto& processor = select_processor_for(thread);
+    processor.get_scheduler_data().enqueue(thread, processor.id());
+}
+
+bool Scheduler::dequeue_runnable_thread(Thread& thread)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    if (thread.m_runnable_priority < 0)
+        return false;
+    Processor::by_id(thread.m_ready_queue_cpu).get_scheduler_data().remove(thread);
+    return true;
+}
+
+Thread* Scheduler::pull_next_runnable_thread(Thread& current_thread)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    auto& processor = Processor::current();
+    auto cpu = processor.id();
+
+    auto& scheduler_data = processor.get_scheduler_data();
+    for (u32 step = 0; step < g_ready_queue_buckets && scheduler_data.m_ticks_since_aging >= g_ready_queue_aging_ticks; ++step) {
+        scheduler_data.m_ticks_since_aging -= g_ready_queue_aging_ticks;
+        scheduler_data.age();
+    }
+    // Anything beyond moving every thread all the way up has no further effect.
+    if (scheduler_data.m_ticks_since_aging >= g_ready_queue_aging_ticks)
+        scheduler_data.m_ticks_since_aging = 0;
+
+    auto* candidate = scheduler_data.find_next_for(cpu);
+    if (!candidate) {
+        // Our own run queues are empty, try to steal the most important
+        // thread that is allowed to run here from another processor.
+        Processor::for_each([&](Processor& other) {
+            if (&other == &processor || !other.has_scheduler_data())
+                return IterationDecision::Continue;
+            auto* thread = other.get_scheduler_data().find_next_for(cpu);
+            if (thread && (!candidate || thread->m_runnable_priority < candidate->m_runnable_priority))
+                candidate = thread;
+            return IterationDecision::Continue;
+        });
+    }
+
+    // Keep running the current thread if nothing more important is waiting.
+    // Threads of equal priority take turns.
+    if (&current_thread != processor.idle_thread()
+        && current_thread.state() == Thread::Running
+        && (current_thread.affinity() & (1u << cpu))
+        && (!current_thread.process().exec_tid() || current_thread.process().exec_tid() == current_thread.tid())) {
+        if (!candidate || (int)thread_priority_to_bucket(current_thread.priority()) < candidate->m_runnable_priority)
+            return &current_thread;
+    }
+
+    if (!candidate)
+        return processor.idle_thread();
+
+    dequeue_runnable_thread(*candidate);
+    return candidate;
+}
+
 void Scheduler::start()
 {
     ASSERT_INTERRUPTS_DISABLED();
@@ -85,7 +288,7 @@ void Scheduler::start()
     g_scheduler_lock.lock();
 
     auto& processor = Processor::current();
-    processor.set_scheduler_data(*new SchedulerPerProcessorData());
+    ASSERT(processor.has_scheduler_data());
     ASSERT(processor.is_initialized());
     auto& idle_thread = *processor.idle_thread();
     ASSERT(processor.current_thread() == &idle_thread);
@@ -173,24 +376,8 @@ bool Scheduler::pick_next()
         });
     }
 
-    Thread* thread_to_schedule = nullptr;
-
     auto pending_beneficiary = scheduler_data.m_pending_beneficiary.strong_ref();
-    Vector<Thread*, 128> sorted_runnables;
-    for_each_runnable([&](auto& thread) {
-        if ((thread.affinity() & (1u << Processor::current().id())) == 0)
-            return IterationDecision::Continue;
-        if (thread.state() == Thread::Running && &thread != current_thread)
-            return IterationDecision::Continue;
-        sorted_runnables.append(&thread);
-        if (&thread == pending_beneficiary) {
-            thread_to_schedule = &thread;
-            return IterationDecision::Break;
-        }
-        return IterationDecision::Continue;
-    });
-
-    if (thread_to_schedule) {
+    if (pending_beneficiary && pending_beneficiary->state() == Thread::Runnable && can_pull_thread(*pending_beneficiary, 1u << Processor::current().id())) {
         // The thread we're supposed to donate to still exists
         const char* reason = scheduler_data.m_pending_donate_reason;
         scheduler_data.m_pending_beneficiary = nullptr;
@@ -200,8 +387,8 @@ bool Scheduler::pick_next()
         // but since we're still holding the scheduler lock we're still in a critical section
         critical.leave();
 
-        dbgln<debug_scheduler>("Processing pending donate to {} reason={}", *thread_to_schedule, reason);
-        return donate_to_and_switch(thread_to_schedule, reason);
+        dbgln<debug_scheduler>("Processing pending donate to {} reason={}", *pending_beneficiary, reason);
+        return donate_to_and_switch(pending_beneficiary.ptr(), reason);
     }
 
     // Either we're not donating or the beneficiary disappeared.
@@ -209,24 +396,7 @@ bool Scheduler::pick_next()
     scheduler_data.m_pending_beneficiary = nullptr;
     scheduler_data.m_pending_donate_reason = nullptr;
 
-    quick_sort(sorted_runnables, [](auto& a, auto& b) { return a->effective_priority() >= b->effective_priority(); });
-
-    for (auto* thread : sorted_runnables) {
-        if (thread->process().exec_tid() && thread->process().exec_tid() != thread->tid())
-            continue;
-
-        ASSERT(thread->state() == Thread::Runnable || thread->state() == Thread::Running);
-
-        if (!thread_to_schedule) {
-            thread->m_extra_priority = 0;
-            thread_to_schedule = thread;
-        } else {
-            thread->m_extra_priority++;
-        }
-    }
-
-    if (!thread_to_schedule)
-        thread_to_schedule = Processor::current().idle_thread();
+    auto* thread_to_schedule = pull_next_runnable_thread(*current_thread);
 
     if constexpr (debug_scheduler) {
         dbgln("Scheduler[{}]: Switch to {} @ {:04x}:{:08x}",
@@ -464,6 +634,8 @@ void Scheduler::initialize()
 
 void Scheduler::set_idle_thread(Thread* idle_thread)
 {
+    // Set up the run queues before any thread can be placed on this processor
+    Processor::current().set_scheduler_data(*new SchedulerPerProcessorData());
     Processor::current().set_idle_thread(*idle_thread);
     Processor::current().set_current_thread(*idle_thread);
 }
@@ -492,6 +664,7 @@ void Scheduler::timer_tick(const RegisterState& regs)
     bool is_bsp = Processor::current().id() == 0;
     if (!is_bsp)
         return; // TODO: This prevents scheduling on other CPUs!
+    Processor::current().get_scheduler_data().m_ticks_since_aging++;
     if (current_thread->process().is_profiling()) {
         ASSERT(current_thread->process().perf_events());
         auto& perf_events = *current_thread->process().perf_events();
@@ -56,6 +56,8 @@ public:
     static void timer_tick(const RegisterState&);
     [[noreturn]] static void start();
     static bool pick_next();
+    static void queue_runnable_thread(Thread&);
+    static bool dequeue_runnable_thread(Thread&);
     static bool yield();
     static void yield_from_critical();
     static bool donate_to_and_switch(Thread*, const char* reason);
@@ -78,6 +80,9 @@ public:
     static inline IterationDecision for_each_nonrunnable(Callback);
 
     static void init_thread(Thread& thread);
+
+private:
+    static Thread* pull_next_runnable_thread(Thread& current_thread);
 };
 
 }
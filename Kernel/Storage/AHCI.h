@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// Register and structure layouts of the Advanced Host Controller Interface,
+// as described in the Serial ATA AHCI 1.3.1 specification:
+//      https://www.intel.com/content/www/us/en/io/serial-ata/serial-ata-ahci-spec-rev1-3-1.html
+//
+
+#pragma once
+
+#include <AK/Types.h>
+#include <Kernel/IO.h>
+
+namespace Kernel::AHCI {
+
+static constexpr size_t max_ports = 32;
+static constexpr size_t max_command_slots = 32;
+
+namespace HBACapabilities {
+static constexpr u32 NumberOfPortsMask = 0x1f;
+static constexpr u32 NumberOfCommandSlotsShift = 8;
+static constexpr u32 NumberOfCommandSlotsMask = 0x1f;
+static constexpr u32 SupportsNativeCommandQueuing = 1u << 30;
+static constexpr u32 Supports64BitAddressing = 1u << 31;
+}
+
+namespace HBACapabilitiesExtended {
+static constexpr u32 BIOSOSHandoff = 1u << 0;
+}
+
+namespace GlobalHBAControl {
+static constexpr u32 HBAReset = 1u << 0;
+static constexpr u32 InterruptEnable = 1u << 1;
+static constexpr u32 AHCIEnable = 1u << 31;
+}
+
+namespace BIOSOSHandoffControl {
+static constexpr u32 BIOSOwnedSemaphore = 1u << 0;
+static constexpr u32 OSOwnedSemaphore = 1u << 1;
+static constexpr u32 BIOSBusy = 1u << 4;
+}
+
+namespace PortCommand {
+static constexpr u32 Start = 1u << 0;
+static constexpr u32 SpinUpDevice = 1u << 1;
+static constexpr u32 PowerOnDevice = 1u << 2;
+static constexpr u32 FISReceiveEnable = 1u << 4;
+static constexpr u32 FISReceiveRunning = 1u << 14;
+static constexpr u32 CommandListRunning = 1u << 15;
+}
+
+namespace PortInterrupt {
+static constexpr u32 DeviceToHostRegisterFIS = 1u << 0;
+static constexpr u32 PIOSetupFIS = 1u << 1;
+static constexpr u32 DMASetupFIS = 1u << 2;
+static constexpr u32 SetDeviceBitsFIS = 1u << 3;
+static constexpr u32 DescriptorProcessed = 1u << 5;
+static constexpr u32 PortConnectChange = 1u << 6;
+static constexpr u32 OverflowStatus = 1u << 24;
+static constexpr u32 InterfaceNonFatalError = 1u << 26;
+static constexpr u32 InterfaceFatalError = 1u << 27;
+static constexpr u32 HostBusDataError = 1u << 28;
+static constexpr u32 HostBusFatalError = 1u << 29;
+static constexpr u32 TaskFileError = 1u << 30;
+
+static constexpr u32 Completion = DeviceToHostRegisterFIS | PIOSetupFIS | DMASetupFIS | SetDeviceBitsFIS | DescriptorProcessed;
+static constexpr u32 FatalErrors = OverflowStatus | InterfaceFatalError | HostBusDataError | HostBusFatalError | TaskFileError;
+}
+
+namespace PortTaskFileData {
+static constexpr u32 Error = 1u << 0;
+static constexpr u32 DataRequest = 1u << 3;
+static constexpr u32 Busy = 1u << 7;
+}
+
+namespace PortSATAStatus {
+static constexpr u32 DeviceDetectionMask = 0xf;
+static constexpr u32 DevicePresentAndCommunicating = 3;
+}
+
+namespace PortSignature {
+static constexpr u32 ATA = 0x00000101;
+static constexpr u32 ATAPI = 0xeb140101;
+}
+
+struct [[gnu::packed]] PortRegisters {
+    u32 command_list_base;
+    u32 command_list_base_upper;
+    u32 fis_base;
+    u32 fis_base_upper;
+    u32 interrupt_status;
+    u32 interrupt_enable;
+    u32 command;
+    u32 reserved;
+    u32 task_file_data;
+    u32 signature;
+    u32 sata_status;
+    u32 sata_control;
+    u32 sata_error;
+    u32 sata_active;
+    u32 command_issue;
+    u32 sata_notification;
+    u32 fis_based_switching_control;
+    u32 device_sleep;
+    u8 reserved2[0x70 - 0x48];
+    u8 vendor_specific[0x80 - 0x70];
+};
+static_assert(sizeof(PortRegisters) == 0x80);
+
+struct [[gnu::packed]] HBARegisters {
+    u32 capabilities;
+    u32 global_host_control;
+    u32 interrupt_status;
+    u32 ports_implemented;
+    u32 version;
+    u32 command_completion_coalescing_control;
+    u32 command_completion_coalescing_ports;
+    u32 enclosure_management_location;
+    u32 enclosure_management_control;
+    u32 capabilities_extended;
+    u32 bios_os_handoff_control;
+    u8 reserved[0xa0 - 0x2c];
+    u8 vendor_specific[0x100 - 0xa0];
+    PortRegisters ports[max_ports];
+};
+static_assert(sizeof(HBARegisters) == 0x1100);
+
+namespace CommandHeaderAttributes {
+static constexpr u16 FISLengthMask = 0x1f;
+static constexpr u16 Write = 1u << 6;
+static constexpr u16 Prefetchable = 1u << 7;
+static constexpr u16 ClearBusyUponOk = 1u << 10;
+}
+
+// One entry of a port's command list, there's one of these per command slot.
+struct [[gnu::packed]] CommandHeader {
+    u16 attributes;
+    u16 prdt_length;
+    volatile u32 prd_byte_count;
+    u32 command_table_base;
+    u32 command_table_base_upper;
+    u32 reserved[4];
+};
+static_assert(sizeof(CommandHeader) == 32);
+
+struct [[gnu::packed]] PhysicalRegionDescriptor {
+    u32 data_base;
+    u32 data_base_upper;
+    u32 reserved;
+    u32 byte_count_and_flags; // Byte count minus one in bits 0-21, interrupt on completion in bit 31.
+};
+static_assert(sizeof(PhysicalRegionDescriptor) == 16);
+
+static constexpr size_t max_prd_byte_count = 4 * MiB;
+
+namespace FISType {
+static constexpr u8 RegisterHostToDevice = 0x27;
+static constexpr u8 RegisterDeviceToHost = 0x34;
+static constexpr u8 SetDeviceBits = 0xa1;
+}
+
+struct [[gnu::packed]] RegisterHostToDeviceFIS {
+    u8 fis_type;
+    u8 port_multiplier_and_command; // Bit 7 is set for commands, clear for device control updates.
+    u8 command;
+    u8 feature_low;
+    u8 lba0;
+    u8 lba1;
+    u8 lba2;
+    u8 device;
+    u8 lba3;
+    u8 lba4;
+    u8 lba5;
+    u8 feature_high;
+    u8 count_low;
+    u8 count_high;
+    u8 isochronous_command_completion;
+    u8 control;
+    u8 reserved[4];
+};
+static_assert(sizeof(RegisterHostToDeviceFIS) == 20);
+
+// The area the HBA copies the FISes it receives from the device into.
+struct [[gnu::packed]] ReceivedFIS {
+    u8 dma_setup[0x20];
+    u8 pio_setup[0x20];
+    u8 register_device_to_host[0x18];
+    u8 set_device_bits[0x8];
+    u8 unknown[0x40];
+    u8 reserved[0x60];
+};
+static_assert(sizeof(ReceivedFIS) == 0x100);
+
+// Polls the condition every millisecond, giving up after the given time.
+template<typename Callback>
+inline bool wait_until(Callback condition, size_t milliseconds)
+{
+    for (size_t i = 0; i < milliseconds; ++i) {
+        if (condition())
+            return true;
+        IO::delay(1000);
+    }
+    return condition();
+}
+
+}
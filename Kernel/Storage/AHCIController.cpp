@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/OwnPtr.h>
+#include <AK/RefPtr.h>
+#include <AK/Types.h>
+#include <Kernel/IO.h>
+#include <Kernel/Storage/AHCIController.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+AHCIInterruptHandler::AHCIInterruptHandler(AHCIController& controller, u8 irq)
+    : IRQHandler(irq)
+    , m_parent_controller(controller)
+{
+    disable_irq();
+}
+
+AHCIInterruptHandler::~AHCIInterruptHandler()
+{
+}
+
+void AHCIInterruptHandler::handle_irq(const RegisterState&)
+{
+    m_parent_controller.handle_interrupt();
+}
+
+NonnullRefPtr<AHCIController> AHCIController::initialize(PCI::Address address)
+{
+    return adopt(*new AHCIController(address));
+}
+
+AHCIController::AHCIController(PCI::Address address)
+    : StorageController(address)
+{
+    initialize();
+}
+
+AHCIController::~AHCIController()
+{
+}
+
+bool AHCIController::reset()
+{
+    auto& hba = this->hba();
+    hba.global_host_control = AHCI::GlobalHBAControl::AHCIEnable;
+    hba.global_host_control = AHCI::GlobalHBAControl::AHCIEnable | AHCI::GlobalHBAControl::HBAReset;
+    if (!AHCI::wait_until([&] { return !(hba.global_host_control & AHCI::GlobalHBAControl::HBAReset); }, 1000))
+        return false;
+    // The reset clears AE on controllers that also support legacy mode.
+    hba.global_host_control = AHCI::GlobalHBAControl::AHCIEnable;
+    return true;
+}
+
+bool AHCIController::shutdown()
+{
+    auto& hba = this->hba();
+    hba.global_host_control = hba.global_host_control & ~AHCI::GlobalHBAControl::InterruptEnable;
+    for (auto& port : m_ports)
+        port.stop_command_engine();
+    return true;
+}
+
+size_t AHCIController::devices_count() const
+{
+    return m_ports.size();
+}
+
+RefPtr<StorageDevice> AHCIController::device(u32 index) const
+{
+    if (index >= m_ports.size())
+        return nullptr;
+    return m_ports[index].connected_device();
+}
+
+void AHCIController::start_request(const StorageDevice&, AsyncBlockDeviceRequest&)
+{
+    ASSERT_NOT_REACHED();
+}
+
+void AHCIController::complete_current_request(AsyncDeviceRequest::RequestResult)
+{
+    ASSERT_NOT_REACHED();
+}
+
+void AHCIController::take_ownership_from_bios()
+{
+    auto& hba = this->hba();
+    if (!(hba.capabilities_extended & AHCI::HBACapabilitiesExtended::BIOSOSHandoff))
+        return;
+
+    hba.bios_os_handoff_control = hba.bios_os_handoff_control | AHCI::BIOSOSHandoffControl::OSOwnedSemaphore;
+    if (!AHCI::wait_until([&] { return !(hba.bios_os_handoff_control & AHCI::BIOSOSHandoffControl::BIOSOwnedSemaphore); }, 25)) {
+        klog() << "AHCIController: BIOS didn't release the controller";
+        return;
+    }
+    // The BIOS may still be finishing outstanding commands.
+    if (hba.bios_os_handoff_control & AHCI::BIOSOSHandoffControl::BIOSBusy)
+        AHCI::wait_until([&] { return !(hba.bios_os_handoff_control & AHCI::BIOSOSHandoffControl::BIOSBusy); }, 2000);
+}
+
+void AHCIController::initialize()
+{
+    PCI::enable_bus_mastering(pci_address());
+    enable_pin_based_interrupts();
+
+    // The HBA registers live in BAR5, which need not be page-aligned.
+    auto hba_base = PCI::get_BAR5(pci_address()) & ~0xf;
+    size_t hba_size = PCI::get_BAR_space_size(pci_address(), 5);
+    m_hba_offset_in_region = hba_base & ~PAGE_MASK;
+    m_hba_region = MM.allocate_kernel_region(PhysicalAddress(page_base_of(hba_base)), PAGE_ROUND_UP(m_hba_offset_in_region + hba_size), "AHCI HBA", Region::Access::Read | Region::Access::Write, false, false);
+    if (!m_hba_region) {
+        klog() << "AHCIController: Failed to map the HBA registers";
+        return;
+    }
+
+    klog() << "AHCIController: Found @ " << pci_address() << ", HBA registers @ " << PhysicalAddress(hba_base) << ", version " << String::format("%#x", (u32)hba().version);
+
+    take_ownership_from_bios();
+    if (!reset()) {
+        klog() << "AHCIController: HBA reset timed out";
+        return;
+    }
+
+    u32 capabilities = hba().capabilities;
+    size_t command_slot_count = ((capabilities >> AHCI::HBACapabilities::NumberOfCommandSlotsShift) & AHCI::HBACapabilities::NumberOfCommandSlotsMask) + 1;
+    bool supports_ncq = capabilities & AHCI::HBACapabilities::SupportsNativeCommandQueuing;
+    klog() << "AHCIController: " << command_slot_count << " command slots, NCQ=" << supports_ncq;
+
+    m_interrupt_handler = make<AHCIInterruptHandler>(*this, PCI::get_interrupt_line(pci_address()));
+
+    u32 ports_implemented = hba().ports_implemented;
+    for (u32 port_index = 0; port_index < AHCI::max_ports; ++port_index) {
+        if (!(ports_implemented & (1u << port_index)))
+            continue;
+        auto port = AHCIPort::create(*this, hba().ports[port_index], port_index, command_slot_count, supports_ncq);
+        if (!port->initialize())
+            continue;
+        m_ports.append(move(port));
+    }
+
+    hba().interrupt_status = 0xffffffff;
+    hba().global_host_control = hba().global_host_control | AHCI::GlobalHBAControl::InterruptEnable;
+    m_interrupt_handler->enable_irq();
+}
+
+void AHCIController::handle_interrupt()
+{
+    auto& hba = this->hba();
+    u32 pending_ports = hba.interrupt_status;
+    if (!pending_ports)
+        return;
+
+    for (auto& port : m_ports) {
+        if (pending_ports & (1u << port.port_index()))
+            port.handle_interrupt();
+    }
+
+    // Port status has to be cleared first, otherwise the port would raise the interrupt again.
+    hba.interrupt_status = pending_ports;
+}
+
+}
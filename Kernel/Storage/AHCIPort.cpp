@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Memory.h>
+#include <AK/NumericLimits.h>
+#include <AK/StringView.h>
+#include <Kernel/IO.h>
+#include <Kernel/Process.h>
+#include <Kernel/Storage/AHCIController.h>
+#include <Kernel/Storage/AHCIPort.h>
+#include <Kernel/Storage/SATADiskDevice.h>
+#include <Kernel/Storage/StorageManagement.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+//#define AHCI_DEBUG
+
+#define ATA_CMD_READ_DMA_EXT 0x25
+#define ATA_CMD_WRITE_DMA_EXT 0x35
+#define ATA_CMD_READ_FPDMA_QUEUED 0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED 0x61
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_IDENT_WORD_QUEUE_DEPTH 75
+#define ATA_IDENT_WORD_SATA_CAPABILITIES 76
+#define ATA_IDENT_WORD_COMMAND_SETS 83
+#define ATA_IDENT_WORD_MAX_LBA_EXT 100
+
+NonnullOwnPtr<AHCIPort> AHCIPort::create(AHCIController& controller, volatile AHCI::PortRegisters& port_registers, u32 port_index, size_t command_slot_count, bool hba_supports_ncq)
+{
+    return make<AHCIPort>(controller, port_registers, port_index, command_slot_count, hba_supports_ncq);
+}
+
+AHCIPort::AHCIPort(AHCIController& controller, volatile AHCI::PortRegisters& port_registers, u32 port_index, size_t command_slot_count, bool hba_supports_ncq)
+    : m_parent_controller(controller)
+    , m_port_registers(port_registers)
+    , m_port_index(port_index)
+    , m_command_slot_count(command_slot_count)
+    , m_hba_supports_ncq(hba_supports_ncq)
+{
+    ASSERT(m_command_slot_count > 0 && m_command_slot_count <= AHCI::max_command_slots);
+}
+
+AHCIPort::~AHCIPort()
+{
+}
+
+bool AHCIPort::initialize()
+{
+    // The command list and FIS area may only be changed while the port is idle.
+    stop_command_engine();
+
+    // Give an attached device a moment to re-establish the link after the HBA reset.
+    bool has_device = AHCI::wait_until([&] { return (m_port_registers.sata_status & AHCI::PortSATAStatus::DeviceDetectionMask) == AHCI::PortSATAStatus::DevicePresentAndCommunicating; }, 10);
+    if (!has_device)
+        return false;
+
+    if (m_port_registers.signature != AHCI::PortSignature::ATA) {
+        klog() << "AHCIPort: Port " << m_port_index << ": Ignoring device with signature " << String::format("%#x", (u32)m_port_registers.signature);
+        return false;
+    }
+
+    m_command_list_page = MM.allocate_supervisor_physical_page();
+    m_command_table_region = MM.allocate_contiguous_kernel_region(PAGE_ROUND_UP(sizeof(CommandTable) * m_command_slot_count), "AHCI Command Tables", Region::Access::Read | Region::Access::Write);
+    m_bounce_buffer_region = MM.allocate_contiguous_kernel_region(bounce_buffer_count * bounce_buffer_size, "AHCI Bounce Buffers", Region::Access::Read | Region::Access::Write);
+    if (!m_command_list_page || !m_command_table_region || !m_bounce_buffer_region) {
+        klog() << "AHCIPort: Port " << m_port_index << ": Failed to allocate memory";
+        return false;
+    }
+
+    // The command list takes the first KiB of the page, and the received FIS area follows it.
+    auto command_list_paddr = m_command_list_page->paddr();
+    memset(command_list_paddr.offset(0xc0000000).as_ptr(), 0, AHCI::max_command_slots * sizeof(AHCI::CommandHeader) + sizeof(AHCI::ReceivedFIS));
+    memset(m_command_table_region->vaddr().as_ptr(), 0, m_command_table_region->size());
+    m_port_registers.command_list_base = command_list_paddr.get();
+    m_port_registers.command_list_base_upper = 0;
+    m_port_registers.fis_base = command_list_paddr.offset(AHCI::max_command_slots * sizeof(AHCI::CommandHeader)).get();
+    m_port_registers.fis_base_upper = 0;
+
+    m_port_registers.interrupt_enable = 0;
+    m_port_registers.sata_error = 0xffffffff;
+    m_port_registers.interrupt_status = 0xffffffff;
+
+    if (!start_command_engine()) {
+        klog() << "AHCIPort: Port " << m_port_index << ": Device didn't become ready";
+        return false;
+    }
+
+    if (!identify_device()) {
+        klog() << "AHCIPort: Port " << m_port_index << ": IDENTIFY DEVICE failed";
+        stop_command_engine();
+        return false;
+    }
+
+    auto* identify_data = reinterpret_cast<const u16*>(bounce_buffer(0));
+    if (!(identify_data[ATA_IDENT_WORD_COMMAND_SETS] & (1 << 10))) {
+        klog() << "AHCIPort: Port " << m_port_index << ": Device doesn't support 48-bit addressing";
+        stop_command_engine();
+        return false;
+    }
+
+    u64 sector_count = 0;
+    for (size_t i = 0; i < 4; ++i)
+        sector_count |= (u64)identify_data[ATA_IDENT_WORD_MAX_LBA_EXT + i] << (16 * i);
+
+    // With NCQ the drive may work on many commands at once, and decides itself in which
+    // order to carry them out. Without it, we can only give it one command at a time.
+    bool device_supports_ncq = identify_data[ATA_IDENT_WORD_SATA_CAPABILITIES] & (1 << 8);
+    m_uses_ncq = m_hba_supports_ncq && device_supports_ncq;
+    if (m_uses_ncq)
+        m_queue_depth = min<size_t>(m_command_slot_count, (identify_data[ATA_IDENT_WORD_QUEUE_DEPTH] & 0x1f) + 1);
+
+    // The model name is stored as big-endian words, and padded with spaces.
+    char model[41];
+    for (size_t i = 0; i < 20; ++i) {
+        model[i * 2] = identify_data[27 + i] >> 8;
+        model[i * 2 + 1] = identify_data[27 + i] & 0xff;
+    }
+    model[40] = '\0';
+    for (ssize_t i = 39; i >= 0 && model[i] == ' '; --i)
+        model[i] = '\0';
+
+    klog() << "AHCIPort: Port " << m_port_index << ": Name=" << model << ", Sectors=" << sector_count << ", NCQ=" << m_uses_ncq << ", Queue depth=" << m_queue_depth;
+
+    m_connected_device = SATADiskDevice::create(m_parent_controller, *this, 3, StorageManagement::allocate_disk_minor(), min<u64>(sector_count, NumericLimits<size_t>::max()));
+    m_port_registers.interrupt_enable = AHCI::PortInterrupt::Completion | AHCI::PortInterrupt::FatalErrors;
+    return true;
+}
+
+void AHCIPort::stop_command_engine()
+{
+    m_port_registers.command = m_port_registers.command & ~AHCI::PortCommand::Start;
+    if (!AHCI::wait_until([&] { return !(m_port_registers.command & AHCI::PortCommand::CommandListRunning); }, 500))
+        dbgln("AHCIPort: Port {}: Command list didn't stop", m_port_index);
+
+    m_port_registers.command = m_port_registers.command & ~AHCI::PortCommand::FISReceiveEnable;
+    if (!AHCI::wait_until([&] { return !(m_port_registers.command & AHCI::PortCommand::FISReceiveRunning); }, 500))
+        dbgln("AHCIPort: Port {}: FIS receive didn't stop", m_port_index);
+}
+
+bool AHCIPort::start_command_engine()
+{
+    m_port_registers.command = m_port_registers.command | AHCI::PortCommand::SpinUpDevice | AHCI::PortCommand::PowerOnDevice | AHCI::PortCommand::FISReceiveEnable;
+    if (!AHCI::wait_until([&] { return !(m_port_registers.task_file_data & (AHCI::PortTaskFileData::Busy | AHCI::PortTaskFileData::DataRequest)); }, 1000))
+        return false;
+    m_port_registers.command = m_port_registers.command | AHCI::PortCommand::Start;
+    return true;
+}
+
+bool AHCIPort::identify_device()
+{
+    // This runs before the port's interrupts are enabled, so we poll for completion.
+    // The data ends up in the first bounce buffer.
+    m_prdt_entry_count[0] = 0;
+    add_physical_region(0, bounce_buffer_paddr(0), 512);
+    build_command(0, ATA_CMD_IDENTIFY, 0, 0, false);
+    m_port_registers.command_issue = 1;
+
+    bool completed = AHCI::wait_until([&] {
+        return !(m_port_registers.command_issue & 1) || (m_port_registers.interrupt_status & AHCI::PortInterrupt::FatalErrors);
+    },
+        1000);
+    bool failed = !completed || (m_port_registers.command_issue & 1) || (m_port_registers.task_file_data & AHCI::PortTaskFileData::Error);
+    m_port_registers.interrupt_status = 0xffffffff;
+    return !failed;
+}
+
+void AHCIPort::recover_from_error()
+{
+    ASSERT(m_lock.is_locked());
+    stop_command_engine();
+    m_port_registers.sata_error = 0xffffffff;
+    m_port_registers.interrupt_status = 0xffffffff;
+
+    // If the device is stuck busy, it needs a COMRESET before it accepts commands again.
+    if (m_port_registers.task_file_data & (AHCI::PortTaskFileData::Busy | AHCI::PortTaskFileData::DataRequest)) {
+        u32 sata_control = m_port_registers.sata_control & ~0xf;
+        m_port_registers.sata_control = sata_control | 1;
+        IO::delay(1000);
+        m_port_registers.sata_control = sata_control;
+        AHCI::wait_until([&] { return (m_port_registers.sata_status & AHCI::PortSATAStatus::DeviceDetectionMask) == AHCI::PortSATAStatus::DevicePresentAndCommunicating; }, 1000);
+        m_port_registers.sata_error = 0xffffffff;
+    }
+
+    if (!start_command_engine())
+        dbgln("AHCIPort: Port {}: Device didn't recover from error", m_port_index);
+}
+
+volatile AHCI::CommandHeader& AHCIPort::command_header(size_t slot_index)
+{
+    return reinterpret_cast<volatile AHCI::CommandHeader*>(m_command_list_page->paddr().offset(0xc0000000).as_ptr())[slot_index];
+}
+
+AHCIPort::CommandTable& AHCIPort::command_table(size_t slot_index)
+{
+    return reinterpret_cast<CommandTable*>(m_command_table_region->vaddr().as_ptr())[slot_index];
+}
+
+PhysicalAddress AHCIPort::command_table_paddr(size_t slot_index) const
+{
+    return m_command_table_region->physical_page(0)->paddr().offset(slot_index * sizeof(CommandTable));
+}
+
+u8* AHCIPort::bounce_buffer(size_t index)
+{
+    return m_bounce_buffer_region->vaddr().offset(index * bounce_buffer_size).as_ptr();
+}
+
+PhysicalAddress AHCIPort::bounce_buffer_paddr(size_t index) const
+{
+    return m_bounce_buffer_region->physical_page(0)->paddr().offset(index * bounce_buffer_size);
+}
+
+void AHCIPort::build_command(size_t slot_index, u8 command, u64 lba, u16 block_count, bool is_write)
+{
+    auto& table = command_table(slot_index);
+    memset(table.command_fis, 0, sizeof(table.command_fis));
+    auto& fis = *reinterpret_cast<AHCI::RegisterHostToDeviceFIS*>(table.command_fis);
+    fis.fis_type = AHCI::FISType::RegisterHostToDevice;
+    fis.port_multiplier_and_command = 0x80;
+    fis.command = command;
+    fis.device = command == ATA_CMD_IDENTIFY ? 0 : 1 << 6; // LBA mode
+    fis.lba0 = lba & 0xff;
+    fis.lba1 = (lba >> 8) & 0xff;
+    fis.lba2 = (lba >> 16) & 0xff;
+    fis.lba3 = (lba >> 24) & 0xff;
+    fis.lba4 = (lba >> 32) & 0xff;
+    fis.lba5 = (lba >> 40) & 0xff;
+
+    if (command == ATA_CMD_READ_FPDMA_QUEUED || command == ATA_CMD_WRITE_FPDMA_QUEUED) {
+        // Queued commands carry the sector count in the feature field, and their tag in the count field.
+        fis.feature_low = block_count & 0xff;
+        fis.feature_high = block_count >> 8;
+        fis.count_low = slot_index << 3;
+    } else {
+        fis.count_low = block_count & 0xff;
+        fis.count_high = block_count >> 8;
+    }
+
+    auto& header = command_header(slot_index);
+    header.attributes = (sizeof(AHCI::RegisterHostToDeviceFIS) / sizeof(u32)) | (is_write ? AHCI::CommandHeaderAttributes::Write : 0);
+    header.prdt_length = m_prdt_entry_count[slot_index];
+    header.prd_byte_count = 0;
+    header.command_table_base = command_table_paddr(slot_index).get();
+    header.command_table_base_upper = 0;
+}
+
+bool AHCIPort::add_physical_region(size_t slot_index, PhysicalAddress paddr, size_t size)
+{
+    auto& table = command_table(slot_index);
+    auto& entry_count = m_prdt_entry_count[slot_index];
+    if (entry_count > 0) {
+        auto& last = table.prdt[entry_count - 1];
+        size_t last_size = (last.byte_count_and_flags & 0x3fffff) + 1;
+        if (last.data_base + last_size == paddr.get() && last_size + size <= AHCI::max_prd_byte_count) {
+            last.byte_count_and_flags = last_size + size - 1;
+            return true;
+        }
+    }
+
+    if (entry_count >= max_prdt_entries)
+        return false;
+    auto& entry = table.prdt[entry_count++];
+    entry.data_base = paddr.get();
+    entry.data_base_upper = 0;
+    entry.reserved = 0;
+    entry.byte_count_and_flags = size - 1;
+    return true;
+}
+
+bool AHCIPort::add_kernel_buffer(size_t slot_index, FlatPtr address, size_t size)
+{
+    // Data buffers must be word-aligned.
+    if (address % 2)
+        return false;
+
+    while (size > 0) {
+        size_t chunk_size = min<size_t>(size, PAGE_SIZE - (address & ~PAGE_MASK));
+        auto paddr = MM.physical_address_for_kernel_vaddr(VirtualAddress(address));
+        if (!paddr.has_value() || !add_physical_region(slot_index, paddr.value(), chunk_size)) {
+            m_prdt_entry_count[slot_index] = 0;
+            return false;
+        }
+        address += chunk_size;
+        size -= chunk_size;
+    }
+    return true;
+}
+
+Optional<size_t> AHCIPort::find_free_command_slot() const
+{
+    for (size_t i = 0; i < m_queue_depth; ++i) {
+        if (!(m_used_slots & (1u << i)))
+            return i;
+    }
+    return {};
+}
+
+Optional<size_t> AHCIPort::find_free_bounce_buffer() const
+{
+    for (size_t i = 0; i < bounce_buffer_count; ++i) {
+        if (!(m_used_bounce_buffers & (1u << i)))
+            return i;
+    }
+    return {};
+}
+
+bool AHCIPort::can_issue_request(const AsyncBlockDeviceRequest& request) const
+{
+    // The drive may finish queued commands in any order, so a request must not
+    // overtake one that's still in flight for the same blocks.
+    u32 first_block = request.block_index();
+    u32 end_block = first_block + request.block_count();
+    for (size_t i = 0; i < m_command_slot_count; ++i) {
+        if (!(m_used_slots & (1u << i)))
+            continue;
+        auto& other = *m_command_slots[i].request;
+        u32 other_first_block = other.block_index();
+        u32 other_end_block = other_first_block + other.block_count();
+        if (first_block < other_end_block && other_first_block < end_block)
+            return false;
+    }
+    return true;
+}
+
+void AHCIPort::start_request(AsyncBlockDeviceRequest& request)
+{
+    FinishedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_lock);
+#ifdef AHCI_DEBUG
+        dbg() << "AHCIPort::start_request port " << m_port_index << " (" << request.block_index() << " x" << request.block_count() << ")";
+#endif
+        m_pending_requests.append(&request);
+        issue_pending_requests(failed_requests);
+    }
+
+    for (auto& failed_request : failed_requests)
+        failed_request.request->complete(failed_request.result);
+}
+
+void AHCIPort::issue_pending_requests(FinishedRequests& failed_requests)
+{
+    ASSERT(m_lock.is_locked());
+    while (!m_pending_requests.is_empty()) {
+        auto& request = *m_pending_requests.first();
+        if (request.block_count() > max_sectors_per_command) {
+            failed_requests.append(CommandSlot { m_pending_requests.take_first(), {}, AsyncDeviceRequest::Failure });
+            continue;
+        }
+
+        // Requests are issued in the order they came in, the drive reorders them if it can.
+        if (!can_issue_request(request))
+            break;
+        auto slot_index = find_free_command_slot();
+        if (!slot_index.has_value())
+            break;
+
+        bool is_write = request.request_type() == AsyncBlockDeviceRequest::Write;
+        size_t size = request.block_count() * 512;
+        m_prdt_entry_count[slot_index.value()] = 0;
+
+        // Kernel memory with committed pages is handed to the HBA as is.
+        Optional<size_t> bounce_buffer_index;
+        if (!request.buffer().is_kernel_buffer() || !add_kernel_buffer(slot_index.value(), (FlatPtr)request.buffer().user_or_kernel_ptr(), size)) {
+            bounce_buffer_index = find_free_bounce_buffer();
+            if (!bounce_buffer_index.has_value())
+                break;
+            if (is_write && !request.read_from_buffer(request.buffer(), bounce_buffer(bounce_buffer_index.value()), size)) {
+                failed_requests.append(CommandSlot { m_pending_requests.take_first(), {}, AsyncDeviceRequest::MemoryFault });
+                continue;
+            }
+            // The bounce buffer is physically contiguous, so this is the table's only entry.
+            add_physical_region(slot_index.value(), bounce_buffer_paddr(bounce_buffer_index.value()), size);
+            m_used_bounce_buffers |= 1u << bounce_buffer_index.value();
+        }
+
+        m_pending_requests.take_first();
+        m_command_slots[slot_index.value()] = CommandSlot { &request, bounce_buffer_index, AsyncDeviceRequest::Pending };
+        u32 slot_bit = 1u << slot_index.value();
+        m_used_slots |= slot_bit;
+        m_issued_slots |= slot_bit;
+
+        u8 command;
+        if (m_uses_ncq)
+            command = is_write ? ATA_CMD_WRITE_FPDMA_QUEUED : ATA_CMD_READ_FPDMA_QUEUED;
+        else
+            command = is_write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+        build_command(slot_index.value(), command, request.block_index(), request.block_count(), is_write);
+
+#ifdef AHCI_DEBUG
+        dbg() << "AHCIPort: Port " << m_port_index << ": Issuing slot " << slot_index.value() << " (" << request.block_index() << " x" << request.block_count() << ")";
+#endif
+        if (m_uses_ncq)
+            m_port_registers.sata_active = slot_bit;
+        m_port_registers.command_issue = slot_bit;
+    }
+}
+
+void AHCIPort::handle_interrupt()
+{
+    u32 status = m_port_registers.interrupt_status;
+    m_port_registers.interrupt_status = status;
+    m_entropy_source.add_random_event(status);
+
+    ScopedSpinLock lock(m_lock);
+    u32 completed_slots = 0;
+    if (status & AHCI::PortInterrupt::FatalErrors) {
+        dbgln("AHCIPort: Port {}: Error, interrupt status {:#08x}, task file {:#08x}, SATA error {:#08x}", m_port_index, status, (u32)m_port_registers.task_file_data, (u32)m_port_registers.sata_error);
+        // We don't know which of the queued commands failed, so all of them have to go.
+        completed_slots = m_issued_slots;
+        for (size_t i = 0; i < m_command_slot_count; ++i) {
+            if (completed_slots & (1u << i))
+                m_command_slots[i].result = AsyncDeviceRequest::Failure;
+        }
+        recover_from_error();
+    } else {
+        // Queued commands are done once their bit in SACT is cleared, others once their bit in CI is.
+        u32 running_slots = m_port_registers.sata_active | m_port_registers.command_issue;
+        completed_slots = m_issued_slots & ~running_slots;
+        for (size_t i = 0; i < m_command_slot_count; ++i) {
+            if (completed_slots & (1u << i))
+                m_command_slots[i].result = AsyncDeviceRequest::Success;
+        }
+    }
+
+    if (!completed_slots)
+        return;
+    m_issued_slots &= ~completed_slots;
+    m_completed_slots |= completed_slots;
+
+    // Copying out of the bounce buffers could cause page faults, so we finish
+    // the requests once we've left the irq handler.
+    Processor::deferred_call_queue([this]() {
+        finish_completed_commands();
+    });
+}
+
+void AHCIPort::finish_completed_commands()
+{
+    u32 completed_slots;
+    {
+        ScopedSpinLock lock(m_lock);
+        completed_slots = m_completed_slots;
+        m_completed_slots = 0;
+    }
+
+    // Nobody else touches these slots until they're marked as free again.
+    FinishedRequests finished_requests;
+    for (size_t i = 0; i < m_command_slot_count; ++i) {
+        if (!(completed_slots & (1u << i)))
+            continue;
+        auto slot = m_command_slots[i];
+        auto& request = *slot.request;
+        if (slot.result == AsyncDeviceRequest::Success && slot.bounce_buffer_index.has_value() && request.request_type() == AsyncBlockDeviceRequest::Read) {
+            if (!request.write_to_buffer(request.buffer(), bounce_buffer(slot.bounce_buffer_index.value()), 512 * request.block_count()))
+                slot.result = AsyncDeviceRequest::MemoryFault;
+        }
+        finished_requests.append(slot);
+    }
+
+    FinishedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_lock);
+        for (auto& finished_request : finished_requests) {
+            if (finished_request.bounce_buffer_index.has_value())
+                m_used_bounce_buffers &= ~(1u << finished_request.bounce_buffer_index.value());
+        }
+        m_used_slots &= ~completed_slots;
+        issue_pending_requests(failed_requests);
+    }
+
+    for (auto& finished_request : finished_requests)
+        finished_request.request->complete(finished_request.result);
+    for (auto& failed_request : failed_requests)
+        failed_request.request->complete(failed_request.result);
+}
+
+}
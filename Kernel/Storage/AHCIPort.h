@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/RefPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <Kernel/Devices/Device.h>
+#include <Kernel/Random.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/Storage/AHCI.h>
+#include <Kernel/Storage/StorageDevice.h>
+#include <Kernel/VM/PhysicalPage.h>
+#include <Kernel/VM/Region.h>
+
+namespace Kernel {
+
+class AsyncBlockDeviceRequest;
+class AHCIController;
+
+class AHCIPort {
+    AK_MAKE_NONCOPYABLE(AHCIPort);
+    AK_MAKE_NONMOVABLE(AHCIPort);
+
+public:
+    // The most sectors we move with one command.
+    static constexpr size_t max_sectors_per_command = 128;
+
+    static NonnullOwnPtr<AHCIPort> create(AHCIController&, volatile AHCI::PortRegisters&, u32 port_index, size_t command_slot_count, bool hba_supports_ncq);
+    AHCIPort(AHCIController&, volatile AHCI::PortRegisters&, u32 port_index, size_t command_slot_count, bool hba_supports_ncq);
+    ~AHCIPort();
+
+    u32 port_index() const { return m_port_index; }
+    RefPtr<StorageDevice> connected_device() const { return m_connected_device; }
+
+    // Looks for a disk on the port and gets the command engine going if there is one.
+    bool initialize();
+
+    void start_request(AsyncBlockDeviceRequest&);
+    void handle_interrupt();
+
+    void stop_command_engine();
+
+private:
+    struct [[gnu::packed]] CommandTable {
+        u8 command_fis[64];
+        u8 atapi_command[16];
+        u8 reserved[48];
+        AHCI::PhysicalRegionDescriptor prdt[24];
+    };
+    static_assert(sizeof(CommandTable) % 128 == 0);
+    static constexpr size_t max_prdt_entries = sizeof(CommandTable::prdt) / sizeof(AHCI::PhysicalRegionDescriptor);
+
+    // Requests whose buffers we can't hand to the HBA directly go through one of these.
+    static constexpr size_t bounce_buffer_count = 4;
+    static constexpr size_t bounce_buffer_size = max_sectors_per_command * 512;
+
+    struct CommandSlot {
+        AsyncBlockDeviceRequest* request { nullptr };
+        Optional<size_t> bounce_buffer_index;
+        AsyncDeviceRequest::RequestResult result { AsyncDeviceRequest::Pending };
+    };
+
+    using FinishedRequests = Vector<CommandSlot, AHCI::max_command_slots>;
+
+    bool start_command_engine();
+    bool identify_device();
+    void recover_from_error();
+
+    void issue_pending_requests(FinishedRequests&);
+    bool can_issue_request(const AsyncBlockDeviceRequest&) const;
+    Optional<size_t> find_free_command_slot() const;
+    Optional<size_t> find_free_bounce_buffer() const;
+    void finish_completed_commands();
+
+    void build_command(size_t slot_index, u8 command, u64 lba, u16 block_count, bool is_write);
+    bool add_physical_region(size_t slot_index, PhysicalAddress, size_t);
+    bool add_kernel_buffer(size_t slot_index, FlatPtr, size_t);
+
+    volatile AHCI::CommandHeader& command_header(size_t slot_index);
+    CommandTable& command_table(size_t slot_index);
+    PhysicalAddress command_table_paddr(size_t slot_index) const;
+    u8* bounce_buffer(size_t index);
+    PhysicalAddress bounce_buffer_paddr(size_t index) const;
+
+    NonnullRefPtr<AHCIController> m_parent_controller;
+    volatile AHCI::PortRegisters& m_port_registers;
+    u32 m_port_index { 0 };
+    size_t m_command_slot_count { 0 };
+    bool m_hba_supports_ncq { false };
+    bool m_uses_ncq { false };
+    size_t m_queue_depth { 1 };
+
+    RefPtr<PhysicalPage> m_command_list_page;
+    OwnPtr<Region> m_command_table_region;
+    OwnPtr<Region> m_bounce_buffer_region;
+    EntropySource m_entropy_source;
+
+    RefPtr<StorageDevice> m_connected_device;
+
+    SpinLock<u8> m_lock;
+    // Requests waiting for a free command slot, oldest first.
+    Vector<AsyncBlockDeviceRequest*> m_pending_requests;
+    CommandSlot m_command_slots[AHCI::max_command_slots];
+    // Slots that hold a request, commands that the HBA is still working on, and commands
+    // that are done but whose requests haven't been completed yet.
+    u32 m_used_slots { 0 };
+    u32 m_issued_slots { 0 };
+    u32 m_completed_slots { 0 };
+    u32 m_used_bounce_buffers { 0 };
+    size_t m_prdt_entry_count[AHCI::max_command_slots] {};
+};
+
+}
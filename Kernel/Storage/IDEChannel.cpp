@@ -143,28 +143,214 @@ IDEChannel::~IDEChannel()
 {
 }
 
+static bool comes_before(bool is_slave, u32 block_index, bool other_is_slave, u32 other_block_index)
+{
+    if (is_slave != other_is_slave)
+        return !is_slave;
+    return block_index < other_block_index;
+}
+
 void IDEChannel::start_request(AsyncBlockDeviceRequest& request, bool use_dma, bool is_slave)
 {
-    ScopedSpinLock lock(m_request_lock);
+    FailedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_request_lock);
 #ifdef PATA_DEBUG
-    dbgln("IDEChannel::start_request");
+        dbgln("IDEChannel::start_request");
 #endif
-    m_current_request = &request;
-    m_current_request_block_index = 0;
-    m_current_request_uses_dma = use_dma;
-    m_current_request_flushing_cache = false;
-
-    if (request.request_type() == AsyncBlockDeviceRequest::Read) {
-        if (use_dma)
-            ata_read_sectors_with_dma(is_slave);
-        else
-            ata_read_sectors(is_slave);
-    } else {
-        if (use_dma)
-            ata_write_sectors_with_dma(is_slave);
-        else
-            ata_write_sectors(is_slave);
+        size_t index = 0;
+        while (index < m_queued_requests.size()) {
+            auto& queued_request = m_queued_requests[index];
+            if (comes_before(is_slave, request.block_index(), queued_request.is_slave, queued_request.request->block_index()))
+                break;
+            ++index;
+        }
+        m_queued_requests.insert(index, QueuedRequest { &request, m_next_sequence_number++, is_slave, use_dma });
+
+        if (!m_current_request)
+            start_next_transfer(failed_requests);
+    }
+
+    for (auto* failed_request : failed_requests)
+        failed_request->complete(AsyncDeviceRequest::MemoryFault);
+}
+
+bool IDEChannel::can_start_queued_request(size_t index) const
+{
+    // Requests may be served out of order, but never ahead of an older one touching the same blocks.
+    auto& queued_request = m_queued_requests[index];
+    u32 first_block = queued_request.request->block_index();
+    u32 end_block = first_block + queued_request.request->block_count();
+    for (auto& other : m_queued_requests) {
+        if (other.sequence_number >= queued_request.sequence_number || other.is_slave != queued_request.is_slave)
+            continue;
+        u32 other_first_block = other.request->block_index();
+        u32 other_end_block = other_first_block + other.request->block_count();
+        if (first_block < other_end_block && other_first_block < end_block)
+            return false;
+    }
+    return true;
+}
+
+size_t IDEChannel::pick_next_queued_request() const
+{
+    // Serve the first request at or past where the heads were left, and wrap around
+    // to the lowest one once the sweep has passed everything that's queued.
+    Optional<size_t> lowest_startable_index;
+    for (size_t index = 0; index < m_queued_requests.size(); ++index) {
+        if (!can_start_queued_request(index))
+            continue;
+        auto& queued_request = m_queued_requests[index];
+        if (!comes_before(queued_request.is_slave, queued_request.request->block_index(), m_head_is_slave, m_head_block_index))
+            return index;
+        if (!lowest_startable_index.has_value())
+            lowest_startable_index = index;
+    }
+    // The oldest request can always be started.
+    ASSERT(lowest_startable_index.has_value());
+    return lowest_startable_index.value();
+}
+
+void IDEChannel::start_next_transfer(FailedRequests& failed_requests)
+{
+    ASSERT(m_request_lock.is_locked());
+    while (!m_current_request && !m_queued_requests.is_empty()) {
+        size_t index = pick_next_queued_request();
+        auto first = m_queued_requests[index];
+        auto request_type = first.request->request_type();
+        u32 block_count = first.request->block_count();
+
+        // Requests that continue right where this one ends go out with it as a single command.
+        // Only kernel buffers are merged, so a fault in someone's user buffer can't fail the others.
+        size_t request_count = 1;
+        if (first.use_dma && first.request->buffer().is_kernel_buffer()) {
+            while (index + request_count < m_queued_requests.size() && request_count < max_requests_per_transfer) {
+                auto& next = m_queued_requests[index + request_count];
+                if (next.is_slave != first.is_slave || !next.use_dma || next.request->request_type() != request_type)
+                    break;
+                if (!next.request->buffer().is_kernel_buffer() || next.request->block_index() != first.request->block_index() + block_count)
+                    break;
+                if (block_count + next.request->block_count() > max_sectors_per_transfer || !can_start_queued_request(index + request_count))
+                    break;
+                block_count += next.request->block_count();
+                ++request_count;
+            }
+        }
+
+        ASSERT(m_current_transfer.is_empty());
+        for (size_t i = 0; i < request_count; ++i) {
+            m_current_transfer.append(TransferRequest { m_queued_requests[index].request, {}, AsyncDeviceRequest::Pending });
+            m_queued_requests.remove(index);
+        }
+
+        m_current_request = first.request;
+        m_current_transfer_block_index = first.request->block_index();
+        m_current_transfer_block_count = block_count;
+        m_current_request_block_index = 0;
+        m_current_request_uses_dma = first.use_dma;
+        m_current_request_flushing_cache = false;
+        m_head_is_slave = first.is_slave;
+        m_head_block_index = m_current_transfer_block_index + block_count;
+
+#ifdef PATA_DEBUG
+        dbg() << "IDEChannel: Starting transfer of " << request_count << " request(s), " << block_count << " block(s) @ LBA " << m_current_transfer_block_index;
+#endif
+
+        if (first.use_dma && !prepare_dma_transfer()) {
+            // Only a request with a user buffer can fault, and those are never merged.
+            for (auto& transfer_request : m_current_transfer)
+                failed_requests.append(transfer_request.request);
+            m_current_transfer.clear();
+            m_current_request = nullptr;
+            continue;
+        }
+
+        if (request_type == AsyncBlockDeviceRequest::Read) {
+            if (first.use_dma)
+                ata_read_sectors_with_dma(first.is_slave);
+            else
+                ata_read_sectors(first.is_slave);
+        } else {
+            if (first.use_dma)
+                ata_write_sectors_with_dma(first.is_slave);
+            else
+                ata_write_sectors(first.is_slave);
+        }
+    }
+}
+
+void IDEChannel::add_physical_region_to_prdt(PhysicalAddress paddr, size_t size)
+{
+    // A region must not cross a 64 KiB boundary, and a size of 0 would mean 64 KiB.
+    if (m_prdt_entry_count > 0) {
+        auto& last = prdt(m_prdt_entry_count - 1);
+        if (last.offset.offset(last.size) == paddr && (last.offset.get() >> 16) == ((paddr.get() + size - 1) >> 16) && last.size + size < 0x10000) {
+            last.size += size;
+            return;
+        }
+    }
+
+    ASSERT((paddr.get() >> 16) == ((paddr.get() + size - 1) >> 16));
+    ASSERT(m_prdt_entry_count < max_prdt_entries);
+    auto& entry = prdt(m_prdt_entry_count++);
+    entry.offset = paddr;
+    entry.size = size;
+    entry.end_of_table = 0;
+}
+
+bool IDEChannel::add_kernel_buffer_to_prdt(FlatPtr address, size_t size)
+{
+    // The bus master wants word-aligned regions, and some controllers want them dword-aligned.
+    if (address % 4)
+        return false;
+
+    size_t entry_count_before = m_prdt_entry_count;
+    while (size > 0) {
+        size_t chunk_size = min<size_t>(size, PAGE_SIZE - (address & ~PAGE_MASK));
+        auto paddr = MM.physical_address_for_kernel_vaddr(VirtualAddress(address));
+        if (!paddr.has_value()) {
+            m_prdt_entry_count = entry_count_before;
+            return false;
+        }
+        add_physical_region_to_prdt(paddr.value(), chunk_size);
+        address += chunk_size;
+        size -= chunk_size;
+    }
+    return true;
+}
+
+bool IDEChannel::prepare_dma_transfer()
+{
+    m_prdt_entry_count = 0;
+    size_t bounce_buffer_size = 0;
+    for (auto& transfer_request : m_current_transfer) {
+        auto& request = *transfer_request.request;
+        size_t size = 512 * request.block_count();
+
+        // Kernel memory with committed pages is handed to the bus master as is.
+        if (request.buffer().is_kernel_buffer() && add_kernel_buffer_to_prdt((FlatPtr)request.buffer().user_or_kernel_ptr(), size))
+            continue;
+
+        transfer_request.bounce_buffer_offset = bounce_buffer_size;
+        if (request.request_type() == AsyncBlockDeviceRequest::Write) {
+            if (!request.read_from_buffer(request.buffer(), m_dma_buffer_region->vaddr().offset(bounce_buffer_size).as_ptr(), size))
+                return false;
+        }
+        // Requests are only 512-byte aligned within the bounce buffer, so split them at page
+        // boundaries. That also keeps every region within a 64 KiB boundary.
+        auto bounce_buffer_paddr = m_dma_buffer_region->physical_page(0)->paddr().offset(bounce_buffer_size);
+        for (size_t offset = 0; offset < size;) {
+            auto paddr = bounce_buffer_paddr.offset(offset);
+            size_t chunk_size = min<size_t>(size - offset, PAGE_SIZE - (paddr.get() & ~PAGE_MASK));
+            add_physical_region_to_prdt(paddr, chunk_size);
+            offset += chunk_size;
+        }
+        bounce_buffer_size += size;
     }
+
+    ASSERT(bounce_buffer_size <= m_dma_buffer_region->size());
+    prdt(m_prdt_entry_count - 1).end_of_table = 0x8000;
+    return true;
 }
 
 void IDEChannel::complete_current_request(AsyncDeviceRequest::RequestResult result)
@@ -178,29 +364,50 @@ void IDEChannel::complete_current_request(AsyncDeviceRequest::RequestResult resu
     // which could cause page faults. Note that this may be called immediately
     // before Processor::deferred_call_queue returns!
     Processor::deferred_call_queue([this, result]() {
+        finish_current_transfer(result);
+    });
+}
+
+void IDEChannel::finish_current_transfer(AsyncDeviceRequest::RequestResult result)
+{
 #ifdef PATA_DEBUG
-        dbg() << "IDEChannel::complete_current_request result: " << result;
+    dbg() << "IDEChannel::finish_current_transfer result: " << result;
 #endif
-        ASSERT(m_current_request);
-        auto& request = *m_current_request;
-        m_current_request = nullptr;
+    ASSERT(m_current_request);
 
-        if (m_current_request_uses_dma) {
-            if (result == AsyncDeviceRequest::Success) {
-                if (request.request_type() == AsyncBlockDeviceRequest::Read) {
-                    if (!request.write_to_buffer(request.buffer(), m_dma_buffer_page->paddr().offset(0xc0000000).as_ptr(), 512 * request.block_count())) {
-                        request.complete(AsyncDeviceRequest::MemoryFault);
-                        return;
-                    }
-                }
+    // Nobody else touches the current transfer until m_current_request is cleared.
+    auto transfer = m_current_transfer;
+    m_current_transfer.clear();
 
-                // I read somewhere that this may trigger a cache flush so let's do it.
-                m_io_group.bus_master_base().offset(2).out<u8>(m_io_group.bus_master_base().offset(2).in<u8>() | 0x6);
-            }
+    for (auto& transfer_request : transfer) {
+        auto& request = *transfer_request.request;
+        transfer_request.result = result;
+        if (result != AsyncDeviceRequest::Success || !transfer_request.bounce_buffer_offset.has_value())
+            continue;
+        if (request.request_type() == AsyncBlockDeviceRequest::Read) {
+            auto* bounce_buffer = m_dma_buffer_region->vaddr().offset(transfer_request.bounce_buffer_offset.value()).as_ptr();
+            if (!request.write_to_buffer(request.buffer(), bounce_buffer, 512 * request.block_count()))
+                transfer_request.result = AsyncDeviceRequest::MemoryFault;
         }
+    }
 
-        request.complete(result);
-    });
+    if (m_current_request_uses_dma && result == AsyncDeviceRequest::Success) {
+        // I read somewhere that this may trigger a cache flush so let's do it.
+        m_io_group.bus_master_base().offset(2).out<u8>(m_io_group.bus_master_base().offset(2).in<u8>() | 0x6);
+    }
+
+    // Get the next transfer going before waking anyone up, the bounce buffer is free again.
+    FailedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_request_lock);
+        m_current_request = nullptr;
+        start_next_transfer(failed_requests);
+    }
+
+    for (auto& transfer_request : transfer)
+        transfer_request.request->complete(transfer_request.result);
+    for (auto* failed_request : failed_requests)
+        failed_request->complete(AsyncDeviceRequest::MemoryFault);
 }
 
 void IDEChannel::initialize(bool force_pio)
@@ -214,8 +421,7 @@ void IDEChannel::initialize(bool force_pio)
     // Let's try to set up DMA transfers.
     PCI::enable_bus_mastering(m_parent_controller->pci_address());
     m_prdt_page = MM.allocate_supervisor_physical_page();
-    prdt().end_of_table = 0x8000;
-    m_dma_buffer_page = MM.allocate_supervisor_physical_page();
+    m_dma_buffer_region = MM.allocate_contiguous_kernel_region(max_sectors_per_transfer * 512, "IDE DMA buffer", Region::Access::Read | Region::Access::Write);
     klog() << "IDEChannel: Bus master IDE: " << m_io_group.bus_master_base();
 }
 
@@ -366,17 +572,12 @@ void IDEChannel::detect_disks()
 
 void IDEChannel::ata_read_sectors_with_dma(bool slave_request)
 {
-    auto& request = *m_current_request;
-    u32 lba = request.block_index();
+    u32 lba = m_current_transfer_block_index;
+    u32 count = m_current_transfer_block_count;
 #ifdef PATA_DEBUG
-    dbg() << "IDEChannel::ata_read_sectors_with_dma (" << lba << " x" << request.block_count() << ")";
+    dbg() << "IDEChannel::ata_read_sectors_with_dma (" << lba << " x" << count << ")";
 #endif
 
-    prdt().offset = m_dma_buffer_page->paddr();
-    prdt().size = 512 * request.block_count();
-
-    ASSERT(prdt().size <= PAGE_SIZE);
-
     // Stop bus master
     m_io_group.bus_master_base().out<u8>(0);
 
@@ -398,12 +599,13 @@ void IDEChannel::ata_read_sectors_with_dma(bool slave_request)
 
     m_io_group.io_base().offset(ATA_REG_FEATURES).out<u16>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(0);
-    m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>(0);
+    // LBA48 takes the high bytes of the sector count and address first.
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>((count & 0xff00) >> 8);
+    m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0xff000000) >> 24);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>(0);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(request.block_count());
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(count & 0xff);
     m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0x000000ff) >> 0);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>((lba & 0x0000ff00) >> 8);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>((lba & 0x00ff0000) >> 16);
@@ -487,22 +689,12 @@ void IDEChannel::ata_read_sectors(bool slave_request)
 
 void IDEChannel::ata_write_sectors_with_dma(bool slave_request)
 {
-    auto& request = *m_current_request;
-    u32 lba = request.block_index();
+    u32 lba = m_current_transfer_block_index;
+    u32 count = m_current_transfer_block_count;
 #ifdef PATA_DEBUG
-    dbg() << "IDEChannel::ata_write_sectors_with_dma (" << lba << " x" << request.block_count() << ")";
+    dbg() << "IDEChannel::ata_write_sectors_with_dma (" << lba << " x" << count << ")";
 #endif
 
-    prdt().offset = m_dma_buffer_page->paddr();
-    prdt().size = 512 * request.block_count();
-
-    if (!request.read_from_buffer(request.buffer(), m_dma_buffer_page->paddr().offset(0xc0000000).as_ptr(), 512 * request.block_count())) {
-        complete_current_request(AsyncDeviceRequest::MemoryFault);
-        return;
-    }
-
-    ASSERT(prdt().size <= PAGE_SIZE);
-
     // Stop bus master
     m_io_group.bus_master_base().out<u8>(0);
 
@@ -521,12 +713,13 @@ void IDEChannel::ata_write_sectors_with_dma(bool slave_request)
 
     m_io_group.io_base().offset(ATA_REG_FEATURES).out<u16>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(0);
-    m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>(0);
+    // LBA48 takes the high bytes of the sector count and address first.
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>((count & 0xff00) >> 8);
+    m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0xff000000) >> 24);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>(0);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(request.block_count());
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(count & 0xff);
     m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0x000000ff) >> 0);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>((lba & 0x0000ff00) >> 8);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>((lba & 0x00ff0000) >> 16);
@@ -37,8 +37,10 @@
 
 #pragma once
 
+#include <AK/Optional.h>
 #include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
+#include <AK/Vector.h>
 #include <Kernel/Devices/Device.h>
 #include <Kernel/IO.h>
 #include <Kernel/Interrupts/IRQHandler.h>
@@ -47,6 +49,7 @@
 #include <Kernel/Random.h>
 #include <Kernel/Storage/StorageDevice.h>
 #include <Kernel/VM/PhysicalPage.h>
+#include <Kernel/VM/Region.h>
 #include <Kernel/WaitQueue.h>
 
 namespace Kernel {
@@ -104,6 +107,12 @@ public:
     };
 
 public:
+    // The most sectors we move with one command. DMA transfers that can't target the
+    // requests' own memory go through a bounce buffer of this size instead.
+    static constexpr size_t max_sectors_per_transfer = 256;
+    // Adjacent requests are merged into one transfer, up to this many at a time.
+    static constexpr size_t max_requests_per_transfer = 32;
+
     static NonnullOwnPtr<IDEChannel> create(const IDEController&, IOAddressGroup, ChannelType type, bool force_pio);
     IDEChannel(const IDEController&, IOAddressGroup, ChannelType type, bool force_pio);
     virtual ~IDEChannel() override;
@@ -120,8 +129,31 @@ private:
     void initialize(bool force_pio);
     void detect_disks();
 
+    struct QueuedRequest {
+        AsyncBlockDeviceRequest* request { nullptr };
+        u64 sequence_number { 0 };
+        bool is_slave { false };
+        bool use_dma { false };
+    };
+
+    struct TransferRequest {
+        AsyncBlockDeviceRequest* request { nullptr };
+        Optional<size_t> bounce_buffer_offset;
+        AsyncDeviceRequest::RequestResult result { AsyncDeviceRequest::Pending };
+    };
+
+    using FailedRequests = Vector<AsyncBlockDeviceRequest*, max_requests_per_transfer>;
+
     void start_request(AsyncBlockDeviceRequest&, bool, bool);
+    void start_next_transfer(FailedRequests&);
+    size_t pick_next_queued_request() const;
+    bool can_start_queued_request(size_t index) const;
     void complete_current_request(AsyncDeviceRequest::RequestResult);
+    void finish_current_transfer(AsyncDeviceRequest::RequestResult);
+
+    bool prepare_dma_transfer();
+    bool add_kernel_buffer_to_prdt(FlatPtr, size_t);
+    void add_physical_region_to_prdt(PhysicalAddress, size_t);
 
     void ata_read_sectors_with_dma(bool);
     void ata_read_sectors(bool);
@@ -135,15 +167,28 @@ private:
 
     volatile u8 m_device_error { 0 };
 
-    PhysicalRegionDescriptor& prdt() { return *reinterpret_cast<PhysicalRegionDescriptor*>(m_prdt_page->paddr().offset(0xc0000000).as_ptr()); }
+    static constexpr size_t max_prdt_entries = PAGE_SIZE / sizeof(PhysicalRegionDescriptor);
+    PhysicalRegionDescriptor& prdt(size_t index) { return reinterpret_cast<PhysicalRegionDescriptor*>(m_prdt_page->paddr().offset(0xc0000000).as_ptr())[index]; }
     RefPtr<PhysicalPage> m_prdt_page;
-    RefPtr<PhysicalPage> m_dma_buffer_page;
+    size_t m_prdt_entry_count { 0 };
+    OwnPtr<Region> m_dma_buffer_region;
     Lockable<bool> m_dma_enabled;
     EntropySource m_entropy_source;
 
     RefPtr<StorageDevice> m_master;
     RefPtr<StorageDevice> m_slave;
 
+    // Pending requests of both drives, sorted by drive and then block index.
+    Vector<QueuedRequest> m_queued_requests;
+    u64 m_next_sequence_number { 0 };
+
+    // Where the last transfer left the heads, so the elevator can keep sweeping upwards from there.
+    bool m_head_is_slave { false };
+    u32 m_head_block_index { 0 };
+
+    Vector<TransferRequest, max_requests_per_transfer> m_current_transfer;
+    u32 m_current_transfer_block_index { 0 };
+    u32 m_current_transfer_block_count { 0 };
     AsyncBlockDeviceRequest* m_current_request { nullptr };
     u32 m_current_request_block_index { 0 };
     bool m_current_request_uses_dma { false };
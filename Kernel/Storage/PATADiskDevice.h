@@ -58,6 +58,10 @@ public:
     // ^StorageDevice
     virtual Type type() const override { return StorageDevice::Type::IDE; }
     virtual size_t max_addressable_block() const override;
+    virtual size_t max_blocks_per_request() const override;
+
+    // ^Device
+    virtual bool schedules_own_requests() const override { return true; }
 
     // ^BlockDevice
     virtual void start_request(AsyncBlockDeviceRequest&) override;
@@ -47,6 +47,7 @@ public:
 
     // ^Device
     virtual mode_t required_mode() const override { return 0600; }
+    virtual bool schedules_own_requests() const override { return true; }
 
     const DiskPartitionMetadata& metadata() const;
 
@@ -48,6 +48,8 @@ class StorageController : public RefCounted<StorageController>
 public:
     enum class Type : u8 {
         IDE,
+        AHCI,
+        VirtIO,
         NVMe
     };
     virtual Type type() const = 0;
@@ -56,12 +56,9 @@ KResultOr<size_t> StorageDevice::read(FileDescription&, size_t offset, UserOrKer
     u16 whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
-    // PATAChannel will chuck a wobbly if we try to read more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
+    // Anything beyond what the device can transfer in one go is left for the caller to retry.
+    if (whole_blocks >= max_blocks_per_request()) {
+        whole_blocks = max_blocks_per_request();
         remaining = 0;
     }
 
@@ -123,12 +120,9 @@ KResultOr<size_t> StorageDevice::write(FileDescription&, size_t offset, const Us
     u16 whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
-    // PATAChannel will chuck a wobbly if we try to write more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
+    // Anything beyond what the device can transfer in one go is left for the caller to retry.
+    if (whole_blocks >= max_blocks_per_request()) {
+        whole_blocks = max_blocks_per_request();
         remaining = 0;
     }
 
@@ -40,12 +40,15 @@ class StorageDevice : public BlockDevice {
 public:
     enum class Type : u8 {
         IDE,
+        AHCI,
+        VirtIO,
         NVMe,
     };
 
 public:
     virtual Type type() const = 0;
     virtual size_t max_addressable_block() const { return m_max_addressable_block; }
+    virtual size_t max_blocks_per_request() const { return PAGE_SIZE / block_size(); }
 
     NonnullRefPtr<StorageController> controller() const;
 
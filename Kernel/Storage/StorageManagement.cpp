@@ -25,14 +25,17 @@
  */
 
 #include <AK/UUID.h>
+#include <Kernel/CommandLine.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/Ext2FileSystem.h>
 #include <Kernel/PCI/Access.h>
+#include <Kernel/Storage/AHCIController.h>
 #include <Kernel/Storage/IDEController.h>
 #include <Kernel/Storage/Partition/EBRPartitionTable.h>
 #include <Kernel/Storage/Partition/GUIDPartitionTable.h>
 #include <Kernel/Storage/Partition/MBRPartitionTable.h>
 #include <Kernel/Storage/StorageManagement.h>
+#include <Kernel/Storage/VirtIOBlockController.h>
 
 namespace Kernel {
 
@@ -59,10 +62,19 @@ bool StorageManagement::boot_argument_contains_partition_uuid()
 NonnullRefPtrVector<StorageController> StorageManagement::enumerate_controllers(bool force_pio) const
 {
     NonnullRefPtrVector<StorageController> controllers;
-    PCI::enumerate([&](const PCI::Address& address, PCI::ID) {
+    // FIXME: Enable the AHCI driver by default once it has been tested on real and emulated controllers.
+    bool ahci_enabled = kernel_command_line().lookup("ahci").value_or("off") == "on";
+    PCI::enumerate([&](const PCI::Address& address, PCI::ID id) {
         if (PCI::get_class(address) == 0x1 && PCI::get_subclass(address) == 0x1) {
             controllers.append(IDEController::initialize(address, force_pio));
         }
+        // SATA controllers in AHCI mode
+        if (ahci_enabled && PCI::get_class(address) == 0x1 && PCI::get_subclass(address) == 0x6 && PCI::get_programming_interface(address) == 0x1) {
+            controllers.append(AHCIController::initialize(address));
+        }
+        if (id.vendor_id == VIRTIO_PCI_VENDOR_ID && id.device_id == VIRTIO_PCI_DEVICE_ID_BLOCK) {
+            controllers.append(VirtIOBlockController::initialize(address));
+        }
     });
     return controllers;
 }
@@ -225,6 +237,13 @@ StorageManagement& StorageManagement::the()
     return *s_the;
 }
 
+int StorageManagement::allocate_disk_minor()
+{
+    // Disks on IDE controllers always take minors 0 to 3, see IDEChannel::detect_disks().
+    static int s_next_disk_minor = 4;
+    return s_next_disk_minor++;
+}
+
 NonnullRefPtrVector<StorageController> StorageManagement::ide_controllers() const
 {
     NonnullRefPtrVector<StorageController> ide_controllers;
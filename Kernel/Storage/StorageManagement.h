@@ -46,6 +46,9 @@ public:
     static void initialize(String boot_argument, bool force_pio);
     static StorageManagement& the();
 
+    // Minors for disks on controllers that don't assign fixed ones.
+    static int allocate_disk_minor();
+
     NonnullRefPtr<FS> root_filesystem() const;
 
     NonnullRefPtrVector<StorageController> ide_controllers() const;
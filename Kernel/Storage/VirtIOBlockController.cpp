@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NumericLimits.h>
+#include <Kernel/Process.h>
+#include <Kernel/Storage/StorageManagement.h>
+#include <Kernel/Storage/VirtIOBlockController.h>
+#include <Kernel/Storage/VirtIOBlockDevice.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+//#define VIRTIO_BLOCK_DEBUG
+
+#define VIRTIO_BLK_F_SIZE_MAX (1 << 1)
+#define VIRTIO_BLK_F_SEG_MAX (1 << 2)
+#define VIRTIO_BLK_F_RO (1 << 5)
+
+#define VIRTIO_BLK_CONFIG_CAPACITY 0
+#define VIRTIO_BLK_CONFIG_SIZE_MAX 8
+#define VIRTIO_BLK_CONFIG_SEG_MAX 12
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+
+#define VIRTIO_BLK_S_OK 0
+
+NonnullRefPtr<VirtIOBlockController> VirtIOBlockController::initialize(PCI::Address address)
+{
+    return adopt(*new VirtIOBlockController(address));
+}
+
+VirtIOBlockController::VirtIOBlockController(PCI::Address address)
+    : StorageController(address)
+    , VirtIODevice(address, "VirtIO Block Controller")
+{
+    initialize();
+}
+
+VirtIOBlockController::~VirtIOBlockController()
+{
+}
+
+void VirtIOBlockController::initialize()
+{
+    negotiate_features(VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO);
+
+    m_request_region = MM.allocate_contiguous_kernel_region(PAGE_SIZE, "VirtIO Block Requests", Region::Access::Read | Region::Access::Write);
+    m_bounce_buffer_region = MM.allocate_contiguous_kernel_region(bounce_buffer_count * bounce_buffer_size, "VirtIO Block Bounce Buffers", Region::Access::Read | Region::Access::Write);
+    if (!m_request_region || !m_bounce_buffer_region || !setup_queues(1)) {
+        klog() << "VirtIOBlockController: Failed to allocate memory";
+        fail_initialization();
+        return;
+    }
+
+    if (is_feature_accepted(VIRTIO_BLK_F_SEG_MAX))
+        m_max_segment_count = max<size_t>(1, min<size_t>(config_read32(VIRTIO_BLK_CONFIG_SEG_MAX), max_data_segments));
+    if (is_feature_accepted(VIRTIO_BLK_F_SIZE_MAX) && config_read32(VIRTIO_BLK_CONFIG_SIZE_MAX))
+        m_max_segment_size = min<size_t>(config_read32(VIRTIO_BLK_CONFIG_SIZE_MAX), bounce_buffer_size);
+    m_is_read_only = is_feature_accepted(VIRTIO_BLK_F_RO);
+
+    u64 capacity = config_read64(VIRTIO_BLK_CONFIG_CAPACITY);
+    klog() << "VirtIOBlockController: Sectors=" << capacity << ", Read-only=" << m_is_read_only << ", Queue size=" << queue(0).size();
+
+    m_device = VirtIOBlockDevice::create(*this, 3, StorageManagement::allocate_disk_minor(), min<u64>(capacity, NumericLimits<size_t>::max()));
+    finish_initialization();
+}
+
+bool VirtIOBlockController::reset()
+{
+    FinishedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_lock);
+        // negotiate_features() resets the device, so it forgets about every request we gave it.
+        negotiate_features(VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO);
+        if (!setup_queues(1)) {
+            klog() << "VirtIOBlockController: Failed to set up queues after reset";
+            fail_initialization();
+            return false;
+        }
+        m_is_read_only = is_feature_accepted(VIRTIO_BLK_F_RO);
+
+        // Requests that already completed are finished by finish_completed_requests() as usual.
+        u32 lost_slots = m_used_slots & ~m_completed_slots;
+        for (size_t i = 0; i < max_requests_in_flight; ++i) {
+            if (!(lost_slots & (1u << i)))
+                continue;
+            auto& slot = m_request_slots[i];
+            if (slot.bounce_buffer_index.has_value())
+                m_used_bounce_buffers &= ~(1u << slot.bounce_buffer_index.value());
+            failed_requests.append(RequestSlot { slot.request, {}, AsyncDeviceRequest::Failure });
+        }
+        m_used_slots &= ~lost_slots;
+
+        finish_initialization();
+        issue_pending_requests(failed_requests);
+    }
+
+    for (auto& failed_request : failed_requests)
+        failed_request.request->complete(failed_request.result);
+    return true;
+}
+
+bool VirtIOBlockController::shutdown()
+{
+    reset_device();
+    return true;
+}
+
+size_t VirtIOBlockController::devices_count() const
+{
+    return m_device ? 1 : 0;
+}
+
+RefPtr<StorageDevice> VirtIOBlockController::device(u32 index) const
+{
+    if (index > 0)
+        return nullptr;
+    return m_device;
+}
+
+void VirtIOBlockController::start_request(const StorageDevice&, AsyncBlockDeviceRequest&)
+{
+    ASSERT_NOT_REACHED();
+}
+
+void VirtIOBlockController::complete_current_request(AsyncDeviceRequest::RequestResult)
+{
+    ASSERT_NOT_REACHED();
+}
+
+VirtIOBlockController::RequestHeader& VirtIOBlockController::request_header(size_t slot_index)
+{
+    return reinterpret_cast<RequestHeader*>(m_request_region->vaddr().as_ptr())[slot_index];
+}
+
+volatile u8& VirtIOBlockController::request_status(size_t slot_index)
+{
+    return m_request_region->vaddr().offset(max_requests_in_flight * sizeof(RequestHeader) + slot_index).as_ptr()[0];
+}
+
+PhysicalAddress VirtIOBlockController::request_header_paddr(size_t slot_index) const
+{
+    return m_request_region->physical_page(0)->paddr().offset(slot_index * sizeof(RequestHeader));
+}
+
+PhysicalAddress VirtIOBlockController::request_status_paddr(size_t slot_index) const
+{
+    return m_request_region->physical_page(0)->paddr().offset(max_requests_in_flight * sizeof(RequestHeader) + slot_index);
+}
+
+Optional<size_t> VirtIOBlockController::find_free_request_slot() const
+{
+    for (size_t i = 0; i < max_requests_in_flight; ++i) {
+        if (!(m_used_slots & (1u << i)))
+            return i;
+    }
+    return {};
+}
+
+Optional<size_t> VirtIOBlockController::find_free_bounce_buffer() const
+{
+    for (size_t i = 0; i < bounce_buffer_count; ++i) {
+        if (!(m_used_bounce_buffers & (1u << i)))
+            return i;
+    }
+    return {};
+}
+
+bool VirtIOBlockController::can_issue_request(const AsyncBlockDeviceRequest& request) const
+{
+    // The device may finish requests in any order, so a request must not
+    // overtake one that's still in flight for the same blocks.
+    u32 first_block = request.block_index();
+    u32 end_block = first_block + request.block_count();
+    for (size_t i = 0; i < max_requests_in_flight; ++i) {
+        if (!(m_used_slots & (1u << i)))
+            continue;
+        auto& other = *m_request_slots[i].request;
+        u32 other_first_block = other.block_index();
+        u32 other_end_block = other_first_block + other.block_count();
+        if (first_block < other_end_block && other_first_block < end_block)
+            return false;
+    }
+    return true;
+}
+
+bool VirtIOBlockController::add_data_segment(Segments& segments, PhysicalAddress paddr, size_t size, bool device_writable) const
+{
+    // The first entry is the request header, which is never merged with the data.
+    if (segments.size() > 1) {
+        auto& last = segments.last();
+        if (last.address.offset(last.length) == paddr && last.length + size <= m_max_segment_size) {
+            last.length += size;
+            return true;
+        }
+    }
+    if (segments.size() - 1 >= m_max_segment_count)
+        return false;
+    segments.append({ paddr, (u32)size, device_writable });
+    return true;
+}
+
+bool VirtIOBlockController::add_kernel_buffer_segments(Segments& segments, FlatPtr address, size_t size, bool device_writable) const
+{
+    while (size > 0) {
+        size_t chunk_size = min<size_t>(size, PAGE_SIZE - (address & ~PAGE_MASK));
+        auto paddr = MM.physical_address_for_kernel_vaddr(VirtualAddress(address));
+        if (!paddr.has_value() || !add_data_segment(segments, paddr.value(), chunk_size, device_writable))
+            return false;
+        address += chunk_size;
+        size -= chunk_size;
+    }
+    return true;
+}
+
+void VirtIOBlockController::submit_request(AsyncBlockDeviceRequest& request)
+{
+    FinishedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_lock);
+#ifdef VIRTIO_BLOCK_DEBUG
+        dbg() << "VirtIOBlockController::submit_request (" << request.block_index() << " x" << request.block_count() << ")";
+#endif
+        m_pending_requests.append(&request);
+        issue_pending_requests(failed_requests);
+    }
+
+    for (auto& failed_request : failed_requests)
+        failed_request.request->complete(failed_request.result);
+}
+
+void VirtIOBlockController::issue_pending_requests(FinishedRequests& failed_requests)
+{
+    ASSERT(m_lock.is_locked());
+    bool supplied_any = false;
+    while (!m_pending_requests.is_empty()) {
+        auto& request = *m_pending_requests.first();
+        bool is_write = request.request_type() == AsyncBlockDeviceRequest::Write;
+        if (request.block_count() > max_sectors_per_request || (is_write && m_is_read_only)) {
+            failed_requests.append(RequestSlot { m_pending_requests.take_first(), {}, AsyncDeviceRequest::Failure });
+            continue;
+        }
+
+        // Requests are issued in the order they came in.
+        if (!can_issue_request(request))
+            break;
+        auto slot_index = find_free_request_slot();
+        if (!slot_index.has_value())
+            break;
+
+        size_t size = request.block_count() * 512;
+        Segments segments;
+        segments.append({ request_header_paddr(slot_index.value()), sizeof(RequestHeader), false });
+
+        // Kernel memory with committed pages is handed to the device as is.
+        Optional<size_t> bounce_buffer_index;
+        if (!request.buffer().is_kernel_buffer() || !add_kernel_buffer_segments(segments, (FlatPtr)request.buffer().user_or_kernel_ptr(), size, !is_write)) {
+            segments.resize(1);
+            bounce_buffer_index = find_free_bounce_buffer();
+            if (!bounce_buffer_index.has_value())
+                break;
+            auto* bounce_buffer = m_bounce_buffer_region->vaddr().offset(bounce_buffer_index.value() * bounce_buffer_size).as_ptr();
+            if (is_write && !request.read_from_buffer(request.buffer(), bounce_buffer, size)) {
+                failed_requests.append(RequestSlot { m_pending_requests.take_first(), {}, AsyncDeviceRequest::MemoryFault });
+                continue;
+            }
+            auto bounce_buffer_paddr = m_bounce_buffer_region->physical_page(0)->paddr().offset(bounce_buffer_index.value() * bounce_buffer_size);
+            bool fits = true;
+            for (size_t offset = 0; offset < size && fits; offset += PAGE_SIZE)
+                fits = add_data_segment(segments, bounce_buffer_paddr.offset(offset), min<size_t>(size - offset, PAGE_SIZE), !is_write);
+            if (!fits) {
+                // The device takes too few or too small segments for even a contiguous buffer.
+                failed_requests.append(RequestSlot { m_pending_requests.take_first(), {}, AsyncDeviceRequest::Failure });
+                continue;
+            }
+        }
+        segments.append({ request_status_paddr(slot_index.value()), 1, true });
+
+        if (queue(0).free_descriptor_count() < segments.size())
+            break;
+
+        auto& header = request_header(slot_index.value());
+        header.type = is_write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+        header.reserved = 0;
+        header.sector = request.block_index();
+        request_status(slot_index.value()) = 0xff;
+
+        bool supplied = queue(0).supply_buffers(segments.data(), segments.size(), &m_request_slots[slot_index.value()]);
+        ASSERT(supplied);
+        supplied_any = true;
+
+        m_pending_requests.take_first();
+        m_request_slots[slot_index.value()] = RequestSlot { &request, bounce_buffer_index, AsyncDeviceRequest::Pending };
+        m_used_slots |= 1u << slot_index.value();
+        if (bounce_buffer_index.has_value())
+            m_used_bounce_buffers |= 1u << bounce_buffer_index.value();
+    }
+
+    // One notification covers everything we've queued up.
+    if (supplied_any)
+        notify_queue(0);
+}
+
+void VirtIOBlockController::handle_queue_update(u16 queue_index)
+{
+    ASSERT(queue_index == 0);
+    ScopedSpinLock lock(m_lock);
+    u32 completed_slots = 0;
+    for (;;) {
+        auto used_buffers = queue(0).take_used_buffers();
+        if (!used_buffers.has_value())
+            break;
+        auto* slot = static_cast<RequestSlot*>(used_buffers->token);
+        size_t slot_index = slot - m_request_slots;
+        ASSERT(slot_index < max_requests_in_flight);
+        slot->result = request_status(slot_index) == VIRTIO_BLK_S_OK ? AsyncDeviceRequest::Success : AsyncDeviceRequest::Failure;
+        completed_slots |= 1u << slot_index;
+    }
+
+    if (!completed_slots)
+        return;
+    m_completed_slots |= completed_slots;
+
+    // Copying out of the bounce buffers could cause page faults, so we finish
+    // the requests once we've left the irq handler.
+    Processor::deferred_call_queue([this]() {
+        finish_completed_requests();
+    });
+}
+
+void VirtIOBlockController::finish_completed_requests()
+{
+    u32 completed_slots;
+    {
+        ScopedSpinLock lock(m_lock);
+        completed_slots = m_completed_slots;
+        m_completed_slots = 0;
+    }
+
+    // Nobody else touches these slots until they're marked as free again.
+    FinishedRequests finished_requests;
+    for (size_t i = 0; i < max_requests_in_flight; ++i) {
+        if (!(completed_slots & (1u << i)))
+            continue;
+        auto slot = m_request_slots[i];
+        auto& request = *slot.request;
+        if (slot.result == AsyncDeviceRequest::Success && slot.bounce_buffer_index.has_value() && request.request_type() == AsyncBlockDeviceRequest::Read) {
+            auto* bounce_buffer = m_bounce_buffer_region->vaddr().offset(slot.bounce_buffer_index.value() * bounce_buffer_size).as_ptr();
+            if (!request.write_to_buffer(request.buffer(), bounce_buffer, 512 * request.block_count()))
+                slot.result = AsyncDeviceRequest::MemoryFault;
+        }
+        finished_requests.append(slot);
+    }
+
+    FinishedRequests failed_requests;
+    {
+        ScopedSpinLock lock(m_lock);
+        for (auto& finished_request : finished_requests) {
+            if (finished_request.bounce_buffer_index.has_value())
+                m_used_bounce_buffers &= ~(1u << finished_request.bounce_buffer_index.value());
+        }
+        m_used_slots &= ~completed_slots;
+        issue_pending_requests(failed_requests);
+    }
+
+    for (auto& finished_request : finished_requests)
+        finished_request.request->complete(finished_request.result);
+    for (auto& failed_request : failed_requests)
+        failed_request.request->complete(failed_request.result);
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/OwnPtr.h>
+#include <AK/RefPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/Storage/StorageController.h>
+#include <Kernel/Storage/StorageDevice.h>
+#include <Kernel/VM/Region.h>
+#include <Kernel/VirtIO/VirtIO.h>
+
+namespace Kernel {
+
+class AsyncBlockDeviceRequest;
+
+class VirtIOBlockController final : public StorageController
+    , public VirtIODevice {
+    AK_MAKE_ETERNAL
+public:
+    // The most sectors we move with one request.
+    static constexpr size_t max_sectors_per_request = 128;
+
+    static NonnullRefPtr<VirtIOBlockController> initialize(PCI::Address address);
+    virtual ~VirtIOBlockController() override;
+
+    virtual Type type() const override { return Type::VirtIO; }
+    virtual RefPtr<StorageDevice> device(u32 index) const override;
+    virtual bool reset() override;
+    virtual bool shutdown() override;
+    virtual size_t devices_count() const override;
+    virtual void start_request(const StorageDevice&, AsyncBlockDeviceRequest&) override;
+    virtual void complete_current_request(AsyncDeviceRequest::RequestResult) override;
+
+    void submit_request(AsyncBlockDeviceRequest&);
+
+private:
+    explicit VirtIOBlockController(PCI::Address address);
+
+    void initialize();
+
+    // ^VirtIODevice
+    virtual void handle_queue_update(u16 queue_index) override;
+
+    struct [[gnu::packed]] RequestHeader {
+        u32 type;
+        u32 reserved;
+        u64 sector;
+    };
+
+    struct RequestSlot {
+        AsyncBlockDeviceRequest* request { nullptr };
+        Optional<size_t> bounce_buffer_index;
+        AsyncDeviceRequest::RequestResult result { AsyncDeviceRequest::Pending };
+    };
+
+    static constexpr size_t max_requests_in_flight = 32;
+    // Requests whose buffers we can't hand to the device directly go through one of these.
+    static constexpr size_t bounce_buffer_count = 4;
+    static constexpr size_t bounce_buffer_size = max_sectors_per_request * 512;
+    // An unaligned buffer touches one more page than it would otherwise.
+    static constexpr size_t max_data_segments = bounce_buffer_size / PAGE_SIZE + 1;
+
+    using FinishedRequests = Vector<RequestSlot, max_requests_in_flight>;
+    using Segments = Vector<VirtIOQueue::Buffer, max_data_segments + 2>;
+
+    void issue_pending_requests(FinishedRequests&);
+    bool can_issue_request(const AsyncBlockDeviceRequest&) const;
+    Optional<size_t> find_free_request_slot() const;
+    Optional<size_t> find_free_bounce_buffer() const;
+    bool add_data_segment(Segments&, PhysicalAddress, size_t, bool device_writable) const;
+    bool add_kernel_buffer_segments(Segments&, FlatPtr, size_t, bool device_writable) const;
+    void finish_completed_requests();
+
+    RequestHeader& request_header(size_t slot_index);
+    volatile u8& request_status(size_t slot_index);
+    PhysicalAddress request_header_paddr(size_t slot_index) const;
+    PhysicalAddress request_status_paddr(size_t slot_index) const;
+
+    RefPtr<StorageDevice> m_device;
+    OwnPtr<Region> m_request_region;
+    OwnPtr<Region> m_bounce_buffer_region;
+    bool m_is_read_only { false };
+    size_t m_max_segment_count { max_data_segments };
+    size_t m_max_segment_size { bounce_buffer_size };
+
+    SpinLock<u8> m_lock;
+    // Requests waiting for a free slot, oldest first.
+    Vector<AsyncBlockDeviceRequest*> m_pending_requests;
+    RequestSlot m_request_slots[max_requests_in_flight];
+    // Slots that hold a request, and requests that are done but haven't been completed yet.
+    u32 m_used_slots { 0 };
+    u32 m_completed_slots { 0 };
+    u32 m_used_bounce_buffers { 0 };
+};
+
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/Storage/VirtIOBlockController.h>
+#include <Kernel/Storage/VirtIOBlockDevice.h>
+
+namespace Kernel {
+
+NonnullRefPtr<VirtIOBlockDevice> VirtIOBlockDevice::create(VirtIOBlockController& controller, int major, int minor, size_t max_addressable_block)
+{
+    return adopt(*new VirtIOBlockDevice(controller, major, minor, max_addressable_block));
+}
+
+VirtIOBlockDevice::VirtIOBlockDevice(VirtIOBlockController& controller, int major, int minor, size_t max_addressable_block)
+    : StorageDevice(controller, major, minor, 512, max_addressable_block)
+    , m_controller(controller)
+{
+}
+
+VirtIOBlockDevice::~VirtIOBlockDevice()
+{
+}
+
+const char* VirtIOBlockDevice::class_name() const
+{
+    return "VirtIOBlockDevice";
+}
+
+void VirtIOBlockDevice::start_request(AsyncBlockDeviceRequest& request)
+{
+    m_controller.submit_request(request);
+}
+
+size_t VirtIOBlockDevice::max_blocks_per_request() const
+{
+    return VirtIOBlockController::max_sectors_per_request;
+}
+
+}
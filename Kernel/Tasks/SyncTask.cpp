@@ -28,19 +28,31 @@
 #include <Kernel/Process.h>
 #include <Kernel/Tasks/SyncTask.h>
 #include <Kernel/Time/TimeManagement.h>
+#include <Kernel/WaitQueue.h>
 
 namespace Kernel {
 
+static WaitQueue* s_sync_wait_queue;
+
 void SyncTask::spawn()
 {
+    s_sync_wait_queue = new WaitQueue;
+
     RefPtr<Thread> syncd_thread;
     Process::create_kernel_process(syncd_thread, "SyncTask", [] {
         dbgln("SyncTask is running");
         for (;;) {
             VFS::the().sync();
-            Thread::current()->sleep({ 1, 0 });
+            timespec timeout { 1, 0 };
+            Thread::current()->wait_on(*s_sync_wait_queue, Thread::BlockTimeout(false, &timeout), "SyncTask");
         }
     });
 }
 
+void SyncTask::wake()
+{
+    if (s_sync_wait_queue)
+        s_sync_wait_queue->wake_one();
+}
+
 }
@@ -30,5 +30,8 @@ namespace Kernel {
 class SyncTask {
 public:
     static void spawn();
+
+    // Ask the sync task to write back dirty data now instead of on its next periodic run.
+    static void wake();
 };
 }
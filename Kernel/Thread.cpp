@@ -134,6 +134,7 @@ Thread::~Thread()
         // the middle of being destroyed.
         ScopedSpinLock lock(g_scheduler_lock);
         g_scheduler_data->thread_list_for_state(m_state).remove(*this);
+        Scheduler::dequeue_runnable_thread(*this);
     }
 }
 
@@ -179,6 +180,15 @@ void Thread::unblock(u8 signal)
     set_state(Thread::Runnable);
 }
 
+void Thread::set_priority(u32 priority)
+{
+    ScopedSpinLock lock(g_scheduler_lock);
+    m_priority = priority;
+    // A queued thread has to move to the run queue bucket for its new priority.
+    if (Scheduler::dequeue_runnable_thread(*this))
+        Scheduler::queue_runnable_thread(*this);
+}
+
 void Thread::set_should_die()
 {
     if (m_should_die) {
@@ -946,6 +956,13 @@ void Thread::update_state_for_thread(Thread::State previous_state)
         previous_list.remove(*this);
     }
 
+    // Only threads that are waiting for a processor live in the run queues,
+    // the thread a processor is currently running has been pulled out already.
+    if (previous_state == Runnable)
+        Scheduler::dequeue_runnable_thread(*this);
+    else if (state() == Runnable)
+        Scheduler::queue_runnable_thread(*this);
+
     if (list.contains(*this))
         return;
 
@@ -100,7 +100,7 @@ public:
     ThreadID tid() const { return m_tid; }
     ProcessID pid() const;
 
-    void set_priority(u32 p) { m_priority = p; }
+    void set_priority(u32);
     u32 priority() const { return m_priority; }
 
     u32 effective_priority() const;
@@ -581,6 +581,10 @@ public:
 
         virtual bool unblock(bool, void*) = 0;
 
+        // Called with the block condition locked when a description of the file is about
+        // to be destroyed. Returning true removes the blocker from the block condition.
+        virtual bool description_will_be_destroyed(const FileDescription&) { return false; }
+
     protected:
         bool m_should_block { true };
     };
@@ -1157,9 +1161,13 @@ public:
 
 private:
     IntrusiveListNode m_runnable_list_node;
+    IntrusiveListNode m_ready_queue_node;
+    int m_runnable_priority { -1 };
+    u32 m_ready_queue_cpu { 0 };
 
 private:
     friend struct SchedulerData;
+    friend class SchedulerPerProcessorData;
     friend class WaitQueue;
 
     class JoinBlockCondition : public BlockCondition {
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <AK/Bitmap.h>
+#include <Kernel/FileSystem/ReadaheadState.h>
 #include <Kernel/UnixTypes.h>
 #include <Kernel/VM/VMObject.h>
 
@@ -50,6 +51,8 @@ public:
     u32 writable_mappings() const;
     u32 executable_mappings() const;
 
+    ReadaheadState& readahead_state() { return m_readahead_state; }
+
 protected:
     explicit InodeVMObject(Inode&, size_t);
     explicit InodeVMObject(const InodeVMObject&);
@@ -64,6 +67,7 @@ protected:
 
     NonnullRefPtr<Inode> m_inode;
     Bitmap m_dirty_pages;
+    ReadaheadState m_readahead_state;
 };
 
 }
@@ -318,6 +318,22 @@ Region* MemoryManager::kernel_region_from_vaddr(VirtualAddress vaddr)
     return nullptr;
 }
 
+Optional<PhysicalAddress> MemoryManager::physical_address_for_kernel_vaddr(VirtualAddress vaddr)
+{
+    // The kernel image and kmalloc heap are mapped linearly to low physical memory.
+    if (vaddr.get() >= FlatPtr(&start_of_kernel_image) && vaddr.get() < FlatPtr(kmalloc_end))
+        return PhysicalAddress(virtual_to_low_physical(vaddr.get()));
+
+    ScopedSpinLock lock(s_mm_lock);
+    auto* region = kernel_region_from_vaddr(vaddr);
+    if (!region)
+        return {};
+    auto* page = region->physical_page((vaddr.get() - region->vaddr().get()) / PAGE_SIZE);
+    if (!page || page->is_shared_zero_page() || page->is_lazy_committed_page())
+        return {};
+    return page->paddr().offset(vaddr.get() & ~PAGE_MASK);
+}
+
 Region* MemoryManager::user_region_from_vaddr(Process& process, VirtualAddress vaddr)
 {
     ScopedSpinLock lock(s_mm_lock);
@@ -28,6 +28,7 @@
 
 #include <AK/HashTable.h>
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/Optional.h>
 #include <AK/String.h>
 #include <Kernel/Arch/i386/CPU.h>
 #include <Kernel/Forward.h>
@@ -128,6 +129,9 @@ public:
     OwnPtr<Region> allocate_kernel_region_with_vmobject(const Range&, VMObject&, const StringView& name, u8 access, bool user_accessible = false, bool cacheable = true);
     OwnPtr<Region> allocate_user_accessible_kernel_region(size_t, const StringView& name, u8 access, bool cacheable = true);
 
+    // Only succeeds if a physical page is committed behind the address, so it's safe to hand to a DMA engine.
+    Optional<PhysicalAddress> physical_address_for_kernel_vaddr(VirtualAddress);
+
     unsigned user_physical_pages() const { return m_user_physical_pages; }
     unsigned user_physical_pages_used() const { return m_user_physical_pages_used; }
     unsigned user_physical_pages_committed() const { return m_user_physical_pages_committed; }
@@ -539,6 +539,7 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
 #endif
         if (!remap_vmobject_page(page_index_in_vmobject))
             return PageFaultResponse::OutOfMemory;
+        fault_around(page_index_in_vmobject);
         return PageFaultResponse::Continue;
     }
 
@@ -546,6 +547,41 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
     if (current_thread)
         current_thread->did_inode_fault();
 
+    // If the mapping is being faulted in sequentially, get the inode to read
+    // ahead into the disk cache in large batches, and populate the pages in
+    // that range too so that the next faults find them already present.
+    auto readahead = inode_vmobject.readahead_state().did_access(page_index_in_vmobject * PAGE_SIZE, PAGE_SIZE);
+    if (readahead.size)
+        inode_vmobject.inode().read_ahead(readahead.offset, readahead.size);
+
+    auto response = page_in_from_inode(inode_vmobject, page_index_in_vmobject);
+    if (response != PageFaultResponse::Continue)
+        return response;
+    remap_vmobject_page(page_index_in_vmobject);
+
+    if (readahead.size) {
+        size_t first_page = readahead.offset / PAGE_SIZE;
+        size_t end_page = min(ceil_div(readahead.offset + readahead.size, PAGE_SIZE), inode_vmobject.page_count());
+        for (size_t page_index = first_page; page_index < end_page; ++page_index) {
+            if (!inode_vmobject.physical_pages()[page_index].is_null())
+                continue;
+            // Readahead is opportunistic, so just stop if we can't get a page.
+            if (page_in_from_inode(inode_vmobject, page_index) != PageFaultResponse::Continue)
+                break;
+            remap_vmobject_page(page_index, false);
+        }
+    }
+
+    fault_around(page_index_in_vmobject);
+    return PageFaultResponse::Continue;
+}
+
+PageFaultResponse Region::page_in_from_inode(InodeVMObject& inode_vmobject, size_t page_index_in_vmobject)
+{
+    ASSERT(inode_vmobject.m_paging_lock.is_locked());
+    auto& vmobject_physical_page_entry = inode_vmobject.physical_pages()[page_index_in_vmobject];
+    ASSERT(vmobject_physical_page_entry.is_null());
+
     u8 page_buffer[PAGE_SIZE];
     auto& inode = inode_vmobject.inode();
     auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
@@ -579,11 +615,25 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
         }
     }
     MM.unquickmap_page();
-
-    remap_vmobject_page(page_index_in_vmobject);
     return PageFaultResponse::Continue;
 }
 
+void Region::fault_around(size_t page_index_in_vmobject)
+{
+    // Map the neighbouring pages that are already in the page cache, so that
+    // we don't take a separate fault for each of them. The PTEs weren't
+    // present before, so there's no need to flush the TLB for them.
+    static constexpr size_t fault_around_pages = 16;
+    size_t first_page = max(first_page_index(), page_index_in_vmobject & ~(fault_around_pages - 1));
+    size_t end_page = min(first_page_index() + page_count(), first_page + fault_around_pages);
+    for (size_t page_index = first_page; page_index < end_page; ++page_index) {
+        if (page_index == page_index_in_vmobject || vmobject().physical_pages()[page_index].is_null())
+            continue;
+        if (!remap_vmobject_page(page_index, false))
+            break;
+    }
+}
+
 RefPtr<Process> Region::get_owner()
 {
     return m_owner.strong_ref();
@@ -256,6 +256,8 @@ private:
     PageFaultResponse handle_cow_fault(size_t page_index);
     PageFaultResponse handle_inode_fault(size_t page_index);
     PageFaultResponse handle_zero_fault(size_t page_index);
+    PageFaultResponse page_in_from_inode(InodeVMObject&, size_t page_index_in_vmobject);
+    void fault_around(size_t page_index_in_vmobject);
 
     bool map_individual_page_impl(size_t page_index);
 
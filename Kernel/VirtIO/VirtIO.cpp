@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/VirtIO/VirtIO.h>
+
+namespace Kernel {
+
+//#define VIRTIO_DEBUG
+
+#define VIRTIO_PCI_HOST_FEATURES 0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN 0x08
+#define VIRTIO_PCI_QUEUE_SIZE 0x0c
+#define VIRTIO_PCI_QUEUE_SELECT 0x0e
+#define VIRTIO_PCI_QUEUE_NOTIFY 0x10
+#define VIRTIO_PCI_STATUS 0x12
+#define VIRTIO_PCI_ISR 0x13
+// Device specific configuration follows the common registers, as long as MSI-X is disabled.
+#define VIRTIO_PCI_CONFIG 0x14
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 1
+#define VIRTIO_STATUS_DRIVER 2
+#define VIRTIO_STATUS_DRIVER_OK 4
+#define VIRTIO_STATUS_FAILED 128
+
+#define VIRTIO_ISR_QUEUE_INTERRUPT 1
+#define VIRTIO_ISR_CONFIG_INTERRUPT 2
+
+VirtIOInterruptHandler::VirtIOInterruptHandler(VirtIODevice& device, u8 irq)
+    : IRQHandler(irq)
+    , m_parent_device(device)
+{
+    disable_irq();
+}
+
+VirtIOInterruptHandler::~VirtIOInterruptHandler()
+{
+}
+
+const char* VirtIOInterruptHandler::purpose() const
+{
+    return m_parent_device.m_device_name;
+}
+
+void VirtIOInterruptHandler::handle_irq(const RegisterState&)
+{
+    m_parent_device.handle_interrupt();
+}
+
+VirtIODevice::VirtIODevice(PCI::Address address, const char* device_name)
+    : m_device_name(device_name)
+    , m_pci_address(address)
+    , m_io_base(PCI::get_BAR0(address) & ~1)
+{
+    klog() << "VirtIO: Found " << device_name << " @ " << address << ", I/O base " << m_io_base;
+    PCI::enable_bus_mastering(address);
+    PCI::enable_interrupt_line(address);
+    m_interrupt_handler = make<VirtIOInterruptHandler>(*this, PCI::get_interrupt_line(address));
+}
+
+VirtIODevice::~VirtIODevice()
+{
+}
+
+void VirtIODevice::set_status_bit(u8 bit)
+{
+    auto status = m_io_base.offset(VIRTIO_PCI_STATUS);
+    status.out<u8>(status.in<u8>() | bit);
+}
+
+void VirtIODevice::reset_device()
+{
+    m_io_base.offset(VIRTIO_PCI_STATUS).out<u8>(0);
+}
+
+void VirtIODevice::negotiate_features(u32 wanted_features)
+{
+    reset_device();
+    set_status_bit(VIRTIO_STATUS_ACKNOWLEDGE);
+    set_status_bit(VIRTIO_STATUS_DRIVER);
+
+    u32 offered_features = m_io_base.offset(VIRTIO_PCI_HOST_FEATURES).in<u32>();
+    m_accepted_features = offered_features & wanted_features;
+    m_io_base.offset(VIRTIO_PCI_GUEST_FEATURES).out<u32>(m_accepted_features);
+#ifdef VIRTIO_DEBUG
+    dbgln("VirtIO: {} offers features {:#08x}, accepted {:#08x}", m_device_name, offered_features, m_accepted_features);
+#endif
+}
+
+bool VirtIODevice::setup_queues(u16 queue_count)
+{
+    // The device forgets its queues when it's reset, so start over with fresh ones.
+    m_queues.clear();
+    for (u16 queue_index = 0; queue_index < queue_count; ++queue_index) {
+        m_io_base.offset(VIRTIO_PCI_QUEUE_SELECT).out<u16>(queue_index);
+        u16 queue_size = m_io_base.offset(VIRTIO_PCI_QUEUE_SIZE).in<u16>();
+        auto queue = VirtIOQueue::try_create(queue_size);
+        if (!queue) {
+            klog() << "VirtIO: " << m_device_name << ": Failed to set up queue " << queue_index << " of size " << queue_size;
+            return false;
+        }
+        m_io_base.offset(VIRTIO_PCI_QUEUE_PFN).out<u32>(queue->physical_address().get() >> 12);
+        m_queues.append(queue.release_nonnull());
+    }
+    return true;
+}
+
+void VirtIODevice::finish_initialization()
+{
+    set_status_bit(VIRTIO_STATUS_DRIVER_OK);
+    m_interrupt_handler->enable_irq();
+}
+
+void VirtIODevice::fail_initialization()
+{
+    set_status_bit(VIRTIO_STATUS_FAILED);
+}
+
+void VirtIODevice::notify_queue(u16 index)
+{
+    // Every notification is a trip out of the guest, so skip it if the device is polling anyway.
+    if (!queue(index).device_wants_notification())
+        return;
+    m_io_base.offset(VIRTIO_PCI_QUEUE_NOTIFY).out<u16>(index);
+}
+
+u8 VirtIODevice::config_read8(u16 offset)
+{
+    return m_io_base.offset(VIRTIO_PCI_CONFIG + offset).in<u8>();
+}
+
+u16 VirtIODevice::config_read16(u16 offset)
+{
+    return m_io_base.offset(VIRTIO_PCI_CONFIG + offset).in<u16>();
+}
+
+u32 VirtIODevice::config_read32(u16 offset)
+{
+    return m_io_base.offset(VIRTIO_PCI_CONFIG + offset).in<u32>();
+}
+
+u64 VirtIODevice::config_read64(u16 offset)
+{
+    // The two halves aren't read atomically, so read until we get a consistent value.
+    for (;;) {
+        u32 high = config_read32(offset + 4);
+        u32 low = config_read32(offset);
+        if (high == config_read32(offset + 4))
+            return ((u64)high << 32) | low;
+    }
+}
+
+void VirtIODevice::handle_interrupt()
+{
+    // Reading the ISR status also deasserts the interrupt.
+    u8 isr_status = m_io_base.offset(VIRTIO_PCI_ISR).in<u8>();
+    if (!isr_status)
+        return;
+
+    if (isr_status & VIRTIO_ISR_QUEUE_INTERRUPT) {
+        for (u16 queue_index = 0; queue_index < m_queues.size(); ++queue_index)
+            handle_queue_update(queue_index);
+    }
+    if (isr_status & VIRTIO_ISR_CONFIG_INTERRUPT)
+        handle_config_change();
+}
+
+}
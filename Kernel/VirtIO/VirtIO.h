@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//
+// VirtIO devices behind the legacy PCI interface, as described in section 4.1.4.8 of
+// the Virtual I/O Device (VIRTIO) 1.1 specification:
+//      https://docs.oasis-open.org/virtio/virtio/v1.1/virtio-v1.1.html
+//
+
+#pragma once
+
+#include <AK/NonnullOwnPtrVector.h>
+#include <AK/OwnPtr.h>
+#include <AK/Types.h>
+#include <Kernel/IO.h>
+#include <Kernel/Interrupts/IRQHandler.h>
+#include <Kernel/PCI/Access.h>
+#include <Kernel/VirtIO/VirtIOQueue.h>
+
+namespace Kernel {
+
+#define VIRTIO_PCI_VENDOR_ID 0x1af4
+// Transitional devices, which still speak the legacy interface.
+#define VIRTIO_PCI_DEVICE_ID_NETWORK 0x1000
+#define VIRTIO_PCI_DEVICE_ID_BLOCK 0x1001
+
+class VirtIODevice;
+
+class VirtIOInterruptHandler final : public IRQHandler {
+public:
+    VirtIOInterruptHandler(VirtIODevice&, u8 irq);
+    virtual ~VirtIOInterruptHandler() override;
+
+    virtual const char* purpose() const override;
+
+private:
+    //^ IRQHandler
+    virtual void handle_irq(const RegisterState&) override;
+
+    VirtIODevice& m_parent_device;
+};
+
+class VirtIODevice {
+    AK_MAKE_NONCOPYABLE(VirtIODevice);
+    AK_MAKE_NONMOVABLE(VirtIODevice);
+    friend class VirtIOInterruptHandler;
+
+public:
+    virtual ~VirtIODevice();
+
+protected:
+    VirtIODevice(PCI::Address, const char* device_name);
+
+    // Resets the device and accepts whichever of the wanted features it offers.
+    void negotiate_features(u32 wanted_features);
+    bool is_feature_accepted(u32 feature) const { return (m_accepted_features & feature) == feature; }
+
+    bool setup_queues(u16 queue_count);
+    void finish_initialization();
+    void fail_initialization();
+    void reset_device();
+
+    VirtIOQueue& queue(u16 index) { return m_queues[index]; }
+    void notify_queue(u16 index);
+
+    u8 config_read8(u16 offset);
+    u16 config_read16(u16 offset);
+    u32 config_read32(u16 offset);
+    u64 config_read64(u16 offset);
+
+    // These are called from the irq handler.
+    virtual void handle_queue_update(u16 queue_index) = 0;
+    virtual void handle_config_change() { }
+
+private:
+    void set_status_bit(u8);
+    void handle_interrupt();
+
+    const char* m_device_name { nullptr };
+    PCI::Address m_pci_address;
+    IOAddress m_io_base;
+    u32 m_accepted_features { 0 };
+    NonnullOwnPtrVector<VirtIOQueue> m_queues;
+    OwnPtr<VirtIOInterruptHandler> m_interrupt_handler;
+};
+
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Atomic.h>
+#include <AK/Memory.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VirtIO/VirtIOQueue.h>
+
+namespace Kernel {
+
+size_t VirtIOQueue::driver_ring_offset(u16 queue_size)
+{
+    return sizeof(VirtIOQueueDescriptor) * queue_size;
+}
+
+size_t VirtIOQueue::device_ring_offset(u16 queue_size)
+{
+    // The legacy interface wants the device ring on the next page boundary after the
+    // driver ring, which ends with the used_event field.
+    return PAGE_ROUND_UP(driver_ring_offset(queue_size) + sizeof(VirtIOQueueDriverRing) + sizeof(u16) * (queue_size + 1));
+}
+
+OwnPtr<VirtIOQueue> VirtIOQueue::try_create(u16 queue_size)
+{
+    if (!queue_size)
+        return {};
+    size_t size = device_ring_offset(queue_size) + PAGE_ROUND_UP(sizeof(VirtIOQueueDeviceRing) + sizeof(VirtIOQueueDeviceRingElement) * queue_size + sizeof(u16));
+    auto region = MM.allocate_contiguous_kernel_region(size, "VirtIO Queue", Region::Access::Read | Region::Access::Write);
+    if (!region)
+        return {};
+    return make<VirtIOQueue>(queue_size, region.release_nonnull());
+}
+
+VirtIOQueue::VirtIOQueue(u16 queue_size, NonnullOwnPtr<Region> region)
+    : m_queue_size(queue_size)
+    , m_free_descriptor_count(queue_size)
+    , m_region(move(region))
+{
+    auto* base = m_region->vaddr().as_ptr();
+    memset(base, 0, m_region->size());
+    m_descriptors = reinterpret_cast<VirtIOQueueDescriptor*>(base);
+    m_driver_ring = reinterpret_cast<VirtIOQueueDriverRing*>(base + driver_ring_offset(queue_size));
+    m_device_ring = reinterpret_cast<VirtIOQueueDeviceRing*>(base + device_ring_offset(queue_size));
+
+    // All descriptors start out on the free list.
+    for (u16 i = 0; i + 1 < queue_size; ++i)
+        m_descriptors[i].next = i + 1;
+    m_tokens.resize(queue_size);
+}
+
+VirtIOQueue::~VirtIOQueue()
+{
+}
+
+bool VirtIOQueue::supply_buffers(const Buffer* buffers, size_t count, void* token)
+{
+    ASSERT(count > 0);
+    if (count > m_free_descriptor_count)
+        return false;
+
+    u16 head = m_free_head;
+    u16 descriptor_index = head;
+    for (size_t i = 0; i < count; ++i) {
+        auto& descriptor = m_descriptors[descriptor_index];
+        descriptor.address = buffers[i].address.get();
+        descriptor.length = buffers[i].length;
+        descriptor.flags = buffers[i].device_writable ? VIRTQ_DESC_F_WRITE : 0;
+        if (i + 1 < count)
+            descriptor.flags |= VIRTQ_DESC_F_NEXT;
+        else
+            m_free_head = descriptor.next;
+        descriptor_index = descriptor.next;
+    }
+    m_free_descriptor_count -= count;
+    m_tokens[head] = token;
+
+    u16 driver_index = m_driver_ring->index;
+    m_driver_ring->rings[driver_index % m_queue_size] = head;
+    // The device must see the descriptors and the ring entry before the new index.
+    AK::atomic_thread_fence(AK::memory_order_release);
+    m_driver_ring->index = driver_index + 1;
+    return true;
+}
+
+bool VirtIOQueue::has_used_buffers() const
+{
+    AK::atomic_thread_fence(AK::memory_order_acquire);
+    return m_last_used_index != *reinterpret_cast<volatile u16*>(&m_device_ring->index);
+}
+
+Optional<VirtIOQueue::UsedBuffers> VirtIOQueue::take_used_buffers()
+{
+    if (!has_used_buffers())
+        return {};
+
+    auto& element = m_device_ring->rings[m_last_used_index % m_queue_size];
+    ++m_last_used_index;
+    ASSERT(element.id < m_queue_size);
+    u16 head = element.id;
+    UsedBuffers used_buffers { m_tokens[head], element.length };
+    m_tokens[head] = nullptr;
+
+    // Put the whole chain back on the free list.
+    u16 descriptor_index = head;
+    size_t chain_length = 1;
+    while (m_descriptors[descriptor_index].flags & VIRTQ_DESC_F_NEXT) {
+        descriptor_index = m_descriptors[descriptor_index].next;
+        ++chain_length;
+    }
+    m_descriptors[descriptor_index].next = m_free_head;
+    m_free_head = head;
+    m_free_descriptor_count += chain_length;
+    return used_buffers;
+}
+
+bool VirtIOQueue::device_wants_notification() const
+{
+    AK::atomic_thread_fence(AK::memory_order_seq_cst);
+    return !(*reinterpret_cast<volatile u16*>(&m_device_ring->flags) & VIRTQ_USED_F_NO_NOTIFY);
+}
+
+void VirtIOQueue::enable_interrupts()
+{
+    m_driver_ring->flags = 0;
+    AK::atomic_thread_fence(AK::memory_order_seq_cst);
+}
+
+void VirtIOQueue::disable_interrupts()
+{
+    m_driver_ring->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/OwnPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <Kernel/PhysicalAddress.h>
+#include <Kernel/VM/PhysicalPage.h>
+#include <Kernel/VM/Region.h>
+
+namespace Kernel {
+
+#define VIRTQ_DESC_F_NEXT 1
+#define VIRTQ_DESC_F_WRITE 2
+
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 1
+#define VIRTQ_USED_F_NO_NOTIFY 1
+
+struct [[gnu::packed]] VirtIOQueueDescriptor {
+    u64 address;
+    u32 length;
+    u16 flags;
+    u16 next;
+};
+
+struct [[gnu::packed]] VirtIOQueueDriverRing {
+    u16 flags;
+    u16 index;
+    u16 rings[];
+};
+
+struct [[gnu::packed]] VirtIOQueueDeviceRingElement {
+    u32 id;
+    u32 length;
+};
+
+struct [[gnu::packed]] VirtIOQueueDeviceRing {
+    u16 flags;
+    u16 index;
+    VirtIOQueueDeviceRingElement rings[];
+};
+
+// A split virtqueue, laid out the way the legacy PCI interface expects it.
+// It doesn't lock anything itself, so users of a queue have to serialize access to it.
+class VirtIOQueue {
+    AK_MAKE_NONCOPYABLE(VirtIOQueue);
+    AK_MAKE_NONMOVABLE(VirtIOQueue);
+
+public:
+    static OwnPtr<VirtIOQueue> try_create(u16 queue_size);
+    VirtIOQueue(u16 queue_size, NonnullOwnPtr<Region>);
+    ~VirtIOQueue();
+
+    u16 size() const { return m_queue_size; }
+    PhysicalAddress physical_address() const { return m_region->physical_page(0)->paddr(); }
+
+    struct Buffer {
+        PhysicalAddress address;
+        u32 length { 0 };
+        bool device_writable { false };
+    };
+
+    // Chains the buffers together and makes them available to the device. The token is handed
+    // back once the device is done with them. Fails if there aren't enough free descriptors.
+    bool supply_buffers(const Buffer*, size_t count, void* token);
+    size_t free_descriptor_count() const { return m_free_descriptor_count; }
+
+    struct UsedBuffers {
+        void* token { nullptr };
+        u32 length { 0 };
+    };
+
+    bool has_used_buffers() const;
+    Optional<UsedBuffers> take_used_buffers();
+
+    // Whether the device wants to be told about newly supplied buffers.
+    bool device_wants_notification() const;
+
+    void enable_interrupts();
+    void disable_interrupts();
+
+private:
+    static size_t driver_ring_offset(u16 queue_size);
+    static size_t device_ring_offset(u16 queue_size);
+
+    u16 m_queue_size { 0 };
+    u16 m_free_head { 0 };
+    u16 m_free_descriptor_count { 0 };
+    u16 m_last_used_index { 0 };
+
+    NonnullOwnPtr<Region> m_region;
+    VirtIOQueueDescriptor* m_descriptors { nullptr };
+    VirtIOQueueDriverRing* m_driver_ring { nullptr };
+    VirtIOQueueDeviceRing* m_device_ring { nullptr };
+    Vector<void*> m_tokens;
+};
+
+}
@@ -55,6 +55,7 @@
 #include <Kernel/Net/LoopbackAdapter.h>
 #include <Kernel/Net/NetworkTask.h>
 #include <Kernel/Net/RTL8139NetworkAdapter.h>
+#include <Kernel/Net/VirtIONetworkAdapter.h>
 #include <Kernel/PCI/Access.h>
 #include <Kernel/PCI/Initializer.h>
 #include <Kernel/Process.h>
@@ -250,6 +251,7 @@ void init_stage2(void*)
 
     E1000NetworkAdapter::detect();
     RTL8139NetworkAdapter::detect();
+    VirtIONetworkAdapter::detect();
 
     LoopbackAdapter::the();
 
@@ -62,6 +62,21 @@ $SERENITY_EXTRA_QEMU_ARGS
 -device sb16
 "
 
+[ -z "$SERENITY_COMMON_QEMU_VIRTIO_ARGS" ] && SERENITY_COMMON_QEMU_VIRTIO_ARGS="
+$SERENITY_EXTRA_QEMU_ARGS
+-s -m $SERENITY_RAM_SIZE
+-cpu $SERENITY_QEMU_CPU
+-d guest_errors
+-smp 2
+-device VGA,vgamem_mb=64
+-drive file=${SERENITY_DISK_IMAGE},format=raw,id=disk,if=none
+-device virtio-blk-pci,drive=disk
+-usb
+-debugcon stdio
+-soundhw pcspk
+-device sb16
+"
+
 export SDL_VIDEO_X11_DGAMOUSE=0
 
 : "${SERENITY_BUILD:=.}"
@@ -114,6 +129,16 @@ elif [ "$SERENITY_RUN" = "q35_cmd" ]; then
         -device e1000,netdev=breh \
         -kernel Kernel/Kernel \
         -append "${SERENITY_KERNEL_CMDLINE}"
+elif [ "$SERENITY_RUN" = "qvirtio" ]; then
+    # Meta/run.sh qvirtio: qemu with the disk and network on virtio
+    "$SERENITY_QEMU_BIN" \
+        $SERENITY_COMMON_QEMU_VIRTIO_ARGS \
+        $SERENITY_KVM_ARG \
+        $SERENITY_PACKET_LOGGING_ARG \
+        -netdev user,id=breh,hostfwd=tcp:127.0.0.1:8888-10.0.2.15:8888,hostfwd=tcp:127.0.0.1:8823-10.0.2.15:23 \
+        -device virtio-net-pci,netdev=breh \
+        -kernel Kernel/Kernel \
+        -append "${SERENITY_KERNEL_CMDLINE}"
 elif [ "$SERENITY_RUN" = "qcmd" ]; then
     # Meta/run.sh qcmd: qemu with SerenityOS with custom commandline
     shift
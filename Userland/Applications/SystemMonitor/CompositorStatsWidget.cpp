@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CompositorStatsWidget.h"
+#include "GraphWidget.h"
+#include <LibCore/Timer.h>
+#include <LibGUI/BoxLayout.h>
+#include <LibGUI/Label.h>
+#include <LibGUI/WindowServerConnection.h>
+#include <LibGfx/FontDatabase.h>
+
+// One frame at 60 Hz, in microseconds.
+static constexpr int frame_budget_us = 1'000'000 / 60;
+
+CompositorStatsWidget::CompositorStatsWidget(GraphWidget& graph)
+    : m_graph(graph)
+{
+    set_fixed_height(80);
+
+    set_layout<GUI::VerticalBoxLayout>();
+    layout()->set_margins({ 0, 8, 0, 0 });
+    layout()->set_spacing(3);
+
+    auto build_widgets_for_label = [this](const String& description) -> RefPtr<GUI::Label> {
+        auto& container = add<GUI::Widget>();
+        container.set_layout<GUI::HorizontalBoxLayout>();
+        container.set_fixed_size(275, 12);
+        auto& description_label = container.add<GUI::Label>(description);
+        description_label.set_font(Gfx::FontDatabase::default_bold_font());
+        description_label.set_text_alignment(Gfx::TextAlignment::CenterLeft);
+        auto& label = container.add<GUI::Label>();
+        label.set_text_alignment(Gfx::TextAlignment::CenterRight);
+        return label;
+    };
+
+    m_frame_rate_label = build_widgets_for_label("Frames per second:");
+    m_average_compose_time_label = build_widgets_for_label("Average compose time:");
+    m_last_compose_time_label = build_widgets_for_label("Last compose time:");
+    m_dirty_tiles_label = build_widgets_for_label("Dirty tiles in last frame:");
+    m_worker_threads_label = build_widgets_for_label("Worker threads:");
+
+    // Start from the current totals so the first sample only covers the first interval.
+    auto statistics = GUI::WindowServerConnection::the().send_sync<Messages::WindowServer::GetCompositorStatistics>();
+    m_last_composed_frame_count = statistics->composed_frame_count();
+    m_last_total_compose_time_us = statistics->total_compose_time_us();
+
+    m_refresh_timer = add<Core::Timer>(1000, [this] {
+        refresh();
+    });
+}
+
+CompositorStatsWidget::~CompositorStatsWidget()
+{
+}
+
+void CompositorStatsWidget::refresh()
+{
+    auto statistics = GUI::WindowServerConnection::the().send_sync<Messages::WindowServer::GetCompositorStatistics>();
+
+    // Turn the running totals into per-interval figures.
+    u64 frame_count = statistics->composed_frame_count() - m_last_composed_frame_count;
+    u64 compose_time_us = statistics->total_compose_time_us() - m_last_total_compose_time_us;
+    m_last_composed_frame_count = statistics->composed_frame_count();
+    m_last_total_compose_time_us = statistics->total_compose_time_us();
+
+    int average_compose_time_us = frame_count ? compose_time_us / frame_count : 0;
+    int last_compose_time_us = statistics->last_compose_time_us();
+
+    m_frame_rate_label->set_text(String::formatted("{}", frame_count * 1000 / m_refresh_timer->interval()));
+    m_average_compose_time_label->set_text(String::formatted("{} µs", average_compose_time_us));
+    m_last_compose_time_label->set_text(String::formatted("{} µs", last_compose_time_us));
+    m_dirty_tiles_label->set_text(String::formatted("{}", statistics->last_dirty_tile_count()));
+    m_worker_threads_label->set_text(String::formatted("{}", statistics->worker_count()));
+
+    m_graph.set_max(max(frame_budget_us, max(average_compose_time_us, last_compose_time_us)));
+    m_graph.add_value({ average_compose_time_us, last_compose_time_us });
+}
@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "CompositorStatsWidget.h"
 #include "DevicesModel.h"
 #include "GraphWidget.h"
 #include "InterruptsWidget.h"
@@ -631,6 +632,28 @@ NonnullRefPtr<GUI::Widget> build_graphs_tab()
                                          });
 
         self.add<MemoryStatsWidget>(memory_graph);
+
+        auto& compositor_graph_group_box = self.add<GUI::GroupBox>("Compositor");
+        compositor_graph_group_box.set_layout<GUI::VerticalBoxLayout>();
+        compositor_graph_group_box.layout()->set_margins({ 6, 16, 6, 6 });
+        compositor_graph_group_box.set_fixed_height(120);
+        auto& compositor_graph = compositor_graph_group_box.add<GraphWidget>();
+        compositor_graph.set_background_color(Color::White);
+        compositor_graph.set_value_format(0, {
+                                                 .line_color = Color::Blue,
+                                                 .background_color = Color::from_rgb(0xaaaaff),
+                                                 .text_formatter = [](int value) {
+                                                     return String::formatted("Average: {} µs", value);
+                                                 },
+                                             });
+        compositor_graph.set_value_format(1, {
+                                                 .line_color = Color::Red,
+                                                 .text_formatter = [](int value) {
+                                                     return String::formatted("Last frame: {} µs", value);
+                                                 },
+                                             });
+
+        self.add<CompositorStatsWidget>(compositor_graph);
     };
     return graphs_container;
 }
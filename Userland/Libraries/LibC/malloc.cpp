@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/Atomic.h>
 #include <AK/InlineLinkedList.h>
 #include <AK/LogStream.h>
 #include <AK/ScopedValueRollback.h>
@@ -69,6 +70,19 @@ static LibThread::Lock& malloc_lock()
 constexpr size_t number_of_chunked_blocks_to_keep_around_per_size_class = 4;
 constexpr size_t number_of_big_blocks_to_keep_around_per_size_class = 8;
 
+// Every thread keeps a small stack of free chunks for each size class, so
+// most calls to malloc() and free() can be served without taking the malloc
+// lock. Chunks move between a thread cache and the shared allocators in
+// batches. Large size classes get fewer cached chunks (or none at all) to
+// bound how much memory an idle thread can sit on.
+constexpr size_t thread_cache_max_chunks_per_size_class = 32;
+constexpr size_t thread_cache_bytes_per_size_class = 8 * KiB;
+
+static constexpr size_t thread_cache_capacity_for(size_t size_class)
+{
+    return min(thread_cache_max_chunks_per_size_class, thread_cache_bytes_per_size_class / size_classes[size_class]);
+}
+
 static bool s_log_malloc = false;
 static bool s_scrub_malloc = true;
 static bool s_scrub_free = true;
@@ -94,6 +108,9 @@ struct MallocStats {
     size_t number_of_freed_full_blocks;
     size_t number_of_keeps;
     size_t number_of_frees;
+
+    size_t number_of_thread_cache_refills;
+    size_t number_of_thread_cache_flushes;
 };
 static MallocStats g_malloc_stats = {};
 
@@ -129,6 +146,22 @@ static inline BigAllocator (&big_allocators())[1]
     return reinterpret_cast<BigAllocator(&)[1]>(g_big_allocators_storage);
 }
 
+struct ThreadCache {
+    size_t count[num_size_classes];
+    void* chunks[num_size_classes][thread_cache_max_chunks_per_size_class];
+};
+
+#ifdef NO_TLS
+static ThreadCache t_thread_cache;
+#else
+static __thread ThreadCache t_thread_cache;
+#endif
+
+static inline size_t size_class_of(const Allocator& allocator)
+{
+    return &allocator - &allocators()[0];
+}
+
 static Allocator* allocator_for_size(size_t size, size_t& good_size)
 {
     for (size_t i = 0; size_classes[i]; ++i) {
@@ -165,65 +198,18 @@ static void os_free(void* ptr, size_t size)
     assert(rc == 0);
 }
 
-static void* malloc_impl(size_t size)
+static void* allocate_chunk(Allocator& allocator, size_t good_size)
 {
-    LOCKER(malloc_lock());
-
-    if (s_log_malloc)
-        dbgprintf("LibC: malloc(%zu)\n", size);
-
-    if (!size)
-        return nullptr;
-
-    g_malloc_stats.number_of_malloc_calls++;
-
-    size_t good_size;
-    auto* allocator = allocator_for_size(size, good_size);
-
-    if (!allocator) {
-        size_t real_size = round_up_to_power_of_two(sizeof(BigAllocationBlock) + size, ChunkedBlock::block_size);
-#ifdef RECYCLE_BIG_ALLOCATIONS
-        if (auto* allocator = big_allocator_for_size(real_size)) {
-            if (!allocator->blocks.is_empty()) {
-                g_malloc_stats.number_of_big_allocator_hits++;
-                auto* block = allocator->blocks.take_last();
-                int rc = madvise(block, real_size, MADV_SET_NONVOLATILE);
-                bool this_block_was_purged = rc == 1;
-                if (rc < 0) {
-                    perror("madvise");
-                    ASSERT_NOT_REACHED();
-                }
-                if (mprotect(block, real_size, PROT_READ | PROT_WRITE) < 0) {
-                    perror("mprotect");
-                    ASSERT_NOT_REACHED();
-                }
-                if (this_block_was_purged) {
-                    g_malloc_stats.number_of_big_allocator_purge_hits++;
-                    new (block) BigAllocationBlock(real_size);
-                }
-
-                ue_notify_malloc(&block->m_slot[0], size);
-                return &block->m_slot[0];
-            }
-        }
-#endif
-        g_malloc_stats.number_of_big_allocs++;
-        auto* block = (BigAllocationBlock*)os_alloc(real_size, "malloc: BigAllocationBlock");
-        new (block) BigAllocationBlock(real_size);
-        ue_notify_malloc(&block->m_slot[0], size);
-        return &block->m_slot[0];
-    }
-
     ChunkedBlock* block = nullptr;
 
-    for (block = allocator->usable_blocks.head(); block; block = block->next()) {
+    for (block = allocator.usable_blocks.head(); block; block = block->next()) {
         if (block->free_chunks())
             break;
     }
 
-    if (!block && allocator->empty_block_count) {
+    if (!block && allocator.empty_block_count) {
         g_malloc_stats.number_of_empty_block_hits++;
-        block = allocator->empty_blocks[--allocator->empty_block_count];
+        block = allocator.empty_blocks[--allocator.empty_block_count];
         int rc = madvise(block, ChunkedBlock::block_size, MADV_SET_NONVOLATILE);
         bool this_block_was_purged = rc == 1;
         if (rc < 0) {
@@ -239,7 +225,7 @@ static void* malloc_impl(size_t size)
             g_malloc_stats.number_of_empty_block_purge_hits++;
             new (block) ChunkedBlock(good_size);
         }
-        allocator->usable_blocks.append(block);
+        allocator.usable_blocks.append(block);
     }
 
     if (!block) {
@@ -248,8 +234,8 @@ static void* malloc_impl(size_t size)
         snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
         block = (ChunkedBlock*)os_alloc(ChunkedBlock::block_size, buffer);
         new (block) ChunkedBlock(good_size);
-        allocator->usable_blocks.append(block);
-        ++allocator->block_count;
+        allocator.usable_blocks.append(block);
+        ++allocator.block_count;
     }
 
     --block->m_free_chunks;
@@ -261,18 +247,136 @@ static void* malloc_impl(size_t size)
 #ifdef MALLOC_DEBUG
         dbgprintf("Block %p is now full in size class %zu\n", block, good_size);
 #endif
-        allocator->usable_blocks.remove(block);
-        allocator->full_blocks.append(block);
+        allocator.usable_blocks.remove(block);
+        allocator.full_blocks.append(block);
     }
 #ifdef MALLOC_DEBUG
     dbgprintf("LibC: allocated %p (chunk in block %p, size %zu)\n", ptr, block, block->bytes_per_chunk());
 #endif
+    return ptr;
+}
+
+static void* malloc_impl(size_t size)
+{
+    if (s_log_malloc)
+        dbgprintf("LibC: malloc(%zu)\n", size);
 
-    if (s_scrub_malloc)
-        memset(ptr, MALLOC_SCRUB_BYTE, block->m_size);
+    if (!size)
+        return nullptr;
 
-    ue_notify_malloc(ptr, size);
-    return ptr;
+    // Counted outside of malloc_lock() so the thread cache fast path stays lock-free.
+    AK::atomic_fetch_add(&g_malloc_stats.number_of_malloc_calls, (size_t)1, AK::memory_order_relaxed);
+
+    size_t good_size;
+    auto* allocator = allocator_for_size(size, good_size);
+
+    if (allocator) {
+        auto size_class = size_class_of(*allocator);
+        auto capacity = thread_cache_capacity_for(size_class);
+        void* ptr = nullptr;
+        if (!capacity) {
+            LOCKER(malloc_lock());
+            ptr = allocate_chunk(*allocator, good_size);
+        } else {
+            auto& count = t_thread_cache.count[size_class];
+            auto* chunks = t_thread_cache.chunks[size_class];
+            if (!count) {
+                LOCKER(malloc_lock());
+                g_malloc_stats.number_of_thread_cache_refills++;
+                while (count < capacity / 2 + 1)
+                    chunks[count++] = allocate_chunk(*allocator, good_size);
+            }
+            ptr = chunks[--count];
+        }
+
+        if (s_scrub_malloc)
+            memset(ptr, MALLOC_SCRUB_BYTE, good_size);
+
+        ue_notify_malloc(ptr, size);
+        return ptr;
+    }
+
+    LOCKER(malloc_lock());
+
+    size_t real_size = round_up_to_power_of_two(sizeof(BigAllocationBlock) + size, ChunkedBlock::block_size);
+#ifdef RECYCLE_BIG_ALLOCATIONS
+    if (auto* allocator = big_allocator_for_size(real_size)) {
+        if (!allocator->blocks.is_empty()) {
+            g_malloc_stats.number_of_big_allocator_hits++;
+            auto* block = allocator->blocks.take_last();
+            int rc = madvise(block, real_size, MADV_SET_NONVOLATILE);
+            bool this_block_was_purged = rc == 1;
+            if (rc < 0) {
+                perror("madvise");
+                ASSERT_NOT_REACHED();
+            }
+            if (mprotect(block, real_size, PROT_READ | PROT_WRITE) < 0) {
+                perror("mprotect");
+                ASSERT_NOT_REACHED();
+            }
+            if (this_block_was_purged) {
+                g_malloc_stats.number_of_big_allocator_purge_hits++;
+                new (block) BigAllocationBlock(real_size);
+            }
+
+            ue_notify_malloc(&block->m_slot[0], size);
+            return &block->m_slot[0];
+        }
+    }
+#endif
+    g_malloc_stats.number_of_big_allocs++;
+    auto* block = (BigAllocationBlock*)os_alloc(real_size, "malloc: BigAllocationBlock");
+    new (block) BigAllocationBlock(real_size);
+    ue_notify_malloc(&block->m_slot[0], size);
+    return &block->m_slot[0];
+}
+
+static void release_chunk(ChunkedBlock* block, void* ptr)
+{
+    auto* entry = (FreelistEntry*)ptr;
+    entry->next = block->m_freelist;
+    block->m_freelist = entry;
+
+    if (block->is_full()) {
+        size_t good_size;
+        auto* allocator = allocator_for_size(block->m_size, good_size);
+#ifdef MALLOC_DEBUG
+        dbgprintf("Block %p no longer full in size class %zu\n", block, good_size);
+#endif
+        g_malloc_stats.number_of_freed_full_blocks++;
+        allocator->full_blocks.remove(block);
+        allocator->usable_blocks.prepend(block);
+    }
+
+    ++block->m_free_chunks;
+
+    if (!block->used_chunks()) {
+        size_t good_size;
+        auto* allocator = allocator_for_size(block->m_size, good_size);
+        if (allocator->block_count < number_of_chunked_blocks_to_keep_around_per_size_class) {
+#ifdef MALLOC_DEBUG
+            dbgprintf("Keeping block %p around for size class %zu\n", block, good_size);
+#endif
+            g_malloc_stats.number_of_keeps++;
+            allocator->usable_blocks.remove(block);
+            allocator->empty_blocks[allocator->empty_block_count++] = block;
+            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
+            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
+            return;
+        }
+#ifdef MALLOC_DEBUG
+        dbgprintf("Releasing block %p for size class %zu\n", block, good_size);
+#endif
+        g_malloc_stats.number_of_frees++;
+        allocator->usable_blocks.remove(block);
+        --allocator->block_count;
+        os_free(block, ChunkedBlock::block_size);
+    }
+}
+
+static inline ChunkedBlock* block_for_chunk(void* ptr)
+{
+    return (ChunkedBlock*)((FlatPtr)ptr & ChunkedBlock::block_mask);
 }
 
 static void free_impl(void* ptr)
@@ -282,14 +386,13 @@ static void free_impl(void* ptr)
     if (!ptr)
         return;
 
-    g_malloc_stats.number_of_free_calls++;
-
-    LOCKER(malloc_lock());
+    AK::atomic_fetch_add(&g_malloc_stats.number_of_free_calls, (size_t)1, AK::memory_order_relaxed);
 
     void* block_base = (void*)((FlatPtr)ptr & ChunkedBlock::ChunkedBlock::block_mask);
     size_t magic = *(size_t*)block_base;
 
     if (magic == MAGIC_BIGALLOC_HEADER) {
+        LOCKER(malloc_lock());
         auto* block = (BigAllocationBlock*)block_base;
 #ifdef RECYCLE_BIG_ALLOCATIONS
         if (auto* allocator = big_allocator_for_size(block->m_size)) {
@@ -324,44 +427,41 @@ static void free_impl(void* ptr)
     if (s_scrub_free)
         memset(ptr, FREE_SCRUB_BYTE, block->bytes_per_chunk());
 
-    auto* entry = (FreelistEntry*)ptr;
-    entry->next = block->m_freelist;
-    block->m_freelist = entry;
-
-    if (block->is_full()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-#ifdef MALLOC_DEBUG
-        dbgprintf("Block %p no longer full in size class %zu\n", block, good_size);
-#endif
-        g_malloc_stats.number_of_freed_full_blocks++;
-        allocator->full_blocks.remove(block);
-        allocator->usable_blocks.prepend(block);
+    // A chunk's block can't go away while the chunk is allocated, so
+    // looking at its size class doesn't need the lock.
+    size_t good_size;
+    auto* allocator = allocator_for_size(block->m_size, good_size);
+    auto size_class = size_class_of(*allocator);
+    auto capacity = thread_cache_capacity_for(size_class);
+    if (!capacity) {
+        LOCKER(malloc_lock());
+        release_chunk(block, ptr);
+        return;
     }
 
-    ++block->m_free_chunks;
+    auto& count = t_thread_cache.count[size_class];
+    auto* chunks = t_thread_cache.chunks[size_class];
+    if (count == capacity) {
+        LOCKER(malloc_lock());
+        g_malloc_stats.number_of_thread_cache_flushes++;
+        while (count > capacity / 2) {
+            void* chunk = chunks[--count];
+            release_chunk(block_for_chunk(chunk), chunk);
+        }
+    }
+    chunks[count++] = ptr;
+}
 
-    if (!block->used_chunks()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-        if (allocator->block_count < number_of_chunked_blocks_to_keep_around_per_size_class) {
-#ifdef MALLOC_DEBUG
-            dbgprintf("Keeping block %p around for size class %zu\n", block, good_size);
-#endif
-            g_malloc_stats.number_of_keeps++;
-            allocator->usable_blocks.remove(block);
-            allocator->empty_blocks[allocator->empty_block_count++] = block;
-            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
-            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
-            return;
+void __malloc_flush_thread_cache()
+{
+    LOCKER(malloc_lock());
+    for (size_t size_class = 0; size_class < num_size_classes; ++size_class) {
+        auto& count = t_thread_cache.count[size_class];
+        auto* chunks = t_thread_cache.chunks[size_class];
+        while (count) {
+            void* chunk = chunks[--count];
+            release_chunk(block_for_chunk(chunk), chunk);
         }
-#ifdef MALLOC_DEBUG
-        dbgprintf("Releasing block %p for size class %zu\n", block, good_size);
-#endif
-        g_malloc_stats.number_of_frees++;
-        allocator->usable_blocks.remove(block);
-        --allocator->block_count;
-        os_free(block, ChunkedBlock::block_size);
     }
 }
 
@@ -468,5 +568,8 @@ void serenity_dump_malloc_stats()
     dbgln("full block frees: {}", g_malloc_stats.number_of_freed_full_blocks);
     dbgln("number of keeps: {}", g_malloc_stats.number_of_keeps);
     dbgln("number of frees: {}", g_malloc_stats.number_of_frees);
+    dbgln();
+    dbgln("thread cache refills: {}", g_malloc_stats.number_of_thread_cache_refills);
+    dbgln("thread cache flushes: {}", g_malloc_stats.number_of_thread_cache_flushes);
 }
 }
@@ -26,14 +26,34 @@
 
 #include <AK/Array.h>
 #include <AK/Assertions.h>
-#include <AK/BinarySearch.h>
 #include <AK/LogStream.h>
 #include <AK/MemoryStream.h>
+#include <AK/NumericLimits.h>
+#include <AK/QuickSort.h>
 
 #include <LibCompress/Deflate.h>
+#include <string.h>
 
 namespace Compress {
 
+static constexpr u16 length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static constexpr u8 length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static constexpr u16 distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static constexpr u8 distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// The order in which the code length code lengths are stored, see RFC 1951 section 3.2.7.
+static constexpr u8 code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static u16 reverse_bits(u16 code, size_t length)
+{
+    u16 result = 0;
+    for (size_t i = 0; i < length; ++i) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return result;
+}
+
 const CanonicalCode& CanonicalCode::fixed_literal_codes()
 {
     static CanonicalCode code;
@@ -73,31 +93,48 @@ const CanonicalCode& CanonicalCode::fixed_distance_codes()
 
 Optional<CanonicalCode> CanonicalCode::from_bytes(ReadonlyBytes bytes)
 {
-    // FIXME: I can't quite follow the algorithm here, but it seems to work.
-
     CanonicalCode code;
 
-    auto next_code = 0;
-    for (size_t code_length = 1; code_length <= 15; ++code_length) {
-        next_code <<= 1;
-        auto start_bit = 1 << code_length;
+    for (auto length : bytes) {
+        if (length > 15)
+            return {};
+        code.m_code_count[length]++;
+    }
+    code.m_code_count[0] = 0;
 
-        for (size_t symbol = 0; symbol < bytes.size(); ++symbol) {
-            if (bytes[symbol] != code_length)
-                continue;
+    // Codes of each length follow the last code of the previous length, see RFC 1951 section 3.2.2.
+    // Only complete codes are accepted, every sequence of 15 bits has to start with a valid code.
+    u32 next_code = 0;
+    u16 next_symbol_index = 0;
+    for (size_t length = 1; length <= 15; ++length) {
+        next_code <<= 1;
+        code.m_first_code[length] = next_code;
+        code.m_first_symbol_index[length] = next_symbol_index;
+        next_code += code.m_code_count[length];
+        next_symbol_index += code.m_code_count[length];
+        if (next_code > (1u << length))
+            return {};
+    }
+    if (next_code != (1 << 15))
+        return {};
 
-            if (next_code > start_bit)
-                return {};
+    code.m_symbols_by_code.resize(next_symbol_index);
+    auto next_index = code.m_first_symbol_index;
+    for (size_t symbol = 0; symbol < bytes.size(); ++symbol) {
+        auto length = bytes[symbol];
+        if (!length)
+            continue;
 
-            code.m_symbol_codes.append(start_bit | next_code);
-            code.m_symbol_values.append(symbol);
+        auto index = next_index[length]++;
+        code.m_symbols_by_code[index] = symbol;
 
-            next_code++;
-        }
-    }
+        if (length > fast_lookup_bits)
+            continue;
 
-    if (next_code != (1 << 15)) {
-        return {};
+        // Bits are read least significant bit first, but codes are stored most significant bit first.
+        auto reversed_code = reverse_bits(code.m_first_code[length] + index - code.m_first_symbol_index[length], length);
+        for (size_t i = reversed_code; i < code.m_fast_lookup_table.size(); i += 1 << length)
+            code.m_fast_lookup_table[i] = symbol << 4 | length;
     }
 
     return code;
@@ -105,18 +142,63 @@ Optional<CanonicalCode> CanonicalCode::from_bytes(ReadonlyBytes bytes)
 
 u32 CanonicalCode::read_symbol(InputBitStream& stream) const
 {
-    u32 code_bits = 1;
+    // Near the end of the stream there might be fewer bits left than the longest code, which is fine
+    // as long as the code that is actually there fits.
+    stream.ensure_bits(15);
+
+    auto entry = m_fast_lookup_table[stream.peek_bits(fast_lookup_bits)];
+    if (entry != 0 && (entry & 0xf) <= stream.buffered_bit_count()) {
+        stream.discard_bits(entry & 0xf);
+        return entry >> 4;
+    }
 
-    for (;;) {
-        code_bits = code_bits << 1 | stream.read_bits(1);
-        ASSERT(code_bits < (1 << 16));
+    return read_long_symbol(stream);
+}
+
+u32 CanonicalCode::read_long_symbol(InputBitStream& stream) const
+{
+    auto bits = stream.peek_bits(15);
+    auto max_length = min<size_t>(15, stream.buffered_bit_count());
+
+    u32 code = 0;
+    for (size_t length = 1; length <= max_length; ++length) {
+        code = code << 1 | ((bits >> (length - 1)) & 1);
+
+        auto offset = code - m_first_code[length];
+        if (offset < m_code_count[length]) {
+            stream.discard_bits(length);
+            return m_symbols_by_code[m_first_symbol_index[length] + offset];
+        }
+    }
+
+    // The stream ended in the middle of a code.
+    stream.set_fatal_error();
+    return 0;
+}
+
+// Copies length bytes from distance bytes back, which may overlap with the destination. This might
+// write up to seven bytes past the end of the copy.
+ALWAYS_INLINE static void copy_back_reference(u8* destination, size_t distance, size_t length)
+{
+    const u8* source = destination - distance;
+
+    if (distance >= sizeof(u64)) {
+        // Every word that is read lies entirely before the word that is written next.
+        for (size_t i = 0; i < length; i += sizeof(u64)) {
+            u64 word;
+            memcpy(&word, source + i, sizeof(word));
+            memcpy(destination + i, &word, sizeof(word));
+        }
+        return;
+    }
 
-        // FIXME: This is very inefficent and could greatly be improved by implementing this
-        //        algorithm: https://www.hanshq.net/zip.html#huffdec
-        size_t index;
-        if (AK::binary_search(m_symbol_codes.span(), code_bits, &index))
-            return m_symbol_values[index];
+    if (distance == 1) {
+        memset(destination, *source, length);
+        return;
     }
+
+    for (size_t i = 0; i < length; ++i)
+        destination[i] = source[i];
 }
 
 DeflateDecompressor::CompressedBlock::CompressedBlock(DeflateDecompressor& decompressor, CanonicalCode literal_codes, Optional<CanonicalCode> distance_codes)
@@ -131,31 +213,52 @@ bool DeflateDecompressor::CompressedBlock::try_read_more()
     if (m_eof == true)
         return false;
 
-    const auto symbol = m_literal_codes.read_symbol(m_decompressor.m_input_stream);
+    auto& input_stream = m_decompressor.m_input_stream;
+    u8* output = m_decompressor.m_output_buffer.data();
+    size_t position = m_decompressor.m_output_write_offset;
+    const size_t end = window_size + output_chunk_size;
 
-    if (symbol < 256) {
-        m_decompressor.m_output_stream << static_cast<u8>(symbol);
-        return true;
-    } else if (symbol == 256) {
-        m_eof = true;
+    auto fail = [&] {
+        input_stream.handle_any_error();
+        m_decompressor.set_fatal_error();
         return false;
-    } else {
-        if (!m_distance_codes.has_value()) {
-            m_decompressor.set_fatal_error();
-            return false;
+    };
+
+    while (position < end) {
+        const auto symbol = m_literal_codes.read_symbol(input_stream);
+        if (input_stream.has_any_error())
+            return fail();
+
+        if (symbol < 256) {
+            output[position++] = static_cast<u8>(symbol);
+            continue;
+        }
+
+        if (symbol == 256) {
+            m_eof = true;
+            break;
         }
 
+        // Symbols 286 and 287 (and distance symbols 30 and 31) can be coded but never occur in valid data.
+        if (!m_distance_codes.has_value() || symbol > 285)
+            return fail();
+
         const auto length = m_decompressor.decode_length(symbol);
-        const auto distance = m_decompressor.decode_distance(m_distance_codes.value().read_symbol(m_decompressor.m_input_stream));
+        const auto distance_symbol = m_distance_codes.value().read_symbol(input_stream);
+        if (input_stream.has_any_error() || distance_symbol > 29)
+            return fail();
+        const auto distance = m_decompressor.decode_distance(distance_symbol);
 
-        for (size_t idx = 0; idx < length; ++idx) {
-            u8 byte = 0;
-            m_decompressor.m_output_stream.read({ &byte, sizeof(byte) }, distance);
-            m_decompressor.m_output_stream << byte;
-        }
+        // The distance reached back further than the data decompressed so far.
+        if (input_stream.has_any_error() || distance > position)
+            return fail();
 
-        return true;
+        copy_back_reference(output + position, distance, length);
+        position += length;
     }
+
+    m_decompressor.m_output_write_offset = position;
+    return !m_eof;
 }
 
 DeflateDecompressor::UncompressedBlock::UncompressedBlock(DeflateDecompressor& decompressor, size_t length)
@@ -169,16 +272,29 @@ bool DeflateDecompressor::UncompressedBlock::try_read_more()
     if (m_bytes_remaining == 0)
         return false;
 
-    const auto nread = min(m_bytes_remaining, m_decompressor.m_output_stream.remaining_contigous_space());
+    const auto nread = min(m_bytes_remaining, window_size + output_chunk_size - m_decompressor.m_output_write_offset);
     m_bytes_remaining -= nread;
 
-    m_decompressor.m_input_stream >> m_decompressor.m_output_stream.reserve_contigous_space(nread);
+    m_decompressor.m_input_stream >> m_decompressor.m_output_buffer.bytes().slice(m_decompressor.m_output_write_offset, nread);
+    if (m_decompressor.m_input_stream.handle_any_error()) {
+        m_decompressor.set_fatal_error();
+        return false;
+    }
+    m_decompressor.m_output_write_offset += nread;
 
     return true;
 }
 
 DeflateDecompressor::DeflateDecompressor(InputStream& stream)
+    : m_owned_input_stream(make<InputBitStream>(stream))
+    , m_input_stream(*m_owned_input_stream)
+    , m_output_buffer(ByteBuffer::create_uninitialized(window_size + output_chunk_size + max_match_length + sizeof(u64)))
+{
+}
+
+DeflateDecompressor::DeflateDecompressor(InputBitStream& stream)
     : m_input_stream(stream)
+    , m_output_buffer(ByteBuffer::create_uninitialized(window_size + output_chunk_size + max_match_length + sizeof(u64)))
 {
 }
 
@@ -190,90 +306,108 @@ DeflateDecompressor::~DeflateDecompressor()
         m_uncompressed_block.~UncompressedBlock();
 }
 
-size_t DeflateDecompressor::read(Bytes bytes)
+// Once all output has been read, only the window is needed for back-references, which makes
+// room for the next chunk of output.
+void DeflateDecompressor::discard_read_output()
 {
-    if (has_any_error())
-        return 0;
-
-    if (m_state == State::Idle) {
-        if (m_read_final_bock)
-            return 0;
-
-        m_read_final_bock = m_input_stream.read_bit();
-        const auto block_type = m_input_stream.read_bits(2);
+    ASSERT(m_output_read_offset == m_output_write_offset);
 
-        if (block_type == 0b00) {
-            m_input_stream.align_to_byte_boundary();
-
-            LittleEndian<u16> length, negated_length;
-            m_input_stream >> length >> negated_length;
-
-            if ((length ^ 0xffff) != negated_length) {
-                set_fatal_error();
-                return 0;
-            }
+    if (m_output_write_offset <= window_size + output_chunk_size / 2)
+        return;
 
-            m_state = State::ReadingUncompressedBlock;
-            new (&m_uncompressed_block) UncompressedBlock(*this, length);
+    memmove(m_output_buffer.data(), m_output_buffer.data() + m_output_write_offset - window_size, window_size);
+    m_output_read_offset = window_size;
+    m_output_write_offset = window_size;
+}
 
-            return read(bytes);
+size_t DeflateDecompressor::read(Bytes bytes)
+{
+    size_t nread = 0;
+
+    while (nread < bytes.size() && !has_any_error()) {
+        if (m_output_read_offset < m_output_write_offset) {
+            const auto count = min(bytes.size() - nread, m_output_write_offset - m_output_read_offset);
+            memcpy(bytes.offset(nread), m_output_buffer.data() + m_output_read_offset, count);
+            m_output_read_offset += count;
+            nread += count;
+            continue;
         }
 
-        if (block_type == 0b01) {
-            m_state = State::ReadingCompressedBlock;
-            new (&m_compressed_block) CompressedBlock(*this, CanonicalCode::fixed_literal_codes(), CanonicalCode::fixed_distance_codes());
+        discard_read_output();
 
-            return read(bytes);
-        }
+        if (m_state == State::Idle) {
+            if (m_read_final_bock)
+                break;
 
-        if (block_type == 0b10) {
-            CanonicalCode literal_codes;
-            Optional<CanonicalCode> distance_codes;
-            decode_codes(literal_codes, distance_codes);
+            m_read_final_bock = m_input_stream.read_bit();
+            const auto block_type = m_input_stream.read_bits(2);
 
-            m_state = State::ReadingCompressedBlock;
-            new (&m_compressed_block) CompressedBlock(*this, literal_codes, distance_codes);
+            if (m_input_stream.handle_any_error()) {
+                set_fatal_error();
+                break;
+            }
 
-            return read(bytes);
-        }
+            if (block_type == 0b00) {
+                m_input_stream.align_to_byte_boundary();
 
-        set_fatal_error();
-        return 0;
-    }
+                LittleEndian<u16> length, negated_length;
+                m_input_stream >> length >> negated_length;
 
-    if (m_state == State::ReadingCompressedBlock) {
-        auto nread = m_output_stream.read(bytes);
+                if (m_input_stream.handle_any_error() || (length ^ 0xffff) != negated_length) {
+                    set_fatal_error();
+                    break;
+                }
 
-        while (nread < bytes.size() && m_compressed_block.try_read_more()) {
-            nread += m_output_stream.read(bytes.slice(nread));
-        }
+                m_state = State::ReadingUncompressedBlock;
+                new (&m_uncompressed_block) UncompressedBlock(*this, length);
+                continue;
+            }
 
-        if (nread == bytes.size())
-            return nread;
+            if (block_type == 0b01) {
+                m_state = State::ReadingCompressedBlock;
+                new (&m_compressed_block) CompressedBlock(*this, CanonicalCode::fixed_literal_codes(), CanonicalCode::fixed_distance_codes());
+                continue;
+            }
 
-        m_compressed_block.~CompressedBlock();
-        m_state = State::Idle;
+            if (block_type == 0b10) {
+                CanonicalCode literal_codes;
+                Optional<CanonicalCode> distance_codes;
+                decode_codes(literal_codes, distance_codes);
 
-        return nread + read(bytes.slice(nread));
-    }
+                if (m_input_stream.handle_any_error() || has_any_error()) {
+                    set_fatal_error();
+                    break;
+                }
 
-    if (m_state == State::ReadingUncompressedBlock) {
-        auto nread = m_output_stream.read(bytes);
+                m_state = State::ReadingCompressedBlock;
+                new (&m_compressed_block) CompressedBlock(*this, literal_codes, distance_codes);
+                continue;
+            }
 
-        while (nread < bytes.size() && m_uncompressed_block.try_read_more()) {
-            nread += m_output_stream.read(bytes.slice(nread));
+            set_fatal_error();
+            break;
         }
 
-        if (nread == bytes.size())
-            return nread;
+        if (m_state == State::ReadingCompressedBlock) {
+            if (!m_compressed_block.try_read_more()) {
+                m_compressed_block.~CompressedBlock();
+                m_state = State::Idle;
+            }
+            continue;
+        }
 
-        m_uncompressed_block.~UncompressedBlock();
-        m_state = State::Idle;
+        if (m_state == State::ReadingUncompressedBlock) {
+            if (!m_uncompressed_block.try_read_more()) {
+                m_uncompressed_block.~UncompressedBlock();
+                m_state = State::Idle;
+            }
+            continue;
+        }
 
-        return nread + read(bytes.slice(nread));
+        ASSERT_NOT_REACHED();
     }
 
-    ASSERT_NOT_REACHED();
+    return nread;
 }
 
 bool DeflateDecompressor::read_or_error(Bytes bytes)
@@ -303,7 +437,7 @@ bool DeflateDecompressor::discard_or_error(size_t count)
     return true;
 }
 
-bool DeflateDecompressor::unreliable_eof() const { return m_state == State::Idle && m_read_final_bock; }
+bool DeflateDecompressor::unreliable_eof() const { return m_state == State::Idle && m_read_final_bock && m_output_read_offset == m_output_write_offset; }
 
 Optional<ByteBuffer> DeflateDecompressor::decompress_all(ReadonlyBytes bytes)
 {
@@ -317,6 +451,8 @@ Optional<ByteBuffer> DeflateDecompressor::decompress_all(ReadonlyBytes bytes)
         output_stream.write_or_error({ buffer, nread });
     }
 
+    // A truncated stream also leaves an error on the stream we were reading from.
+    memory_stream.handle_any_error();
     if (deflate_stream.handle_any_error())
         return {};
 
@@ -325,35 +461,15 @@ Optional<ByteBuffer> DeflateDecompressor::decompress_all(ReadonlyBytes bytes)
 
 u32 DeflateDecompressor::decode_length(u32 symbol)
 {
-    // FIXME: I can't quite follow the algorithm here, but it seems to work.
-
-    if (symbol <= 264)
-        return symbol - 254;
-
-    if (symbol <= 284) {
-        auto extra_bits = (symbol - 261) / 4;
-        return (((symbol - 265) % 4 + 4) << extra_bits) + 3 + m_input_stream.read_bits(extra_bits);
-    }
-
-    if (symbol == 285)
-        return 258;
-
-    ASSERT_NOT_REACHED();
+    ASSERT(symbol >= 257 && symbol <= 285);
+    auto index = symbol - 257;
+    return length_base[index] + m_input_stream.read_bits(length_extra_bits[index]);
 }
 
 u32 DeflateDecompressor::decode_distance(u32 symbol)
 {
-    // FIXME: I can't quite follow the algorithm here, but it seems to work.
-
-    if (symbol <= 3)
-        return symbol + 1;
-
-    if (symbol <= 29) {
-        auto extra_bits = (symbol / 2) - 1;
-        return ((symbol % 2 + 2) << extra_bits) + 1 + m_input_stream.read_bits(extra_bits);
-    }
-
-    ASSERT_NOT_REACHED();
+    ASSERT(symbol <= 29);
+    return distance_base[symbol] + m_input_stream.read_bits(distance_extra_bits[symbol]);
 }
 
 void DeflateDecompressor::decode_codes(CanonicalCode& literal_code, Optional<CanonicalCode>& distance_code)
@@ -449,4 +565,606 @@ void DeflateDecompressor::decode_codes(CanonicalCode& literal_code, Optional<Can
     distance_code = distance_code_result.value();
 }
 
+static constexpr size_t literal_code_count = 288;
+static constexpr size_t distance_code_count = 30;
+static constexpr size_t code_length_code_count = 19;
+static constexpr u16 end_of_block = 256;
+
+// Index into length_base for a match length of 3 to 258.
+static size_t length_index(size_t length)
+{
+    if (length == 258)
+        return 28;
+    auto n = length - 3;
+    if (n < 8)
+        return n;
+    auto high_bit = 31 - __builtin_clz(n);
+    return 4 * (high_bit - 1) + ((n >> (high_bit - 2)) & 3);
+}
+
+// Index into distance_base for a distance of 1 to 32768.
+static size_t distance_index(size_t distance)
+{
+    auto n = distance - 1;
+    if (n < 4)
+        return n;
+    auto high_bit = 31 - __builtin_clz(n);
+    return 2 * high_bit + ((n >> (high_bit - 1)) & 1);
+}
+
+// Builds length-limited Huffman code lengths. If the optimal code is too deep, the frequencies
+// are flattened and the code rebuilt until it fits, which is simple and close enough in practice.
+template<size_t Size>
+static void generate_huffman_lengths(Array<u8, Size>& lengths, const Array<u32, Size>& frequencies, size_t max_bit_length)
+{
+    Array<u32, Size> adjusted_frequencies = frequencies;
+
+    // Inflaters only accept complete codes, which needs at least two symbols.
+    size_t used_symbols = 0;
+    for (auto frequency : adjusted_frequencies)
+        used_symbols += frequency != 0;
+    for (size_t i = 0; used_symbols < 2; ++i) {
+        if (adjusted_frequencies[i] == 0) {
+            adjusted_frequencies[i] = 1;
+            ++used_symbols;
+        }
+    }
+
+    Array<u16, Size> leaves;
+    Array<u32, 2 * Size> node_frequencies;
+    Array<u16, 2 * Size> parents;
+    Array<u8, 2 * Size> depths;
+
+    for (;;) {
+        size_t leaf_count = 0;
+        for (size_t i = 0; i < Size; ++i) {
+            if (adjusted_frequencies[i])
+                leaves[leaf_count++] = i;
+        }
+        auto sorted_leaves = leaves.span().trim(leaf_count);
+        quick_sort(sorted_leaves, [&](u16 a, u16 b) { return adjusted_frequencies[a] < adjusted_frequencies[b]; });
+
+        for (size_t i = 0; i < leaf_count; ++i)
+            node_frequencies[i] = adjusted_frequencies[leaves[i]];
+
+        // Leaves are sorted and internal nodes are created in increasing order of frequency,
+        // so the two smallest nodes are always at the front of one of the two queues.
+        size_t next_leaf = 0;
+        size_t next_internal_node = leaf_count;
+        size_t node_count = leaf_count;
+        auto take_smallest = [&] {
+            if (next_leaf < leaf_count && (next_internal_node == node_count || node_frequencies[next_leaf] <= node_frequencies[next_internal_node]))
+                return next_leaf++;
+            return next_internal_node++;
+        };
+        while (node_count < 2 * leaf_count - 1) {
+            auto a = take_smallest();
+            auto b = take_smallest();
+            node_frequencies[node_count] = node_frequencies[a] + node_frequencies[b];
+            parents[a] = node_count;
+            parents[b] = node_count;
+            ++node_count;
+        }
+
+        size_t max_depth = 0;
+        depths[node_count - 1] = 0;
+        for (size_t i = node_count - 1; i-- > 0;) {
+            depths[i] = depths[parents[i]] + 1;
+            max_depth = max<size_t>(max_depth, depths[i]);
+        }
+
+        if (max_depth <= max_bit_length) {
+            lengths.span().fill(0);
+            for (size_t i = 0; i < leaf_count; ++i)
+                lengths[leaves[i]] = depths[i];
+            return;
+        }
+
+        for (auto& frequency : adjusted_frequencies) {
+            if (frequency)
+                frequency = (frequency + 1) / 2;
+        }
+    }
+}
+
+// Assigns canonical codes (RFC 1951 section 3.2.2), bit-reversed since the stream is written LSB first.
+template<size_t Size>
+static void generate_huffman_codes(Array<u16, Size>& codes, const Array<u8, Size>& lengths)
+{
+    u16 length_counts[16] = { 0 };
+    for (auto length : lengths)
+        length_counts[length]++;
+    length_counts[0] = 0;
+
+    u16 next_code[16] = { 0 };
+    u16 code = 0;
+    for (size_t bits = 1; bits < 16; ++bits) {
+        code = (code + length_counts[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+
+    for (size_t i = 0; i < Size; ++i) {
+        if (lengths[i])
+            codes[i] = reverse_bits(next_code[lengths[i]]++, lengths[i]);
+    }
+}
+
+struct HuffmanCodes {
+    Array<u8, literal_code_count> literal_lengths;
+    Array<u16, literal_code_count> literal_codes;
+    Array<u8, distance_code_count> distance_lengths;
+    Array<u16, distance_code_count> distance_codes;
+};
+
+static const HuffmanCodes& fixed_huffman_codes()
+{
+    static HuffmanCodes codes;
+    static bool initialized = false;
+
+    if (initialized)
+        return codes;
+
+    codes.literal_lengths.span().slice(0, 144 - 0).fill(8);
+    codes.literal_lengths.span().slice(144, 256 - 144).fill(9);
+    codes.literal_lengths.span().slice(256, 280 - 256).fill(7);
+    codes.literal_lengths.span().slice(280, 288 - 280).fill(8);
+    codes.distance_lengths.span().fill(5);
+    generate_huffman_codes(codes.literal_codes, codes.literal_lengths);
+    generate_huffman_codes(codes.distance_codes, codes.distance_lengths);
+    initialized = true;
+
+    return codes;
+}
+
+// The code lengths of a dynamic block, run-length encoded as in RFC 1951 section 3.2.7.
+struct DynamicHeader {
+    struct Entry {
+        u8 symbol;
+        u8 extra;
+    };
+
+    size_t literal_count { 0 };
+    size_t distance_count { 0 };
+    size_t code_length_count { 0 };
+    Vector<Entry, 320> entries;
+    Array<u8, code_length_code_count> code_length_lengths;
+    Array<u16, code_length_code_count> code_length_codes;
+
+    size_t bit_size() const
+    {
+        size_t bits = 5 + 5 + 4 + 3 * code_length_count;
+        for (auto& entry : entries) {
+            bits += code_length_lengths[entry.symbol];
+            bits += entry.symbol == 16 ? 2 : entry.symbol == 17 ? 3 : entry.symbol == 18 ? 7 : 0;
+        }
+        return bits;
+    }
+};
+
+static DynamicHeader build_dynamic_header(const HuffmanCodes& codes)
+{
+    DynamicHeader header;
+
+    header.literal_count = 286;
+    while (header.literal_count > 257 && codes.literal_lengths[header.literal_count - 1] == 0)
+        header.literal_count--;
+    header.distance_count = distance_code_count;
+    while (header.distance_count > 1 && codes.distance_lengths[header.distance_count - 1] == 0)
+        header.distance_count--;
+
+    Vector<u8, literal_code_count + distance_code_count> lengths;
+    lengths.append(codes.literal_lengths.data(), header.literal_count);
+    lengths.append(codes.distance_lengths.data(), header.distance_count);
+
+    for (size_t i = 0; i < lengths.size();) {
+        auto length = lengths[i];
+        size_t run = 1;
+        while (i + run < lengths.size() && lengths[i + run] == length)
+            ++run;
+        i += run;
+
+        if (length == 0) {
+            while (run >= 11) {
+                auto count = min<size_t>(run, 138);
+                header.entries.append({ 18, static_cast<u8>(count - 11) });
+                run -= count;
+            }
+            if (run >= 3) {
+                header.entries.append({ 17, static_cast<u8>(run - 3) });
+                run = 0;
+            }
+        } else {
+            header.entries.append({ length, 0 });
+            --run;
+            while (run >= 3) {
+                auto count = min<size_t>(run, 6);
+                header.entries.append({ 16, static_cast<u8>(count - 3) });
+                run -= count;
+            }
+        }
+        for (; run > 0; --run)
+            header.entries.append({ length, 0 });
+    }
+
+    Array<u32, code_length_code_count> frequencies {};
+    for (auto& entry : header.entries)
+        frequencies[entry.symbol]++;
+    generate_huffman_lengths(header.code_length_lengths, frequencies, 7);
+    generate_huffman_codes(header.code_length_codes, header.code_length_lengths);
+
+    header.code_length_count = code_length_code_count;
+    while (header.code_length_count > 4 && header.code_length_lengths[code_length_order[header.code_length_count - 1]] == 0)
+        header.code_length_count--;
+
+    return header;
+}
+
+DeflateCompressor::DeflateCompressor(OutputStream& stream, CompressionLevel compression_level)
+    : m_output_stream(stream)
+    , m_compression_level(compression_level)
+{
+    switch (compression_level) {
+    case CompressionLevel::Store:
+        m_parameters = { 0, 0, 0, false };
+        break;
+    case CompressionLevel::Fast:
+        m_parameters = { 8, 32, 0, false };
+        break;
+    case CompressionLevel::Good:
+        m_parameters = { 128, 128, 16, true };
+        break;
+    case CompressionLevel::Best:
+        m_parameters = { 4096, max_match_length, max_match_length, true };
+        break;
+    }
+
+    m_buffer = ByteBuffer::create_uninitialized(window_size + block_size);
+    if (compression_level != CompressionLevel::Store) {
+        m_hash_head.resize(1 << hash_bits);
+        m_hash_previous.resize(window_size);
+        m_hash_head.span().fill(0);
+        m_hash_previous.span().fill(0);
+    }
+}
+
+DeflateCompressor::~DeflateCompressor()
+{
+}
+
+size_t DeflateCompressor::write(ReadonlyBytes bytes)
+{
+    ASSERT(!m_finished);
+    if (has_any_error())
+        return 0;
+
+    size_t nwritten = 0;
+    while (nwritten < bytes.size()) {
+        auto count = min(bytes.size() - nwritten, block_size - m_pending_size);
+        memcpy(m_buffer.data() + m_history_size + m_pending_size, bytes.data() + nwritten, count);
+        m_pending_size += count;
+        nwritten += count;
+
+        if (m_pending_size == block_size) {
+            compress_block(false);
+            if (has_any_error())
+                return 0;
+        }
+    }
+
+    return nwritten;
+}
+
+bool DeflateCompressor::write_or_error(ReadonlyBytes bytes)
+{
+    if (write(bytes) < bytes.size()) {
+        set_fatal_error();
+        return false;
+    }
+
+    return true;
+}
+
+void DeflateCompressor::final()
+{
+    ASSERT(!m_finished);
+    m_finished = true;
+
+    if (has_any_error())
+        return;
+
+    compress_block(true);
+    m_output_stream.align_to_byte_boundary();
+    if (m_output_stream.handle_any_error())
+        set_fatal_error();
+}
+
+Optional<ByteBuffer> DeflateCompressor::compress_all(ReadonlyBytes bytes, CompressionLevel compression_level)
+{
+    DuplexMemoryStream output_stream;
+    DeflateCompressor deflate_stream { output_stream, compression_level };
+
+    deflate_stream.write_or_error(bytes);
+    deflate_stream.final();
+
+    if (deflate_stream.handle_any_error())
+        return {};
+
+    return output_stream.copy_into_contiguous_buffer();
+}
+
+u32 DeflateCompressor::insert_hash(size_t position)
+{
+    const u8* bytes = m_buffer.data() + position;
+    u32 hash = ((bytes[0] | bytes[1] << 8 | bytes[2] << 16) * 2654435761u) >> (32 - hash_bits);
+
+    u32 candidate = m_hash_head[hash];
+    m_hash_previous[(m_buffer_offset + position) % window_size] = candidate;
+    m_hash_head[hash] = position + 1;
+    return candidate;
+}
+
+size_t DeflateCompressor::longest_match(size_t position, size_t end, u32 candidate, u16& distance) const
+{
+    const u8* data = m_buffer.data();
+    const u8* current = data + position;
+    size_t max_length = min(max_match_length, end - position);
+    size_t lowest_position = position > window_size ? position - window_size : 0;
+
+    size_t best_length = min_match_length - 1;
+    for (size_t chain = m_parameters.max_chain_length; chain > 0 && candidate > lowest_position; --chain) {
+        size_t match_position = candidate - 1;
+        const u8* match = data + match_position;
+
+        // Cheaply rule out candidates that can't beat the current best.
+        if (match[best_length] == current[best_length] && match[0] == current[0]) {
+            size_t length = 0;
+            while (length + sizeof(u64) <= max_length) {
+                u64 a, b;
+                memcpy(&a, current + length, sizeof(a));
+                memcpy(&b, match + length, sizeof(b));
+                if (a != b) {
+                    length += __builtin_ctzll(a ^ b) / 8;
+                    goto counted;
+                }
+                length += sizeof(u64);
+            }
+            while (length < max_length && current[length] == match[length])
+                ++length;
+        counted:
+            if (length > best_length) {
+                best_length = length;
+                distance = position - match_position;
+                if (length >= m_parameters.nice_match_length || length == max_length)
+                    break;
+            }
+        }
+
+        // Slots are reused once a position falls out of the window, so stop at anything that isn't older.
+        u32 next_candidate = m_hash_previous[(m_buffer_offset + match_position) % window_size];
+        if (next_candidate >= candidate)
+            break;
+        candidate = next_candidate;
+    }
+
+    // A three byte match far away costs more bits than the literals it replaces.
+    if (best_length == min_match_length && distance > 4096)
+        return 0;
+    return best_length >= min_match_length ? best_length : 0;
+}
+
+void DeflateCompressor::tokenize_greedy(size_t start, size_t end)
+{
+    const u8* data = m_buffer.data();
+    size_t position = start;
+    while (position < end) {
+        size_t length = 0;
+        u16 distance = 0;
+        if (position + min_match_length <= end)
+            length = longest_match(position, end, insert_hash(position), distance);
+
+        if (!length) {
+            m_tokens.append({ 0, data[position] });
+            ++position;
+            continue;
+        }
+
+        m_tokens.append({ static_cast<u16>(length), distance });
+        for (size_t i = 1; i < length && position + i + min_match_length <= end; ++i)
+            insert_hash(position + i);
+        position += length;
+    }
+}
+
+// Before taking a match, checks whether the next position starts a longer one (like zlib's deflate_slow).
+void DeflateCompressor::tokenize_lazy(size_t start, size_t end)
+{
+    const u8* data = m_buffer.data();
+    size_t previous_length = 0;
+    u16 previous_distance = 0;
+    bool has_previous_literal = false;
+
+    size_t position = start;
+    while (position < end) {
+        size_t length = 0;
+        u16 distance = 0;
+        if (position + min_match_length <= end) {
+            auto candidate = insert_hash(position);
+            if (previous_length < m_parameters.max_lazy_match_length)
+                length = longest_match(position, end, candidate, distance);
+        }
+
+        if (previous_length && length <= previous_length) {
+            // The match starting one byte back wins.
+            m_tokens.append({ static_cast<u16>(previous_length), previous_distance });
+            size_t match_end = position - 1 + previous_length;
+            for (size_t i = position + 1; i < match_end && i + min_match_length <= end; ++i)
+                insert_hash(i);
+            position = match_end;
+            previous_length = 0;
+            has_previous_literal = false;
+            continue;
+        }
+
+        if (has_previous_literal)
+            m_tokens.append({ 0, data[position - 1] });
+        has_previous_literal = true;
+        previous_length = length;
+        previous_distance = distance;
+        ++position;
+    }
+
+    if (has_previous_literal)
+        m_tokens.append({ 0, data[position - 1] });
+}
+
+void DeflateCompressor::compress_block(bool is_final)
+{
+    auto data = m_buffer.span().slice(m_history_size, m_pending_size);
+
+    if (m_compression_level == CompressionLevel::Store) {
+        write_stored_blocks(data, is_final);
+    } else {
+        m_tokens.clear_with_capacity();
+        if (m_parameters.max_lazy_match_length)
+            tokenize_lazy(m_history_size, m_history_size + m_pending_size);
+        else
+            tokenize_greedy(m_history_size, m_history_size + m_pending_size);
+        write_block(data, is_final);
+    }
+
+    if (m_output_stream.handle_any_error())
+        set_fatal_error();
+
+    slide_window();
+}
+
+void DeflateCompressor::slide_window()
+{
+    size_t total_size = m_history_size + m_pending_size;
+    size_t kept_size = min(total_size, window_size);
+    size_t shift = total_size - kept_size;
+
+    memmove(m_buffer.data(), m_buffer.data() + shift, kept_size);
+    m_buffer_offset += shift;
+    m_history_size = kept_size;
+    m_pending_size = 0;
+
+    if (m_compression_level == CompressionLevel::Store || !shift)
+        return;
+
+    auto rebase = [shift](u32& entry) { entry = entry > shift ? entry - shift : 0; };
+    for (auto& entry : m_hash_head)
+        rebase(entry);
+    for (auto& entry : m_hash_previous)
+        rebase(entry);
+}
+
+void DeflateCompressor::write_stored_blocks(ReadonlyBytes data, bool is_final)
+{
+    // Stored blocks hold at most 65535 bytes, and an empty final block still has to be written.
+    do {
+        auto chunk = data.trim(0xffff);
+        data = data.slice(chunk.size());
+
+        m_output_stream.write_bit(is_final && data.is_empty());
+        m_output_stream.write_bits(0b00, 2);
+        m_output_stream.align_to_byte_boundary();
+
+        LittleEndian<u16> length = chunk.size();
+        LittleEndian<u16> negated_length = ~chunk.size();
+        m_output_stream << length << negated_length;
+        m_output_stream.write_or_error(chunk);
+    } while (!data.is_empty());
+}
+
+void DeflateCompressor::write_block(ReadonlyBytes data, bool is_final)
+{
+    Array<u32, literal_code_count> literal_frequencies {};
+    Array<u32, distance_code_count> distance_frequencies {};
+    size_t extra_bits = 0;
+
+    for (auto& token : m_tokens) {
+        if (!token.length) {
+            literal_frequencies[token.literal_or_distance]++;
+            continue;
+        }
+        auto length_symbol = length_index(token.length);
+        auto distance_symbol = distance_index(token.literal_or_distance);
+        literal_frequencies[257 + length_symbol]++;
+        distance_frequencies[distance_symbol]++;
+        extra_bits += length_extra_bits[length_symbol] + distance_extra_bits[distance_symbol];
+    }
+    literal_frequencies[end_of_block]++;
+
+    auto encoded_bit_size = [&](const HuffmanCodes& codes) {
+        size_t bits = extra_bits;
+        for (size_t i = 0; i < literal_code_count; ++i)
+            bits += literal_frequencies[i] * codes.literal_lengths[i];
+        for (size_t i = 0; i < distance_code_count; ++i)
+            bits += distance_frequencies[i] * codes.distance_lengths[i];
+        return bits;
+    };
+
+    auto& fixed_codes = fixed_huffman_codes();
+    size_t fixed_bit_size = 3 + encoded_bit_size(fixed_codes);
+    // Roughly: the header, padding up to a byte boundary, and LEN/NLEN for every 65535 bytes.
+    size_t stored_bit_size = 3 + 7 + (data.size() / 0xffff + 1) * 32 + data.size() * 8;
+
+    HuffmanCodes dynamic_codes;
+    Optional<DynamicHeader> dynamic_header;
+    size_t dynamic_bit_size = NumericLimits<size_t>::max();
+    if (m_parameters.use_dynamic_codes) {
+        generate_huffman_lengths(dynamic_codes.literal_lengths, literal_frequencies, 15);
+        generate_huffman_lengths(dynamic_codes.distance_lengths, distance_frequencies, 15);
+        generate_huffman_codes(dynamic_codes.literal_codes, dynamic_codes.literal_lengths);
+        generate_huffman_codes(dynamic_codes.distance_codes, dynamic_codes.distance_lengths);
+        dynamic_header = build_dynamic_header(dynamic_codes);
+        dynamic_bit_size = 3 + dynamic_header->bit_size() + encoded_bit_size(dynamic_codes);
+    }
+
+    if (stored_bit_size <= fixed_bit_size && stored_bit_size <= dynamic_bit_size) {
+        write_stored_blocks(data, is_final);
+        return;
+    }
+
+    m_output_stream.write_bit(is_final);
+
+    const HuffmanCodes* codes = &fixed_codes;
+    if (dynamic_bit_size < fixed_bit_size) {
+        codes = &dynamic_codes;
+        auto& header = dynamic_header.value();
+        m_output_stream.write_bits(0b10, 2);
+        m_output_stream.write_bits(header.literal_count - 257, 5);
+        m_output_stream.write_bits(header.distance_count - 1, 5);
+        m_output_stream.write_bits(header.code_length_count - 4, 4);
+        for (size_t i = 0; i < header.code_length_count; ++i)
+            m_output_stream.write_bits(header.code_length_lengths[code_length_order[i]], 3);
+        for (auto& entry : header.entries) {
+            m_output_stream.write_bits(header.code_length_codes[entry.symbol], header.code_length_lengths[entry.symbol]);
+            if (entry.symbol == 16)
+                m_output_stream.write_bits(entry.extra, 2);
+            else if (entry.symbol == 17)
+                m_output_stream.write_bits(entry.extra, 3);
+            else if (entry.symbol == 18)
+                m_output_stream.write_bits(entry.extra, 7);
+        }
+    } else {
+        m_output_stream.write_bits(0b01, 2);
+    }
+
+    for (auto& token : m_tokens) {
+        if (!token.length) {
+            m_output_stream.write_bits(codes->literal_codes[token.literal_or_distance], codes->literal_lengths[token.literal_or_distance]);
+            continue;
+        }
+        auto length_symbol = length_index(token.length);
+        auto distance_symbol = distance_index(token.literal_or_distance);
+        m_output_stream.write_bits(codes->literal_codes[257 + length_symbol], codes->literal_lengths[257 + length_symbol]);
+        m_output_stream.write_bits(token.length - length_base[length_symbol], length_extra_bits[length_symbol]);
+        m_output_stream.write_bits(codes->distance_codes[distance_symbol], codes->distance_lengths[distance_symbol]);
+        m_output_stream.write_bits(token.literal_or_distance - distance_base[distance_symbol], distance_extra_bits[distance_symbol]);
+    }
+    m_output_stream.write_bits(codes->literal_codes[end_of_block], codes->literal_lengths[end_of_block]);
+}
+
 }
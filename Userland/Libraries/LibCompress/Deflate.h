@@ -26,10 +26,11 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/BitStream.h>
 #include <AK/ByteBuffer.h>
-#include <AK/CircularDuplexStream.h>
 #include <AK/Endian.h>
+#include <AK/OwnPtr.h>
 #include <AK/Vector.h>
 
 namespace Compress {
@@ -45,8 +46,19 @@ public:
     static Optional<CanonicalCode> from_bytes(ReadonlyBytes);
 
 private:
-    Vector<u32> m_symbol_codes;
-    Vector<u32> m_symbol_values;
+    static constexpr size_t fast_lookup_bits = 9;
+
+    u32 read_long_symbol(InputBitStream&) const;
+
+    // Indexed by the next fast_lookup_bits bits of the stream, each entry holds a symbol in the upper
+    // bits and the length of its code in the lower four. Zero means the code is longer than that.
+    Array<u16, 1 << fast_lookup_bits> m_fast_lookup_table {};
+
+    // Longer codes are decoded by walking the code lengths in order, see https://www.hanshq.net/zip.html#huffdec
+    Array<u16, 16> m_first_code {};
+    Array<u16, 16> m_code_count {};
+    Array<u16, 16> m_first_symbol_index {};
+    Vector<u16, 288> m_symbols_by_code;
 };
 
 class DeflateDecompressor final : public InputStream {
@@ -86,7 +98,10 @@ public:
     friend CompressedBlock;
     friend UncompressedBlock;
 
+    // Since bits are read ahead, this may consume a few bytes past the end of the deflate stream. Pass
+    // in an InputBitStream to read whatever follows the deflate stream from that afterwards instead.
     DeflateDecompressor(InputStream&);
+    DeflateDecompressor(InputBitStream&);
     ~DeflateDecompressor();
 
     size_t read(Bytes) override;
@@ -110,8 +125,93 @@ private:
         UncompressedBlock m_uncompressed_block;
     };
 
-    InputBitStream m_input_stream;
-    CircularDuplexStream<32 * 1024> m_output_stream;
+    static constexpr size_t window_size = 32 * KiB;
+    static constexpr size_t output_chunk_size = 64 * KiB;
+    static constexpr size_t max_match_length = 258;
+
+    void discard_read_output();
+
+    OwnPtr<InputBitStream> m_owned_input_stream;
+    InputBitStream& m_input_stream;
+
+    // The last window_size bytes that were read, followed by the output that hasn't been read yet. The
+    // slack at the end lets a back-reference be copied in whole words without checking for the end.
+    ByteBuffer m_output_buffer;
+    size_t m_output_read_offset { 0 };
+    size_t m_output_write_offset { 0 };
+};
+
+class DeflateCompressor final : public OutputStream {
+public:
+    enum class CompressionLevel {
+        // Stored blocks only, the data is not compressed at all.
+        Store,
+        // Greedy matching over short hash chains, fixed Huffman codes.
+        Fast,
+        // Lazy matching over longer hash chains, dynamic Huffman codes.
+        Good,
+        // Like Good, but searching much harder for long matches.
+        Best,
+    };
+
+    DeflateCompressor(OutputStream&, CompressionLevel = CompressionLevel::Good);
+    ~DeflateCompressor();
+
+    size_t write(ReadonlyBytes) override;
+    bool write_or_error(ReadonlyBytes) override;
+
+    // Compresses whatever is still buffered and ends the stream. Must be called once, after the last write.
+    void final();
+
+    static Optional<ByteBuffer> compress_all(ReadonlyBytes, CompressionLevel = CompressionLevel::Good);
+
+private:
+    static constexpr size_t window_size = 32 * KiB;
+    static constexpr size_t block_size = 64 * KiB;
+    static constexpr size_t hash_bits = 15;
+    static constexpr size_t min_match_length = 3;
+    static constexpr size_t max_match_length = 258;
+
+    // A literal byte if length is 0, a back-reference otherwise.
+    struct Token {
+        u16 length;
+        u16 literal_or_distance;
+    };
+
+    struct LevelParameters {
+        size_t max_chain_length;
+        size_t nice_match_length;
+        size_t max_lazy_match_length;
+        bool use_dynamic_codes;
+    };
+
+    void compress_block(bool is_final);
+    void tokenize_greedy(size_t start, size_t end);
+    void tokenize_lazy(size_t start, size_t end);
+    u32 insert_hash(size_t position);
+    size_t longest_match(size_t position, size_t end, u32 candidate, u16& distance) const;
+    void slide_window();
+
+    void write_block(ReadonlyBytes, bool is_final);
+    void write_stored_blocks(ReadonlyBytes, bool is_final);
+
+    OutputBitStream m_output_stream;
+    CompressionLevel m_compression_level;
+    LevelParameters m_parameters;
+
+    // The last window_size bytes that were compressed, followed by the pending input.
+    ByteBuffer m_buffer;
+    size_t m_history_size { 0 };
+    size_t m_pending_size { 0 };
+    // Offset of m_buffer[0] in the whole input, m_hash_previous is indexed by input offset.
+    size_t m_buffer_offset { 0 };
+
+    // Hash chains over the buffer. Entries are buffer positions plus one, zero means "none".
+    Vector<u32> m_hash_head;
+    Vector<u32> m_hash_previous;
+
+    Vector<Token> m_tokens;
+    bool m_finished { false };
 };
 
 }
@@ -48,10 +48,6 @@ bool GzipDecompressor::BlockHeader::supported_by_implementation() const
         return false;
     }
 
-    if (flags & Flags::FHCRC) {
-        TODO();
-    }
-
     return true;
 }
 
@@ -62,10 +58,11 @@ GzipDecompressor::GzipDecompressor(InputStream& stream)
 
 GzipDecompressor::~GzipDecompressor()
 {
+    if (m_current_member.has_value())
+        current_member().m_stream.handle_any_error();
     m_current_member.clear();
 }
 
-// FIXME: Again, there are surely a ton of bugs because the code doesn't check for read errors.
 size_t GzipDecompressor::read(Bytes bytes)
 {
     if (has_any_error() || m_eof)
@@ -73,6 +70,10 @@ size_t GzipDecompressor::read(Bytes bytes)
 
     if (m_current_member.has_value()) {
         size_t nread = current_member().m_stream.read(bytes);
+        if (current_member().m_stream.handle_any_error() || m_input_stream.handle_any_error()) {
+            set_fatal_error();
+            return 0;
+        }
         current_member().m_checksum.update(bytes.trim(nread));
         current_member().m_nread += nread;
 
@@ -80,6 +81,11 @@ size_t GzipDecompressor::read(Bytes bytes)
             LittleEndian<u32> crc32, input_size;
             m_input_stream >> crc32 >> input_size;
 
+            if (m_input_stream.handle_any_error()) {
+                set_fatal_error();
+                return 0;
+            }
+
             if (crc32 != current_member().m_checksum.digest()) {
                 // FIXME: Somehow the checksum is incorrect?
 
@@ -100,13 +106,21 @@ size_t GzipDecompressor::read(Bytes bytes)
         return nread;
     } else {
         BlockHeader header;
-        m_input_stream >> Bytes { &header, sizeof(header) };
+        Bytes header_bytes { &header, sizeof(header) };
 
+        // Running out of input is only fine before the first byte of a member.
+        m_input_stream >> header_bytes.slice(0, 1);
         if (m_input_stream.handle_any_error()) {
             m_eof = true;
             return 0;
         }
 
+        m_input_stream >> header_bytes.slice(1);
+        if (m_input_stream.handle_any_error()) {
+            set_fatal_error();
+            return 0;
+        }
+
         if (!header.valid_magic_number() || !header.supported_by_implementation()) {
             set_fatal_error();
             return 0;
@@ -128,6 +142,17 @@ size_t GzipDecompressor::read(Bytes bytes)
             m_input_stream >> comment;
         }
 
+        if (header.flags & Flags::FHCRC) {
+            // FIXME: Check the CRC16 of the header instead of skipping it.
+            LittleEndian<u16> header_crc16;
+            m_input_stream >> header_crc16;
+        }
+
+        if (m_input_stream.handle_any_error()) {
+            set_fatal_error();
+            return 0;
+        }
+
         m_current_member.emplace(header, m_input_stream);
         return read(bytes);
     }
@@ -172,6 +197,7 @@ Optional<ByteBuffer> GzipDecompressor::decompress_all(ReadonlyBytes bytes)
         output_stream.write_or_error({ buffer, nread });
     }
 
+    memory_stream.handle_any_error();
     if (gzip_stream.handle_any_error())
         return {};
 
@@ -180,4 +206,83 @@ Optional<ByteBuffer> GzipDecompressor::decompress_all(ReadonlyBytes bytes)
 
 bool GzipDecompressor::unreliable_eof() const { return m_eof; }
 
+GzipCompressor::GzipCompressor(OutputStream& stream, CompressionLevel compression_level)
+    : m_output_stream(stream)
+    , m_deflate_stream(stream, compression_level)
+{
+    GzipDecompressor::BlockHeader header;
+    header.identification_1 = 0x1f;
+    header.identification_2 = 0x8b;
+    header.compression_method = 0x08;
+    header.flags = 0;
+    header.modification_time = 0;
+    // XFL tells decompressors whether the slowest (2) or the fastest (4) algorithm was used.
+    header.extra_flags = compression_level == CompressionLevel::Best ? 2 : compression_level == CompressionLevel::Good ? 0 : 4;
+    header.operating_system = 3; // Unix
+
+    m_output_stream << ReadonlyBytes { &header, sizeof(header) };
+}
+
+GzipCompressor::~GzipCompressor()
+{
+}
+
+size_t GzipCompressor::write(ReadonlyBytes bytes)
+{
+    ASSERT(!m_finished);
+    if (has_any_error())
+        return 0;
+
+    auto nwritten = m_deflate_stream.write(bytes);
+    m_checksum.update(bytes.trim(nwritten));
+    m_total_size += nwritten;
+
+    if (m_deflate_stream.handle_any_error())
+        set_fatal_error();
+
+    return nwritten;
+}
+
+bool GzipCompressor::write_or_error(ReadonlyBytes bytes)
+{
+    if (write(bytes) < bytes.size()) {
+        set_fatal_error();
+        return false;
+    }
+
+    return true;
+}
+
+void GzipCompressor::final()
+{
+    ASSERT(!m_finished);
+    m_finished = true;
+
+    m_deflate_stream.final();
+    if (m_deflate_stream.handle_any_error())
+        set_fatal_error();
+    if (has_any_error())
+        return;
+
+    LittleEndian<u32> crc32 = m_checksum.digest();
+    LittleEndian<u32> input_size = static_cast<u32>(m_total_size);
+    m_output_stream << crc32 << input_size;
+    if (m_output_stream.handle_any_error())
+        set_fatal_error();
+}
+
+Optional<ByteBuffer> GzipCompressor::compress_all(ReadonlyBytes bytes, CompressionLevel compression_level)
+{
+    DuplexMemoryStream output_stream;
+    GzipCompressor gzip_stream { output_stream, compression_level };
+
+    gzip_stream.write_or_error(bytes);
+    gzip_stream.final();
+
+    if (gzip_stream.handle_any_error())
+        return {};
+
+    return output_stream.copy_into_contiguous_buffer();
+}
+
 }
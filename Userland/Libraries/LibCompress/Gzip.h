@@ -45,6 +45,8 @@ public:
     static Optional<ByteBuffer> decompress_all(ReadonlyBytes);
 
 private:
+    friend class GzipCompressor;
+
     struct [[gnu::packed]] BlockHeader {
         u8 identification_1;
         u8 identification_2;
@@ -70,7 +72,7 @@ private:
 
     class Member {
     public:
-        Member(BlockHeader header, InputStream& stream)
+        Member(BlockHeader header, InputBitStream& stream)
             : m_header(header)
             , m_stream(stream)
         {
@@ -85,10 +87,36 @@ private:
     const Member& current_member() const { return m_current_member.value(); }
     Member& current_member() { return m_current_member.value(); }
 
-    InputStream& m_input_stream;
+    // Deflate reads ahead, so headers and trailers are read through the same bit stream.
+    InputBitStream m_input_stream;
     Optional<Member> m_current_member;
 
     bool m_eof { false };
 };
 
+// Writes a single gzip member (RFC 1952) without a file name or modification time.
+// final() writes the CRC-32 and size trailer and has to be called after the last write.
+class GzipCompressor final : public OutputStream {
+public:
+    using CompressionLevel = DeflateCompressor::CompressionLevel;
+
+    GzipCompressor(OutputStream&, CompressionLevel = CompressionLevel::Good);
+    ~GzipCompressor();
+
+    size_t write(ReadonlyBytes) override;
+    bool write_or_error(ReadonlyBytes) override;
+
+    void final();
+
+    static Optional<ByteBuffer> compress_all(ReadonlyBytes, CompressionLevel = CompressionLevel::Good);
+
+private:
+    OutputStream& m_output_stream;
+    DeflateCompressor m_deflate_stream;
+    Crypto::Checksum::CRC32 m_checksum;
+    size_t m_total_size { 0 };
+
+    bool m_finished { false };
+};
+
 }
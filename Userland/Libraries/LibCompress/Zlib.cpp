@@ -25,6 +25,7 @@
  */
 
 #include <AK/Assertions.h>
+#include <AK/MemoryStream.h>
 #include <AK/Span.h>
 #include <AK/Types.h>
 #include <AK/Vector.h>
@@ -76,4 +77,206 @@ u32 Zlib::checksum()
     return m_checksum;
 }
 
+ZlibDecompressor::ZlibDecompressor(InputStream& stream)
+    : m_input_stream(stream)
+{
+}
+
+ZlibDecompressor::~ZlibDecompressor()
+{
+    if (m_deflate_stream.has_value())
+        m_deflate_stream->handle_any_error();
+}
+
+bool ZlibDecompressor::read_header()
+{
+    u8 compression_info = 0;
+    u8 flags = 0;
+    m_input_stream >> compression_info >> flags;
+    if (m_input_stream.handle_any_error())
+        return false;
+
+    auto compression_method = compression_info & 0xf;
+    auto window_size_log2 = (compression_info >> 4) + 8;
+    bool has_dictionary = flags & 0x20;
+
+    if (compression_method != 8 || window_size_log2 > 15 || has_dictionary)
+        return false;
+    if ((compression_info * 256 + flags) % 31 != 0)
+        return false;
+
+    m_deflate_stream.emplace(m_input_stream);
+    return true;
+}
+
+bool ZlibDecompressor::read_trailer()
+{
+    BigEndian<u32> checksum;
+    m_input_stream >> checksum;
+    if (m_input_stream.handle_any_error())
+        return false;
+
+    return checksum == m_checksum.digest();
+}
+
+size_t ZlibDecompressor::read(Bytes bytes)
+{
+    if (has_any_error() || m_eof)
+        return 0;
+
+    if (!m_deflate_stream.has_value() && !read_header()) {
+        set_fatal_error();
+        return 0;
+    }
+
+    auto nread = m_deflate_stream->read(bytes);
+    if (m_deflate_stream->handle_any_error()) {
+        set_fatal_error();
+        return 0;
+    }
+    m_checksum.update(bytes.trim(nread));
+
+    if (nread < bytes.size() && m_deflate_stream->unreliable_eof()) {
+        m_eof = true;
+        if (!read_trailer()) {
+            set_fatal_error();
+            return 0;
+        }
+    }
+
+    return nread;
+}
+
+bool ZlibDecompressor::read_or_error(Bytes bytes)
+{
+    if (read(bytes) < bytes.size()) {
+        set_fatal_error();
+        return false;
+    }
+
+    return true;
+}
+
+bool ZlibDecompressor::discard_or_error(size_t count)
+{
+    u8 buffer[4096];
+
+    size_t ndiscarded = 0;
+    while (ndiscarded < count) {
+        if (unreliable_eof()) {
+            set_fatal_error();
+            return false;
+        }
+
+        ndiscarded += read({ buffer, min<size_t>(count - ndiscarded, sizeof(buffer)) });
+    }
+
+    return true;
+}
+
+bool ZlibDecompressor::unreliable_eof() const { return m_eof; }
+
+Optional<ByteBuffer> ZlibDecompressor::decompress_all(ReadonlyBytes bytes)
+{
+    InputMemoryStream memory_stream { bytes };
+    ZlibDecompressor zlib_stream { memory_stream };
+    DuplexMemoryStream output_stream;
+
+    u8 buffer[4096];
+    while (!zlib_stream.has_any_error() && !zlib_stream.unreliable_eof()) {
+        const auto nread = zlib_stream.read({ buffer, sizeof(buffer) });
+        output_stream.write_or_error({ buffer, nread });
+    }
+
+    memory_stream.handle_any_error();
+    if (zlib_stream.handle_any_error())
+        return {};
+
+    return output_stream.copy_into_contiguous_buffer();
+}
+
+ZlibCompressor::ZlibCompressor(OutputStream& stream, CompressionLevel compression_level)
+    : m_output_stream(stream)
+    , m_deflate_stream(stream, compression_level)
+{
+    // Deflate with a 32 KiB window, and FLEVEL as a hint about how hard the compressor tried.
+    u8 compression_method_and_flags = 0x78;
+    u8 flags = 0;
+    switch (compression_level) {
+    case CompressionLevel::Store:
+    case CompressionLevel::Fast:
+        flags = 0 << 6;
+        break;
+    case CompressionLevel::Good:
+        flags = 2 << 6;
+        break;
+    case CompressionLevel::Best:
+        flags = 3 << 6;
+        break;
+    }
+    flags |= 31 - (compression_method_and_flags * 256 + flags) % 31;
+
+    m_output_stream << compression_method_and_flags << flags;
+}
+
+ZlibCompressor::~ZlibCompressor()
+{
+}
+
+size_t ZlibCompressor::write(ReadonlyBytes bytes)
+{
+    ASSERT(!m_finished);
+    if (has_any_error())
+        return 0;
+
+    auto nwritten = m_deflate_stream.write(bytes);
+    m_checksum.update(bytes.trim(nwritten));
+
+    if (m_deflate_stream.handle_any_error())
+        set_fatal_error();
+
+    return nwritten;
+}
+
+bool ZlibCompressor::write_or_error(ReadonlyBytes bytes)
+{
+    if (write(bytes) < bytes.size()) {
+        set_fatal_error();
+        return false;
+    }
+
+    return true;
+}
+
+void ZlibCompressor::final()
+{
+    ASSERT(!m_finished);
+    m_finished = true;
+
+    m_deflate_stream.final();
+    if (m_deflate_stream.handle_any_error())
+        set_fatal_error();
+    if (has_any_error())
+        return;
+
+    BigEndian<u32> checksum = m_checksum.digest();
+    m_output_stream << checksum;
+    if (m_output_stream.handle_any_error())
+        set_fatal_error();
+}
+
+Optional<ByteBuffer> ZlibCompressor::compress_all(ReadonlyBytes bytes, CompressionLevel compression_level)
+{
+    DuplexMemoryStream output_stream;
+    ZlibCompressor zlib_stream { output_stream, compression_level };
+
+    zlib_stream.write_or_error(bytes);
+    zlib_stream.final();
+
+    if (zlib_stream.handle_any_error())
+        return {};
+
+    return output_stream.copy_into_contiguous_buffer();
+}
+
 }
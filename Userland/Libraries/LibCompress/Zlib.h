@@ -29,6 +29,8 @@
 #include <AK/ByteBuffer.h>
 #include <AK/Span.h>
 #include <AK/Types.h>
+#include <LibCompress/Deflate.h>
+#include <LibCrypto/Checksum/Adler32.h>
 
 namespace Compress {
 
@@ -53,4 +55,56 @@ private:
     ReadonlyBytes m_data_bytes;
 };
 
+// Inflates a zlib stream (RFC 1950) as it is read, without needing all of the
+// compressed data up front. The Adler-32 checksum is verified once the end of
+// the deflate stream has been reached.
+class ZlibDecompressor final : public InputStream {
+public:
+    ZlibDecompressor(InputStream&);
+    ~ZlibDecompressor();
+
+    size_t read(Bytes) override;
+    bool read_or_error(Bytes) override;
+    bool discard_or_error(size_t) override;
+
+    bool unreliable_eof() const override;
+
+    static Optional<ByteBuffer> decompress_all(ReadonlyBytes);
+
+private:
+    bool read_header();
+    bool read_trailer();
+
+    // Deflate reads ahead, so headers and trailers are read through the same bit stream.
+    InputBitStream m_input_stream;
+    Optional<DeflateDecompressor> m_deflate_stream;
+    Crypto::Checksum::Adler32 m_checksum;
+
+    bool m_eof { false };
+};
+
+// Deflates everything written to it into a zlib stream (RFC 1950). final() writes
+// the Adler-32 trailer and has to be called once all data has been written.
+class ZlibCompressor final : public OutputStream {
+public:
+    using CompressionLevel = DeflateCompressor::CompressionLevel;
+
+    ZlibCompressor(OutputStream&, CompressionLevel = CompressionLevel::Good);
+    ~ZlibCompressor();
+
+    size_t write(ReadonlyBytes) override;
+    bool write_or_error(ReadonlyBytes) override;
+
+    void final();
+
+    static Optional<ByteBuffer> compress_all(ReadonlyBytes, CompressionLevel = CompressionLevel::Good);
+
+private:
+    OutputStream& m_output_stream;
+    DeflateCompressor m_deflate_stream;
+    Crypto::Checksum::Adler32 m_checksum;
+
+    bool m_finished { false };
+};
+
 }
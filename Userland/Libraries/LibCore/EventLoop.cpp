@@ -47,13 +47,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__serenity__) || defined(__linux__)
+#    include <sys/epoll.h>
+#    define EVENTLOOP_USE_EPOLL
+#else
+#    include <sys/select.h>
+#endif
+
 //#define EVENTLOOP_DEBUG
 //#define DEFERRED_INVOKE_DEBUG
 
@@ -81,7 +87,17 @@ static EventLoop* s_main_event_loop;
 static Vector<EventLoop*>* s_event_loop_stack;
 static NeverDestroyed<IDAllocator> s_id_allocator;
 static HashMap<int, NonnullOwnPtr<EventLoopTimer>>* s_timers;
-static HashTable<Notifier*>* s_notifiers;
+
+// The notifiers watching each fd. The kernel only knows about fds, so the
+// event masks of all notifiers for an fd are combined into a single interest.
+struct NotifiersForFD {
+    Vector<Notifier*, 2> notifiers;
+    unsigned event_mask { 0 };
+};
+static HashMap<int, NotifiersForFD>* s_notifiers;
+#ifdef EVENTLOOP_USE_EPOLL
+static int s_epoll_fd = -1;
+#endif
 int EventLoop::s_wake_pipe_fds[2];
 static RefPtr<LocalServer> s_rpc_server;
 HashMap<int, RefPtr<RPCClient>> s_rpc_clients;
@@ -284,7 +300,7 @@ EventLoop::EventLoop()
     if (!s_event_loop_stack) {
         s_event_loop_stack = new Vector<EventLoop*>;
         s_timers = new HashMap<int, NonnullOwnPtr<EventLoopTimer>>;
-        s_notifiers = new HashTable<Notifier*>;
+        s_notifiers = new HashMap<int, NotifiersForFD>;
     }
 
     if (!s_main_event_loop) {
@@ -299,6 +315,18 @@ EventLoop::EventLoop()
 
 #endif
         ASSERT(rc == 0);
+#ifdef EVENTLOOP_USE_EPOLL
+        s_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (s_epoll_fd < 0) {
+            perror("epoll_create1");
+            ASSERT_NOT_REACHED();
+        }
+        epoll_event wake_event {};
+        wake_event.events = EPOLLIN;
+        wake_event.data.fd = s_wake_pipe_fds[0];
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, s_wake_pipe_fds[0], &wake_event);
+        ASSERT(rc == 0);
+#endif
         s_event_loop_stack->append(this);
 
 #ifdef __serenity__
@@ -602,6 +630,11 @@ void EventLoop::notify_forked(ForkEvent event)
         s_event_loop_stack->clear();
         s_timers->clear();
         s_notifiers->clear();
+#ifdef EVENTLOOP_USE_EPOLL
+        // The epoll set is shared with the parent, so we must not touch it.
+        close(s_epoll_fd);
+        s_epoll_fd = -1;
+#endif
         if (auto* info = signals_info<false>()) {
             info->signal_handlers.clear();
             info->next_signal_id = 0;
@@ -619,31 +652,7 @@ void EventLoop::notify_forked(ForkEvent event)
 
 void EventLoop::wait_for_event(WaitMode mode)
 {
-    fd_set rfds;
-    fd_set wfds;
 retry:
-    FD_ZERO(&rfds);
-    FD_ZERO(&wfds);
-
-    int max_fd = 0;
-    auto add_fd_to_set = [&max_fd](int fd, fd_set& set) {
-        FD_SET(fd, &set);
-        if (fd > max_fd)
-            max_fd = fd;
-    };
-
-    int max_fd_added = -1;
-    add_fd_to_set(s_wake_pipe_fds[0], rfds);
-    max_fd = max(max_fd, max_fd_added);
-    for (auto& notifier : *s_notifiers) {
-        if (notifier->event_mask() & Notifier::Read)
-            add_fd_to_set(notifier->fd(), rfds);
-        if (notifier->event_mask() & Notifier::Write)
-            add_fd_to_set(notifier->fd(), wfds);
-        if (notifier->event_mask() & Notifier::Exceptional)
-            ASSERT_NOT_REACHED();
-    }
-
     bool queued_events_is_empty;
     {
         LOCKER(m_private->lock);
@@ -670,6 +679,57 @@ retry:
         }
     }
 
+    // Only the fds that are actually ready come back from the kernel, so the
+    // cost of a wakeup doesn't depend on how many notifiers we have.
+    struct ReadyFD {
+        int fd;
+        bool readable;
+        bool writable;
+    };
+    Vector<ReadyFD, 64> ready_fds;
+
+#ifdef EVENTLOOP_USE_EPOLL
+    int timeout_ms = -1;
+    if (!should_wait_forever)
+        timeout_ms = timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000;
+
+    epoll_event events[64];
+try_wait_again:
+    int ready_count = epoll_wait(s_epoll_fd, events, 64, timeout_ms);
+    if (ready_count < 0) {
+        int saved_errno = errno;
+        if (saved_errno == EINTR) {
+            if (m_exit_requested)
+                return;
+            goto try_wait_again;
+        }
+#    ifdef EVENTLOOP_DEBUG
+        dbgln("Core::EventLoop::wait_for_event: {} ({}: {})", ready_count, saved_errno, strerror(saved_errno));
+#    endif
+        // Blow up, similar to Core::safe_syscall.
+        ASSERT_NOT_REACHED();
+    }
+    for (int i = 0; i < ready_count; ++i) {
+        // Errors and hangups are reported to readers and writers alike, just like select() would.
+        bool has_error = events[i].events & (EPOLLERR | EPOLLHUP);
+        ready_fds.append({ events[i].data.fd, has_error || (events[i].events & EPOLLIN), has_error || (events[i].events & EPOLLOUT) });
+    }
+#else
+    fd_set rfds;
+    fd_set wfds;
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+
+    int max_fd = s_wake_pipe_fds[0];
+    FD_SET(s_wake_pipe_fds[0], &rfds);
+    for (auto& it : *s_notifiers) {
+        if (it.value.event_mask & Notifier::Read)
+            FD_SET(it.key, &rfds);
+        if (it.value.event_mask & Notifier::Write)
+            FD_SET(it.key, &wfds);
+        max_fd = max(max_fd, it.key);
+    }
+
 try_select_again:
     int marked_fd_count = select(max_fd + 1, &rfds, &wfds, nullptr, should_wait_forever ? nullptr : &timeout);
     if (marked_fd_count < 0) {
@@ -679,13 +739,23 @@ try_select_again:
                 return;
             goto try_select_again;
         }
-#ifdef EVENTLOOP_DEBUG
+#    ifdef EVENTLOOP_DEBUG
         dbgln("Core::EventLoop::wait_for_event: {} ({}: {})", marked_fd_count, saved_errno, strerror(saved_errno));
-#endif
+#    endif
         // Blow up, similar to Core::safe_syscall.
         ASSERT_NOT_REACHED();
     }
-    if (FD_ISSET(s_wake_pipe_fds[0], &rfds)) {
+    for (int fd = 0; marked_fd_count > 0 && fd <= max_fd; ++fd) {
+        bool readable = FD_ISSET(fd, &rfds);
+        bool writable = FD_ISSET(fd, &wfds);
+        if (readable || writable)
+            ready_fds.append({ fd, readable, writable });
+    }
+#endif
+
+    for (auto& ready_fd : ready_fds) {
+        if (ready_fd.fd != s_wake_pipe_fds[0])
+            continue;
         int wake_events[8];
         auto nread = read(s_wake_pipe_fds[0], wake_events, sizeof(wake_events));
         if (nread < 0) {
@@ -735,16 +805,14 @@ try_select_again:
         }
     }
 
-    if (!marked_fd_count)
-        return;
-
-    for (auto& notifier : *s_notifiers) {
-        if (FD_ISSET(notifier->fd(), &rfds)) {
-            if (notifier->event_mask() & Notifier::Event::Read)
+    for (auto& ready_fd : ready_fds) {
+        auto it = s_notifiers->find(ready_fd.fd);
+        if (it == s_notifiers->end())
+            continue;
+        for (auto* notifier : it->value.notifiers) {
+            if (ready_fd.readable && (notifier->event_mask() & Notifier::Event::Read))
                 post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
-        }
-        if (FD_ISSET(notifier->fd(), &wfds)) {
-            if (notifier->event_mask() & Notifier::Event::Write)
+            if (ready_fd.writable && (notifier->event_mask() & Notifier::Event::Write))
                 post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
         }
     }
@@ -808,14 +876,87 @@ bool EventLoop::unregister_timer(int timer_id)
     return true;
 }
 
+static void update_fd_interest(int fd, NotifiersForFD& notifiers_for_fd)
+{
+    unsigned event_mask = 0;
+    for (auto* notifier : notifiers_for_fd.notifiers)
+        event_mask |= notifier->event_mask();
+    ASSERT(!(event_mask & Notifier::Exceptional));
+    if (event_mask == notifiers_for_fd.event_mask)
+        return;
+
+#ifdef EVENTLOOP_USE_EPOLL
+    if (!event_mask) {
+        // Errors and hangups are always reported for an fd in the epoll set, so
+        // an fd nobody wants events for has to leave it, or it would keep waking us.
+        // This fails harmlessly if the fd has already been closed.
+        epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        notifiers_for_fd.event_mask = 0;
+        return;
+    }
+
+    epoll_event event {};
+    if (event_mask & Notifier::Read)
+        event.events |= EPOLLIN;
+    if (event_mask & Notifier::Write)
+        event.events |= EPOLLOUT;
+    event.data.fd = fd;
+
+    int rc;
+    if (!notifiers_for_fd.event_mask) {
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    } else {
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        // The fd may have been closed and reopened behind our back, in which case
+        // the kernel has already forgotten about it.
+        if (rc < 0 && errno == ENOENT)
+            rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+    if (rc < 0 && errno == EEXIST)
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    if (rc < 0)
+        perror("EventLoop: epoll_ctl");
+#else
+    (void)fd;
+#endif
+    notifiers_for_fd.event_mask = event_mask;
+}
+
 void EventLoop::register_notifier(Badge<Notifier>, Notifier& notifier)
 {
-    s_notifiers->set(&notifier);
+    auto& notifiers_for_fd = s_notifiers->ensure(notifier.fd());
+    if (!notifiers_for_fd.notifiers.contains_slow(&notifier))
+        notifiers_for_fd.notifiers.append(&notifier);
+    // The fd may have been closed and reused for another file while other notifiers
+    // were still registered for it, and the kernel drops its interest along with the
+    // old file. So don't trust the cached event mask, and always tell the kernel.
+    notifiers_for_fd.event_mask = 0;
+    update_fd_interest(notifier.fd(), notifiers_for_fd);
 }
 
 void EventLoop::unregister_notifier(Badge<Notifier>, Notifier& notifier)
 {
-    s_notifiers->remove(&notifier);
+    auto it = s_notifiers->find(notifier.fd());
+    if (it == s_notifiers->end())
+        return;
+    it->value.notifiers.remove_first_matching([&](auto* entry) { return entry == &notifier; });
+    if (!it->value.notifiers.is_empty()) {
+        update_fd_interest(notifier.fd(), it->value);
+        return;
+    }
+#ifdef EVENTLOOP_USE_EPOLL
+    // This fails harmlessly if the fd has already been closed.
+    epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, notifier.fd(), nullptr);
+#endif
+    s_notifiers->remove(it);
+}
+
+void EventLoop::notifier_event_mask_changed(Badge<Notifier>, Notifier& notifier)
+{
+    auto it = s_notifiers->find(notifier.fd());
+    if (it == s_notifiers->end() || !it->value.notifiers.contains_slow(&notifier))
+        return;
+    update_fd_interest(notifier.fd(), it->value);
 }
 
 void EventLoop::wake()
@@ -65,6 +65,8 @@ public:
     Function<void()> on_connected;
     Function<void()> on_ready_to_read;
 
+    Notifier* read_notifier() { return m_read_notifier.ptr(); }
+
 protected:
     Socket(Type, Object* parent);
 
@@ -25,16 +25,29 @@
  */
 
 #include <AK/Span.h>
+#include <AK/StdLibExtras.h>
 #include <AK/Types.h>
 #include <LibCrypto/Checksum/Adler32.h>
 
 namespace Crypto::Checksum {
 
+// Summing more bytes than this without reducing could overflow m_state_b (this is zlib's NMAX).
+static constexpr size_t max_bytes_between_reductions = 5552;
+
 void Adler32::update(ReadonlyBytes data)
 {
-    for (size_t i = 0; i < data.size(); i++) {
-        m_state_a = (m_state_a + data.at(i)) % 65521;
-        m_state_b = (m_state_b + m_state_a) % 65521;
+    const u8* bytes = data.data();
+    size_t remaining = data.size();
+    while (remaining) {
+        auto count = min(remaining, max_bytes_between_reductions);
+        remaining -= count;
+        for (size_t i = 0; i < count; i++) {
+            m_state_a += bytes[i];
+            m_state_b += m_state_a;
+        }
+        bytes += count;
+        m_state_a %= 65521;
+        m_state_b %= 65521;
     }
 };
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Platform.h>
+#include <LibGfx/Blending.h>
+
+#if ARCH(I386) || ARCH(X86_64)
+#    include <cpuid.h>
+#    include <emmintrin.h>
+#    define HAVE_SSE2_KERNELS
+#    define SSE2_TARGET [[gnu::target("sse2")]]
+#endif
+
+namespace Gfx {
+
+static void blend_scanline_scalar(RGBA32* dst, const RGBA32* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        u8 alpha = Color::from_rgba(src[i]).alpha();
+        if (alpha == 0xff)
+            dst[i] = src[i];
+        else if (alpha)
+            dst[i] = Color::from_rgba(dst[i]).blend(Color::from_rgba(src[i])).value();
+    }
+}
+
+static void blend_scanline_with_opacity_scalar(RGBA32* dst, const RGBA32* src, size_t count, u8 alpha)
+{
+    for (size_t i = 0; i < count; ++i) {
+        Color src_color_with_alpha = Color::from_rgb(src[i]);
+        src_color_with_alpha.set_alpha(alpha);
+        dst[i] = Color::from_rgb(dst[i]).blend(src_color_with_alpha).value();
+    }
+}
+
+static void blend_scanline_with_color_scalar(RGBA32* dst, Color color, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = Color::from_rgba(dst[i]).blend(color).value();
+}
+
+#ifdef HAVE_SSE2_KERNELS
+
+static bool detect_sse2()
+{
+#    ifdef __SSE2__
+    return true;
+#    else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return edx & bit_SSE2;
+#    endif
+}
+
+static bool cpu_has_sse2()
+{
+    static bool s_has_sse2 = detect_sse2();
+    return s_has_sse2;
+}
+
+// Divides each u16 lane (which must be <= 255 * 255) by 255, rounding down.
+SSE2_TARGET ALWAYS_INLINE static __m128i divide_by_255(__m128i x)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+SSE2_TARGET ALWAYS_INLINE static __m128i broadcast_alpha(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Blends two unpacked pixels of src over two unpacked pixels of an opaque dst.
+// With dst.alpha() == 255, Color::blend() reduces to (dst * (255 - alpha) + src * alpha) / 255.
+SSE2_TARGET ALWAYS_INLINE static __m128i blend_two_pixels(__m128i dst, __m128i src, __m128i alpha)
+{
+    auto inverse_alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return divide_by_255(_mm_add_epi16(_mm_mullo_epi16(dst, inverse_alpha), _mm_mullo_epi16(src, alpha)));
+}
+
+SSE2_TARGET ALWAYS_INLINE static __m128i blend_four_pixels(__m128i dst, __m128i src)
+{
+    auto zero = _mm_setzero_si128();
+    auto src_lo = _mm_unpacklo_epi8(src, zero);
+    auto src_hi = _mm_unpackhi_epi8(src, zero);
+    auto lo = blend_two_pixels(_mm_unpacklo_epi8(dst, zero), src_lo, broadcast_alpha(src_lo));
+    auto hi = blend_two_pixels(_mm_unpackhi_epi8(dst, zero), src_hi, broadcast_alpha(src_hi));
+    return _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(0xff000000));
+}
+
+SSE2_TARGET ALWAYS_INLINE static bool all_opaque(__m128i pixels, __m128i alpha_mask)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(pixels, alpha_mask), alpha_mask)) == 0xffff;
+}
+
+SSE2_TARGET static void blend_scanline_sse2(RGBA32* dst, const RGBA32* src, size_t count)
+{
+    auto alpha_mask = _mm_set1_epi32(0xff000000);
+    auto zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto src_pixels = _mm_loadu_si128((const __m128i*)(src + i));
+        auto src_alpha = _mm_and_si128(src_pixels, alpha_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(src_alpha, alpha_mask)) == 0xffff) {
+            _mm_storeu_si128((__m128i*)(dst + i), src_pixels);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(src_alpha, zero)) == 0xffff)
+            continue;
+        auto dst_pixels = _mm_loadu_si128((const __m128i*)(dst + i));
+        if (!all_opaque(dst_pixels, alpha_mask)) {
+            blend_scanline_scalar(dst + i, src + i, 4);
+            continue;
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), blend_four_pixels(dst_pixels, src_pixels));
+    }
+    blend_scanline_scalar(dst + i, src + i, count - i);
+}
+
+SSE2_TARGET static void blend_scanline_with_opacity_sse2(RGBA32* dst, const RGBA32* src, size_t count, u8 alpha)
+{
+    auto zero = _mm_setzero_si128();
+    auto alpha_vector = _mm_set1_epi16(alpha);
+    auto alpha_mask = _mm_set1_epi32(0xff000000);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto src_pixels = _mm_loadu_si128((const __m128i*)(src + i));
+        auto dst_pixels = _mm_loadu_si128((const __m128i*)(dst + i));
+        auto lo = blend_two_pixels(_mm_unpacklo_epi8(dst_pixels, zero), _mm_unpacklo_epi8(src_pixels, zero), alpha_vector);
+        auto hi = blend_two_pixels(_mm_unpackhi_epi8(dst_pixels, zero), _mm_unpackhi_epi8(src_pixels, zero), alpha_vector);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_packus_epi16(lo, hi), alpha_mask));
+    }
+    blend_scanline_with_opacity_scalar(dst + i, src + i, count - i, alpha);
+}
+
+SSE2_TARGET static void blend_scanline_with_color_sse2(RGBA32* dst, Color color, size_t count)
+{
+    auto alpha_mask = _mm_set1_epi32(0xff000000);
+    auto color_pixels = _mm_set1_epi32(color.value());
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto dst_pixels = _mm_loadu_si128((const __m128i*)(dst + i));
+        if (!all_opaque(dst_pixels, alpha_mask)) {
+            blend_scanline_with_color_scalar(dst + i, color, 4);
+            continue;
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), blend_four_pixels(dst_pixels, color_pixels));
+    }
+    blend_scanline_with_color_scalar(dst + i, color, count - i);
+}
+
+#endif
+
+bool has_simd_blending()
+{
+#ifdef HAVE_SSE2_KERNELS
+    return cpu_has_sse2();
+#else
+    return false;
+#endif
+}
+
+void blend_scanline(RGBA32* dst, const RGBA32* src, size_t count)
+{
+#ifdef HAVE_SSE2_KERNELS
+    if (cpu_has_sse2())
+        return blend_scanline_sse2(dst, src, count);
+#endif
+    blend_scanline_scalar(dst, src, count);
+}
+
+void blend_scanline_with_opacity(RGBA32* dst, const RGBA32* src, size_t count, u8 alpha)
+{
+#ifdef HAVE_SSE2_KERNELS
+    if (cpu_has_sse2())
+        return blend_scanline_with_opacity_sse2(dst, src, count, alpha);
+#endif
+    blend_scanline_with_opacity_scalar(dst, src, count, alpha);
+}
+
+void blend_scanline_with_color(RGBA32* dst, Color color, size_t count)
+{
+#ifdef HAVE_SSE2_KERNELS
+    if (cpu_has_sse2())
+        return blend_scanline_with_color_sse2(dst, color, count);
+#endif
+    blend_scanline_with_color_scalar(dst, color, count);
+}
+
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <LibGfx/Color.h>
+
+// Scanline compositing kernels used by Painter.
+//
+// Every kernel produces exactly the same pixels as the per-pixel Color::blend() loop it replaces.
+// On x86, an SSE2 implementation is picked at runtime if the CPU supports it; groups of
+// pixels that the vector path can't handle exactly (i.e. a destination that isn't fully
+// opaque) fall back to the scalar code.
+
+namespace Gfx {
+
+// dst[i] = dst[i].blend(src[i]), except that fully transparent source pixels leave dst untouched.
+void blend_scanline(RGBA32* dst, const RGBA32* src, size_t count);
+
+// Blends the RGB values of src over the RGB values of dst with a constant alpha.
+// The alpha channels of both scanlines are ignored and the result is fully opaque.
+void blend_scanline_with_opacity(RGBA32* dst, const RGBA32* src, size_t count, u8 alpha);
+
+// dst[i] = dst[i].blend(color)
+void blend_scanline_with_color(RGBA32* dst, Color color, size_t count);
+
+bool has_simd_blending();
+
+}
@@ -24,21 +24,25 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/ByteBuffer.h>
 #include <AK/Endian.h>
 #include <AK/LexicalPath.h>
 #include <AK/MappedFile.h>
-#include <LibCore/puff.h>
+#include <AK/Platform.h>
+#include <LibCompress/Zlib.h>
 #include <LibGfx/PNGLoader.h>
 #include <fcntl.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-#ifdef __serenity__
-#    include <serenity.h>
+#if ARCH(I386) || ARCH(X86_64)
+#    include <cpuid.h>
+#    include <emmintrin.h>
+#    define HAVE_SSE2_UNFILTERING
+#    define SSE2_TARGET [[gnu::target("sse2")]]
 #endif
 
 //#define PNG_DEBUG
@@ -59,11 +63,6 @@ struct PNG_IHDR {
 
 static_assert(sizeof(PNG_IHDR) == 13);
 
-struct Scanline {
-    u8 filter { 0 };
-    ReadonlyBytes data {};
-};
-
 struct [[gnu::packed]] PaletteEntry {
     u8 r;
     u8 g;
@@ -71,32 +70,19 @@ struct [[gnu::packed]] PaletteEntry {
     //u8 a;
 };
 
-template<typename T>
-struct [[gnu::packed]] Tuple {
-    T gray;
-    T a;
-};
-
-template<typename T>
-struct [[gnu::packed]] Triplet {
-    T r;
-    T g;
-    T b;
-};
-
-template<typename T>
-struct [[gnu::packed]] Quad {
-    T r;
-    T g;
-    T b;
-    T a;
-};
-
 enum PngInterlaceMethod {
     Null = 0,
     Adam7 = 1
 };
 
+enum class PngFilterType : u8 {
+    None = 0,
+    Sub = 1,
+    Up = 2,
+    Average = 3,
+    Paeth = 4,
+};
+
 struct PNGLoadingContext {
     enum State {
         NotDecoded = 0,
@@ -119,11 +105,8 @@ struct PNGLoadingContext {
     u8 channels { 0 };
     bool has_seen_zlib_header { false };
     bool has_alpha() const { return color_type & 4 || palette_transparency_data.size() > 0; }
-    Vector<Scanline> scanlines;
     RefPtr<Gfx::Bitmap> bitmap;
-    u8* decompression_buffer { nullptr };
-    size_t decompression_buffer_size { 0 };
-    Vector<u8> compressed_data;
+    Vector<ReadonlyBytes> compressed_data;
     Vector<PaletteEntry> palette_data;
     Vector<u8> palette_transparency_data;
 
@@ -188,6 +171,64 @@ private:
     size_t m_size_remaining { 0 };
 };
 
+// Presents the contents of all IDAT chunks as one stream, so that the image data
+// can be inflated without first copying it into a contiguous buffer.
+class IDATStream final : public InputStream {
+public:
+    explicit IDATStream(const Vector<ReadonlyBytes>& chunks)
+        : m_chunks(chunks)
+    {
+    }
+
+    size_t read(Bytes bytes) override
+    {
+        if (has_any_error())
+            return 0;
+
+        size_t nread = 0;
+        while (nread < bytes.size() && m_chunk_index < m_chunks.size()) {
+            auto chunk = m_chunks[m_chunk_index].slice(m_offset_in_chunk);
+            auto count = min(chunk.size(), bytes.size() - nread);
+            memcpy(bytes.data() + nread, chunk.data(), count);
+            nread += count;
+            m_offset_in_chunk += count;
+            if (m_offset_in_chunk == m_chunks[m_chunk_index].size()) {
+                ++m_chunk_index;
+                m_offset_in_chunk = 0;
+            }
+        }
+        return nread;
+    }
+
+    bool read_or_error(Bytes bytes) override
+    {
+        if (read(bytes) < bytes.size()) {
+            set_fatal_error();
+            return false;
+        }
+        return true;
+    }
+
+    bool discard_or_error(size_t count) override
+    {
+        u8 buffer[4096];
+        while (count) {
+            auto nread = min(count, sizeof(buffer));
+            if (!read_or_error({ buffer, nread }))
+                return false;
+            count -= nread;
+        }
+        return true;
+    }
+
+    bool unreliable_eof() const override { return m_chunk_index == m_chunks.size(); }
+
+private:
+    const Vector<ReadonlyBytes>& m_chunks;
+    size_t m_chunk_index { 0 };
+    size_t m_offset_in_chunk { 0 };
+};
+
 static RefPtr<Gfx::Bitmap> load_png_impl(const u8*, size_t);
 static bool process_chunk(Streamer&, PNGLoadingContext& context);
 
@@ -223,302 +264,274 @@ ALWAYS_INLINE static u8 paeth_predictor(int a, int b, int c)
     return c;
 }
 
-union [[gnu::packed]] Pixel {
-    RGBA32 rgba { 0 };
-    u8 v[4];
-    struct {
-        u8 r;
-        u8 g;
-        u8 b;
-        u8 a;
-    };
-};
-static_assert(sizeof(Pixel) == 4);
+// The unfilter functions below work on raw scanline bytes. Both rows are preceded by
+// bytes_per_pixel zero bytes, which stand in for the pixel to the left of the first one.
 
-template<bool has_alpha, u8 filter_type>
-ALWAYS_INLINE static void unfilter_impl(Gfx::Bitmap& bitmap, int y, const void* dummy_scanline_data)
+static void unfilter_sub(u8* row, size_t size, size_t bytes_per_pixel)
 {
-    auto* dummy_scanline = (const Pixel*)dummy_scanline_data;
-    if constexpr (filter_type == 0) {
-        auto* pixels = (Pixel*)bitmap.scanline(y);
-        for (int i = 0; i < bitmap.width(); ++i) {
-            auto& x = pixels[i];
-            swap(x.r, x.b);
-        }
-    }
+    const u8* left = row - bytes_per_pixel;
+    for (size_t i = 0; i < size; ++i)
+        row[i] += left[i];
+}
 
-    if constexpr (filter_type == 1) {
-        auto* pixels = (Pixel*)bitmap.scanline(y);
-        swap(pixels[0].r, pixels[0].b);
-        for (int i = 1; i < bitmap.width(); ++i) {
-            auto& x = pixels[i];
-            swap(x.r, x.b);
-            auto& a = (const Pixel&)pixels[i - 1];
-            x.v[0] += a.v[0];
-            x.v[1] += a.v[1];
-            x.v[2] += a.v[2];
-            if constexpr (has_alpha)
-                x.v[3] += a.v[3];
-        }
-        return;
+static void unfilter_up(u8* row, const u8* previous_row, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        row[i] += previous_row[i];
+}
+
+static void unfilter_average(u8* row, const u8* previous_row, size_t size, size_t bytes_per_pixel)
+{
+    const u8* left = row - bytes_per_pixel;
+    for (size_t i = 0; i < size; ++i)
+        row[i] += (left[i] + previous_row[i]) / 2;
+}
+
+static void unfilter_paeth(u8* row, const u8* previous_row, size_t size, size_t bytes_per_pixel)
+{
+    const u8* left = row - bytes_per_pixel;
+    const u8* upper_left = previous_row - bytes_per_pixel;
+    for (size_t i = 0; i < size; ++i)
+        row[i] += paeth_predictor(left[i], previous_row[i], upper_left[i]);
+}
+
+#ifdef HAVE_SSE2_UNFILTERING
+
+static bool detect_sse2()
+{
+#    ifdef __SSE2__
+    return true;
+#    else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return edx & bit_SSE2;
+#    endif
+}
+
+static bool cpu_has_sse2()
+{
+    static bool s_has_sse2 = detect_sse2();
+    return s_has_sse2;
+}
+
+template<size_t bytes_per_pixel>
+SSE2_TARGET ALWAYS_INLINE static __m128i load_pixel(const u8* pixel)
+{
+    u32 value = 0;
+    memcpy(&value, pixel, bytes_per_pixel);
+    return _mm_cvtsi32_si128(value);
+}
+
+template<size_t bytes_per_pixel>
+SSE2_TARGET ALWAYS_INLINE static void store_pixel(u8* pixel, __m128i value)
+{
+    u32 raw_value = _mm_cvtsi128_si32(value);
+    memcpy(pixel, &raw_value, bytes_per_pixel);
+}
+
+SSE2_TARGET ALWAYS_INLINE static __m128i absolute_value(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+SSE2_TARGET ALWAYS_INLINE static __m128i select(__m128i mask, __m128i if_true, __m128i if_false)
+{
+    return _mm_or_si128(_mm_and_si128(mask, if_true), _mm_andnot_si128(mask, if_false));
+}
+
+SSE2_TARGET static void unfilter_up_sse2(u8* row, const u8* previous_row, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128((const __m128i*)(row + i));
+        auto b = _mm_loadu_si128((const __m128i*)(previous_row + i));
+        _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(x, b));
     }
-    if constexpr (filter_type == 2) {
-        auto* pixels = (Pixel*)bitmap.scanline(y);
-        auto* pixels_y_minus_1 = y == 0 ? dummy_scanline : (const Pixel*)bitmap.scanline(y - 1);
-        for (int i = 0; i < bitmap.width(); ++i) {
-            auto& x = pixels[i];
-            swap(x.r, x.b);
-            const Pixel& b = pixels_y_minus_1[i];
-            x.v[0] += b.v[0];
-            x.v[1] += b.v[1];
-            x.v[2] += b.v[2];
-            if constexpr (has_alpha)
-                x.v[3] += b.v[3];
-        }
-        return;
+    unfilter_up(row + i, previous_row + i, size - i);
+}
+
+// Sub, Average and Paeth depend on the pixel just decoded, so these process one whole
+// pixel per step instead of one byte. size must be a multiple of bytes_per_pixel.
+
+template<size_t bytes_per_pixel>
+SSE2_TARGET static void unfilter_sub_sse2(u8* row, size_t size)
+{
+    auto a = _mm_setzero_si128();
+    for (size_t i = 0; i < size; i += bytes_per_pixel) {
+        a = _mm_add_epi8(a, load_pixel<bytes_per_pixel>(row + i));
+        store_pixel<bytes_per_pixel>(row + i, a);
     }
-    if constexpr (filter_type == 3) {
-        auto* pixels = (Pixel*)bitmap.scanline(y);
-        auto* pixels_y_minus_1 = y == 0 ? dummy_scanline : (const Pixel*)bitmap.scanline(y - 1);
-        for (int i = 0; i < bitmap.width(); ++i) {
-            auto& x = pixels[i];
-            swap(x.r, x.b);
-            Pixel a;
-            if (i != 0)
-                a = pixels[i - 1];
-            const Pixel& b = pixels_y_minus_1[i];
-            x.v[0] = x.v[0] + ((a.v[0] + b.v[0]) / 2);
-            x.v[1] = x.v[1] + ((a.v[1] + b.v[1]) / 2);
-            x.v[2] = x.v[2] + ((a.v[2] + b.v[2]) / 2);
-            if constexpr (has_alpha)
-                x.v[3] = x.v[3] + ((a.v[3] + b.v[3]) / 2);
-        }
-        return;
+}
+
+template<size_t bytes_per_pixel>
+SSE2_TARGET static void unfilter_average_sse2(u8* row, const u8* previous_row, size_t size)
+{
+    auto a = _mm_setzero_si128();
+    auto ones = _mm_set1_epi8(1);
+    for (size_t i = 0; i < size; i += bytes_per_pixel) {
+        auto b = load_pixel<bytes_per_pixel>(previous_row + i);
+        // _mm_avg_epu8() rounds up, but the filter wants (a + b) / 2 rounded down.
+        auto average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), ones));
+        a = _mm_add_epi8(average, load_pixel<bytes_per_pixel>(row + i));
+        store_pixel<bytes_per_pixel>(row + i, a);
     }
-    if constexpr (filter_type == 4) {
-        auto* pixels = (Pixel*)bitmap.scanline(y);
-        auto* pixels_y_minus_1 = y == 0 ? dummy_scanline : (Pixel*)bitmap.scanline(y - 1);
-        for (int i = 0; i < bitmap.width(); ++i) {
-            auto& x = pixels[i];
-            swap(x.r, x.b);
-            Pixel a;
-            const Pixel& b = pixels_y_minus_1[i];
-            Pixel c;
-            if (i != 0) {
-                a = pixels[i - 1];
-                c = pixels_y_minus_1[i - 1];
-            }
-            x.v[0] += paeth_predictor(a.v[0], b.v[0], c.v[0]);
-            x.v[1] += paeth_predictor(a.v[1], b.v[1], c.v[1]);
-            x.v[2] += paeth_predictor(a.v[2], b.v[2], c.v[2]);
-            if constexpr (has_alpha)
-                x.v[3] += paeth_predictor(a.v[3], b.v[3], c.v[3]);
-        }
+}
+
+template<size_t bytes_per_pixel>
+SSE2_TARGET static void unfilter_paeth_sse2(u8* row, const u8* previous_row, size_t size)
+{
+    // The predictor is evaluated on 16-bit lanes, where a + b - c can't overflow.
+    auto zero = _mm_setzero_si128();
+    auto a = zero;
+    auto c = zero;
+    for (size_t i = 0; i < size; i += bytes_per_pixel) {
+        auto b = _mm_unpacklo_epi8(load_pixel<bytes_per_pixel>(previous_row + i), zero);
+        auto b_minus_c = _mm_sub_epi16(b, c);
+        auto a_minus_c = _mm_sub_epi16(a, c);
+        auto pa = absolute_value(b_minus_c);
+        auto pb = absolute_value(a_minus_c);
+        auto pc = absolute_value(_mm_add_epi16(b_minus_c, a_minus_c));
+        auto smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        // Like paeth_predictor(), break ties in favor of a, then b.
+        auto predictor = select(_mm_cmpeq_epi16(smallest, pa), a, select(_mm_cmpeq_epi16(smallest, pb), b, c));
+        auto x = _mm_add_epi8(load_pixel<bytes_per_pixel>(row + i), _mm_packus_epi16(predictor, predictor));
+        store_pixel<bytes_per_pixel>(row + i, x);
+        a = _mm_unpacklo_epi8(x, zero);
+        c = b;
     }
 }
 
-template<typename T>
-ALWAYS_INLINE static void unpack_grayscale_without_alpha(PNGLoadingContext& context)
+template<size_t bytes_per_pixel>
+SSE2_TARGET static void unfilter_scanline_sse2(PngFilterType filter, u8* row, const u8* previous_row, size_t size)
 {
-    for (int y = 0; y < context.height; ++y) {
-        auto* gray_values = reinterpret_cast<const T*>(context.scanlines[y].data.data());
-        for (int i = 0; i < context.width; ++i) {
-            auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-            pixel.r = gray_values[i];
-            pixel.g = gray_values[i];
-            pixel.b = gray_values[i];
-            pixel.a = 0xff;
-        }
+    switch (filter) {
+    case PngFilterType::None:
+        return;
+    case PngFilterType::Sub:
+        unfilter_sub_sse2<bytes_per_pixel>(row, size);
+        return;
+    case PngFilterType::Up:
+        unfilter_up_sse2(row, previous_row, size);
+        return;
+    case PngFilterType::Average:
+        unfilter_average_sse2<bytes_per_pixel>(row, previous_row, size);
+        return;
+    case PngFilterType::Paeth:
+        unfilter_paeth_sse2<bytes_per_pixel>(row, previous_row, size);
+        return;
     }
+    ASSERT_NOT_REACHED();
 }
 
-template<typename T>
-ALWAYS_INLINE static void unpack_grayscale_with_alpha(PNGLoadingContext& context)
+#endif
+
+static void unfilter_scanline(PngFilterType filter, u8* row, const u8* previous_row, size_t size, size_t bytes_per_pixel)
 {
-    for (int y = 0; y < context.height; ++y) {
-        auto* tuples = reinterpret_cast<const Tuple<T>*>(context.scanlines[y].data.data());
-        for (int i = 0; i < context.width; ++i) {
-            auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-            pixel.r = tuples[i].gray;
-            pixel.g = tuples[i].gray;
-            pixel.b = tuples[i].gray;
-            pixel.a = tuples[i].a;
-        }
+#ifdef HAVE_SSE2_UNFILTERING
+    if (cpu_has_sse2()) {
+        if (bytes_per_pixel == 4)
+            return unfilter_scanline_sse2<4>(filter, row, previous_row, size);
+        if (bytes_per_pixel == 3)
+            return unfilter_scanline_sse2<3>(filter, row, previous_row, size);
+        if (filter == PngFilterType::Up)
+            return unfilter_up_sse2(row, previous_row, size);
+    }
+#endif
+
+    switch (filter) {
+    case PngFilterType::None:
+        return;
+    case PngFilterType::Sub:
+        unfilter_sub(row, size, bytes_per_pixel);
+        return;
+    case PngFilterType::Up:
+        unfilter_up(row, previous_row, size);
+        return;
+    case PngFilterType::Average:
+        unfilter_average(row, previous_row, size, bytes_per_pixel);
+        return;
+    case PngFilterType::Paeth:
+        unfilter_paeth(row, previous_row, size, bytes_per_pixel);
+        return;
     }
+    ASSERT_NOT_REACHED();
 }
 
-template<typename T>
-ALWAYS_INLINE static void unpack_triplets_without_alpha(PNGLoadingContext& context)
+// Samples wider than 8 bits are stored big-endian, so their first byte is the most significant one.
+template<u8 color_type, size_t bytes_per_sample>
+static void unpack_scanline_impl(const u8* row, int width, RGBA32* pixels)
 {
-    for (int y = 0; y < context.height; ++y) {
-        auto* triplets = reinterpret_cast<const Triplet<T>*>(context.scanlines[y].data.data());
-        for (int i = 0; i < context.width; ++i) {
-            auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-            pixel.r = triplets[i].r;
-            pixel.g = triplets[i].g;
-            pixel.b = triplets[i].b;
-            pixel.a = 0xff;
-        }
+    constexpr size_t channels = color_type == 0 ? 1 : color_type == 4 ? 2 : color_type == 2 ? 3 : 4;
+    for (int x = 0; x < width; ++x) {
+        const u8* samples = row + x * channels * bytes_per_sample;
+        if constexpr (color_type == 0)
+            pixels[x] = Color(samples[0], samples[0], samples[0]).value();
+        if constexpr (color_type == 4)
+            pixels[x] = Color(samples[0], samples[0], samples[0], samples[bytes_per_sample]).value();
+        if constexpr (color_type == 2)
+            pixels[x] = Color(samples[0], samples[bytes_per_sample], samples[2 * bytes_per_sample]).value();
+        if constexpr (color_type == 6)
+            pixels[x] = Color(samples[0], samples[bytes_per_sample], samples[2 * bytes_per_sample], samples[3 * bytes_per_sample]).value();
     }
 }
 
-NEVER_INLINE FLATTEN static bool unfilter(PNGLoadingContext& context)
+ALWAYS_INLINE static u8 packed_sample(const u8* row, int x, u8 bit_depth)
+{
+    auto samples_per_byte = 8 / bit_depth;
+    auto bit_offset = (8 - bit_depth) - (bit_depth * (x % samples_per_byte));
+    return (row[x / samples_per_byte] >> bit_offset) & ((1 << bit_depth) - 1);
+}
+
+static bool unpack_scanline(const PNGLoadingContext& context, const u8* row, int width, RGBA32* pixels)
 {
-    // First unpack the scanlines to RGBA:
     switch (context.color_type) {
     case 0:
         if (context.bit_depth == 8) {
-            unpack_grayscale_without_alpha<u8>(context);
+            unpack_scanline_impl<0, 1>(row, width, pixels);
         } else if (context.bit_depth == 16) {
-            unpack_grayscale_without_alpha<u16>(context);
-        } else if (context.bit_depth == 1 || context.bit_depth == 2 || context.bit_depth == 4) {
-            auto bit_depth_squared = context.bit_depth * context.bit_depth;
-            auto pixels_per_byte = 8 / context.bit_depth;
-            auto mask = (1 << context.bit_depth) - 1;
-            for (int y = 0; y < context.height; ++y) {
-                auto* gray_values = context.scanlines[y].data.data();
-                for (int x = 0; x < context.width; ++x) {
-                    auto bit_offset = (8 - context.bit_depth) - (context.bit_depth * (x % pixels_per_byte));
-                    auto value = (gray_values[x / pixels_per_byte] >> bit_offset) & mask;
-                    auto& pixel = (Pixel&)context.bitmap->scanline(y)[x];
-                    pixel.r = value * (0xff / bit_depth_squared);
-                    pixel.g = value * (0xff / bit_depth_squared);
-                    pixel.b = value * (0xff / bit_depth_squared);
-                    pixel.a = 0xff;
-                }
-            }
+            unpack_scanline_impl<0, 2>(row, width, pixels);
         } else {
-            ASSERT_NOT_REACHED();
+            auto max_value = (1 << context.bit_depth) - 1;
+            for (int x = 0; x < width; ++x) {
+                u8 gray = packed_sample(row, x, context.bit_depth) * 0xff / max_value;
+                pixels[x] = Color(gray, gray, gray).value();
+            }
         }
-        break;
+        return true;
     case 4:
-        if (context.bit_depth == 8) {
-            unpack_grayscale_with_alpha<u8>(context);
-        } else if (context.bit_depth == 16) {
-            unpack_grayscale_with_alpha<u16>(context);
-        } else {
-            ASSERT_NOT_REACHED();
-        }
-        break;
+        if (context.bit_depth == 8)
+            unpack_scanline_impl<4, 1>(row, width, pixels);
+        else
+            unpack_scanline_impl<4, 2>(row, width, pixels);
+        return true;
     case 2:
-        if (context.bit_depth == 8) {
-            unpack_triplets_without_alpha<u8>(context);
-        } else if (context.bit_depth == 16) {
-            unpack_triplets_without_alpha<u16>(context);
-        } else {
-            ASSERT_NOT_REACHED();
-        }
-        break;
+        if (context.bit_depth == 8)
+            unpack_scanline_impl<2, 1>(row, width, pixels);
+        else
+            unpack_scanline_impl<2, 2>(row, width, pixels);
+        return true;
     case 6:
-        if (context.bit_depth == 8) {
-            for (int y = 0; y < context.height; ++y) {
-                memcpy(context.bitmap->scanline(y), context.scanlines[y].data.data(), context.scanlines[y].data.size());
-            }
-        } else if (context.bit_depth == 16) {
-            for (int y = 0; y < context.height; ++y) {
-                auto* triplets = reinterpret_cast<const Quad<u16>*>(context.scanlines[y].data.data());
-                for (int i = 0; i < context.width; ++i) {
-                    auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-                    pixel.r = triplets[i].r & 0xFF;
-                    pixel.g = triplets[i].g & 0xFF;
-                    pixel.b = triplets[i].b & 0xFF;
-                    pixel.a = triplets[i].a & 0xFF;
-                }
-            }
-        } else {
-            ASSERT_NOT_REACHED();
-        }
-        break;
+        if (context.bit_depth == 8)
+            unpack_scanline_impl<6, 1>(row, width, pixels);
+        else
+            unpack_scanline_impl<6, 2>(row, width, pixels);
+        return true;
     case 3:
-        if (context.bit_depth == 8) {
-            for (int y = 0; y < context.height; ++y) {
-                auto* palette_index = context.scanlines[y].data.data();
-                for (int i = 0; i < context.width; ++i) {
-                    auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-                    if (palette_index[i] >= context.palette_data.size())
-                        return false;
-                    auto& color = context.palette_data.at((int)palette_index[i]);
-                    auto transparency = context.palette_transparency_data.size() >= palette_index[i] + 1u
-                        ? context.palette_transparency_data.data()[palette_index[i]]
-                        : 0xff;
-                    pixel.r = color.r;
-                    pixel.g = color.g;
-                    pixel.b = color.b;
-                    pixel.a = transparency;
-                }
-            }
-        } else if (context.bit_depth == 1 || context.bit_depth == 2 || context.bit_depth == 4) {
-            auto pixels_per_byte = 8 / context.bit_depth;
-            auto mask = (1 << context.bit_depth) - 1;
-            for (int y = 0; y < context.height; ++y) {
-                auto* palette_indexes = context.scanlines[y].data.data();
-                for (int i = 0; i < context.width; ++i) {
-                    auto bit_offset = (8 - context.bit_depth) - (context.bit_depth * (i % pixels_per_byte));
-                    auto palette_index = (palette_indexes[i / pixels_per_byte] >> bit_offset) & mask;
-                    auto& pixel = (Pixel&)context.bitmap->scanline(y)[i];
-                    if ((size_t)palette_index >= context.palette_data.size())
-                        return false;
-                    auto& color = context.palette_data.at(palette_index);
-                    auto transparency = context.palette_transparency_data.size() >= palette_index + 1u
-                        ? context.palette_transparency_data.data()[palette_index]
-                        : 0xff;
-                    pixel.r = color.r;
-                    pixel.g = color.g;
-                    pixel.b = color.b;
-                    pixel.a = transparency;
-                }
-            }
-        } else {
-            ASSERT_NOT_REACHED();
+        for (int x = 0; x < width; ++x) {
+            auto palette_index = context.bit_depth == 8 ? row[x] : packed_sample(row, x, context.bit_depth);
+            if (palette_index >= context.palette_data.size())
+                return false;
+            auto& color = context.palette_data[palette_index];
+            auto transparency = palette_index < context.palette_transparency_data.size()
+                ? context.palette_transparency_data[palette_index]
+                : 0xff;
+            pixels[x] = Color(color.r, color.g, color.b, transparency).value();
         }
-        break;
+        return true;
     default:
         ASSERT_NOT_REACHED();
-        break;
-    }
-
-    u8 dummy_scanline[context.width * sizeof(RGBA32)];
-
-    for (int y = 0; y < context.height; ++y) {
-        auto filter = context.scanlines[y].filter;
-        if (filter == 0) {
-            if (context.has_alpha())
-                unfilter_impl<true, 0>(*context.bitmap, y, dummy_scanline);
-            else
-                unfilter_impl<false, 0>(*context.bitmap, y, dummy_scanline);
-            continue;
-        }
-        if (filter == 1) {
-            if (context.has_alpha())
-                unfilter_impl<true, 1>(*context.bitmap, y, dummy_scanline);
-            else
-                unfilter_impl<false, 1>(*context.bitmap, y, dummy_scanline);
-            continue;
-        }
-        if (filter == 2) {
-            if (context.has_alpha())
-                unfilter_impl<true, 2>(*context.bitmap, y, dummy_scanline);
-            else
-                unfilter_impl<false, 2>(*context.bitmap, y, dummy_scanline);
-            continue;
-        }
-        if (filter == 3) {
-            if (context.has_alpha())
-                unfilter_impl<true, 3>(*context.bitmap, y, dummy_scanline);
-            else
-                unfilter_impl<false, 3>(*context.bitmap, y, dummy_scanline);
-            continue;
-        }
-        if (filter == 4) {
-            if (context.has_alpha())
-                unfilter_impl<true, 4>(*context.bitmap, y, dummy_scanline);
-            else
-                unfilter_impl<false, 4>(*context.bitmap, y, dummy_scanline);
-            continue;
-        }
     }
-
-    return true;
 }
 
 static bool decode_png_header(PNGLoadingContext& context)
@@ -587,8 +600,6 @@ static bool decode_png_chunks(PNGLoadingContext& context)
     const u8* data_ptr = context.data + sizeof(png_header);
     int data_remaining = context.data_size - sizeof(png_header);
 
-    context.compressed_data.ensure_capacity(context.data_size);
-
     Streamer streamer(data_ptr, data_remaining);
     while (!streamer.at_end()) {
         if (!process_chunk(streamer, context)) {
@@ -602,167 +613,69 @@ static bool decode_png_chunks(PNGLoadingContext& context)
     return true;
 }
 
-static bool decode_png_bitmap_simple(PNGLoadingContext& context)
-{
-    Streamer streamer(context.decompression_buffer, context.decompression_buffer_size);
-
-    for (int y = 0; y < context.height; ++y) {
-        u8 filter;
-        if (!streamer.read(filter)) {
-            context.state = PNGLoadingContext::State::Error;
-            return false;
-        }
+// Index 0 describes a non-interlaced image: a single pass covering every pixel.
+static const int adam7_starty[8] = { 0, 0, 0, 4, 0, 2, 0, 1 };
+static const int adam7_startx[8] = { 0, 0, 4, 0, 2, 0, 1, 0 };
+static const int adam7_stepy[8] = { 1, 8, 8, 8, 4, 4, 2, 2 };
+static const int adam7_stepx[8] = { 1, 8, 8, 4, 4, 2, 2, 1 };
 
-        if (filter > 4) {
-#ifdef PNG_DEBUG
-            dbg() << "Invalid PNG filter: " << filter;
-#endif
-            context.state = PNGLoadingContext::State::Error;
-            return false;
-        }
-
-        context.scanlines.append({ filter });
-        auto& scanline_buffer = context.scanlines.last().data;
-        auto row_size = context.compute_row_size_for_width(context.width);
-        if (row_size.has_overflow())
-            return false;
-
-        if (!streamer.wrap_bytes(scanline_buffer, row_size.value())) {
-            context.state = PNGLoadingContext::State::Error;
-            return false;
-        }
-    }
+static bool decode_png_pass(PNGLoadingContext& context, InputStream& stream, int pass)
+{
+    int width = (context.width - adam7_startx[pass] + adam7_stepx[pass] - 1) / adam7_stepx[pass];
+    int height = (context.height - adam7_starty[pass] + adam7_stepy[pass] - 1) / adam7_stepy[pass];
 
-    context.bitmap = Bitmap::create_purgeable(context.has_alpha() ? BitmapFormat::RGBA32 : BitmapFormat::RGB32, { context.width, context.height });
+    // For small images, some passes might be empty
+    if (!width || !height)
+        return true;
 
-    if (!context.bitmap) {
-        context.state = PNGLoadingContext::State::Error;
+    auto row_size = context.compute_row_size_for_width(width);
+    if (row_size.has_overflow())
         return false;
-    }
-
-    return unfilter(context);
-}
-
-static int adam7_height(PNGLoadingContext& context, int pass)
-{
-    switch (pass) {
-    case 1:
-        return (context.height + 7) / 8;
-    case 2:
-        return (context.height + 7) / 8;
-    case 3:
-        return (context.height + 3) / 8;
-    case 4:
-        return (context.height + 3) / 4;
-    case 5:
-        return (context.height + 1) / 4;
-    case 6:
-        return (context.height + 1) / 2;
-    case 7:
-        return context.height / 2;
-    default:
-        ASSERT_NOT_REACHED();
-    }
-}
-
-static int adam7_width(PNGLoadingContext& context, int pass)
-{
-    switch (pass) {
-    case 1:
-        return (context.width + 7) / 8;
-    case 2:
-        return (context.width + 3) / 8;
-    case 3:
-        return (context.width + 3) / 4;
-    case 4:
-        return (context.width + 1) / 4;
-    case 5:
-        return (context.width + 1) / 2;
-    case 6:
-        return context.width / 2;
-    case 7:
-        return context.width;
-    default:
-        ASSERT_NOT_REACHED();
-    }
-}
 
-// Index 0 unused (non-interlaced case)
-static int adam7_starty[8] = { 0, 0, 0, 4, 0, 2, 0, 1 };
-static int adam7_startx[8] = { 0, 0, 4, 0, 2, 0, 1, 0 };
-static int adam7_stepy[8] = { 1, 8, 8, 8, 4, 4, 2, 2 };
-static int adam7_stepx[8] = { 1, 8, 8, 4, 4, 2, 2, 1 };
+    // Filters work on bytes, so with less than one byte per pixel they look at the previous byte instead.
+    size_t bytes_per_pixel = max(1, context.channels * context.bit_depth / 8);
 
-static bool decode_adam7_pass(PNGLoadingContext& context, Streamer& streamer, int pass)
-{
-    PNGLoadingContext subimage_context;
-    subimage_context.width = adam7_width(context, pass);
-    subimage_context.height = adam7_height(context, pass);
-    subimage_context.channels = context.channels;
-    subimage_context.color_type = context.color_type;
-    subimage_context.palette_data = context.palette_data;
-    subimage_context.palette_transparency_data = context.palette_transparency_data;
-    subimage_context.bit_depth = context.bit_depth;
-    subimage_context.filter_method = context.filter_method;
+    // Each row is preceded by bytes_per_pixel zeroes, see unfilter_scanline().
+    auto previous_row_buffer = ByteBuffer::create_zeroed(bytes_per_pixel + row_size.value());
+    auto row_buffer = ByteBuffer::create_zeroed(bytes_per_pixel + row_size.value());
+    u8* previous_row = previous_row_buffer.data() + bytes_per_pixel;
+    u8* row = row_buffer.data() + bytes_per_pixel;
 
-    // For small images, some passes might be empty
-    if (!subimage_context.width || !subimage_context.height)
-        return true;
+    Vector<RGBA32> pass_pixels;
+    if (pass)
+        pass_pixels.resize(width);
 
-    subimage_context.scanlines.clear_with_capacity();
-    for (int y = 0; y < subimage_context.height; ++y) {
+    for (int y = 0; y < height; ++y) {
         u8 filter;
-        if (!streamer.read(filter)) {
-            context.state = PNGLoadingContext::State::Error;
+        if (!stream.read_or_error({ &filter, sizeof(filter) }))
             return false;
-        }
 
-        if (filter > 4) {
+        if (filter > (u8)PngFilterType::Paeth) {
 #ifdef PNG_DEBUG
-            dbg() << "Invalid PNG filter: " << filter;
+            dbgln("Invalid PNG filter: {}", filter);
 #endif
-            context.state = PNGLoadingContext::State::Error;
             return false;
         }
 
-        subimage_context.scanlines.append({ filter });
-        auto& scanline_buffer = subimage_context.scanlines.last().data;
-
-        auto row_size = context.compute_row_size_for_width(subimage_context.width);
-        if (row_size.has_overflow())
+        if (!stream.read_or_error({ row, (size_t)row_size.value() }))
             return false;
-        if (!streamer.wrap_bytes(scanline_buffer, row_size.value())) {
-            context.state = PNGLoadingContext::State::Error;
-            return false;
-        }
-    }
 
-    subimage_context.bitmap = Bitmap::create(context.bitmap->format(), { subimage_context.width, subimage_context.height });
-    if (!unfilter(subimage_context)) {
-        subimage_context.bitmap = nullptr;
-        return false;
-    }
+        unfilter_scanline((PngFilterType)filter, row, previous_row, row_size.value(), bytes_per_pixel);
 
-    // Copy the subimage data into the main image according to the pass pattern
-    for (int y = 0, dy = adam7_starty[pass]; y < subimage_context.height && dy < context.height; ++y, dy += adam7_stepy[pass]) {
-        for (int x = 0, dx = adam7_startx[pass]; x < subimage_context.width && dy < context.width; ++x, dx += adam7_stepx[pass]) {
-            context.bitmap->set_pixel(dx, dy, subimage_context.bitmap->get_pixel(x, y));
+        if (!pass) {
+            if (!unpack_scanline(context, row, width, context.bitmap->scanline(y)))
+                return false;
+        } else {
+            if (!unpack_scanline(context, row, width, pass_pixels.data()))
+                return false;
+            auto* pixels = context.bitmap->scanline(adam7_starty[pass] + y * adam7_stepy[pass]);
+            for (int x = 0; x < width; ++x)
+                pixels[adam7_startx[pass] + x * adam7_stepx[pass]] = pass_pixels[x];
         }
-    }
-    return true;
-}
-
-static bool decode_png_adam7(PNGLoadingContext& context)
-{
-    Streamer streamer(context.decompression_buffer, context.decompression_buffer_size);
-    context.bitmap = Bitmap::create_purgeable(context.has_alpha() ? BitmapFormat::RGBA32 : BitmapFormat::RGB32, { context.width, context.height });
-    if (!context.bitmap)
-        return false;
 
-    for (int pass = 1; pass <= 7; ++pass) {
-        if (!decode_adam7_pass(context, streamer, pass))
-            return false;
+        swap(row, previous_row);
     }
+
     return true;
 }
 
@@ -782,45 +695,41 @@ static bool decode_png_bitmap(PNGLoadingContext& context)
     if (context.color_type == 3 && context.palette_data.is_empty())
         return false; // Didn't see a PLTE chunk for a palettized image, or it was empty.
 
-    unsigned long srclen = context.compressed_data.size() - 6;
-    unsigned long destlen = 0;
-    int ret = puff(nullptr, &destlen, context.compressed_data.data() + 2, &srclen);
-    if (ret != 0) {
+    context.bitmap = Bitmap::create_purgeable(context.has_alpha() ? BitmapFormat::RGBA32 : BitmapFormat::RGB32, { context.width, context.height });
+    if (!context.bitmap) {
         context.state = PNGLoadingContext::State::Error;
         return false;
     }
-    context.decompression_buffer_size = destlen;
-#ifdef __serenity__
-    context.decompression_buffer = (u8*)mmap_with_name(nullptr, context.decompression_buffer_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0, "PNG decompression buffer");
-#else
-    context.decompression_buffer = (u8*)mmap(nullptr, context.decompression_buffer_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0);
-#endif
 
-    ret = puff(context.decompression_buffer, &destlen, context.compressed_data.data() + 2, &srclen);
-    if (ret != 0) {
-        context.state = PNGLoadingContext::State::Error;
-        return false;
+    // The image data is inflated one scanline at a time, straight from the IDAT chunks.
+    bool success = true;
+    {
+        IDATStream idat_stream { context.compressed_data };
+        Compress::ZlibDecompressor zlib_stream { idat_stream };
+
+        switch (context.interlace_method) {
+        case PngInterlaceMethod::Null:
+            success = decode_png_pass(context, zlib_stream, 0);
+            break;
+        case PngInterlaceMethod::Adam7:
+            for (int pass = 1; pass <= 7 && success; ++pass)
+                success = decode_png_pass(context, zlib_stream, pass);
+            break;
+        default:
+            success = false;
+            break;
+        }
+
+        zlib_stream.handle_any_error();
+        idat_stream.handle_any_error();
     }
     context.compressed_data.clear();
 
-    context.scanlines.ensure_capacity(context.height);
-    switch (context.interlace_method) {
-    case PngInterlaceMethod::Null:
-        if (!decode_png_bitmap_simple(context))
-            return false;
-        break;
-    case PngInterlaceMethod::Adam7:
-        if (!decode_png_adam7(context))
-            return false;
-        break;
-    default:
-        ASSERT_NOT_REACHED();
+    if (!success) {
+        context.state = PNGLoadingContext::State::Error;
+        return false;
     }
 
-    munmap(context.decompression_buffer, context.decompression_buffer_size);
-    context.decompression_buffer = nullptr;
-    context.decompression_buffer_size = 0;
-
     context.state = PNGLoadingContext::State::BitmapDecoded;
     return true;
 }
@@ -871,6 +780,13 @@ static bool process_IHDR(ReadonlyBytes data, PNGLoadingContext& context)
         return false;
     }
 
+    if (ihdr.interlace_method != PngInterlaceMethod::Null && ihdr.interlace_method != PngInterlaceMethod::Adam7) {
+#ifdef PNG_DEBUG
+        dbgln("PNGLoader::process_IHDR: unknown interlace method: {}", ihdr.interlace_method);
+#endif
+        return false;
+    }
+
     context.width = ihdr.width;
     context.height = ihdr.height;
     context.bit_depth = ihdr.bit_depth;
@@ -887,13 +803,6 @@ static bool process_IHDR(ReadonlyBytes data, PNGLoadingContext& context)
     printf(" Interlace type: %d\n", context.interlace_method);
 #endif
 
-    if (context.interlace_method != PngInterlaceMethod::Null && context.interlace_method != PngInterlaceMethod::Adam7) {
-#ifdef PNG_DEBUG
-        dbgln("PNGLoader::process_IHDR: unknown interlace method: {}", context.interlace_method);
-#endif
-        return false;
-    }
-
     switch (context.color_type) {
     case 0: // Each pixel is a grayscale sample.
         if (context.bit_depth != 1 && context.bit_depth != 2 && context.bit_depth != 4 && context.bit_depth != 8 && context.bit_depth != 16)
@@ -928,7 +837,7 @@ static bool process_IHDR(ReadonlyBytes data, PNGLoadingContext& context)
 
 static bool process_IDAT(ReadonlyBytes data, PNGLoadingContext& context)
 {
-    context.compressed_data.append(data.data(), data.size());
+    context.compressed_data.append(data);
     return true;
 }
 
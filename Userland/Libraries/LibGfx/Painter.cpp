@@ -26,6 +26,7 @@
 
 #include "Painter.h"
 #include "Bitmap.h"
+#include "Blending.h"
 #include "Emoji.h"
 #include "Font.h"
 #include "FontDatabase.h"
@@ -131,8 +132,7 @@ void Painter::fill_physical_rect(const IntRect& a_rect, Color color)
     const size_t dst_skip = m_target->pitch() / sizeof(RGBA32);
 
     for (int i = rect.height() - 1; i >= 0; --i) {
-        for (int j = 0; j < rect.width(); ++j)
-            dst[j] = Color::from_rgba(dst[j]).blend(color).value();
+        blend_scanline_with_color(dst, color, rect.width());
         dst += dst_skip;
     }
 }
@@ -220,21 +220,23 @@ void Painter::fill_rect_with_gradient(Orientation orientation, const IntRect& a_
     float increment = (1.0 / ((rect.primary_size_for_orientation(orientation))));
 
     if (orientation == Orientation::Horizontal) {
-        for (int i = clipped_rect.height() - 1; i >= 0; --i) {
-            float c = offset * increment;
-            for (int j = 0; j < clipped_rect.width(); ++j) {
-                dst[j] = gamma_accurate_blend(gradient_start, gradient_end, c).value();
-                c += increment;
-            }
+        // Every row of a horizontal gradient is the same, so only compute the first one.
+        float c = offset * increment;
+        for (int j = 0; j < clipped_rect.width(); ++j) {
+            dst[j] = gamma_accurate_blend(gradient_start, gradient_end, c).value();
+            c += increment;
+        }
+        const RGBA32* first_row = dst;
+        dst += dst_skip;
+        for (int i = clipped_rect.height() - 2; i >= 0; --i) {
+            fast_u32_copy(dst, first_row, clipped_rect.width());
             dst += dst_skip;
         }
     } else {
         float c = offset * increment;
         for (int i = clipped_rect.height() - 1; i >= 0; --i) {
             auto color = gamma_accurate_blend(gradient_start, gradient_end, c);
-            for (int j = 0; j < clipped_rect.width(); ++j) {
-                dst[j] = color.value();
-            }
+            fast_u32_fill(dst, color.value(), clipped_rect.width());
             c += increment;
             dst += dst_skip;
         }
@@ -569,12 +571,7 @@ void Painter::blit_with_opacity(const IntPoint& position, const Gfx::Bitmap& sou
     const unsigned src_skip = source.pitch() / sizeof(RGBA32);
 
     for (int row = first_row; row <= last_row; ++row) {
-        for (int x = 0; x <= (last_column - first_column); ++x) {
-            Color src_color_with_alpha = Color::from_rgb(src[x]);
-            src_color_with_alpha.set_alpha(alpha);
-            Color dst_color = Color::from_rgb(dst[x]);
-            dst[x] = dst_color.blend(src_color_with_alpha).value();
-        }
+        blend_scanline_with_opacity(dst, src, last_column - first_column + 1, alpha);
         dst += dst_skip;
         src += src_skip;
     }
@@ -714,15 +711,7 @@ void Painter::blit_with_alpha(const IntPoint& position, const Gfx::Bitmap& sourc
     const size_t src_skip = source.pitch() / sizeof(RGBA32);
 
     for (int row = first_row; row <= last_row; ++row) {
-        for (int x = 0; x <= (last_column - first_column); ++x) {
-            u8 alpha = Color::from_rgba(src[x]).alpha();
-            if (alpha == 0xff)
-                dst[x] = src[x];
-            else if (!alpha)
-                continue;
-            else
-                dst[x] = Color::from_rgba(dst[x]).blend(Color::from_rgba(src[x])).value();
-        }
+        blend_scanline(dst, src, last_column - first_column + 1);
         dst += dst_skip;
         src += src_skip;
     }
@@ -775,25 +764,31 @@ void Painter::blit(const IntPoint& position, const Gfx::Bitmap& source, const In
     ASSERT_NOT_REACHED();
 }
 
+// The scaled bitmap paths gather source pixels into a span of this many pixels
+// and then hand the whole span to the scanline compositing kernels.
+static constexpr int scaled_bitmap_span_size = 256;
+
 template<bool has_alpha_channel, typename GetPixel>
 ALWAYS_INLINE static void do_draw_integer_scaled_bitmap(Gfx::Bitmap& target, const IntRect& dst_rect, const IntRect& src_rect, const Gfx::Bitmap& source, int hfactor, int vfactor, GetPixel get_pixel, float opacity)
 {
     bool has_opacity = opacity != 1.0f;
+    RGBA32 span[scaled_bitmap_span_size];
     for (int y = 0; y < src_rect.height(); ++y) {
         int dst_y = dst_rect.y() + y * vfactor;
-        for (int x = 0; x < src_rect.width(); ++x) {
-            auto src_pixel = get_pixel(source, x + src_rect.left(), y + src_rect.top());
-            if (has_opacity)
-                src_pixel.set_alpha(src_pixel.alpha() * opacity);
+        for (int column = 0; column < dst_rect.width(); column += scaled_bitmap_span_size) {
+            int count = min(scaled_bitmap_span_size, dst_rect.width() - column);
+            for (int i = 0; i < count; ++i) {
+                auto src_pixel = get_pixel(source, (column + i) / hfactor + src_rect.left(), y + src_rect.top());
+                if (has_opacity)
+                    src_pixel.set_alpha(src_pixel.alpha() * opacity);
+                span[i] = src_pixel.value();
+            }
             for (int yo = 0; yo < vfactor; ++yo) {
-                auto* scanline = (Color*)target.scanline(dst_y + yo);
-                int dst_x = dst_rect.x() + x * hfactor;
-                for (int xo = 0; xo < hfactor; ++xo) {
-                    if constexpr (has_alpha_channel)
-                        scanline[dst_x + xo] = scanline[dst_x + xo].blend(src_pixel);
-                    else
-                        scanline[dst_x + xo] = src_pixel;
-                }
+                auto* scanline = target.scanline(dst_y + yo) + dst_rect.x() + column;
+                if constexpr (has_alpha_channel)
+                    blend_scanline(scanline, span, count);
+                else
+                    fast_u32_copy(scanline, span, count);
             }
         }
     }
@@ -815,19 +810,24 @@ ALWAYS_INLINE static void do_draw_scaled_bitmap(Gfx::Bitmap& target, const IntRe
     }
 
     bool has_opacity = opacity != 1.0f;
+    RGBA32 span[scaled_bitmap_span_size];
 
     for (int y = clipped_rect.top(); y <= clipped_rect.bottom(); ++y) {
-        auto* scanline = (Color*)target.scanline(y);
-        for (int x = clipped_rect.left(); x <= clipped_rect.right(); ++x) {
-            auto scaled_x = ((x - dst_rect.x()) * hscale) >> 16;
-            auto scaled_y = ((y - dst_rect.y()) * vscale) >> 16;
-            auto src_pixel = get_pixel(source, scaled_x, scaled_y);
-            if (has_opacity)
-                src_pixel.set_alpha(src_pixel.alpha() * opacity);
-            if constexpr (has_alpha_channel) {
-                scanline[x] = scanline[x].blend(src_pixel);
-            } else
-                scanline[x] = src_pixel;
+        auto* scanline = target.scanline(y);
+        auto scaled_y = ((y - dst_rect.y()) * vscale) >> 16;
+        for (int x = clipped_rect.left(); x <= clipped_rect.right(); x += scaled_bitmap_span_size) {
+            int count = min(scaled_bitmap_span_size, clipped_rect.right() - x + 1);
+            // Opaque sources are written straight into the target.
+            auto* out = has_alpha_channel ? span : scanline + x;
+            for (int i = 0; i < count; ++i) {
+                auto scaled_x = ((x + i - dst_rect.x()) * hscale) >> 16;
+                auto src_pixel = get_pixel(source, scaled_x, scaled_y);
+                if (has_opacity)
+                    src_pixel.set_alpha(src_pixel.alpha() * opacity);
+                out[i] = src_pixel.value();
+            }
+            if constexpr (has_alpha_channel)
+                blend_scanline(scanline + x, span, count);
         }
     }
 }
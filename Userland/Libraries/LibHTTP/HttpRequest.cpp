@@ -181,6 +181,7 @@ Optional<HttpRequest> HttpRequest::from_raw_request(ReadonlyBytes raw_request)
         return {};
 
     request.m_resource = resource;
+    request.m_protocol = protocol;
     request.m_headers = move(headers);
 
     return request;
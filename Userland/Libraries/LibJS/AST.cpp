@@ -78,13 +78,13 @@ static void update_function_name(Value value, const FlyString& name, HashTable<J
     }
 }
 
-static void update_function_name(Value value, const FlyString& name)
+void update_function_name(Value value, const FlyString& name)
 {
     HashTable<JS::Cell*> visited;
     update_function_name(value, name, visited);
 }
 
-static String get_function_name(GlobalObject& global_object, Value value)
+String get_function_name(GlobalObject& global_object, Value value)
 {
     if (value.is_symbol())
         return String::formatted("[{}]", value.as_symbol().description());
@@ -163,10 +163,17 @@ CallExpression::ThisAndCallee CallExpression::compute_this_and_callee(Interprete
         auto* this_value = is_super_property_lookup ? &vm.this_value(global_object).as_object() : lookup_target.to_object(global_object);
         if (vm.exception())
             return {};
+        if (!is_super_property_lookup && !member_expression.is_computed()) {
+            auto& property_name = static_cast<const Identifier&>(member_expression.property()).string();
+            auto callee = this_value->get_with_cache(property_name, member_expression.property_cache()).value_or(js_undefined());
+            return { this_value, callee };
+        }
         auto property_name = member_expression.computed_property_name(interpreter, global_object);
         if (!property_name.is_valid())
             return {};
-        auto callee = lookup_target.to_object(global_object)->get(property_name).value_or(js_undefined());
+        // The super base is always an object here, it was checked for nullishness above.
+        auto* lookup_object = is_super_property_lookup ? &lookup_target.as_object() : this_value;
+        auto callee = lookup_object->get(property_name).value_or(js_undefined());
         return { this_value, callee };
     }
     return { &global_object, m_callee->execute(interpreter, global_object) };
@@ -1449,7 +1456,7 @@ Value AssignmentExpression::execute(Interpreter& interpreter, GlobalObject& glob
         return {};
     }
     update_function_name(rhs_result, get_function_name(global_object, reference.name().to_value(interpreter.vm())));
-    reference.put(global_object, rhs_result);
+    reference.put(global_object, rhs_result, MemberExpression::property_cache_for(m_lhs, m_property_cache));
 
     if (interpreter.exception())
         return {};
@@ -1464,7 +1471,8 @@ Value UpdateExpression::execute(Interpreter& interpreter, GlobalObject& global_o
     auto reference = m_argument->to_reference(interpreter, global_object);
     if (interpreter.exception())
         return {};
-    auto old_value = reference.get(global_object);
+    auto* property_cache = MemberExpression::property_cache_for(m_argument, m_property_cache);
+    auto old_value = reference.get(global_object, property_cache);
     if (interpreter.exception())
         return {};
     old_value = old_value.to_numeric(global_object);
@@ -1489,7 +1497,7 @@ Value UpdateExpression::execute(Interpreter& interpreter, GlobalObject& global_o
         ASSERT_NOT_REACHED();
     }
 
-    reference.put(global_object, new_value);
+    reference.put(global_object, new_value, property_cache);
     if (interpreter.exception())
         return {};
     return m_prefixed ? new_value : old_value;
@@ -1783,12 +1791,21 @@ Value MemberExpression::execute(Interpreter& interpreter, GlobalObject& global_o
     auto* object_result = object_value.to_object(global_object);
     if (interpreter.exception())
         return {};
+    if (!m_computed)
+        return object_result->get_with_cache(static_cast<const Identifier&>(*m_property).string(), m_property_cache).value_or(js_undefined());
     auto property_name = computed_property_name(interpreter, global_object);
     if (!property_name.is_valid())
         return {};
     return object_result->get(property_name).value_or(js_undefined());
 }
 
+PropertyCache* MemberExpression::property_cache_for(const Expression& expression, PropertyCache& cache)
+{
+    if (!is<MemberExpression>(expression) || static_cast<const MemberExpression&>(expression).is_computed())
+        return nullptr;
+    return &cache;
+}
+
 void MetaProperty::dump(int indent) const
 {
     String name;
@@ -30,10 +30,16 @@
 #include <AK/FlyString.h>
 #include <AK/HashMap.h>
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/Optional.h>
+#include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
 #include <AK/String.h>
 #include <AK/Vector.h>
+#include <LibJS/Bytecode/Block.h>
+#include <LibJS/Bytecode/Generator.h>
+#include <LibJS/Bytecode/Register.h>
 #include <LibJS/Forward.h>
+#include <LibJS/Runtime/PropertyCache.h>
 #include <LibJS/Runtime/PropertyName.h>
 #include <LibJS/Runtime/Value.h>
 #include <LibJS/SourceRange.h>
@@ -43,6 +49,9 @@ namespace JS {
 class VariableDeclaration;
 class FunctionDeclaration;
 
+void update_function_name(Value, const FlyString& name);
+String get_function_name(GlobalObject&, Value);
+
 template<class T, class... Args>
 static inline NonnullRefPtr<T>
 create_ast_node(SourceRange range, Args&&... args)
@@ -54,6 +63,7 @@ class ASTNode : public RefCounted<ASTNode> {
 public:
     virtual ~ASTNode() { }
     virtual Value execute(Interpreter&, GlobalObject&) const = 0;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const;
     virtual void dump(int indent) const;
 
     const SourceRange& source_range() const { return m_source_range; }
@@ -92,6 +102,7 @@ public:
     {
     }
     Value execute(Interpreter&, GlobalObject&) const override { return js_undefined(); }
+    Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override { return {}; }
 };
 
 class ErrorStatement final : public Statement {
@@ -112,6 +123,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     const Expression& expression() const { return m_expression; };
@@ -136,6 +148,7 @@ public:
 
     const NonnullRefPtrVector<Statement>& children() const { return m_children; }
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     void add_variables(NonnullRefPtrVector<VariableDeclaration>);
@@ -143,6 +156,10 @@ public:
     const NonnullRefPtrVector<VariableDeclaration>& variables() const { return m_variables; }
     const NonnullRefPtrVector<FunctionDeclaration>& functions() const { return m_functions; }
 
+    // Generates bytecode for this scope the first time it's needed.
+    // Returns nullptr if it can only be run by the AST interpreter.
+    const Bytecode::Block* bytecode_block(Bytecode::Generator::Kind) const;
+
 protected:
     ScopeNode(SourceRange source_range)
         : Statement(move(source_range))
@@ -153,6 +170,8 @@ private:
     NonnullRefPtrVector<Statement> m_children;
     NonnullRefPtrVector<VariableDeclaration> m_variables;
     NonnullRefPtrVector<FunctionDeclaration> m_functions;
+    mutable OwnPtr<Bytecode::Block> m_bytecode_block;
+    mutable bool m_did_try_generating_bytecode { false };
 };
 
 class Program final : public ScopeNode {
@@ -186,6 +205,7 @@ public:
     {
     }
     virtual Reference to_reference(Interpreter&, GlobalObject&) const;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 };
 
 class Declaration : public Statement {
@@ -256,6 +276,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 };
 
@@ -273,6 +294,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -300,6 +322,7 @@ public:
     const Expression* argument() const { return m_argument; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -321,6 +344,7 @@ public:
     const Statement* alternate() const { return m_alternate; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -342,6 +366,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -362,6 +387,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -406,6 +432,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -497,6 +524,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -522,6 +550,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -550,6 +579,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -567,6 +597,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     NonnullRefPtrVector<Expression> m_expressions;
@@ -589,6 +620,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -604,6 +636,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -635,6 +668,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     StringView value() const { return m_value; }
@@ -653,6 +687,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 };
 
@@ -687,6 +722,7 @@ public:
     const FlyString& string() const { return m_string; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual Reference to_reference(Interpreter&, GlobalObject&) const override;
 
@@ -796,6 +832,7 @@ public:
     {
     }
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 };
 
@@ -814,6 +851,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -865,12 +903,14 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
     AssignmentOp m_op;
     NonnullRefPtr<Expression> m_lhs;
     NonnullRefPtr<Expression> m_rhs;
+    mutable PropertyCache m_property_cache;
 };
 
 enum class UpdateOp {
@@ -889,12 +929,14 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
     UpdateOp m_op;
     NonnullRefPtr<Expression> m_argument;
     bool m_prefixed;
+    mutable PropertyCache m_property_cache;
 };
 
 enum class DeclarationKind {
@@ -941,6 +983,7 @@ public:
     DeclarationKind declaration_kind() const { return m_declaration_kind; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     const NonnullRefPtrVector<VariableDeclarator>& declarations() const { return m_declarations; }
@@ -997,6 +1040,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -1014,6 +1058,7 @@ public:
     const Vector<RefPtr<Expression>>& elements() const { return m_elements; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -1074,11 +1119,16 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual Reference to_reference(Interpreter&, GlobalObject&) const override;
 
     bool is_computed() const { return m_computed; }
     const Expression& object() const { return *m_object; }
+
+    // The inline cache to use for accessing a property through this expression, if it always names the same property.
+    static PropertyCache* property_cache_for(const Expression&, PropertyCache&);
+    PropertyCache& property_cache() const { return m_property_cache; }
     const Expression& property() const { return *m_property; }
 
     PropertyName computed_property_name(Interpreter&, GlobalObject&) const;
@@ -1089,6 +1139,7 @@ private:
     NonnullRefPtr<Expression> m_object;
     NonnullRefPtr<Expression> m_property;
     bool m_computed { false };
+    mutable PropertyCache m_property_cache;
 };
 
 class MetaProperty final : public Expression {
@@ -1123,6 +1174,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     NonnullRefPtr<Expression> m_test;
@@ -1185,6 +1237,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     NonnullRefPtr<Expression> m_argument;
@@ -1236,6 +1289,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
     const FlyString& target_label() const { return m_target_label; }
 
@@ -1252,6 +1306,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
     const FlyString& target_label() const { return m_target_label; }
 
@@ -1267,6 +1322,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 };
 
 }
@@ -0,0 +1,703 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Generator.h>
+#include <LibJS/Bytecode/Op.h>
+#include <LibJS/Bytecode/Register.h>
+
+namespace JS {
+
+const Bytecode::Block* ScopeNode::bytecode_block(Bytecode::Generator::Kind kind) const
+{
+    if (!m_did_try_generating_bytecode) {
+        m_did_try_generating_bytecode = true;
+        m_bytecode_block = Bytecode::Generator::generate(*this, kind);
+    }
+    return m_bytecode_block;
+}
+
+Optional<Bytecode::Register> ASTNode::generate_bytecode(Bytecode::Generator& generator) const
+{
+    generator.fail(*this);
+    return {};
+}
+
+Optional<Bytecode::Register> Expression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::EvaluateExpression>(dst, *this);
+    return dst;
+}
+
+Optional<Bytecode::Register> ScopeNode::generate_bytecode(Bytecode::Generator& generator) const
+{
+    // Labelled blocks can be broken out of, which only loops support so far.
+    if (!label().is_null()) {
+        generator.fail(*this);
+        return {};
+    }
+
+    bool needs_scope = !variables().is_empty() || !functions().is_empty();
+    if (needs_scope)
+        generator.enter_scope(*this);
+
+    for (auto& child : children()) {
+        (void)child.generate_bytecode(generator);
+        if (generator.has_failed())
+            return {};
+    }
+
+    if (needs_scope)
+        generator.leave_scope(*this);
+    return {};
+}
+
+Optional<Bytecode::Register> ExpressionStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    return m_expression->generate_bytecode(generator);
+}
+
+Optional<Bytecode::Register> FunctionDeclaration::generate_bytecode(Bytecode::Generator&) const
+{
+    // Function declarations are hoisted when their scope is entered.
+    return {};
+}
+
+Optional<Bytecode::Register> FunctionExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewFunction>(dst, *this, m_is_arrow_function);
+    return dst;
+}
+
+Optional<Bytecode::Register> VariableDeclaration::generate_bytecode(Bytecode::Generator& generator) const
+{
+    for (auto& declarator : m_declarations) {
+        if (auto* init = declarator.init()) {
+            auto value = init->generate_bytecode(generator).value();
+            generator.emit<Bytecode::Op::SetVariable>(declarator.id().string(), value, Bytecode::Op::SetVariable::Mode::Initialize);
+        }
+    }
+    return {};
+}
+
+Optional<Bytecode::Register> ReturnStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto value = m_argument ? m_argument->generate_bytecode(generator).value() : generator.load_undefined();
+    generator.emit<Bytecode::Op::Return>(value);
+    return {};
+}
+
+Optional<Bytecode::Register> ThrowStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto value = m_argument->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::Throw>(value);
+    return {};
+}
+
+Optional<Bytecode::Register> IfStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto else_label = generator.make_label();
+    auto end_label = generator.make_label();
+
+    auto predicate = m_predicate->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::JumpIfFalse>(predicate, else_label);
+    (void)m_consequent->generate_bytecode(generator);
+    generator.emit<Bytecode::Op::Jump>(end_label);
+
+    generator.bind(else_label);
+    if (m_alternate)
+        (void)m_alternate->generate_bytecode(generator);
+
+    generator.bind(end_label);
+    return {};
+}
+
+Optional<Bytecode::Register> WhileStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto test_label = generator.make_label();
+    auto end_label = generator.make_label();
+
+    generator.bind(test_label);
+    auto test = m_test->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::JumpIfFalse>(test, end_label);
+
+    generator.begin_loop(label(), end_label, test_label);
+    (void)m_body->generate_bytecode(generator);
+    generator.end_loop();
+    generator.emit<Bytecode::Op::Jump>(test_label);
+
+    generator.bind(end_label);
+    return {};
+}
+
+Optional<Bytecode::Register> DoWhileStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto body_label = generator.make_label();
+    auto test_label = generator.make_label();
+    auto end_label = generator.make_label();
+
+    generator.bind(body_label);
+    generator.begin_loop(label(), end_label, test_label);
+    (void)m_body->generate_bytecode(generator);
+    generator.end_loop();
+
+    generator.bind(test_label);
+    auto test = m_test->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::JumpIfTrue>(test, body_label);
+
+    generator.bind(end_label);
+    return {};
+}
+
+Optional<Bytecode::Register> ForStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    // Like the AST interpreter, let and const declarations in the init clause get a scope of their own.
+    RefPtr<BlockStatement> wrapper;
+    if (m_init && is<VariableDeclaration>(*m_init) && static_cast<const VariableDeclaration&>(*m_init).declaration_kind() != DeclarationKind::Var) {
+        wrapper = create_ast_node<BlockStatement>(source_range());
+        NonnullRefPtrVector<VariableDeclaration> decls;
+        decls.append(*static_cast<const VariableDeclaration*>(m_init.ptr()));
+        wrapper->add_variables(decls);
+        generator.retain_node(*wrapper);
+        generator.enter_scope(*wrapper);
+    }
+
+    if (m_init)
+        (void)m_init->generate_bytecode(generator);
+
+    auto test_label = generator.make_label();
+    auto update_label = generator.make_label();
+    auto end_label = generator.make_label();
+
+    generator.bind(test_label);
+    if (m_test) {
+        auto test = m_test->generate_bytecode(generator).value();
+        generator.emit<Bytecode::Op::JumpIfFalse>(test, end_label);
+    }
+
+    generator.begin_loop(label(), end_label, update_label);
+    (void)m_body->generate_bytecode(generator);
+    generator.end_loop();
+
+    generator.bind(update_label);
+    if (m_update)
+        (void)m_update->generate_bytecode(generator);
+    generator.emit<Bytecode::Op::Jump>(test_label);
+
+    generator.bind(end_label);
+    if (wrapper)
+        generator.leave_scope(*wrapper);
+    return {};
+}
+
+Optional<Bytecode::Register> BreakStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    if (!generator.generate_break(m_target_label))
+        generator.fail(*this);
+    return {};
+}
+
+Optional<Bytecode::Register> ContinueStatement::generate_bytecode(Bytecode::Generator& generator) const
+{
+    if (!generator.generate_continue(m_target_label))
+        generator.fail(*this);
+    return {};
+}
+
+Optional<Bytecode::Register> DebuggerStatement::generate_bytecode(Bytecode::Generator&) const
+{
+    return {};
+}
+
+static void generate_binary_op(Bytecode::Generator& generator, BinaryOp op, Bytecode::Register dst, Bytecode::Register lhs, Bytecode::Register rhs)
+{
+    switch (op) {
+    case BinaryOp::Addition:
+        generator.emit<Bytecode::Op::Add>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Subtraction:
+        generator.emit<Bytecode::Op::Sub>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Multiplication:
+        generator.emit<Bytecode::Op::Mul>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Division:
+        generator.emit<Bytecode::Op::Div>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Modulo:
+        generator.emit<Bytecode::Op::Mod>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Exponentiation:
+        generator.emit<Bytecode::Op::Exp>(dst, lhs, rhs);
+        break;
+    case BinaryOp::TypedEquals:
+        generator.emit<Bytecode::Op::TypedEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::TypedInequals:
+        generator.emit<Bytecode::Op::TypedInequals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::AbstractEquals:
+        generator.emit<Bytecode::Op::AbstractEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::AbstractInequals:
+        generator.emit<Bytecode::Op::AbstractInequals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::GreaterThan:
+        generator.emit<Bytecode::Op::GreaterThan>(dst, lhs, rhs);
+        break;
+    case BinaryOp::GreaterThanEquals:
+        generator.emit<Bytecode::Op::GreaterThanEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LessThan:
+        generator.emit<Bytecode::Op::LessThan>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LessThanEquals:
+        generator.emit<Bytecode::Op::LessThanEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseAnd:
+        generator.emit<Bytecode::Op::BitwiseAnd>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseOr:
+        generator.emit<Bytecode::Op::BitwiseOr>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseXor:
+        generator.emit<Bytecode::Op::BitwiseXor>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LeftShift:
+        generator.emit<Bytecode::Op::LeftShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::RightShift:
+        generator.emit<Bytecode::Op::RightShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::UnsignedRightShift:
+        generator.emit<Bytecode::Op::UnsignedRightShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::In:
+        generator.emit<Bytecode::Op::In>(dst, lhs, rhs);
+        break;
+    case BinaryOp::InstanceOf:
+        generator.emit<Bytecode::Op::InstanceOf>(dst, lhs, rhs);
+        break;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+}
+
+Optional<Bytecode::Register> BinaryExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto lhs = m_lhs->generate_bytecode(generator).value();
+    auto rhs = m_rhs->generate_bytecode(generator).value();
+    auto dst = generator.allocate_register();
+    generate_binary_op(generator, m_op, dst, lhs, rhs);
+    return dst;
+}
+
+// Emits a jump to the given label that is taken if the left-hand side of a short-circuiting operator is the result.
+static void generate_short_circuit_jump(Bytecode::Generator& generator, LogicalOp op, Bytecode::Register value, Bytecode::Label target)
+{
+    switch (op) {
+    case LogicalOp::And:
+        generator.emit<Bytecode::Op::JumpIfFalse>(value, target);
+        break;
+    case LogicalOp::Or:
+        generator.emit<Bytecode::Op::JumpIfTrue>(value, target);
+        break;
+    case LogicalOp::NullishCoalescing:
+        generator.emit<Bytecode::Op::JumpIfNotNullish>(value, target);
+        break;
+    }
+}
+
+Optional<Bytecode::Register> LogicalExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    auto end_label = generator.make_label();
+
+    auto lhs = m_lhs->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::Load>(dst, lhs);
+    generate_short_circuit_jump(generator, m_op, dst, end_label);
+
+    auto rhs = m_rhs->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::Load>(dst, rhs);
+
+    generator.bind(end_label);
+    return dst;
+}
+
+Optional<Bytecode::Register> UnaryExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    if (m_op == UnaryOp::Delete)
+        return Expression::generate_bytecode(generator);
+
+    Optional<Bytecode::Register> src;
+    if (m_op == UnaryOp::Typeof && is<Identifier>(*m_lhs)) {
+        // typeof on an undeclared identifier doesn't throw.
+        src = generator.allocate_register();
+        generator.emit<Bytecode::Op::TypeofVariable>(src.value(), static_cast<const Identifier&>(*m_lhs).string());
+    } else {
+        src = m_lhs->generate_bytecode(generator);
+    }
+
+    auto dst = generator.allocate_register();
+
+    switch (m_op) {
+    case UnaryOp::BitwiseNot:
+        generator.emit<Bytecode::Op::BitwiseNot>(dst, src.value());
+        break;
+    case UnaryOp::Not:
+        generator.emit<Bytecode::Op::Not>(dst, src.value());
+        break;
+    case UnaryOp::Plus:
+        generator.emit<Bytecode::Op::UnaryPlus>(dst, src.value());
+        break;
+    case UnaryOp::Minus:
+        generator.emit<Bytecode::Op::UnaryMinus>(dst, src.value());
+        break;
+    case UnaryOp::Typeof:
+        generator.emit<Bytecode::Op::Typeof>(dst, src.value());
+        break;
+    case UnaryOp::Void:
+        return generator.load_undefined();
+    default:
+        ASSERT_NOT_REACHED();
+    }
+    return dst;
+}
+
+Optional<Bytecode::Register> SequenceExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    Optional<Bytecode::Register> last_value;
+    for (auto& expression : m_expressions)
+        last_value = expression.generate_bytecode(generator);
+    return last_value;
+}
+
+Optional<Bytecode::Register> ConditionalExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    auto alternate_label = generator.make_label();
+    auto end_label = generator.make_label();
+
+    auto test = m_test->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::JumpIfFalse>(test, alternate_label);
+    auto consequent = m_consequent->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::Load>(dst, consequent);
+    generator.emit<Bytecode::Op::Jump>(end_label);
+
+    generator.bind(alternate_label);
+    auto alternate = m_alternate->generate_bytecode(generator).value();
+    generator.emit<Bytecode::Op::Load>(dst, alternate);
+
+    generator.bind(end_label);
+    return dst;
+}
+
+Optional<Bytecode::Register> BooleanLiteral::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::LoadImmediate>(dst, Value(m_value));
+    return dst;
+}
+
+Optional<Bytecode::Register> NumericLiteral::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::LoadImmediate>(dst, Value(m_value));
+    return dst;
+}
+
+Optional<Bytecode::Register> StringLiteral::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewString>(dst, m_value);
+    return dst;
+}
+
+Optional<Bytecode::Register> NullLiteral::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::LoadImmediate>(dst, js_null());
+    return dst;
+}
+
+Optional<Bytecode::Register> Identifier::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::GetVariable>(dst, m_string);
+    return dst;
+}
+
+Optional<Bytecode::Register> ThisExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::ResolveThisBinding>(dst);
+    return dst;
+}
+
+Optional<Bytecode::Register> ArrayExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    for (auto& element : m_elements) {
+        if (element && is<SpreadExpression>(*element))
+            return Expression::generate_bytecode(generator);
+    }
+
+    Vector<Bytecode::Register> elements;
+    elements.ensure_capacity(m_elements.size());
+    for (auto& element : m_elements) {
+        // Holes are represented by a register that is never written to, i.e. holds an empty value.
+        elements.append(element ? element->generate_bytecode(generator).value() : generator.allocate_register());
+    }
+
+    auto dst = generator.allocate_register();
+    generator.emit_with_extra_register_slots<Bytecode::Op::NewArray>(elements.size(), dst, elements);
+    return dst;
+}
+
+Optional<Bytecode::Register> ObjectExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    // Spreads, accessors, methods and computed keys are left to the AST interpreter.
+    for (auto& property : m_properties) {
+        if (property.type() != ObjectProperty::Type::KeyValue || property.is_method() || !is<StringLiteral>(property.key()))
+            return Expression::generate_bytecode(generator);
+    }
+
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewObject>(dst);
+    for (auto& property : m_properties) {
+        auto value = property.value().generate_bytecode(generator).value();
+        generator.emit<Bytecode::Op::DefineProperty>(dst, static_cast<const StringLiteral&>(property.key()).value(), value);
+    }
+    return dst;
+}
+
+// Evaluates the object (and, if computed, the property) of a member expression,
+// so that the property can then be read and written without evaluating them again.
+struct MemberReference {
+    Bytecode::Register base;
+    Optional<Bytecode::Register> property;
+    FlyString property_name;
+};
+
+static MemberReference generate_member_reference(Bytecode::Generator& generator, const MemberExpression& expression)
+{
+    auto base = expression.object().generate_bytecode(generator).value();
+    if (expression.is_computed())
+        return { base, expression.property().generate_bytecode(generator).value(), {} };
+    ASSERT(is<Identifier>(expression.property()));
+    return { base, {}, static_cast<const Identifier&>(expression.property()).string() };
+}
+
+static void generate_get(Bytecode::Generator& generator, Bytecode::Register dst, const MemberReference& reference)
+{
+    if (reference.property.has_value())
+        generator.emit<Bytecode::Op::GetByValue>(dst, reference.base, reference.property.value());
+    else
+        generator.emit<Bytecode::Op::GetById>(dst, reference.base, reference.property_name);
+}
+
+static void generate_put(Bytecode::Generator& generator, const MemberReference& reference, Bytecode::Register src)
+{
+    if (reference.property.has_value())
+        generator.emit<Bytecode::Op::PutByValue>(reference.base, reference.property.value(), src);
+    else
+        generator.emit<Bytecode::Op::PutById>(reference.base, reference.property_name, src);
+}
+
+static bool is_simple_member_expression(const Expression& expression)
+{
+    return is<MemberExpression>(expression) && !is<SuperExpression>(static_cast<const MemberExpression&>(expression).object());
+}
+
+Optional<Bytecode::Register> MemberExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    if (!is_simple_member_expression(*this))
+        return Expression::generate_bytecode(generator);
+
+    auto reference = generate_member_reference(generator, *this);
+    auto dst = generator.allocate_register();
+    generate_get(generator, dst, reference);
+    return dst;
+}
+
+static Optional<BinaryOp> binary_op_for_assignment(AssignmentOp op)
+{
+    switch (op) {
+    case AssignmentOp::AdditionAssignment:
+        return BinaryOp::Addition;
+    case AssignmentOp::SubtractionAssignment:
+        return BinaryOp::Subtraction;
+    case AssignmentOp::MultiplicationAssignment:
+        return BinaryOp::Multiplication;
+    case AssignmentOp::DivisionAssignment:
+        return BinaryOp::Division;
+    case AssignmentOp::ModuloAssignment:
+        return BinaryOp::Modulo;
+    case AssignmentOp::ExponentiationAssignment:
+        return BinaryOp::Exponentiation;
+    case AssignmentOp::BitwiseAndAssignment:
+        return BinaryOp::BitwiseAnd;
+    case AssignmentOp::BitwiseOrAssignment:
+        return BinaryOp::BitwiseOr;
+    case AssignmentOp::BitwiseXorAssignment:
+        return BinaryOp::BitwiseXor;
+    case AssignmentOp::LeftShiftAssignment:
+        return BinaryOp::LeftShift;
+    case AssignmentOp::RightShiftAssignment:
+        return BinaryOp::RightShift;
+    case AssignmentOp::UnsignedRightShiftAssignment:
+        return BinaryOp::UnsignedRightShift;
+    default:
+        return {};
+    }
+}
+
+static Optional<LogicalOp> logical_op_for_assignment(AssignmentOp op)
+{
+    switch (op) {
+    case AssignmentOp::AndAssignment:
+        return LogicalOp::And;
+    case AssignmentOp::OrAssignment:
+        return LogicalOp::Or;
+    case AssignmentOp::NullishAssignment:
+        return LogicalOp::NullishCoalescing;
+    default:
+        return {};
+    }
+}
+
+Optional<Bytecode::Register> AssignmentExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    bool is_identifier = is<Identifier>(*m_lhs);
+    if (!is_identifier && !is_simple_member_expression(*m_lhs))
+        return Expression::generate_bytecode(generator);
+
+    Optional<MemberReference> member_reference;
+    if (!is_identifier)
+        member_reference = generate_member_reference(generator, static_cast<const MemberExpression&>(*m_lhs));
+
+    auto generate_lhs_get = [&](Bytecode::Register dst) {
+        if (is_identifier)
+            generator.emit<Bytecode::Op::GetVariable>(dst, static_cast<const Identifier&>(*m_lhs).string());
+        else
+            generate_get(generator, dst, member_reference.value());
+    };
+    auto generate_lhs_put = [&](Bytecode::Register src) {
+        if (is_identifier)
+            generator.emit<Bytecode::Op::SetVariable>(static_cast<const Identifier&>(*m_lhs).string(), src, Bytecode::Op::SetVariable::Mode::Assign);
+        else
+            generate_put(generator, member_reference.value(), src);
+    };
+
+    if (m_op == AssignmentOp::Assignment) {
+        auto value = m_rhs->generate_bytecode(generator).value();
+        generate_lhs_put(value);
+        return value;
+    }
+
+    auto dst = generator.allocate_register();
+    generate_lhs_get(dst);
+
+    if (auto logical_op = logical_op_for_assignment(m_op); logical_op.has_value()) {
+        auto end_label = generator.make_label();
+        generate_short_circuit_jump(generator, logical_op.value(), dst, end_label);
+        auto value = m_rhs->generate_bytecode(generator).value();
+        generator.emit<Bytecode::Op::Load>(dst, value);
+        generate_lhs_put(dst);
+        generator.bind(end_label);
+        return dst;
+    }
+
+    auto rhs = m_rhs->generate_bytecode(generator).value();
+    generate_binary_op(generator, binary_op_for_assignment(m_op).value(), dst, dst, rhs);
+    generate_lhs_put(dst);
+    return dst;
+}
+
+Optional<Bytecode::Register> UpdateExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    bool is_identifier = is<Identifier>(*m_argument);
+    if (!is_identifier && !is_simple_member_expression(*m_argument))
+        return Expression::generate_bytecode(generator);
+
+    Optional<MemberReference> member_reference;
+    auto old_value = generator.allocate_register();
+    if (is_identifier) {
+        generator.emit<Bytecode::Op::GetVariable>(old_value, static_cast<const Identifier&>(*m_argument).string());
+    } else {
+        member_reference = generate_member_reference(generator, static_cast<const MemberExpression&>(*m_argument));
+        generate_get(generator, old_value, member_reference.value());
+    }
+    generator.emit<Bytecode::Op::ToNumeric>(old_value, old_value);
+
+    auto new_value = generator.allocate_register();
+    if (m_op == UpdateOp::Increment)
+        generator.emit<Bytecode::Op::Increment>(new_value, old_value);
+    else
+        generator.emit<Bytecode::Op::Decrement>(new_value, old_value);
+
+    if (is_identifier)
+        generator.emit<Bytecode::Op::SetVariable>(static_cast<const Identifier&>(*m_argument).string(), new_value, Bytecode::Op::SetVariable::Mode::Assign);
+    else
+        generate_put(generator, member_reference.value(), new_value);
+
+    return m_prefixed ? new_value : old_value;
+}
+
+Optional<Bytecode::Register> CallExpression::generate_bytecode(Bytecode::Generator& generator) const
+{
+    if (is<SuperExpression>(*m_callee) || (is<MemberExpression>(*m_callee) && !is_simple_member_expression(*m_callee)))
+        return Expression::generate_bytecode(generator);
+    for (auto& argument : m_arguments) {
+        if (argument.is_spread)
+            return Expression::generate_bytecode(generator);
+    }
+
+    // An undefined |this| makes the call use the global object, like the AST interpreter does.
+    auto this_value = generator.load_undefined();
+    Optional<Bytecode::Register> callee;
+    if (!is<NewExpression>(*this) && is<MemberExpression>(*m_callee)) {
+        auto reference = generate_member_reference(generator, static_cast<const MemberExpression&>(*m_callee));
+        callee = generator.allocate_register();
+        generate_get(generator, callee.value(), reference);
+        this_value = reference.base;
+    } else {
+        callee = m_callee->generate_bytecode(generator);
+    }
+
+    Vector<Bytecode::Register> arguments;
+    arguments.ensure_capacity(m_arguments.size());
+    for (auto& argument : m_arguments)
+        arguments.append(argument.value->generate_bytecode(generator).value());
+
+    auto dst = generator.allocate_register();
+    auto kind = is<NewExpression>(*this) ? Bytecode::Op::Call::Kind::Construct : Bytecode::Op::Call::Kind::Call;
+    generator.emit_with_extra_register_slots<Bytecode::Op::Call>(arguments.size(), kind, dst, callee.value(), this_value, *m_callee, arguments);
+    return dst;
+}
+
+}
@@ -0,0 +1,8 @@
+// Recursive calls with little work in each: measures call overhead.
+function fib(n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+const result = fib(25);
+if (result !== 75025) throw new Error("Wrong result: " + result);
@@ -0,0 +1,25 @@
+// Tight arithmetic loops over local variables: measures the interpreter's dispatch overhead.
+function sumOfSquares(count) {
+    let sum = 0;
+    for (let i = 0; i < count; ++i) {
+        if (i % 3 === 0) continue;
+        sum += i * i;
+    }
+    return sum;
+}
+
+function collatzSteps(limit) {
+    let steps = 0;
+    for (let n = 1; n < limit; ++n) {
+        let x = n;
+        while (x !== 1) {
+            x = x % 2 === 0 ? x / 2 : 3 * x + 1;
+            ++steps;
+        }
+    }
+    return steps;
+}
+
+let result = 0;
+for (let i = 0; i < 10; ++i) result += sumOfSquares(10000);
+result += collatzSteps(3000);
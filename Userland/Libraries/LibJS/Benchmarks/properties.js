@@ -0,0 +1,23 @@
+// Property reads and writes on plain objects and arrays.
+function makePoint(x, y) {
+    const point = {};
+    point.x = x;
+    point.y = y;
+    return point;
+}
+
+function lengthSquared(point) {
+    return point.x * point.x + point.y * point.y;
+}
+
+const points = [];
+for (let i = 0; i < 2000; ++i) points[i] = makePoint(i, i + 1);
+
+let total = 0;
+for (let round = 0; round < 20; ++round) {
+    for (let i = 0; i < points.length; ++i) {
+        const point = points[i];
+        point.x = point.x + 1;
+        total += lengthSquared(point);
+    }
+}
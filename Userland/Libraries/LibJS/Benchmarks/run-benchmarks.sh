@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+
+# Runs every benchmark with both the AST interpreter and the bytecode interpreter,
+# e.g. with the js binary from a Lagom build:
+#
+#     run-benchmarks.sh path/to/Build/Lagom/js [iterations]
+
+set -e
+
+script_path=$(cd -P -- "$(dirname -- "$0")" && pwd -P)
+
+js="${1:-js}"
+iterations="${2:-3}"
+
+# Prints the fastest wall-clock time in milliseconds of running js with the given arguments.
+run_benchmark() {
+    local best=""
+    for ((i = 0; i < iterations; ++i)); do
+        local start end elapsed
+        start=$(date +%s%N)
+        "$js" "$@" > /dev/null
+        end=$(date +%s%N)
+        elapsed=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+            best="$elapsed"
+        fi
+    done
+    echo "$best"
+}
+
+printf "%-16s %10s %10s %8s\n" "Benchmark" "AST" "Bytecode" "Speedup"
+for benchmark in "$script_path"/*.js; do
+    ast_time=$(run_benchmark "$benchmark")
+    bytecode_time=$(run_benchmark --bytecode "$benchmark")
+    speedup=$(( ast_time * 100 / (bytecode_time > 0 ? bytecode_time : 1) ))
+    printf "%-16s %8dms %8dms %4d.%02dx\n" "$(basename "$benchmark" .js)" "$ast_time" "$bytecode_time" $((speedup / 100)) $((speedup % 100))
+done
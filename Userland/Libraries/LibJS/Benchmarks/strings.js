@@ -0,0 +1,15 @@
+// String building and comparisons, similar to what spreadsheet formulas do.
+function columnName(index) {
+    let name = "";
+    do {
+        name = String.fromCharCode(65 + (index % 26)) + name;
+        index = Math.floor(index / 26) - 1;
+    } while (index >= 0);
+    return name;
+}
+
+let matches = 0;
+for (let i = 0; i < 20000; ++i) {
+    const name = columnName(i);
+    if (name.length === 2 && name < "M") ++matches;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/String.h>
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Block.h>
+#include <LibJS/Bytecode/Instruction.h>
+#include <LibJS/Bytecode/Op.h>
+
+namespace JS::Bytecode {
+
+void InstructionStreamIterator::operator++()
+{
+    ASSERT(!at_end());
+    m_offset += aligned_instruction_length(dereference().length());
+}
+
+NonnullOwnPtr<Block> Block::create()
+{
+    return adopt_own(*new Block);
+}
+
+Block::Block()
+{
+}
+
+Block::~Block()
+{
+    InstructionStreamIterator it(instruction_stream());
+    while (!it.at_end()) {
+        auto& instruction = const_cast<Instruction&>(*it);
+        ++it;
+        Instruction::destroy(instruction);
+    }
+}
+
+void Block::retain_node(NonnullRefPtr<ASTNode> node)
+{
+    m_retained_nodes.append(move(node));
+}
+
+void* Block::next_slot(size_t size)
+{
+    size_t offset = m_buffer.size();
+    m_buffer.resize(offset + aligned_instruction_length(size));
+    return m_buffer.data() + offset;
+}
+
+void Block::resolve_labels(const Vector<size_t>& label_addresses)
+{
+    InstructionStreamIterator it(instruction_stream());
+    while (!it.at_end()) {
+        auto& instruction = const_cast<Instruction&>(*it);
+        switch (instruction.type()) {
+        case Instruction::Type::Jump:
+        case Instruction::Type::JumpIfTrue:
+        case Instruction::Type::JumpIfFalse:
+        case Instruction::Type::JumpIfNotNullish: {
+            auto& jump = static_cast<Op::Jump&>(instruction);
+            jump.set_target(Label { label_addresses[jump.target().value()] });
+            break;
+        }
+        default:
+            break;
+        }
+        ++it;
+    }
+}
+
+void Block::dump() const
+{
+    outln("Block ({} registers, {} bytes):", m_register_count, m_buffer.size());
+    InstructionStreamIterator it(instruction_stream());
+    while (!it.at_end()) {
+        outln("[{:4x}] {}", it.offset(), (*it).to_string());
+        ++it;
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/NonnullRefPtrVector.h>
+#include <AK/Vector.h>
+#include <LibJS/Forward.h>
+
+namespace JS::Bytecode {
+
+// Every instruction starts on an 8-byte boundary, so instructions holding
+// pointers or Values can be accessed in place.
+constexpr size_t instruction_alignment = 8;
+
+constexpr size_t aligned_instruction_length(size_t length)
+{
+    return (length + instruction_alignment - 1) & ~(instruction_alignment - 1);
+}
+
+class InstructionStreamIterator {
+public:
+    explicit InstructionStreamIterator(ReadonlyBytes bytes)
+        : m_bytes(bytes)
+    {
+    }
+
+    size_t offset() const { return m_offset; }
+    bool at_end() const { return m_offset >= m_bytes.size(); }
+    void jump(size_t offset) { m_offset = offset; }
+
+    const Instruction& operator*() const { return dereference(); }
+    void operator++();
+
+private:
+    const Instruction& dereference() const { return *reinterpret_cast<const Instruction*>(m_bytes.data() + offset()); }
+
+    ReadonlyBytes m_bytes;
+    size_t m_offset { 0 };
+};
+
+// A straight sequence of instructions for one program or function body.
+class Block {
+public:
+    static NonnullOwnPtr<Block> create();
+    ~Block();
+
+    ReadonlyBytes instruction_stream() const { return m_buffer.span(); }
+    size_t register_count() const { return m_register_count; }
+    void set_register_count(size_t count) { m_register_count = count; }
+
+    // Nodes the generator synthesized, such as the implicit scope around
+    // a for loop's let declarations. Instructions refer to them by reference.
+    void retain_node(NonnullRefPtr<ASTNode>);
+
+    void* next_slot(size_t size);
+    void resolve_labels(const Vector<size_t>& label_addresses);
+
+    void dump() const;
+
+private:
+    Block();
+
+    Vector<u8> m_buffer;
+    size_t m_register_count { 0 };
+    NonnullRefPtrVector<ASTNode> m_retained_nodes;
+};
+
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Generator.h>
+#include <LibJS/Bytecode/Op.h>
+
+//#define BYTECODE_DEBUG
+
+namespace JS::Bytecode {
+
+Generator::Generator(Kind kind)
+    : m_kind(kind)
+    , m_block(Block::create())
+{
+}
+
+OwnPtr<Block> Generator::generate(const ScopeNode& node, Kind kind)
+{
+    Generator generator(kind);
+
+    // Register 0 always holds undefined.
+    auto undefined_register = generator.allocate_register();
+    generator.emit<Op::LoadImmediate>(undefined_register, js_undefined());
+
+    for (auto& child : node.children()) {
+        auto result = child.generate_bytecode(generator);
+        if (generator.has_failed())
+            return {};
+        // A statement's completion value is only observable at the top level of a
+        // program, where it becomes the last value (e.g. in the REPL).
+        if (kind == Kind::Program)
+            generator.emit<Op::SetLastValue>(result.value_or(undefined_register));
+    }
+
+    ASSERT(generator.m_scope_stack.is_empty());
+    ASSERT(generator.m_loops.is_empty());
+
+    auto block = move(generator.m_block);
+    block->resolve_labels(generator.m_label_addresses);
+    block->set_register_count(generator.m_next_register);
+    return block;
+}
+
+Register Generator::allocate_register()
+{
+    return Register { m_next_register++ };
+}
+
+Register Generator::load_undefined()
+{
+    return Register { 0 };
+}
+
+Label Generator::make_label()
+{
+    m_label_addresses.append(0);
+    return Label { m_label_addresses.size() - 1 };
+}
+
+void Generator::bind(Label label)
+{
+    m_label_addresses[label.value()] = m_block->instruction_stream().size();
+}
+
+void Generator::enter_scope(const ScopeNode& scope_node)
+{
+    emit<Op::EnterScope>(scope_node);
+    m_scope_stack.append(&scope_node);
+}
+
+void Generator::leave_scope(const ScopeNode& scope_node)
+{
+    ASSERT(m_scope_stack.last() == &scope_node);
+    emit<Op::LeaveScope>(scope_node);
+    m_scope_stack.take_last();
+}
+
+void Generator::leave_scopes_down_to(size_t depth)
+{
+    if (m_scope_stack.size() > depth)
+        emit<Op::LeaveScope>(*m_scope_stack[depth]);
+}
+
+void Generator::begin_loop(const FlyString& label, Label break_target, Label continue_target)
+{
+    m_loops.append({ label, break_target, continue_target, m_scope_stack.size() });
+}
+
+void Generator::end_loop()
+{
+    m_loops.take_last();
+}
+
+const Generator::LoopFrame* Generator::find_loop(const FlyString& label) const
+{
+    for (ssize_t i = m_loops.size() - 1; i >= 0; --i) {
+        if (label.is_null() || m_loops[i].label == label)
+            return &m_loops[i];
+    }
+    return nullptr;
+}
+
+bool Generator::generate_break(const FlyString& label)
+{
+    auto* loop = find_loop(label);
+    if (!loop)
+        return false;
+    leave_scopes_down_to(loop->scope_depth);
+    emit<Op::Jump>(loop->break_target);
+    return true;
+}
+
+bool Generator::generate_continue(const FlyString& label)
+{
+    auto* loop = find_loop(label);
+    if (!loop)
+        return false;
+    leave_scopes_down_to(loop->scope_depth);
+    emit<Op::Jump>(loop->continue_target);
+    return true;
+}
+
+void Generator::fail([[maybe_unused]] const ASTNode& node)
+{
+#ifdef BYTECODE_DEBUG
+    if (!m_failed)
+        dbgln("Bytecode::Generator: Can't generate bytecode for {}, falling back to the AST interpreter", node.class_name());
+#endif
+    m_failed = true;
+}
+
+}
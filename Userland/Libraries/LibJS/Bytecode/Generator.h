@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/FlyString.h>
+#include <AK/OwnPtr.h>
+#include <AK/Vector.h>
+#include <LibJS/Bytecode/Block.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Forward.h>
+
+namespace JS::Bytecode {
+
+class Generator {
+public:
+    enum class Kind {
+        Program,
+        FunctionBody,
+    };
+
+    // Generates bytecode for the statements of a program or function body.
+    // Returns nullptr if they contain a statement the generator doesn't support,
+    // in which case the caller should fall back to the AST interpreter.
+    static OwnPtr<Block> generate(const ScopeNode&, Kind);
+
+    Register allocate_register();
+
+    Label make_label();
+    void bind(Label);
+
+    template<typename OpType, typename... Args>
+    void emit(Args&&... args)
+    {
+        void* slot = m_block->next_slot(sizeof(OpType));
+        new (slot) OpType(forward<Args>(args)...);
+    }
+
+    template<typename OpType, typename... Args>
+    void emit_with_extra_register_slots(size_t extra_register_slots, Args&&... args)
+    {
+        void* slot = m_block->next_slot(sizeof(OpType) + extra_register_slots * sizeof(Register));
+        new (slot) OpType(forward<Args>(args)...);
+    }
+
+    Register load_undefined();
+
+    void retain_node(NonnullRefPtr<ASTNode> node) { m_block->retain_node(move(node)); }
+
+    Kind kind() const { return m_kind; }
+
+    void enter_scope(const ScopeNode&);
+    void leave_scope(const ScopeNode&);
+
+    void begin_loop(const FlyString& label, Label break_target, Label continue_target);
+    void end_loop();
+
+    // Emit a jump to the end of the targeted loop (or its next iteration),
+    // leaving any scopes that were entered inside of it.
+    bool generate_break(const FlyString& label);
+    bool generate_continue(const FlyString& label);
+
+    void fail(const ASTNode&);
+    bool has_failed() const { return m_failed; }
+
+private:
+    explicit Generator(Kind);
+
+    struct LoopFrame {
+        FlyString label;
+        Label break_target;
+        Label continue_target;
+        size_t scope_depth { 0 };
+    };
+
+    const LoopFrame* find_loop(const FlyString& label) const;
+    void leave_scopes_down_to(size_t depth);
+
+    Kind m_kind;
+    NonnullOwnPtr<Block> m_block;
+    u32 m_next_register { 0 };
+    Vector<size_t> m_label_addresses;
+    Vector<const ScopeNode*> m_scope_stack;
+    Vector<LoopFrame> m_loops;
+    bool m_failed { false };
+};
+
+}
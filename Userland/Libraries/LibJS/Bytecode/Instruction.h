@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Forward.h>
+#include <LibJS/Forward.h>
+
+#define ENUMERATE_BYTECODE_OPS(O) \
+    O(Load)                       \
+    O(LoadImmediate)              \
+    O(NewString)                  \
+    O(NewObject)                  \
+    O(NewArray)                   \
+    O(NewFunction)                \
+    O(GetVariable)                \
+    O(TypeofVariable)             \
+    O(SetVariable)                \
+    O(GetById)                    \
+    O(GetByValue)                 \
+    O(PutById)                    \
+    O(PutByValue)                 \
+    O(DefineProperty)             \
+    O(Add)                        \
+    O(Sub)                        \
+    O(Mul)                        \
+    O(Div)                        \
+    O(Mod)                        \
+    O(Exp)                        \
+    O(GreaterThan)                \
+    O(GreaterThanEquals)          \
+    O(LessThan)                   \
+    O(LessThanEquals)             \
+    O(AbstractEquals)             \
+    O(AbstractInequals)           \
+    O(TypedEquals)                \
+    O(TypedInequals)              \
+    O(BitwiseAnd)                 \
+    O(BitwiseOr)                  \
+    O(BitwiseXor)                 \
+    O(LeftShift)                  \
+    O(RightShift)                 \
+    O(UnsignedRightShift)         \
+    O(In)                         \
+    O(InstanceOf)                 \
+    O(BitwiseNot)                 \
+    O(Not)                        \
+    O(UnaryPlus)                  \
+    O(UnaryMinus)                 \
+    O(Typeof)                     \
+    O(ToNumeric)                  \
+    O(Increment)                  \
+    O(Decrement)                  \
+    O(Jump)                       \
+    O(JumpIfTrue)                 \
+    O(JumpIfFalse)                \
+    O(JumpIfNotNullish)           \
+    O(Call)                       \
+    O(ResolveThisBinding)         \
+    O(EnterScope)                 \
+    O(LeaveScope)                 \
+    O(SetLastValue)               \
+    O(EvaluateExpression)         \
+    O(Throw)                      \
+    O(Return)
+
+namespace JS::Bytecode {
+
+class Instruction {
+public:
+    enum class Type {
+#define __BYTECODE_OP(op) \
+    op,
+        ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+#undef __BYTECODE_OP
+    };
+
+    Type type() const { return m_type; }
+    size_t length() const;
+    String to_string() const;
+    void execute(Bytecode::Interpreter&) const;
+    static void destroy(Instruction&);
+
+protected:
+    explicit Instruction(Type type)
+        : m_type(type)
+    {
+    }
+
+private:
+    Type m_type {};
+};
+
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/Bytecode/Block.h>
+#include <LibJS/Bytecode/Instruction.h>
+#include <LibJS/Bytecode/Interpreter.h>
+#include <LibJS/Runtime/GlobalObject.h>
+
+namespace JS::Bytecode {
+
+Interpreter::Interpreter(GlobalObject& global_object, JS::Interpreter& ast_interpreter)
+    : m_vm(global_object.vm())
+    , m_global_object(global_object)
+    , m_ast_interpreter(ast_interpreter)
+    , m_registers(global_object.heap())
+{
+}
+
+Interpreter::~Interpreter()
+{
+}
+
+Value Interpreter::run(const Block& block)
+{
+    m_registers.resize(block.register_count());
+
+    InstructionStreamIterator pc(block.instruction_stream());
+    while (!pc.at_end()) {
+        auto& instruction = *pc;
+        instruction.execute(*this);
+        if (m_vm.exception())
+            return {};
+        if (m_pending_jump.has_value()) {
+            pc.jump(m_pending_jump.release_value());
+            continue;
+        }
+        if (!m_return_value.is_empty())
+            return m_return_value;
+        ++pc;
+    }
+
+    return js_undefined();
+}
+
+}
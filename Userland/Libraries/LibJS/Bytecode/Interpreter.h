@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Badge.h>
+#include <AK/Optional.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Forward.h>
+#include <LibJS/Runtime/MarkedValueList.h>
+#include <LibJS/Runtime/VM.h>
+#include <LibJS/Runtime/Value.h>
+
+namespace JS::Bytecode {
+
+// Executes one Block. Registers live in a MarkedValueList so the garbage
+// collector can see them; variables still live in the VM's scope chain, so
+// bytecode and AST-interpreted code can freely call into each other.
+class Interpreter {
+public:
+    Interpreter(GlobalObject&, JS::Interpreter& ast_interpreter);
+    ~Interpreter();
+
+    GlobalObject& global_object() { return m_global_object; }
+    VM& vm() { return m_vm; }
+    JS::Interpreter& ast_interpreter() { return m_ast_interpreter; }
+
+    // Returns the operand of the Return instruction that ended execution,
+    // undefined if execution ran off the end of the block, or an empty value
+    // if an exception was thrown.
+    Value run(const Block&);
+
+    ALWAYS_INLINE Value& reg(Register r) { return m_registers[r.index()]; }
+
+    void jump(Label label) { m_pending_jump = label.value(); }
+    void do_return(Value return_value) { m_return_value = return_value; }
+    void set_last_value(Value value) { m_vm.set_last_value(Badge<Interpreter> {}, value); }
+
+private:
+    VM& m_vm;
+    GlobalObject& m_global_object;
+    JS::Interpreter& m_ast_interpreter;
+    MarkedValueList m_registers;
+    Optional<size_t> m_pending_jump;
+    Value m_return_value;
+};
+
+}
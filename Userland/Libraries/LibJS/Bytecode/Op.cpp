@@ -0,0 +1,579 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StringBuilder.h>
+#include <LibCrypto/BigInt/SignedBigInteger.h>
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Block.h>
+#include <LibJS/Bytecode/Interpreter.h>
+#include <LibJS/Bytecode/Op.h>
+#include <LibJS/Interpreter.h>
+#include <LibJS/Runtime/Array.h>
+#include <LibJS/Runtime/BigInt.h>
+#include <LibJS/Runtime/GlobalObject.h>
+#include <LibJS/Runtime/NativeFunction.h>
+#include <LibJS/Runtime/PrimitiveString.h>
+#include <LibJS/Runtime/Reference.h>
+#include <LibJS/Runtime/ScriptFunction.h>
+
+namespace JS::Bytecode {
+
+size_t Instruction::length() const
+{
+    // These carry a trailing array of registers.
+    if (type() == Type::NewArray)
+        return static_cast<const Op::NewArray&>(*this).length();
+    if (type() == Type::Call)
+        return static_cast<const Op::Call&>(*this).length();
+
+    switch (type()) {
+#define __BYTECODE_OP(op) \
+    case Type::op:        \
+        return sizeof(Op::op);
+        ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+#undef __BYTECODE_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+String Instruction::to_string() const
+{
+    switch (type()) {
+#define __BYTECODE_OP(op) \
+    case Type::op:        \
+        return static_cast<const Op::op&>(*this).to_string();
+        ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+#undef __BYTECODE_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+void Instruction::execute(Bytecode::Interpreter& interpreter) const
+{
+    switch (type()) {
+#define __BYTECODE_OP(op) \
+    case Type::op:        \
+        return static_cast<const Op::op&>(*this).execute(interpreter);
+        ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+#undef __BYTECODE_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+void Instruction::destroy(Instruction& instruction)
+{
+    switch (instruction.type()) {
+#define __BYTECODE_OP(op)                                \
+    case Type::op:                                       \
+        static_cast<Op::op&>(instruction).~op();         \
+        return;
+        ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+#undef __BYTECODE_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+}
+
+namespace JS::Bytecode::Op {
+
+void Load::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.reg(m_src);
+}
+
+void LoadImmediate::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = m_value;
+}
+
+void NewString::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = js_string(interpreter.vm(), m_string);
+}
+
+void NewObject::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = Object::create_empty(interpreter.global_object());
+}
+
+void NewArray::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto* array = Array::create(interpreter.global_object());
+    for (size_t i = 0; i < m_element_count; ++i)
+        array->indexed_properties().append(interpreter.reg(m_elements[i]));
+    interpreter.reg(m_dst) = array;
+}
+
+void NewFunction::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto& node = m_function_node;
+    interpreter.reg(m_dst) = ScriptFunction::create(interpreter.global_object(), node.name(), node.body(), node.parameters(), node.function_length(), vm.current_scope(), node.is_strict_mode() || vm.in_strict_mode(), m_is_arrow_function);
+}
+
+void GetVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto value = vm.get_variable(m_name, interpreter.global_object());
+    if (value.is_empty()) {
+        vm.throw_exception<ReferenceError>(interpreter.global_object(), ErrorType::UnknownIdentifier, m_name);
+        return;
+    }
+    interpreter.reg(m_dst) = value;
+}
+
+void TypeofVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.vm().get_variable(m_name, interpreter.global_object()).value_or(js_undefined());
+}
+
+void SetVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto value = interpreter.reg(m_src);
+    update_function_name(value, m_name);
+    if (m_mode == Mode::Initialize) {
+        vm.set_variable(m_name, value, interpreter.global_object(), true);
+        return;
+    }
+    auto reference = vm.get_reference(m_name);
+    if (reference.is_unresolvable()) {
+        vm.throw_exception<ReferenceError>(interpreter.global_object(), ErrorType::InvalidLeftHandAssignment);
+        return;
+    }
+    reference.put(interpreter.global_object(), value);
+}
+
+void GetById::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto* object = interpreter.reg(m_base).to_object(interpreter.global_object());
+    if (!object)
+        return;
+    interpreter.reg(m_dst) = object->get_with_cache(m_property, m_cache).value_or(js_undefined());
+}
+
+void GetByValue::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& global_object = interpreter.global_object();
+    auto* object = interpreter.reg(m_base).to_object(global_object);
+    if (!object)
+        return;
+    auto property_name = PropertyName::from_value(global_object, interpreter.reg(m_property));
+    if (!property_name.is_valid())
+        return;
+    interpreter.reg(m_dst) = object->get(property_name).value_or(js_undefined());
+}
+
+static void put_property(Bytecode::Interpreter& interpreter, Value base, const PropertyName& property_name, Value value, PropertyCache* cache = nullptr)
+{
+    auto& vm = interpreter.vm();
+    auto& global_object = interpreter.global_object();
+    Reference reference { base, property_name };
+    if (reference.is_unresolvable()) {
+        vm.throw_exception<ReferenceError>(global_object, ErrorType::InvalidLeftHandAssignment);
+        return;
+    }
+    update_function_name(value, get_function_name(global_object, property_name.to_value(vm)));
+    reference.put(global_object, value, cache);
+}
+
+void PutById::execute(Bytecode::Interpreter& interpreter) const
+{
+    put_property(interpreter, interpreter.reg(m_base), m_property, interpreter.reg(m_src), &m_cache);
+}
+
+void PutByValue::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto property_name = PropertyName::from_value(interpreter.global_object(), interpreter.reg(m_property));
+    if (!property_name.is_valid())
+        return;
+    put_property(interpreter, interpreter.reg(m_base), property_name, interpreter.reg(m_src));
+}
+
+void DefineProperty::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto value = interpreter.reg(m_src);
+    update_function_name(value, m_property);
+    interpreter.reg(m_base).as_object().define_property(m_property, value);
+}
+
+static Value abstract_equals(GlobalObject& global_object, Value lhs, Value rhs)
+{
+    return Value(abstract_eq(global_object, lhs, rhs));
+}
+
+static Value abstract_inequals(GlobalObject& global_object, Value lhs, Value rhs)
+{
+    return Value(!abstract_eq(global_object, lhs, rhs));
+}
+
+static Value typed_equals(GlobalObject&, Value lhs, Value rhs)
+{
+    return Value(strict_eq(lhs, rhs));
+}
+
+static Value typed_inequals(GlobalObject&, Value lhs, Value rhs)
+{
+    return Value(!strict_eq(lhs, rhs));
+}
+
+#define JS_DEFINE_BYTECODE_BINARY_OP(OpTitleCase, op_snake_case)                                                 \
+    void OpTitleCase::execute(Bytecode::Interpreter& interpreter) const                                          \
+    {                                                                                                            \
+        interpreter.reg(m_dst) = op_snake_case(interpreter.global_object(), interpreter.reg(m_lhs), interpreter.reg(m_rhs)); \
+    }                                                                                                            \
+    String OpTitleCase::to_string() const                                                                        \
+    {                                                                                                            \
+        return String::formatted(#OpTitleCase " {}, {}, {}", m_dst, m_lhs, m_rhs);                               \
+    }
+
+JS_ENUMERATE_BYTECODE_BINARY_OPS(JS_DEFINE_BYTECODE_BINARY_OP)
+#undef JS_DEFINE_BYTECODE_BINARY_OP
+
+static Value not_(GlobalObject&, Value value)
+{
+    return Value(!value.to_boolean());
+}
+
+static Value typeof_(GlobalObject& global_object, Value value)
+{
+    auto& vm = global_object.vm();
+    switch (value.type()) {
+    case Value::Type::Undefined:
+        return js_string(vm, "undefined");
+    case Value::Type::Null:
+        return js_string(vm, "object");
+    case Value::Type::Number:
+        return js_string(vm, "number");
+    case Value::Type::String:
+        return js_string(vm, "string");
+    case Value::Type::Object:
+        if (value.is_function())
+            return js_string(vm, "function");
+        return js_string(vm, "object");
+    case Value::Type::Boolean:
+        return js_string(vm, "boolean");
+    case Value::Type::Symbol:
+        return js_string(vm, "symbol");
+    case Value::Type::BigInt:
+        return js_string(vm, "bigint");
+    default:
+        ASSERT_NOT_REACHED();
+    }
+}
+
+static Value to_numeric(GlobalObject& global_object, Value value)
+{
+    return value.to_numeric(global_object);
+}
+
+// The operand of Increment and Decrement has already been through ToNumeric.
+static Value increment(GlobalObject& global_object, Value value)
+{
+    if (value.is_number())
+        return Value(value.as_double() + 1);
+    return js_bigint(global_object.heap(), value.as_bigint().big_integer().plus(Crypto::SignedBigInteger { 1 }));
+}
+
+static Value decrement(GlobalObject& global_object, Value value)
+{
+    if (value.is_number())
+        return Value(value.as_double() - 1);
+    return js_bigint(global_object.heap(), value.as_bigint().big_integer().minus(Crypto::SignedBigInteger { 1 }));
+}
+
+#define JS_DEFINE_BYTECODE_UNARY_OP(OpTitleCase, op_snake_case)                                         \
+    void OpTitleCase::execute(Bytecode::Interpreter& interpreter) const                                 \
+    {                                                                                                   \
+        auto result = op_snake_case(interpreter.global_object(), interpreter.reg(m_src));               \
+        if (!interpreter.vm().exception())                                                              \
+            interpreter.reg(m_dst) = result;                                                            \
+    }                                                                                                   \
+    String OpTitleCase::to_string() const                                                               \
+    {                                                                                                   \
+        return String::formatted(#OpTitleCase " {}, {}", m_dst, m_src);                                 \
+    }
+
+JS_ENUMERATE_BYTECODE_UNARY_OPS(JS_DEFINE_BYTECODE_UNARY_OP)
+#undef JS_DEFINE_BYTECODE_UNARY_OP
+
+void Jump::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.jump(m_target);
+}
+
+void JumpIfTrue::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (interpreter.reg(m_condition).to_boolean())
+        interpreter.jump(m_target);
+}
+
+void JumpIfFalse::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (!interpreter.reg(m_condition).to_boolean())
+        interpreter.jump(m_target);
+}
+
+void JumpIfNotNullish::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (!interpreter.reg(m_condition).is_nullish())
+        interpreter.jump(m_target);
+}
+
+void Call::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto& global_object = interpreter.global_object();
+    auto callee = interpreter.reg(m_callee);
+
+    if (!callee.is_function()
+        || (m_kind == Kind::Construct && is<NativeFunction>(callee.as_object()) && !static_cast<NativeFunction&>(callee.as_object()).has_constructor())) {
+        auto call_type = m_kind == Kind::Construct ? "constructor" : "function";
+        if (is<Identifier>(m_callee_node) || is<MemberExpression>(m_callee_node)) {
+            String expression_string;
+            if (is<Identifier>(m_callee_node))
+                expression_string = static_cast<const Identifier&>(m_callee_node).string();
+            else
+                expression_string = static_cast<const MemberExpression&>(m_callee_node).to_string_approximation();
+            vm.throw_exception<TypeError>(global_object, ErrorType::IsNotAEvaluatedFrom, callee.to_string_without_side_effects(), call_type, expression_string);
+        } else {
+            vm.throw_exception<TypeError>(global_object, ErrorType::IsNotA, callee.to_string_without_side_effects(), call_type);
+        }
+        return;
+    }
+
+    auto& function = callee.as_function();
+
+    MarkedValueList arguments(vm.heap());
+    arguments.ensure_capacity(m_argument_count);
+    for (size_t i = 0; i < m_argument_count; ++i)
+        arguments.append(interpreter.reg(m_arguments[i]));
+
+    Value result;
+    if (m_kind == Kind::Construct) {
+        result = vm.construct(function, function, move(arguments), global_object);
+    } else {
+        // Like the AST interpreter, a method's |this| is the base object converted with ToObject,
+        // and plain function calls get the global object.
+        Value this_value = &global_object;
+        auto this_register_value = interpreter.reg(m_this_value);
+        if (!this_register_value.is_undefined()) {
+            this_value = this_register_value.to_object(global_object);
+            if (vm.exception())
+                return;
+        }
+        result = vm.call(function, this_value, move(arguments));
+    }
+
+    if (vm.exception())
+        return;
+    interpreter.reg(m_dst) = result;
+}
+
+void ResolveThisBinding::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.vm().resolve_this_binding(interpreter.global_object());
+}
+
+void EnterScope::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.ast_interpreter().enter_scope(m_scope_node, ScopeType::Block, interpreter.global_object());
+}
+
+void LeaveScope::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.ast_interpreter().exit_scope(m_scope_node);
+}
+
+void SetLastValue::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.set_last_value(interpreter.reg(m_src));
+}
+
+void EvaluateExpression::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto result = m_expression.execute(interpreter.ast_interpreter(), interpreter.global_object());
+    if (!interpreter.vm().exception())
+        interpreter.reg(m_dst) = result;
+}
+
+void Throw::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.vm().throw_exception(interpreter.global_object(), interpreter.reg(m_src));
+}
+
+void Return::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.do_return(interpreter.reg(m_src).value_or(js_undefined()));
+}
+
+String Load::to_string() const
+{
+    return String::formatted("Load {}, {}", m_dst, m_src);
+}
+
+String LoadImmediate::to_string() const
+{
+    return String::formatted("LoadImmediate {}, {}", m_dst, m_value.to_string_without_side_effects());
+}
+
+String NewString::to_string() const
+{
+    return String::formatted("NewString {}, \"{}\"", m_dst, m_string);
+}
+
+String NewObject::to_string() const
+{
+    return String::formatted("NewObject {}", m_dst);
+}
+
+String NewArray::to_string() const
+{
+    StringBuilder builder;
+    builder.appendff("NewArray {}", m_dst);
+    if (m_element_count) {
+        builder.append(", [");
+        for (size_t i = 0; i < m_element_count; ++i) {
+            if (i != 0)
+                builder.append(", ");
+            builder.appendff("{}", m_elements[i]);
+        }
+        builder.append(']');
+    }
+    return builder.to_string();
+}
+
+String NewFunction::to_string() const
+{
+    return String::formatted("NewFunction {}, \"{}\"", m_dst, m_function_node.name());
+}
+
+String GetVariable::to_string() const
+{
+    return String::formatted("GetVariable {}, {}", m_dst, m_name);
+}
+
+String TypeofVariable::to_string() const
+{
+    return String::formatted("TypeofVariable {}, {}", m_dst, m_name);
+}
+
+String SetVariable::to_string() const
+{
+    return String::formatted("SetVariable{} {}, {}", m_mode == Mode::Initialize ? " (initialize)" : "", m_name, m_src);
+}
+
+String GetById::to_string() const
+{
+    return String::formatted("GetById {}, {}, {}", m_dst, m_base, m_property);
+}
+
+String GetByValue::to_string() const
+{
+    return String::formatted("GetByValue {}, {}, {}", m_dst, m_base, m_property);
+}
+
+String PutById::to_string() const
+{
+    return String::formatted("PutById {}, {}, {}", m_base, m_property, m_src);
+}
+
+String PutByValue::to_string() const
+{
+    return String::formatted("PutByValue {}, {}, {}", m_base, m_property, m_src);
+}
+
+String DefineProperty::to_string() const
+{
+    return String::formatted("DefineProperty {}, {}, {}", m_base, m_property, m_src);
+}
+
+String Jump::to_string() const
+{
+    return String::formatted("Jump {}", m_target);
+}
+
+String JumpIfTrue::to_string() const
+{
+    return String::formatted("JumpIfTrue {}, {}", m_condition, m_target);
+}
+
+String JumpIfFalse::to_string() const
+{
+    return String::formatted("JumpIfFalse {}, {}", m_condition, m_target);
+}
+
+String JumpIfNotNullish::to_string() const
+{
+    return String::formatted("JumpIfNotNullish {}, {}", m_condition, m_target);
+}
+
+String Call::to_string() const
+{
+    StringBuilder builder;
+    builder.appendff("{} {}, {}, {}", m_kind == Kind::Construct ? "Construct" : "Call", m_dst, m_callee, m_this_value);
+    for (size_t i = 0; i < m_argument_count; ++i)
+        builder.appendff(", {}", m_arguments[i]);
+    return builder.to_string();
+}
+
+String ResolveThisBinding::to_string() const
+{
+    return String::formatted("ResolveThisBinding {}", m_dst);
+}
+
+String EnterScope::to_string() const
+{
+    return String::formatted("EnterScope {}", &m_scope_node);
+}
+
+String LeaveScope::to_string() const
+{
+    return String::formatted("LeaveScope {}", &m_scope_node);
+}
+
+String SetLastValue::to_string() const
+{
+    return String::formatted("SetLastValue {}", m_src);
+}
+
+String EvaluateExpression::to_string() const
+{
+    return String::formatted("EvaluateExpression {}, {}", m_dst, m_expression.class_name());
+}
+
+String Throw::to_string() const
+{
+    return String::formatted("Throw {}", m_src);
+}
+
+String Return::to_string() const
+{
+    return String::formatted("Return {}", m_src);
+}
+
+}
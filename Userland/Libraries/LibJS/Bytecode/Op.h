@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/FlyString.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibJS/Bytecode/Instruction.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Forward.h>
+#include <LibJS/Runtime/PropertyCache.h>
+#include <LibJS/Runtime/Value.h>
+
+namespace JS {
+class FunctionExpression;
+}
+
+namespace JS::Bytecode::Op {
+
+class Load final : public Instruction {
+public:
+    Load(Register dst, Register src)
+        : Instruction(Type::Load)
+        , m_dst(dst)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    Register m_src;
+};
+
+class LoadImmediate final : public Instruction {
+public:
+    LoadImmediate(Register dst, Value value)
+        : Instruction(Type::LoadImmediate)
+        , m_dst(dst)
+        , m_value(value)
+    {
+        // Instructions are not visited by the garbage collector.
+        ASSERT(!value.is_cell());
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    Value m_value;
+};
+
+class NewString final : public Instruction {
+public:
+    NewString(Register dst, String string)
+        : Instruction(Type::NewString)
+        , m_dst(dst)
+        , m_string(move(string))
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    String m_string;
+};
+
+class NewObject final : public Instruction {
+public:
+    explicit NewObject(Register dst)
+        : Instruction(Type::NewObject)
+        , m_dst(dst)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+};
+
+class NewArray final : public Instruction {
+public:
+    NewArray(Register dst, const Vector<Register>& elements)
+        : Instruction(Type::NewArray)
+        , m_dst(dst)
+        , m_element_count(elements.size())
+    {
+        for (size_t i = 0; i < m_element_count; ++i)
+            new (&m_elements[i]) Register(elements[i]);
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+    size_t length() const { return sizeof(*this) + sizeof(Register) * m_element_count; }
+
+private:
+    Register m_dst;
+    size_t m_element_count { 0 };
+    Register m_elements[];
+};
+
+class NewFunction final : public Instruction {
+public:
+    NewFunction(Register dst, const FunctionExpression& function_node, bool is_arrow_function)
+        : Instruction(Type::NewFunction)
+        , m_dst(dst)
+        , m_function_node(function_node)
+        , m_is_arrow_function(is_arrow_function)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    const FunctionExpression& m_function_node;
+    bool m_is_arrow_function { false };
+};
+
+class GetVariable final : public Instruction {
+public:
+    GetVariable(Register dst, FlyString name)
+        : Instruction(Type::GetVariable)
+        , m_dst(dst)
+        , m_name(move(name))
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    FlyString m_name;
+};
+
+// Like GetVariable, but evaluates to undefined instead of throwing for unknown names.
+class TypeofVariable final : public Instruction {
+public:
+    TypeofVariable(Register dst, FlyString name)
+        : Instruction(Type::TypeofVariable)
+        , m_dst(dst)
+        , m_name(move(name))
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    FlyString m_name;
+};
+
+class SetVariable final : public Instruction {
+public:
+    enum class Mode {
+        Assign,
+        Initialize,
+    };
+
+    SetVariable(FlyString name, Register src, Mode mode)
+        : Instruction(Type::SetVariable)
+        , m_name(move(name))
+        , m_src(src)
+        , m_mode(mode)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    FlyString m_name;
+    Register m_src;
+    Mode m_mode;
+};
+
+class GetById final : public Instruction {
+public:
+    GetById(Register dst, Register base, FlyString property)
+        : Instruction(Type::GetById)
+        , m_dst(dst)
+        , m_base(base)
+        , m_property(move(property))
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    Register m_base;
+    FlyString m_property;
+    mutable PropertyCache m_cache;
+};
+
+class GetByValue final : public Instruction {
+public:
+    GetByValue(Register dst, Register base, Register property)
+        : Instruction(Type::GetByValue)
+        , m_dst(dst)
+        , m_base(base)
+        , m_property(property)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    Register m_base;
+    Register m_property;
+};
+
+class PutById final : public Instruction {
+public:
+    PutById(Register base, FlyString property, Register src)
+        : Instruction(Type::PutById)
+        , m_base(base)
+        , m_property(move(property))
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_base;
+    FlyString m_property;
+    Register m_src;
+    mutable PropertyCache m_cache;
+};
+
+class PutByValue final : public Instruction {
+public:
+    PutByValue(Register base, Register property, Register src)
+        : Instruction(Type::PutByValue)
+        , m_base(base)
+        , m_property(property)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_base;
+    Register m_property;
+    Register m_src;
+};
+
+// Defines an own data property without looking at the prototype chain, as object literals do.
+class DefineProperty final : public Instruction {
+public:
+    DefineProperty(Register base, FlyString property, Register src)
+        : Instruction(Type::DefineProperty)
+        , m_base(base)
+        , m_property(move(property))
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_base;
+    FlyString m_property;
+    Register m_src;
+};
+
+#define JS_ENUMERATE_BYTECODE_BINARY_OPS(O)            \
+    O(Add, add)                                        \
+    O(Sub, sub)                                        \
+    O(Mul, mul)                                        \
+    O(Div, div)                                        \
+    O(Mod, mod)                                        \
+    O(Exp, exp)                                        \
+    O(GreaterThan, greater_than)                       \
+    O(GreaterThanEquals, greater_than_equals)          \
+    O(LessThan, less_than)                             \
+    O(LessThanEquals, less_than_equals)                \
+    O(AbstractEquals, abstract_equals)                 \
+    O(AbstractInequals, abstract_inequals)             \
+    O(TypedEquals, typed_equals)                       \
+    O(TypedInequals, typed_inequals)                   \
+    O(BitwiseAnd, bitwise_and)                         \
+    O(BitwiseOr, bitwise_or)                           \
+    O(BitwiseXor, bitwise_xor)                         \
+    O(LeftShift, left_shift)                           \
+    O(RightShift, right_shift)                         \
+    O(UnsignedRightShift, unsigned_right_shift)        \
+    O(In, in)                                          \
+    O(InstanceOf, instance_of)
+
+#define JS_DECLARE_BYTECODE_BINARY_OP(OpTitleCase, op_snake_case) \
+    class OpTitleCase final : public Instruction {                \
+    public:                                                       \
+        OpTitleCase(Register dst, Register lhs, Register rhs)     \
+            : Instruction(Type::OpTitleCase)                      \
+            , m_dst(dst)                                          \
+            , m_lhs(lhs)                                          \
+            , m_rhs(rhs)                                          \
+        {                                                         \
+        }                                                         \
+                                                                  \
+        void execute(Bytecode::Interpreter&) const;               \
+        String to_string() const;                                 \
+                                                                  \
+    private:                                                      \
+        Register m_dst;                                           \
+        Register m_lhs;                                           \
+        Register m_rhs;                                           \
+    };
+
+JS_ENUMERATE_BYTECODE_BINARY_OPS(JS_DECLARE_BYTECODE_BINARY_OP)
+#undef JS_DECLARE_BYTECODE_BINARY_OP
+
+#define JS_ENUMERATE_BYTECODE_UNARY_OPS(O) \
+    O(BitwiseNot, bitwise_not)             \
+    O(Not, not_)                           \
+    O(UnaryPlus, unary_plus)               \
+    O(UnaryMinus, unary_minus)             \
+    O(Typeof, typeof_)                     \
+    O(ToNumeric, to_numeric)               \
+    O(Increment, increment)                \
+    O(Decrement, decrement)
+
+#define JS_DECLARE_BYTECODE_UNARY_OP(OpTitleCase, op_snake_case) \
+    class OpTitleCase final : public Instruction {               \
+    public:                                                      \
+        OpTitleCase(Register dst, Register src)                  \
+            : Instruction(Type::OpTitleCase)                     \
+            , m_dst(dst)                                         \
+            , m_src(src)                                         \
+        {                                                        \
+        }                                                        \
+                                                                 \
+        void execute(Bytecode::Interpreter&) const;              \
+        String to_string() const;                                \
+                                                                 \
+    private:                                                     \
+        Register m_dst;                                          \
+        Register m_src;                                          \
+    };
+
+JS_ENUMERATE_BYTECODE_UNARY_OPS(JS_DECLARE_BYTECODE_UNARY_OP)
+#undef JS_DECLARE_BYTECODE_UNARY_OP
+
+class Jump : public Instruction {
+public:
+    explicit Jump(Label target)
+        : Instruction(Type::Jump)
+        , m_target(target)
+    {
+    }
+
+    void set_target(Label target) { m_target = target; }
+    Label target() const { return m_target; }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+protected:
+    Jump(Type type, Label target)
+        : Instruction(type)
+        , m_target(target)
+    {
+    }
+
+    Label m_target;
+};
+
+class JumpIfTrue final : public Jump {
+public:
+    JumpIfTrue(Register condition, Label target)
+        : Jump(Type::JumpIfTrue, target)
+        , m_condition(condition)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_condition;
+};
+
+class JumpIfFalse final : public Jump {
+public:
+    JumpIfFalse(Register condition, Label target)
+        : Jump(Type::JumpIfFalse, target)
+        , m_condition(condition)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_condition;
+};
+
+class JumpIfNotNullish final : public Jump {
+public:
+    JumpIfNotNullish(Register condition, Label target)
+        : Jump(Type::JumpIfNotNullish, target)
+        , m_condition(condition)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_condition;
+};
+
+class Call final : public Instruction {
+public:
+    enum class Kind {
+        Call,
+        Construct,
+    };
+
+    // The callee expression is only used to describe the callee in error messages.
+    Call(Kind kind, Register dst, Register callee, Register this_value, const Expression& callee_node, const Vector<Register>& arguments)
+        : Instruction(Type::Call)
+        , m_kind(kind)
+        , m_dst(dst)
+        , m_callee(callee)
+        , m_this_value(this_value)
+        , m_callee_node(callee_node)
+        , m_argument_count(arguments.size())
+    {
+        for (size_t i = 0; i < m_argument_count; ++i)
+            new (&m_arguments[i]) Register(arguments[i]);
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+    size_t length() const { return sizeof(*this) + sizeof(Register) * m_argument_count; }
+
+private:
+    Kind m_kind;
+    Register m_dst;
+    Register m_callee;
+    Register m_this_value;
+    const Expression& m_callee_node;
+    size_t m_argument_count { 0 };
+    Register m_arguments[];
+};
+
+class ResolveThisBinding final : public Instruction {
+public:
+    explicit ResolveThisBinding(Register dst)
+        : Instruction(Type::ResolveThisBinding)
+        , m_dst(dst)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+};
+
+class EnterScope final : public Instruction {
+public:
+    explicit EnterScope(const ScopeNode& scope_node)
+        : Instruction(Type::EnterScope)
+        , m_scope_node(scope_node)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    const ScopeNode& m_scope_node;
+};
+
+// Leaves the given scope and any scope that was entered after it.
+class LeaveScope final : public Instruction {
+public:
+    explicit LeaveScope(const ScopeNode& scope_node)
+        : Instruction(Type::LeaveScope)
+        , m_scope_node(scope_node)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    const ScopeNode& m_scope_node;
+};
+
+class SetLastValue final : public Instruction {
+public:
+    explicit SetLastValue(Register src)
+        : Instruction(Type::SetLastValue)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_src;
+};
+
+// Evaluates an expression the generator doesn't know about with the AST interpreter.
+class EvaluateExpression final : public Instruction {
+public:
+    EvaluateExpression(Register dst, const Expression& expression)
+        : Instruction(Type::EvaluateExpression)
+        , m_dst(dst)
+        , m_expression(expression)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_dst;
+    const Expression& m_expression;
+};
+
+class Throw final : public Instruction {
+public:
+    explicit Throw(Register src)
+        : Instruction(Type::Throw)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_src;
+};
+
+class Return final : public Instruction {
+public:
+    explicit Return(Register src)
+        : Instruction(Type::Return)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string() const;
+
+private:
+    Register m_src;
+};
+
+}
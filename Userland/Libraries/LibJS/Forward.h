@@ -139,6 +139,7 @@ class MarkedValueList;
 class NativeFunction;
 class NativeProperty;
 class PrimitiveString;
+class PropertyCache;
 class Reference;
 class ScopeNode;
 class ScopeObject;
@@ -170,4 +171,12 @@ JS_ENUMERATE_TYPED_ARRAYS
 template<class T>
 class Handle;
 
+namespace Bytecode {
+class Block;
+class Generator;
+class Instruction;
+class Interpreter;
+class Register;
+}
+
 }
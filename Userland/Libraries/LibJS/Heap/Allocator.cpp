@@ -26,6 +26,7 @@
 
 #include <AK/Badge.h>
 #include <LibJS/Heap/Allocator.h>
+#include <LibJS/Heap/Heap.h>
 #include <LibJS/Heap/HeapBlock.h>
 
 namespace JS {
@@ -43,6 +44,7 @@ Cell* Allocator::allocate_cell(Heap& heap)
 {
     if (m_usable_blocks.is_empty()) {
         auto block = HeapBlock::create_with_cell_size(heap, m_cell_size);
+        heap.did_create_heap_block({}, *block);
         m_usable_blocks.append(*block.leak_ptr());
     }
 
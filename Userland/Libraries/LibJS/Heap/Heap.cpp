@@ -25,6 +25,7 @@
  */
 
 #include <AK/Badge.h>
+#include <AK/HashMap.h>
 #include <AK/HashTable.h>
 #include <AK/StackInfo.h>
 #include <AK/TemporaryChange.h>
@@ -36,9 +37,13 @@
 #include <LibJS/Interpreter.h>
 #include <LibJS/Runtime/Object.h>
 #include <setjmp.h>
+#include <time.h>
 
 //#define HEAP_DEBUG
 
+// Checks after every collection that all reachable cells were marked.
+//#define HEAP_VERIFY_DEBUG
+
 namespace JS {
 
 Heap::Heap(VM& vm)
@@ -59,6 +64,24 @@ Heap::~Heap()
     collect_garbage(CollectionType::CollectEverything);
 }
 
+static u64 monotonic_time_in_microseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void Heap::PauseTimeHistogram::add_pause(u64 microseconds)
+{
+    ++pause_count;
+    total_microseconds += microseconds;
+    longest_microseconds = max(longest_microseconds, microseconds);
+    size_t bucket = 0;
+    while (bucket < bucket_count - 1 && microseconds >= bucket_limits_in_microseconds[bucket])
+        ++bucket;
+    ++buckets[bucket];
+}
+
 ALWAYS_INLINE Allocator& Heap::allocator_for_size(size_t cell_size)
 {
     for (auto& allocator : m_allocators) {
@@ -71,16 +94,38 @@ ALWAYS_INLINE Allocator& Heap::allocator_for_size(size_t cell_size)
 Cell* Heap::allocate_cell(size_t size)
 {
     if (should_collect_on_every_allocation()) {
-        collect_garbage();
+        if (m_incremental_marking_in_progress)
+            perform_incremental_marking_step(0);
+        else
+            collect_young_generation();
     } else if (m_allocations_since_last_gc > m_max_allocations_between_gc) {
         m_allocations_since_last_gc = 0;
-        collect_garbage();
+        if (m_incremental_marking_in_progress)
+            perform_incremental_marking_step(1);
+        else
+            collect_young_generation();
     } else {
         ++m_allocations_since_last_gc;
     }
 
     auto& allocator = allocator_for_size(size);
-    return allocator.allocate_cell(*this);
+    auto* cell = allocator.allocate_cell(*this);
+    m_young_cells.append(cell);
+    return cell;
+}
+
+void Heap::did_construct_cell(Cell& cell, bool has_write_barriers)
+{
+    // If we collected garbage while the cell was being constructed, it may already have been promoted
+    // and put on the list of cells without write barriers. That's fine, just a bit wasteful.
+    cell.set_has_write_barriers({}, has_write_barriers);
+
+    if (m_incremental_marking_in_progress && !cell.is_marked()) {
+        // Cells allocated during marking survive this collection, but we still have to trace
+        // whatever their constructor stored in them.
+        cell.set_marked(true);
+        m_mark_stack.append(&cell);
+    }
 }
 
 void Heap::collect_garbage(CollectionType collection_type, bool print_report)
@@ -90,16 +135,123 @@ void Heap::collect_garbage(CollectionType collection_type, bool print_report)
 
     Core::ElapsedTimer collection_measurement_timer;
     collection_measurement_timer.start();
+    auto start_time = monotonic_time_in_microseconds();
     if (collection_type == CollectionType::CollectGarbage) {
         if (m_gc_deferrals) {
             m_should_gc_when_deferral_ends = true;
             return;
         }
         HashTable<Cell*> roots;
-        gather_roots(roots);
-        mark_live_cells(roots);
+        if (m_incremental_marking_in_progress) {
+            finish_marking(roots);
+        } else {
+            mark_roots(MarkingMode::Full, roots);
+            process_mark_stack(MarkingMode::Full);
+        }
+#ifdef HEAP_VERIFY_DEBUG
+        verify_marking(MarkingMode::Full, roots);
+#endif
+    } else if (m_incremental_marking_in_progress) {
+        // Everything is about to go away, so forget what we've marked so far.
+        m_incremental_marking_in_progress = false;
+        m_mark_stack.clear();
+        for_each_block([&](auto& block) {
+            block.for_each_cell([&](Cell* cell) {
+                cell->set_marked(false);
+            });
+            return IterationDecision::Continue;
+        });
     }
     sweep_dead_cells(print_report, collection_measurement_timer);
+    if (collection_type == CollectionType::CollectGarbage)
+        m_statistics.full_collections.add_pause(monotonic_time_in_microseconds() - start_time);
+}
+
+void Heap::collect_young_generation()
+{
+    if (m_gc_deferrals || m_incremental_marking_in_progress)
+        return;
+
+    {
+        ASSERT(!m_collecting_garbage);
+        TemporaryChange change(m_collecting_garbage, true);
+
+        auto start_time = monotonic_time_in_microseconds();
+        HashTable<Cell*> roots;
+        mark_roots(MarkingMode::YoungGeneration, roots);
+        process_mark_stack(MarkingMode::YoungGeneration);
+#ifdef HEAP_VERIFY_DEBUG
+        verify_marking(MarkingMode::YoungGeneration, roots);
+#endif
+        sweep_young_generation();
+        m_statistics.young_generation_collections.add_pause(monotonic_time_in_microseconds() - start_time);
+    }
+
+    maybe_start_incremental_marking();
+}
+
+void Heap::maybe_start_incremental_marking()
+{
+    auto threshold = max(minimum_old_cell_count_for_full_collection, m_old_cell_count_after_last_full_collection * 2);
+    if (m_old_cell_count >= threshold)
+        start_incremental_marking();
+}
+
+void Heap::start_incremental_marking()
+{
+    if (m_incremental_marking_in_progress || m_gc_deferrals)
+        return;
+
+    ASSERT(!m_collecting_garbage);
+    TemporaryChange change(m_collecting_garbage, true);
+
+    auto start_time = monotonic_time_in_microseconds();
+    // Every cell that survives this collection is promoted, so we won't need to know which old cells
+    // point to young ones. From now on, the remembered set holds cells written to during marking.
+    forget_remembered_cells();
+    m_incremental_marking_in_progress = true;
+    m_incremental_marking_steps = 0;
+    HashTable<Cell*> roots;
+    mark_roots(MarkingMode::Full, roots);
+    m_statistics.incremental_marking_steps.add_pause(monotonic_time_in_microseconds() - start_time);
+
+    if (on_incremental_marking_start)
+        on_incremental_marking_start();
+}
+
+void Heap::perform_incremental_marking_step(int time_budget_in_ms)
+{
+    if (!m_incremental_marking_in_progress || m_gc_deferrals)
+        return;
+
+    bool done;
+    {
+        ASSERT(!m_collecting_garbage);
+        TemporaryChange change(m_collecting_garbage, true);
+
+        auto start_time = monotonic_time_in_microseconds();
+        // The mutator may have stored pointers to unmarked cells in cells we've already traced.
+        for (auto* cell : m_remembered_cells) {
+            cell->set_remembered({}, false);
+            if (cell->is_marked())
+                m_mark_stack.append(cell);
+        }
+        m_remembered_cells.clear();
+
+        done = process_mark_stack(MarkingMode::Full, start_time + time_budget_in_ms * 1000);
+        m_statistics.incremental_marking_steps.add_pause(monotonic_time_in_microseconds() - start_time);
+    }
+
+    // Don't let a mutator that keeps creating work drag marking out forever.
+    if (done || ++m_incremental_marking_steps >= max_incremental_marking_steps)
+        collect_garbage();
+}
+
+void Heap::forget_remembered_cells()
+{
+    for (auto* cell : m_remembered_cells)
+        cell->set_remembered({}, false);
+    m_remembered_cells.clear();
 }
 
 void Heap::gather_roots(HashTable<Cell*>& roots)
@@ -150,12 +302,6 @@ __attribute__((no_sanitize("address"))) void Heap::gather_conservative_roots(Has
         possible_pointers.set(data);
     }
 
-    HashTable<HeapBlock*> all_live_heap_blocks;
-    for_each_block([&](auto& block) {
-        all_live_heap_blocks.set(&block);
-        return IterationDecision::Continue;
-    });
-
     for (auto possible_pointer : possible_pointers) {
         if (!possible_pointer)
             continue;
@@ -163,7 +309,7 @@ __attribute__((no_sanitize("address"))) void Heap::gather_conservative_roots(Has
         dbgln("  ? {}", (const void*)possible_pointer);
 #endif
         auto* possible_heap_block = HeapBlock::from_cell(reinterpret_cast<const Cell*>(possible_pointer));
-        if (all_live_heap_blocks.contains(possible_heap_block)) {
+        if (m_blocks.contains(possible_heap_block)) {
             if (auto* cell = possible_heap_block->cell_from_possible_pointer(possible_pointer)) {
                 if (cell->is_live()) {
 #ifdef HEAP_DEBUG
@@ -182,28 +328,165 @@ __attribute__((no_sanitize("address"))) void Heap::gather_conservative_roots(Has
 
 class MarkingVisitor final : public Cell::Visitor {
 public:
-    MarkingVisitor() { }
+    MarkingVisitor(Vector<Cell*>& mark_stack, bool young_generation_only)
+        : m_mark_stack(mark_stack)
+        , m_young_generation_only(young_generation_only)
+    {
+    }
 
-    virtual void visit_impl(Cell* cell)
+    virtual void visit_impl(Cell* cell) override
     {
         if (cell->is_marked())
             return;
+        // Old cells are assumed to be live when only collecting the young generation.
+        if (m_young_generation_only && !cell->is_young())
+            return;
 #ifdef HEAP_DEBUG
         dbgln("  ! {}", cell);
 #endif
         cell->set_marked(true);
-        cell->visit_edges(*this);
+        m_mark_stack.append(cell);
     }
+
+private:
+    Vector<Cell*>& m_mark_stack;
+    bool m_young_generation_only { false };
 };
 
-void Heap::mark_live_cells(const HashTable<Cell*>& roots)
+void Heap::mark_roots(MarkingMode mode, HashTable<Cell*>& roots)
 {
 #ifdef HEAP_DEBUG
-    dbgln("mark_live_cells:");
+    dbgln("mark_roots:");
 #endif
-    MarkingVisitor visitor;
+    gather_roots(roots);
+
+    MarkingVisitor visitor(m_mark_stack, mode == MarkingMode::YoungGeneration);
     for (auto* root : roots)
         visitor.visit(root);
+
+    if (mode == MarkingMode::YoungGeneration) {
+        // Old cells aren't traced, so anything they point to has to be treated as a root.
+        for (auto* cell : m_old_cells_without_write_barriers)
+            cell->visit_edges(visitor);
+        for (auto* cell : m_remembered_cells)
+            cell->visit_edges(visitor);
+    }
+}
+
+bool Heap::process_mark_stack(MarkingMode mode, u64 deadline_in_microseconds)
+{
+    MarkingVisitor visitor(m_mark_stack, mode == MarkingMode::YoungGeneration);
+    size_t cells_until_deadline_check = 256;
+    while (!m_mark_stack.is_empty()) {
+        if (deadline_in_microseconds && --cells_until_deadline_check == 0) {
+            if (monotonic_time_in_microseconds() >= deadline_in_microseconds)
+                return false;
+            cells_until_deadline_check = 256;
+        }
+        m_mark_stack.take_last()->visit_edges(visitor);
+    }
+    return true;
+}
+
+void Heap::finish_marking(HashTable<Cell*>& roots)
+{
+    ASSERT(m_incremental_marking_in_progress);
+
+    // Roots and cells without write barriers may have changed in ways we haven't seen
+    // since marking started, so trace them again. The remembered cells are handled below.
+    mark_roots(MarkingMode::Full, roots);
+
+    MarkingVisitor visitor(m_mark_stack, false);
+    for (auto* cell : m_old_cells_without_write_barriers) {
+        if (cell->is_marked())
+            cell->visit_edges(visitor);
+    }
+    for (auto* cell : m_young_cells) {
+        if (!cell->has_write_barriers() && cell->is_marked())
+            cell->visit_edges(visitor);
+    }
+    for (auto* cell : m_remembered_cells) {
+        if (cell->is_marked())
+            cell->visit_edges(visitor);
+    }
+    forget_remembered_cells();
+
+    process_mark_stack(MarkingMode::Full);
+    m_incremental_marking_in_progress = false;
+}
+
+#ifdef HEAP_VERIFY_DEBUG
+void Heap::verify_marking(MarkingMode mode, const HashTable<Cell*>& roots)
+{
+    class VerifyingVisitor final : public Cell::Visitor {
+    public:
+        virtual void visit_impl(Cell* cell) override
+        {
+            if (!visited.contains(cell)) {
+                visited.set(cell);
+                parent.set(cell, current);
+                stack.append(cell);
+            }
+        }
+
+        HashTable<Cell*> visited;
+        HashMap<Cell*, Cell*> parent;
+        Cell* current { nullptr };
+        Vector<Cell*> stack;
+    };
+
+    VerifyingVisitor visitor;
+    for (auto* root : roots)
+        visitor.visit(root);
+    while (!visitor.stack.is_empty()) {
+        auto* cell = visitor.stack.take_last();
+        if (mode == MarkingMode::Full || cell->is_young()) {
+            if (!cell->is_marked()) {
+                dbgln("Reachable cell {} wasn't marked", cell);
+                for (auto* c = cell; c; c = visitor.parent.get(c).value_or(nullptr))
+                    dbgln("  <- {} young={} remembered={} barriers={} marked={}", c, c->is_young(), c->is_remembered(), c->has_write_barriers(), c->is_marked());
+                ASSERT_NOT_REACHED();
+            }
+        }
+        visitor.current = cell;
+        cell->visit_edges(visitor);
+    }
+}
+#endif
+
+void Heap::sweep_young_generation()
+{
+#ifdef HEAP_DEBUG
+    dbgln("sweep_young_generation:");
+#endif
+    HashTable<HeapBlock*> full_blocks_that_became_usable;
+
+    for (auto* cell : m_young_cells) {
+        ASSERT(cell->is_live());
+        if (cell->is_marked()) {
+            cell->set_marked(false);
+            cell->set_young({}, false);
+            if (!cell->has_write_barriers())
+                m_old_cells_without_write_barriers.append(cell);
+            ++m_old_cell_count;
+            continue;
+        }
+#ifdef HEAP_DEBUG
+        dbgln("  ~ {}", cell);
+#endif
+        auto* block = HeapBlock::from_cell(cell);
+        if (block->is_full())
+            full_blocks_that_became_usable.set(block);
+        block->deallocate(cell);
+    }
+    m_young_cells.clear();
+
+    // Everything that survived is old now, so no old cell can point to a young one.
+    forget_remembered_cells();
+
+    // Blocks that became empty are left for the allocator to reuse, and freed by the next full collection.
+    for (auto* block : full_blocks_that_became_usable)
+        allocator_for_size(block->cell_size()).block_did_become_usable({}, *block);
 }
 
 void Heap::sweep_dead_cells(bool print_report, const Core::ElapsedTimer& measurement_timer)
@@ -219,6 +502,9 @@ void Heap::sweep_dead_cells(bool print_report, const Core::ElapsedTimer& measure
     size_t collected_cell_bytes = 0;
     size_t live_cell_bytes = 0;
 
+    forget_remembered_cells();
+    m_old_cells_without_write_barriers.clear();
+
     for_each_block([&](auto& block) {
         bool block_has_live_cells = false;
         bool block_was_full = block.is_full();
@@ -233,6 +519,9 @@ void Heap::sweep_dead_cells(bool print_report, const Core::ElapsedTimer& measure
                     collected_cell_bytes += block.cell_size();
                 } else {
                     cell->set_marked(false);
+                    cell->set_young({}, false);
+                    if (!cell->has_write_barriers())
+                        m_old_cells_without_write_barriers.append(cell);
                     block_has_live_cells = true;
                     ++live_cells;
                     live_cell_bytes += block.cell_size();
@@ -246,10 +535,15 @@ void Heap::sweep_dead_cells(bool print_report, const Core::ElapsedTimer& measure
         return IterationDecision::Continue;
     });
 
+    m_young_cells.clear();
+    m_old_cell_count = live_cells;
+    m_old_cell_count_after_last_full_collection = live_cells;
+
     for (auto* block : empty_blocks) {
 #ifdef HEAP_DEBUG
         dbgln(" - HeapBlock empty @ {}: cell_size={}", block, block->cell_size());
 #endif
+        m_blocks.remove(block);
         allocator_for_size(block->cell_size()).block_did_become_empty({}, *block);
     }
 
@@ -287,6 +581,25 @@ void Heap::sweep_dead_cells(bool print_report, const Core::ElapsedTimer& measure
     }
 }
 
+void Heap::did_create_heap_block(Badge<Allocator>, HeapBlock& block)
+{
+    m_blocks.set(&block);
+}
+
+void Heap::did_write_to_cell(Badge<Cell>, Cell& cell)
+{
+    ASSERT(!cell.is_remembered());
+    cell.set_remembered({}, true);
+    m_remembered_cells.append(&cell);
+}
+
+void Heap::did_disable_write_barriers(Badge<Cell>, Cell& cell)
+{
+    // Young cells are sorted into the right list when they're promoted.
+    if (!cell.is_young())
+        m_old_cells_without_write_barriers.append(&cell);
+}
+
 void Heap::did_create_handle(Badge<HandleImpl>, HandleImpl& impl)
 {
     ASSERT(!m_handles.contains(&impl));
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/Function.h>
 #include <AK/HashTable.h>
 #include <AK/Noncopyable.h>
 #include <AK/NonnullOwnPtr.h>
@@ -53,7 +54,9 @@ public:
     {
         auto* memory = allocate_cell(sizeof(T));
         new (memory) T(forward<Args>(args)...);
-        return static_cast<T*>(memory);
+        auto* cell = static_cast<T*>(memory);
+        did_construct_cell(*cell, IsSame<typename T::CellWithWriteBarriers, T>::value);
+        return cell;
     }
 
     template<typename T, typename... Args>
@@ -62,6 +65,7 @@ public:
         auto* memory = allocate_cell(sizeof(T));
         new (memory) T(forward<Args>(args)...);
         auto* cell = static_cast<T*>(memory);
+        did_construct_cell(*cell, IsSame<typename T::CellWithWriteBarriers, T>::value);
         constexpr bool is_object = IsBaseOf<Object, T>::value;
         if constexpr (is_object)
             static_cast<Object*>(cell)->disable_transitions();
@@ -76,8 +80,42 @@ public:
         CollectEverything,
     };
 
+    // Marks and sweeps the whole heap without yielding to the mutator.
     void collect_garbage(CollectionType = CollectionType::CollectGarbage, bool print_report = false);
 
+    // Frees unreachable cells allocated since the last collection, and promotes the rest.
+    void collect_young_generation();
+
+    bool is_incremental_marking_in_progress() const { return m_incremental_marking_in_progress; }
+    void start_incremental_marking();
+
+    // Marks for at most the given time, and finishes the collection if nothing is left to mark.
+    // Meant to be called from an event loop while incremental marking is in progress.
+    void perform_incremental_marking_step(int time_budget_in_ms);
+
+    // Allocations drive marking forward in any case, so this is only needed to make use of idle time.
+    AK::Function<void()> on_incremental_marking_start;
+
+    struct PauseTimeHistogram {
+        static constexpr size_t bucket_count = 10;
+        static constexpr u64 bucket_limits_in_microseconds[bucket_count - 1] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 };
+
+        void add_pause(u64 microseconds);
+
+        size_t pause_count { 0 };
+        u64 total_microseconds { 0 };
+        u64 longest_microseconds { 0 };
+        size_t buckets[bucket_count] {};
+    };
+
+    struct Statistics {
+        PauseTimeHistogram young_generation_collections;
+        PauseTimeHistogram incremental_marking_steps;
+        PauseTimeHistogram full_collections;
+    };
+
+    const Statistics& statistics() const { return m_statistics; }
+
     VM& vm() { return m_vm; }
 
     bool should_collect_on_every_allocation() const { return m_should_collect_on_every_allocation; }
@@ -89,16 +127,34 @@ public:
     void did_create_marked_value_list(Badge<MarkedValueList>, MarkedValueList&);
     void did_destroy_marked_value_list(Badge<MarkedValueList>, MarkedValueList&);
 
+    void did_create_heap_block(Badge<Allocator>, HeapBlock&);
+
+    void did_write_to_cell(Badge<Cell>, Cell&);
+    void did_disable_write_barriers(Badge<Cell>, Cell&);
+
     void defer_gc(Badge<DeferGC>);
     void undefer_gc(Badge<DeferGC>);
 
 private:
     Cell* allocate_cell(size_t);
+    void did_construct_cell(Cell&, bool has_write_barriers);
+
+    enum class MarkingMode {
+        Full,
+        YoungGeneration,
+    };
 
     void gather_roots(HashTable<Cell*>&);
     void gather_conservative_roots(HashTable<Cell*>&);
-    void mark_live_cells(const HashTable<Cell*>& live_cells);
+    void mark_roots(MarkingMode, HashTable<Cell*>& roots);
+    bool process_mark_stack(MarkingMode, u64 deadline_in_microseconds = 0);
+    void finish_marking(HashTable<Cell*>& roots);
+    void sweep_young_generation();
     void sweep_dead_cells(bool print_report, const Core::ElapsedTimer&);
+    void forget_remembered_cells();
+    void maybe_start_incremental_marking();
+
+    void verify_marking(MarkingMode, const HashTable<Cell*>& roots);
 
     Allocator& allocator_for_size(size_t);
 
@@ -112,21 +168,44 @@ private:
     }
 
     size_t m_max_allocations_between_gc { 10000 };
-    size_t m_allocations_since_last_gc { false };
+    size_t m_allocations_since_last_gc { 0 };
 
     bool m_should_collect_on_every_allocation { false };
 
     VM& m_vm;
 
     Vector<NonnullOwnPtr<Allocator>> m_allocators;
+    HashTable<HeapBlock*> m_blocks;
     HashTable<HandleImpl*> m_handles;
 
     HashTable<MarkedValueList*> m_marked_value_lists;
 
+    // Cells allocated since the last collection.
+    Vector<Cell*> m_young_cells;
+
+    // Old cells that may point to young cells, or that were written to while
+    // incremental marking is in progress.
+    Vector<Cell*> m_remembered_cells;
+
+    // Old cells that don't have write barriers, and so must be treated as remembered at all times.
+    Vector<Cell*> m_old_cells_without_write_barriers;
+
+    Vector<Cell*> m_mark_stack;
+
+    size_t m_old_cell_count { 0 };
+    size_t m_old_cell_count_after_last_full_collection { 0 };
+    static constexpr size_t minimum_old_cell_count_for_full_collection = 50000;
+
+    bool m_incremental_marking_in_progress { false };
+    size_t m_incremental_marking_steps { 0 };
+    static constexpr size_t max_incremental_marking_steps = 100;
+
     size_t m_gc_deferrals { 0 };
     bool m_should_gc_when_deferral_ends { false };
 
     bool m_collecting_garbage { false };
+
+    Statistics m_statistics;
 };
 
 }
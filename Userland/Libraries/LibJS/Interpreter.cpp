@@ -25,8 +25,10 @@
  */
 
 #include <AK/Badge.h>
+#include <AK/ScopeGuard.h>
 #include <AK/StringBuilder.h>
 #include <LibJS/AST.h>
+#include <LibJS/Bytecode/Interpreter.h>
 #include <LibJS/Interpreter.h>
 #include <LibJS/Runtime/Error.h>
 #include <LibJS/Runtime/GlobalObject.h>
@@ -75,7 +77,12 @@ Value Interpreter::run(GlobalObject& global_object, const Program& program)
     global_call_frame.is_strict_mode = program.is_strict_mode();
     vm.push_call_frame(global_call_frame, global_object);
     ASSERT(!vm.exception());
-    auto result = program.execute(*this, global_object);
+    Value result;
+    const Bytecode::Block* block = vm.bytecode_enabled() ? program.bytecode_block(Bytecode::Generator::Kind::Program) : nullptr;
+    if (block)
+        result = execute_bytecode(global_object, program, *block, ScopeType::Block);
+    else
+        result = program.execute(*this, global_object);
     vm.pop_call_frame();
     return result;
 }
@@ -167,10 +174,10 @@ Value Interpreter::execute_statement(GlobalObject& global_object, const Statemen
     enter_scope(block, scope_type, global_object);
 
     if (block.children().is_empty())
-        vm().set_last_value({}, js_undefined());
+        vm().set_last_value(Badge<Interpreter> {}, js_undefined());
 
     for (auto& node : block.children()) {
-        vm().set_last_value({}, node.execute(*this, global_object));
+        vm().set_last_value(Badge<Interpreter> {}, node.execute(*this, global_object));
         if (vm().should_unwind()) {
             if (!block.label().is_null() && vm().should_unwind_until(ScopeType::Breakable, block.label()))
                 vm().stop_unwind();
@@ -188,6 +195,22 @@ Value Interpreter::execute_statement(GlobalObject& global_object, const Statemen
     return did_return ? vm().last_value() : js_undefined();
 }
 
+Value Interpreter::execute_bytecode(GlobalObject& global_object, const ScopeNode& scope_node, const Bytecode::Block& block, ScopeType scope_type)
+{
+    enter_node(scope_node);
+    ScopeGuard exit_node { [&] { this->exit_node(scope_node); } };
+
+    enter_scope(scope_node, scope_type, global_object);
+    if (exception())
+        return {};
+
+    Bytecode::Interpreter bytecode_interpreter(global_object, *this);
+    auto result = bytecode_interpreter.run(block);
+
+    exit_scope(scope_node);
+    return result;
+}
+
 LexicalEnvironment* Interpreter::current_environment()
 {
     ASSERT(is<LexicalEnvironment>(vm().call_frame().scope));
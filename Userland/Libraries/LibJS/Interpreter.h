@@ -81,6 +81,7 @@ public:
     void exit_node(const ASTNode&);
 
     Value execute_statement(GlobalObject&, const Statement&, ScopeType = ScopeType::Block);
+    Value execute_bytecode(GlobalObject&, const ScopeNode&, const Bytecode::Block&, ScopeType);
 
 private:
     explicit Interpreter(VM&);
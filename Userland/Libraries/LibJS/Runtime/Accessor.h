@@ -33,6 +33,8 @@
 namespace JS {
 
 class Accessor final : public Cell {
+    JS_DECLARE_WRITE_BARRIERS(Accessor);
+
 public:
     static Accessor* create(VM& vm, Function* getter, Function* setter)
     {
@@ -46,10 +48,18 @@ public:
     }
 
     Function* getter() const { return m_getter; }
-    void set_getter(Function* getter) { m_getter = getter; }
+    void set_getter(Function* getter)
+    {
+        m_getter = getter;
+        write_barrier();
+    }
 
     Function* setter() const { return m_setter; }
-    void set_setter(Function* setter) { m_setter = setter; }
+    void set_setter(Function* setter)
+    {
+        m_setter = setter;
+        write_barrier();
+    }
 
     Value call_getter(Value this_value)
     {
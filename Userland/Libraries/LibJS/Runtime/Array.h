@@ -32,6 +32,7 @@ namespace JS {
 
 class Array final : public Object {
     JS_OBJECT(Array, Object);
+    JS_DECLARE_WRITE_BARRIERS(Array);
 
 public:
     static Array* create(GlobalObject&);
@@ -32,6 +32,8 @@
 namespace JS {
 
 class BigInt final : public Cell {
+    JS_DECLARE_WRITE_BARRIERS(BigInt);
+
 public:
     BigInt(Crypto::SignedBigInteger);
     virtual ~BigInt();
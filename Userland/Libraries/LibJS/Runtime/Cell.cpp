@@ -55,4 +55,17 @@ VM& Cell::vm() const
     return heap().vm();
 }
 
+void Cell::write_barrier_slow()
+{
+    heap().did_write_to_cell({}, *this);
+}
+
+void Cell::disable_write_barriers()
+{
+    if (!m_has_write_barriers)
+        return;
+    m_has_write_barriers = false;
+    heap().did_disable_write_barriers({}, *this);
+}
+
 }
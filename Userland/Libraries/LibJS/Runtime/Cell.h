@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/Badge.h>
 #include <AK/Format.h>
 #include <AK/Forward.h>
 #include <AK/Noncopyable.h>
@@ -40,6 +41,11 @@ class Cell {
     AK_MAKE_NONMOVABLE(Cell);
 
 public:
+    // Cell types that call write_barrier() after every store of a cell pointer outside their
+    // constructor declare themselves here with JS_DECLARE_WRITE_BARRIERS. Old cells of any
+    // other type are scanned on every young generation collection.
+    using CellWithWriteBarriers = void;
+
     virtual void initialize(GlobalObject&) { }
     virtual ~Cell() { }
 
@@ -49,6 +55,26 @@ public:
     bool is_live() const { return m_live; }
     void set_live(bool b) { m_live = b; }
 
+    bool is_young() const { return m_young; }
+    void set_young(Badge<Heap>, bool b) { m_young = b; }
+
+    bool is_remembered() const { return m_remembered; }
+    void set_remembered(Badge<Heap>, bool b) { m_remembered = b; }
+
+    bool has_write_barriers() const { return m_has_write_barriers; }
+    void set_has_write_barriers(Badge<Heap>, bool b) { m_has_write_barriers = b; }
+
+    // Tells the heap that this cell may now point to cells it didn't point to before.
+    ALWAYS_INLINE void write_barrier()
+    {
+        if (m_remembered || !m_has_write_barriers || (m_young && !m_mark))
+            return;
+        write_barrier_slow();
+    }
+
+    // For cells that hand out references to their internals that can't be tracked.
+    void disable_write_barriers();
+
     virtual const char* class_name() const = 0;
 
     class Visitor {
@@ -69,10 +95,19 @@ protected:
     Cell() { }
 
 private:
+    void write_barrier_slow();
+
     bool m_mark { false };
     bool m_live { true };
+    bool m_young { true };
+    bool m_remembered { false };
+    bool m_has_write_barriers { false };
 };
 
+#define JS_DECLARE_WRITE_BARRIERS(class_) \
+public:                                   \
+    using CellWithWriteBarriers = class_;
+
 }
 
 template<>
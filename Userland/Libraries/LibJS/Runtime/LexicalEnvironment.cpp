@@ -63,7 +63,7 @@ LexicalEnvironment::~LexicalEnvironment()
 
 void LexicalEnvironment::visit_edges(Visitor& visitor)
 {
-    Cell::visit_edges(visitor);
+    Base::visit_edges(visitor);
     visitor.visit(m_this_value);
     visitor.visit(m_home_object);
     visitor.visit(m_new_target);
@@ -80,6 +80,7 @@ Optional<Variable> LexicalEnvironment::get_from_scope(const FlyString& name) con
 void LexicalEnvironment::put_to_scope(const FlyString& name, Variable variable)
 {
     m_variables.set(name, variable);
+    write_barrier();
 }
 
 bool LexicalEnvironment::has_super_binding() const
@@ -129,6 +130,7 @@ void LexicalEnvironment::bind_this_value(GlobalObject& global_object, Value this
     }
     m_this_value = this_value;
     m_this_binding_status = ThisBindingStatus::Initialized;
+    write_barrier();
 }
 
 }
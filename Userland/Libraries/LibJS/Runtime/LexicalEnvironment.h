@@ -35,6 +35,7 @@ namespace JS {
 
 class LexicalEnvironment final : public ScopeObject {
     JS_OBJECT(LexicalEnvironment, ScopeObject);
+    JS_DECLARE_WRITE_BARRIERS(LexicalEnvironment);
 
 public:
     enum class ThisBindingStatus {
@@ -66,7 +67,11 @@ public:
 
     const HashMap<FlyString, Variable>& variables() const { return m_variables; }
 
-    void set_home_object(Value object) { m_home_object = object; }
+    void set_home_object(Value object)
+    {
+        m_home_object = object;
+        write_barrier();
+    }
     bool has_super_binding() const;
     Value get_super_base();
 
@@ -74,13 +79,25 @@ public:
     void bind_this_value(GlobalObject&, Value this_value);
 
     // Not a standard operation.
-    void replace_this_binding(Value this_value) { m_this_value = this_value; }
+    void replace_this_binding(Value this_value)
+    {
+        m_this_value = this_value;
+        write_barrier();
+    }
 
     Value new_target() const { return m_new_target; };
-    void set_new_target(Value new_target) { m_new_target = new_target; }
+    void set_new_target(Value new_target)
+    {
+        m_new_target = new_target;
+        write_barrier();
+    }
 
     Function* current_function() const { return m_current_function; }
-    void set_current_function(Function& function) { m_current_function = &function; }
+    void set_current_function(Function& function)
+    {
+        m_current_function = &function;
+        write_barrier();
+    }
 
     EnvironmentRecordType type() const { return m_environment_record_type; }
 
@@ -34,6 +34,8 @@
 #include <LibJS/Runtime/NativeFunction.h>
 #include <LibJS/Runtime/NativeProperty.h>
 #include <LibJS/Runtime/Object.h>
+#include <LibJS/Runtime/PropertyCache.h>
+#include <LibJS/Runtime/ProxyObject.h>
 #include <LibJS/Runtime/Shape.h>
 #include <LibJS/Runtime/StringObject.h>
 #include <LibJS/Runtime/Value.h>
@@ -139,6 +141,7 @@ bool Object::set_prototype(Object* new_prototype)
         return true;
     }
     m_shape = m_shape->create_prototype_transition(new_prototype);
+    write_barrier();
     return true;
 }
 
@@ -346,6 +349,7 @@ void Object::set_shape(Shape& new_shape)
 {
     m_storage.resize(new_shape.property_count());
     m_shape = &new_shape;
+    write_barrier();
 }
 
 bool Object::define_property(const StringOrSymbol& property_name, const Object& descriptor, bool throw_exceptions)
@@ -492,6 +496,7 @@ bool Object::put_own_property(Object& this_object, const StringOrSymbol& propert
         m_shape->add_property_without_transition(property_name, attributes);
         m_storage.resize(m_shape->property_count());
         m_storage[m_shape->property_count() - 1] = value;
+        write_barrier();
         return true;
     }
 
@@ -564,6 +569,7 @@ bool Object::put_own_property(Object& this_object, const StringOrSymbol& propert
         call_native_property_setter(value_here.as_native_property(), &this_object, value);
     } else {
         m_storage[metadata.value().offset] = value;
+        write_barrier();
     }
     return true;
 }
@@ -618,6 +624,7 @@ bool Object::put_own_property_by_index(Object& this_object, u32 property_index,
         call_native_property_setter(value_here.as_native_property(), &this_object, value);
     } else {
         m_indexed_properties.put(&this_object, property_index, value, attributes, mode == PutOwnPropertyMode::Put);
+        write_barrier();
     }
     return true;
 }
@@ -656,6 +663,7 @@ void Object::ensure_shape_is_unique()
         return;
 
     m_shape = m_shape->create_unique_clone();
+    write_barrier();
 }
 
 Value Object::get_by_index(u32 property_index) const
@@ -778,6 +786,8 @@ bool Object::put(const PropertyName& property_name, Value value, Value receiver)
                 call_native_property_setter(value_here.as_native_property(), receiver, value);
                 return true;
             }
+            // A data property shadows any setter further up the prototype chain.
+            break;
         }
         object = object->prototype();
         if (vm().exception())
@@ -786,6 +796,58 @@ bool Object::put(const PropertyName& property_name, Value value, Value receiver)
     return put_own_property(*this, string_or_symbol, value, default_attributes, PutOwnPropertyMode::Put);
 }
 
+void Object::update_property_cache(const FlyString& property_name, PropertyCache& cache) const
+{
+    if (m_shape->is_unique() || is<ProxyObject>(*this))
+        return;
+    auto metadata = shape().lookup(property_name);
+    if (!metadata.has_value() || !metadata.value().attributes.is_writable())
+        return;
+    auto value = m_storage[metadata.value().offset];
+    if (value.is_empty() || value.is_accessor() || value.is_native_property())
+        return;
+    cache.add(shape(), metadata.value().offset);
+}
+
+Value Object::get_with_cache(const FlyString& property_name, PropertyCache& cache) const
+{
+    auto& statistics = vm().property_cache_statistics();
+    if (auto offset = cache.lookup(shape()); offset.has_value()) {
+        auto value = m_storage[offset.value()];
+        // The shape can't tell whether a slot has been overwritten with an accessor or native property.
+        if (!value.is_empty() && !value.is_accessor() && !value.is_native_property()) {
+            ++statistics.get_hits;
+            return value;
+        }
+    }
+
+    ++statistics.get_misses;
+    auto value = get(property_name);
+    if (!vm().exception())
+        update_property_cache(property_name, cache);
+    return value;
+}
+
+bool Object::put_with_cache(const FlyString& property_name, Value value, PropertyCache& cache)
+{
+    auto& statistics = vm().property_cache_statistics();
+    if (auto offset = cache.lookup(shape()); offset.has_value()) {
+        auto& value_here = m_storage[offset.value()];
+        if (!value_here.is_empty() && !value_here.is_accessor() && !value_here.is_native_property()) {
+            ++statistics.put_hits;
+            value_here = value;
+            write_barrier();
+            return true;
+        }
+    }
+
+    ++statistics.put_misses;
+    bool result = put(property_name, value);
+    if (!vm().exception())
+        update_property_cache(property_name, cache);
+    return result;
+}
+
 bool Object::define_native_function(const StringOrSymbol& property_name, AK::Function<Value(VM&, GlobalObject&)> native_function, i32 length, PropertyAttributes attribute)
 {
     auto& vm = this->vm();
@@ -58,6 +58,8 @@ struct PropertyDescriptor {
 };
 
 class Object : public Cell {
+    JS_DECLARE_WRITE_BARRIERS(Object);
+
 public:
     static Object* create_empty(GlobalObject&);
 
@@ -94,6 +96,10 @@ public:
 
     virtual bool put(const PropertyName&, Value, Value receiver = {});
 
+    // Like get() and put(), but try the given inline cache before looking the property up in the shape.
+    Value get_with_cache(const FlyString& property_name, PropertyCache&) const;
+    bool put_with_cache(const FlyString& property_name, Value, PropertyCache&);
+
     Value get_own_property(const PropertyName&, Value receiver) const;
     Value get_own_properties(const Object& this_object, PropertyKind, bool only_enumerable_properties = false, GetOwnPropertyReturnType = GetOwnPropertyReturnType::StringOnly) const;
     virtual Optional<PropertyDescriptor> get_own_property_descriptor(const PropertyName&) const;
@@ -130,8 +136,17 @@ public:
     Value get_direct(size_t index) const { return m_storage[index]; }
 
     const IndexedProperties& indexed_properties() const { return m_indexed_properties; }
-    IndexedProperties& indexed_properties() { return m_indexed_properties; }
-    void set_indexed_property_elements(Vector<Value>&& values) { m_indexed_properties = IndexedProperties(move(values)); }
+    IndexedProperties& indexed_properties()
+    {
+        // There's no telling what the caller will store in there, or when.
+        disable_write_barriers();
+        return m_indexed_properties;
+    }
+    void set_indexed_property_elements(Vector<Value>&& values)
+    {
+        m_indexed_properties = IndexedProperties(move(values));
+        write_barrier();
+    }
 
     Value invoke(const StringOrSymbol& property_name, Optional<MarkedValueList> arguments = {});
 
@@ -157,6 +172,7 @@ private:
     void call_native_property_setter(NativeProperty& property, Value this_value, Value) const;
 
     void set_shape(Shape&);
+    void update_property_cache(const FlyString& property_name, PropertyCache&) const;
 
     bool m_is_extensible { true };
     bool m_transitions_enabled { true };
@@ -32,6 +32,8 @@
 namespace JS {
 
 class PrimitiveString final : public Cell {
+    JS_DECLARE_WRITE_BARRIERS(PrimitiveString);
+
 public:
     explicit PrimitiveString(String);
     virtual ~PrimitiveString();
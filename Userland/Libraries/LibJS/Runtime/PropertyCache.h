@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/Types.h>
+#include <LibJS/Runtime/Shape.h>
+
+namespace JS {
+
+// An inline cache for one property access site, e.g. `object.x` in a script.
+// It remembers at which storage offset objects of the last few shapes seen at
+// the site keep the named property, so repeated accesses can skip Shape::lookup().
+// Only writable own data properties of non-unique shapes are cached.
+class PropertyCache {
+public:
+    static constexpr size_t max_shapes = 4;
+
+    Optional<size_t> lookup(const Shape& shape) const
+    {
+        for (size_t i = 0; i < m_entry_count; ++i) {
+            // The id guards against a new shape being allocated where a dead one used to be.
+            if (m_entries[i].shape == &shape && m_entries[i].shape_id == shape.id())
+                return m_entries[i].offset;
+        }
+        return {};
+    }
+
+    // Once a site has seen more than max_shapes shapes, it's megamorphic and stops caching.
+    void add(const Shape& shape, size_t offset)
+    {
+        ASSERT(!shape.is_unique());
+        if (m_entry_count == max_shapes)
+            return;
+        m_entries[m_entry_count++] = { &shape, shape.id(), offset };
+    }
+
+private:
+    struct Entry {
+        const Shape* shape { nullptr };
+        u64 shape_id { 0 };
+        size_t offset { 0 };
+    };
+
+    Entry m_entries[max_shapes];
+    size_t m_entry_count { 0 };
+};
+
+struct PropertyCacheStatistics {
+    u64 get_hits { 0 };
+    u64 get_misses { 0 };
+    u64 put_hits { 0 };
+    u64 put_misses { 0 };
+};
+
+}
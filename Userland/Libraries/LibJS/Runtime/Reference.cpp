@@ -32,7 +32,7 @@
 
 namespace JS {
 
-void Reference::put(GlobalObject& global_object, Value value)
+void Reference::put(GlobalObject& global_object, Value value, PropertyCache* cache)
 {
     auto& vm = global_object.vm();
 
@@ -58,7 +58,10 @@ void Reference::put(GlobalObject& global_object, Value value)
     if (!object)
         return;
 
-    object->put(m_name, value);
+    if (cache && m_name.is_string())
+        object->put_with_cache(m_name.as_string(), value, *cache);
+    else
+        object->put(m_name, value);
 }
 
 void Reference::throw_reference_error(GlobalObject& global_object)
@@ -72,7 +75,7 @@ void Reference::throw_reference_error(GlobalObject& global_object)
     }
 }
 
-Value Reference::get(GlobalObject& global_object)
+Value Reference::get(GlobalObject& global_object, PropertyCache* cache)
 {
     auto& vm = global_object.vm();
 
@@ -100,6 +103,8 @@ Value Reference::get(GlobalObject& global_object)
     if (!object)
         return {};
 
+    if (cache && m_name.is_string())
+        return object->get_with_cache(m_name.as_string(), *cache).value_or(js_undefined());
     return object->get(m_name).value_or(js_undefined());
 }
 
@@ -85,8 +85,9 @@ public:
         return m_global_variable;
     }
 
-    void put(GlobalObject&, Value);
-    Value get(GlobalObject&);
+    // The cache must belong to a site that always accesses the same property name.
+    void put(GlobalObject&, Value, PropertyCache* = nullptr);
+    Value get(GlobalObject&, PropertyCache* = nullptr);
 
 private:
     void throw_reference_error(GlobalObject&);
@@ -147,6 +147,12 @@ Value ScriptFunction::execute_function_body()
         vm.current_scope()->put_to_scope(parameter.name, { argument_value, DeclarationKind::Var });
     }
 
+    if (vm.bytecode_enabled() && is<ScopeNode>(*m_body)) {
+        auto& body = static_cast<const ScopeNode&>(*m_body);
+        if (auto* block = body.bytecode_block(Bytecode::Generator::Kind::FunctionBody))
+            return interpreter->execute_bytecode(global_object(), body, *block, ScopeType::Function);
+    }
+
     return interpreter->execute_statement(global_object(), m_body, ScopeType::Function);
 }
 
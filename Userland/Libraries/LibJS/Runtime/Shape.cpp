@@ -30,6 +30,12 @@
 
 namespace JS {
 
+u64 Shape::allocate_id()
+{
+    static u64 s_next_id = 0;
+    return ++s_next_id;
+}
+
 Shape* Shape::create_unique_clone() const
 {
     ASSERT(m_global_object);
@@ -50,6 +56,7 @@ Shape* Shape::create_put_transition(const StringOrSymbol& property_name, Propert
         return existing_shape;
     auto* new_shape = heap().allocate_without_global_object<Shape>(*this, property_name, attributes, TransitionType::Put);
     m_forward_transitions.set(key, new_shape);
+    write_barrier();
     return new_shape;
 }
 
@@ -60,6 +67,7 @@ Shape* Shape::create_configure_transition(const StringOrSymbol& property_name, P
         return existing_shape;
     auto* new_shape = heap().allocate_without_global_object<Shape>(*this, property_name, attributes, TransitionType::Configure);
     m_forward_transitions.set(key, new_shape);
+    write_barrier();
     return new_shape;
 }
 
@@ -154,6 +162,7 @@ void Shape::ensure_property_table() const
 {
     if (m_property_table)
         return;
+    // No write barrier needed: every key comes from a shape in our transition chain, none of which are younger than us.
     m_property_table = make<HashMap<StringOrSymbol, PropertyMetadata>>();
 
     u32 next_offset = 0;
@@ -192,6 +201,7 @@ void Shape::add_property_to_unique_shape(const StringOrSymbol& property_name, Pr
     ASSERT(!m_property_table->contains(property_name));
     m_property_table->set(property_name, { m_property_table->size(), attributes });
     ++m_property_count;
+    write_barrier();
 }
 
 void Shape::reconfigure_property_in_unique_shape(const StringOrSymbol& property_name, PropertyAttributes attributes)
@@ -222,6 +232,9 @@ void Shape::add_property_without_transition(const StringOrSymbol& property_name,
     ensure_property_table();
     if (m_property_table->set(property_name, { m_property_count, attributes }) == AK::HashSetResult::InsertedNewEntry)
         ++m_property_count;
+    else
+        m_id = allocate_id();
+    write_barrier();
 }
 
 }
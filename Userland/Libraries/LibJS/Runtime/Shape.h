@@ -52,6 +52,8 @@ struct TransitionKey {
 };
 
 class Shape final : public Cell {
+    JS_DECLARE_WRITE_BARRIERS(Shape);
+
 public:
     virtual ~Shape() override;
 
@@ -76,6 +78,10 @@ public:
     void add_property_without_transition(const StringOrSymbol&, PropertyAttributes);
 
     bool is_unique() const { return m_unique; }
+
+    // Unique among all shapes ever created, unlike the address of a Shape. Changes if an
+    // existing property is modified in place, so PropertyCache never sees stale offsets.
+    u64 id() const { return m_id; }
     Shape* create_unique_clone() const;
 
     GlobalObject* global_object() const;
@@ -94,7 +100,11 @@ public:
 
     Vector<Property> property_table_ordered() const;
 
-    void set_prototype_without_transition(Object* new_prototype) { m_prototype = new_prototype; }
+    void set_prototype_without_transition(Object* new_prototype)
+    {
+        m_prototype = new_prototype;
+        write_barrier();
+    }
 
     void remove_property_from_unique_shape(const StringOrSymbol&, size_t offset);
     void add_property_to_unique_shape(const StringOrSymbol&, PropertyAttributes attributes);
@@ -106,6 +116,8 @@ private:
 
     void ensure_property_table() const;
 
+    static u64 allocate_id();
+
     PropertyAttributes m_attributes { 0 };
     TransitionType m_transition_type : 6 { TransitionType::Invalid };
     bool m_unique : 1 { false };
@@ -119,6 +131,7 @@ private:
     StringOrSymbol m_property_name;
     Object* m_prototype { nullptr };
     size_t m_property_count { 0 };
+    u64 m_id { allocate_id() };
 };
 
 }
@@ -34,6 +34,7 @@ namespace JS {
 class Symbol final : public Cell {
     AK_MAKE_NONCOPYABLE(Symbol);
     AK_MAKE_NONMOVABLE(Symbol);
+    JS_DECLARE_WRITE_BARRIERS(Symbol);
 
 public:
     Symbol(String, bool);
@@ -36,6 +36,7 @@
 #include <LibJS/Runtime/ErrorTypes.h>
 #include <LibJS/Runtime/Exception.h>
 #include <LibJS/Runtime/MarkedValueList.h>
+#include <LibJS/Runtime/PropertyCache.h>
 #include <LibJS/Runtime/Value.h>
 
 namespace JS {
@@ -72,6 +73,11 @@ public:
     bool should_log_exceptions() const { return m_should_log_exceptions; }
     void set_should_log_exceptions(bool b) { m_should_log_exceptions = b; }
 
+    PropertyCacheStatistics& property_cache_statistics() { return m_property_cache_statistics; }
+
+    bool bytecode_enabled() const { return m_bytecode_enabled; }
+    void set_bytecode_enabled(bool b) { m_bytecode_enabled = b; }
+
     Heap& heap() { return m_heap; }
     const Heap& heap() const { return m_heap; }
 
@@ -173,6 +179,7 @@ public:
 
     Value last_value() const { return m_last_value; }
     void set_last_value(Badge<Interpreter>, Value value) { m_last_value = value; }
+    void set_last_value(Badge<Bytecode::Interpreter>, Value value) { m_last_value = value; }
 
     const StackInfo& stack_info() const { return m_stack_info; };
 
@@ -276,6 +283,9 @@ private:
     Shape* m_scope_object_shape { nullptr };
 
     bool m_should_log_exceptions { false };
+    bool m_bytecode_enabled { false };
+
+    PropertyCacheStatistics m_property_cache_statistics;
 };
 
 template<>
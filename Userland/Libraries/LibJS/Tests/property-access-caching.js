@@ -0,0 +1,94 @@
+function getX(o) {
+    return o.x;
+}
+
+function setX(o, value) {
+    o.x = value;
+}
+
+test("polymorphic access sites", () => {
+    const objects = [
+        { x: 1 },
+        { a: 0, x: 2 },
+        { b: 0, c: 0, x: 3 },
+        { d: 0, e: 0, f: 0, x: 4 },
+        { g: 0, x: 5 },
+        { h: 0, x: 6 },
+    ];
+    for (let i = 0; i < 3; ++i) {
+        for (let j = 0; j < objects.length; ++j) {
+            expect(getX(objects[j])).toBe(j + 1);
+            setX(objects[j], j + 10);
+            expect(getX(objects[j])).toBe(j + 10);
+            setX(objects[j], j + 1);
+        }
+    }
+});
+
+test("deleted and redefined properties", () => {
+    const o = { x: 1, y: 2 };
+    expect(getX(o)).toBe(1);
+    delete o.x;
+    expect(getX(o)).toBeUndefined();
+    o.x = 3;
+    expect(getX(o)).toBe(3);
+
+    Object.defineProperty(o, "x", { get: () => 4, configurable: true });
+    expect(getX(o)).toBe(4);
+});
+
+test("read-only properties", () => {
+    const o = { x: 1 };
+    setX(o, 2);
+    expect(o.x).toBe(2);
+    Object.defineProperty(o, "x", { writable: false });
+    setX(o, 3);
+    expect(o.x).toBe(2);
+});
+
+test("setters and data properties on the prototype chain", () => {
+    let setterValue;
+    const proto = {
+        set x(value) {
+            setterValue = value;
+        },
+    };
+    const o = Object.setPrototypeOf({}, proto);
+    setX(o, 1);
+    expect(setterValue).toBe(1);
+    expect(Object.getOwnPropertyNames(o)).toEqual([]);
+
+    const middle = Object.setPrototypeOf({ x: 0 }, proto);
+    const shadowing = Object.setPrototypeOf({}, middle);
+    setX(shadowing, 2);
+    expect(setterValue).toBe(1);
+    expect(Object.getOwnPropertyNames(shadowing)).toEqual(["x"]);
+    expect(getX(shadowing)).toBe(2);
+});
+
+test("update expressions", () => {
+    const o = { x: 0 };
+    for (let i = 0; i < 10; ++i) o.x++;
+    expect(o.x).toBe(10);
+    for (let i = 0; i < 5; ++i) --o.x;
+    expect(o.x).toBe(5);
+});
+
+test("method calls", () => {
+    const a = {
+        value: 1,
+        get() {
+            return this.value;
+        },
+    };
+    const b = {
+        other: 0,
+        value: 2,
+        get() {
+            return this.value * 2;
+        },
+    };
+    const results = [];
+    for (const o of [a, b, a, b]) results.push(o.get());
+    expect(results).toEqual([1, 4, 1, 4]);
+});
@@ -34,6 +34,7 @@
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/internals.h>
 #include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
@@ -103,6 +104,7 @@ static int create_thread(pthread_t* thread, void* (*entry)(void*), void* argumen
 [[noreturn]] static void exit_thread(void* code)
 {
     KeyDestroyer::destroy_for_current_thread();
+    __malloc_flush_thread_cache();
     syscall(SC_exit_thread, code);
     ASSERT_NOT_REACHED();
 }
@@ -183,31 +185,60 @@ int pthread_mutex_destroy(pthread_mutex_t*)
     return 0;
 }
 
+// The mutex lock word has three states, following Ulrich Drepper's
+// "Futexes Are Tricky": unlocked, locked without waiters, and locked with
+// (possibly) sleeping waiters. Only the last one makes unlock enter the kernel.
+static constexpr u32 MUTEX_UNLOCKED = 0;
+static constexpr u32 MUTEX_LOCKED_NO_WAITERS = 1;
+static constexpr u32 MUTEX_LOCKED_WITH_WAITERS = 2;
+
+// How many times to re-check a contended lock before going to sleep.
+// Critical sections guarded by a mutex are usually short, so a holder
+// running on another CPU will often release it within this window.
+static constexpr int MUTEX_SPIN_COUNT = 100;
+
+static void mutex_lock_slow(Atomic<u32>& lock, u32 state)
+{
+    for (int i = 0; i < MUTEX_SPIN_COUNT && state == MUTEX_LOCKED_NO_WAITERS; ++i) {
+        asm volatile("pause");
+        state = lock.load(AK::memory_order_relaxed);
+        if (state == MUTEX_UNLOCKED) {
+            if (lock.compare_exchange_strong(state, MUTEX_LOCKED_NO_WAITERS, AK::memory_order_acquire))
+                return;
+        }
+    }
+
+    // From here on, we have to assume that somebody else is waiting too,
+    // since we can't tell whether we were the one that set the waiters state.
+    if (state != MUTEX_LOCKED_WITH_WAITERS)
+        state = lock.exchange(MUTEX_LOCKED_WITH_WAITERS, AK::memory_order_acquire);
+    while (state != MUTEX_UNLOCKED) {
+        futex(reinterpret_cast<u32*>(&lock), FUTEX_WAIT, MUTEX_LOCKED_WITH_WAITERS, nullptr, nullptr, 0);
+        state = lock.exchange(MUTEX_LOCKED_WITH_WAITERS, AK::memory_order_acquire);
+    }
+}
+
 int pthread_mutex_lock(pthread_mutex_t* mutex)
 {
-    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    auto& lock = reinterpret_cast<Atomic<u32>&>(mutex->lock);
     pthread_t this_thread = pthread_self();
-    for (;;) {
-        u32 expected = false;
-        if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
-            if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
-                mutex->level++;
-                return 0;
-            }
-            sched_yield();
-            continue;
-        }
-        mutex->owner = this_thread;
-        mutex->level = 0;
+    if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
+        mutex->level++;
         return 0;
     }
+    u32 expected = MUTEX_UNLOCKED;
+    if (!lock.compare_exchange_strong(expected, MUTEX_LOCKED_NO_WAITERS, AK::memory_order_acquire))
+        mutex_lock_slow(lock, expected);
+    mutex->owner = this_thread;
+    mutex->level = 0;
+    return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t* mutex)
 {
-    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
-    u32 expected = false;
-    if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
+    auto& lock = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    u32 expected = MUTEX_UNLOCKED;
+    if (!lock.compare_exchange_strong(expected, MUTEX_LOCKED_NO_WAITERS, AK::memory_order_acquire)) {
         if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == pthread_self()) {
             mutex->level++;
             return 0;
@@ -226,7 +257,9 @@ int pthread_mutex_unlock(pthread_mutex_t* mutex)
         return 0;
     }
     mutex->owner = 0;
-    mutex->lock = 0;
+    auto& lock = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    if (lock.exchange(MUTEX_UNLOCKED, AK::memory_order_release) == MUTEX_LOCKED_WITH_WAITERS)
+        futex(&mutex->lock, FUTEX_WAKE, 1, nullptr, nullptr, 0);
     return 0;
 }
 
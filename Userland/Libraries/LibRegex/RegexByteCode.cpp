@@ -576,8 +576,12 @@ ALWAYS_INLINE void OpCode_Compare::compare_character_class(const MatchInput& inp
         }
         break;
     case CharClass::Alpha:
-        if (isalpha(ch))
-            ++state.string_position;
+        if (isalpha(ch)) {
+            if (inverse)
+                inverse_matched = true;
+            else
+                ++state.string_position;
+        }
         break;
     case CharClass::Blank:
         if (ch == ' ' || ch == '\t') {
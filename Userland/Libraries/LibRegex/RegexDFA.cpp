@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "RegexDFA.h"
+#include <AK/StringImpl.h>
+#include <AK/StringView.h>
+#include <string.h>
+
+namespace regex {
+
+unsigned LazyDFA::StateKeyTraits::hash(const StateKey& key)
+{
+    unsigned hash = pair_int_hash(key.is_match, key.is_match_at_end);
+    for (auto thread : key.threads)
+        hash = pair_int_hash(hash, thread);
+    return hash;
+}
+
+OwnPtr<LazyDFA> LazyDFA::try_create(const ByteCode& bytecode)
+{
+    auto dfa = adopt_own(*new LazyDFA(bytecode));
+    if (!dfa->scan_bytecode())
+        return {};
+    return dfa;
+}
+
+LazyDFA::LazyDFA(const ByteCode& bytecode)
+    : m_bytecode(bytecode)
+{
+}
+
+bool LazyDFA::scan_bytecode()
+{
+    m_thread_at_instruction.resize(m_bytecode.size());
+
+    for (size_t instruction_position = 0; instruction_position < m_bytecode.size();) {
+        switch ((OpCodeId)m_bytecode[instruction_position]) {
+        case OpCodeId::Compare: {
+            auto arguments_count = m_bytecode[instruction_position + 1];
+            auto arguments_size = m_bytecode[instruction_position + 2];
+            auto next_instruction_position = instruction_position + 3 + arguments_size;
+
+            m_thread_at_instruction[instruction_position] = m_threads.size();
+            for (size_t i = 0, offset = instruction_position + 3; i < arguments_count; ++i) {
+                switch ((CharacterCompareType)m_bytecode[offset++]) {
+                case CharacterCompareType::Inverse:
+                case CharacterCompareType::TemporaryInverse:
+                case CharacterCompareType::AnyChar:
+                    break;
+                case CharacterCompareType::Char:
+                case CharacterCompareType::CharClass:
+                case CharacterCompareType::CharRange:
+                    ++offset;
+                    break;
+                case CharacterCompareType::String: {
+                    if (arguments_count != 1)
+                        return false;
+                    auto length = m_bytecode[offset];
+                    for (size_t string_index = 0; string_index < length; ++string_index)
+                        m_threads.append({ instruction_position, next_instruction_position, string_index, length, {} });
+                    offset += 1 + length;
+                    break;
+                }
+                default:
+                    // Backreferences depend on what the capture groups matched.
+                    return false;
+                }
+            }
+            // Everything but a String compare consumes a single character.
+            if (m_thread_at_instruction[instruction_position] == m_threads.size())
+                m_threads.append({ instruction_position, next_instruction_position, 0, 0, {} });
+
+            instruction_position = next_instruction_position;
+            break;
+        }
+        case OpCodeId::Jump:
+        case OpCodeId::ForkJump:
+        case OpCodeId::ForkStay:
+            instruction_position += 2;
+            break;
+        case OpCodeId::CheckBegin:
+            m_check_begin_position = instruction_position;
+            instruction_position += 1;
+            break;
+        case OpCodeId::CheckEnd:
+            m_check_end_position = instruction_position;
+            instruction_position += 1;
+            break;
+        case OpCodeId::SaveLeftCaptureGroup:
+        case OpCodeId::SaveRightCaptureGroup:
+            m_has_capture_groups = true;
+            instruction_position += 2;
+            break;
+        case OpCodeId::SaveLeftNamedCaptureGroup:
+        case OpCodeId::SaveRightNamedCaptureGroup:
+            m_has_capture_groups = true;
+            instruction_position += 3;
+            break;
+        default:
+            // Lookarounds (Save, Restore, GoBack, FailForks), word boundaries and explicit
+            // Exits need the backtracking VM.
+            return false;
+        }
+    }
+
+    m_can_pick_match = !has_empty_loop();
+
+    m_visited_instructions.resize(m_bytecode.size());
+    m_visited_instructions.span().fill(0);
+    m_visited_threads.resize(m_threads.size());
+    m_visited_threads.span().fill(0);
+    return true;
+}
+
+bool LazyDFA::has_empty_loop() const
+{
+    // A loop whose body can match the empty string, like (a*)* or (a|b?)+, lets the VM go
+    // around again without consuming anything, which add_closure() cuts short. Which match
+    // the VM ends up with then depends on how it unwinds those iterations, so the DFA only
+    // says whether there is a match for such patterns, and leaves picking it to the VM.
+    // This looks for a cycle in the instructions that don't consume anything.
+    enum : u8 {
+        Unvisited,
+        OnStack,
+        Done,
+    };
+    Vector<u8> marks;
+    marks.resize(m_bytecode.size());
+    marks.span().fill(Unvisited);
+
+    auto successors = [&](size_t position, Vector<size_t, 2>& out) {
+        out.clear_with_capacity();
+        switch ((OpCodeId)m_bytecode[position]) {
+        case OpCodeId::Compare:
+            break;
+        case OpCodeId::Jump:
+            out.append(position + 2 + m_bytecode[position + 1]);
+            break;
+        case OpCodeId::ForkJump:
+        case OpCodeId::ForkStay:
+            out.append(position + 2);
+            out.append(position + 2 + m_bytecode[position + 1]);
+            break;
+        case OpCodeId::CheckBegin:
+        case OpCodeId::CheckEnd:
+            out.append(position + 1);
+            break;
+        case OpCodeId::SaveLeftCaptureGroup:
+        case OpCodeId::SaveRightCaptureGroup:
+            out.append(position + 2);
+            break;
+        case OpCodeId::SaveLeftNamedCaptureGroup:
+        case OpCodeId::SaveRightNamedCaptureGroup:
+            out.append(position + 3);
+            break;
+        default:
+            ASSERT_NOT_REACHED();
+        }
+    };
+
+    struct Frame {
+        size_t position;
+        Vector<size_t, 2> successors;
+        size_t next { 0 };
+    };
+    Vector<Frame> stack;
+
+    // Every walk add_closure() does starts at the beginning or right after a Compare.
+    Vector<size_t> roots;
+    roots.append(0);
+    for (auto& thread : m_threads)
+        roots.append(thread.next_instruction_position);
+
+    for (auto root : roots) {
+        if (root >= m_bytecode.size() || marks[root] != Unvisited || (OpCodeId)m_bytecode[root] == OpCodeId::Compare)
+            continue;
+
+        stack.append({ root, {}, 0 });
+        successors(root, stack.last().successors);
+        marks[root] = OnStack;
+
+        while (!stack.is_empty()) {
+            auto& frame = stack.last();
+            if (frame.next == frame.successors.size()) {
+                marks[frame.position] = Done;
+                stack.take_last();
+                continue;
+            }
+            auto next = frame.successors[frame.next++];
+            if (next >= m_bytecode.size() || (OpCodeId)m_bytecode[next] == OpCodeId::Compare)
+                continue;
+            if (marks[next] == OnStack)
+                return true;
+            if (marks[next] == Done)
+                continue;
+            marks[next] = OnStack;
+            stack.append({ next, {}, 0 });
+            successors(next, stack.last().successors);
+        }
+    }
+
+    return false;
+}
+
+LazyDFA::ByteSet LazyDFA::compare_bytes(size_t instruction_position) const
+{
+    char character;
+
+    MatchInput input;
+    input.view = StringView { &character, 1 };
+    input.regex_options = m_options.value();
+
+    MatchOutput output;
+    output.operations = 0;
+
+    ByteSet bytes;
+    for (size_t byte = 0; byte < 256; ++byte) {
+        character = byte;
+        MatchState state;
+        state.instruction_position = instruction_position;
+        if (m_bytecode.get_opcode(state)->execute(input, state, output) == ExecutionResult::Continue)
+            bytes.set(byte);
+    }
+    return bytes;
+}
+
+bool LazyDFA::check_passes(size_t instruction_position, size_t string_position) const
+{
+    // The input is one character long, so string_position is either its start or its end.
+    char character = 0;
+
+    MatchInput input;
+    input.view = StringView { &character, 1 };
+    input.regex_options = m_options.value();
+
+    MatchState state;
+    state.string_position = string_position;
+    state.instruction_position = instruction_position;
+
+    MatchOutput output;
+    output.operations = 0;
+
+    return m_bytecode.get_opcode(state)->execute(input, state, output) == ExecutionResult::Continue;
+}
+
+void LazyDFA::set_options(AllOptions options)
+{
+    // Only these flags change what the opcodes handled here do.
+    AllOptions dfa_options;
+    for (auto flag : { AllFlags::Insensitive, AllFlags::Global, AllFlags::MatchNotBeginOfLine, AllFlags::MatchNotEndOfLine }) {
+        if (options.has_flag_set(flag))
+            dfa_options.set_flag(flag);
+    }
+
+    if (m_options.has_value() && m_options.value().value() == dfa_options.value())
+        return;
+    m_options = dfa_options;
+
+    // The opcodes are run on a single character, so their quirks carry over exactly.
+    // CheckBegin and CheckEnd only look at whether the position is the start or the end.
+    if (m_check_begin_position.has_value()) {
+        m_check_begin_passes[false] = check_passes(m_check_begin_position.value(), 1);
+        m_check_begin_passes[true] = check_passes(m_check_begin_position.value(), 0);
+    }
+    if (m_check_end_position.has_value()) {
+        m_check_end_passes[false] = check_passes(m_check_end_position.value(), 0);
+        m_check_end_passes[true] = check_passes(m_check_end_position.value(), 1);
+    }
+
+    // Repetitions like {1,64} copy the same Compare many times, so only the first copy of
+    // each one is run, and only distinct byte sets are used to find the byte classes.
+    HashMap<u32, size_t> first_thread_by_compare_hash;
+    Array<Optional<size_t>, 256> first_thread_by_character;
+    Vector<size_t> distinct_threads;
+    bool insensitive = dfa_options.has_flag_set(AllFlags::Insensitive);
+
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        auto& thread = m_threads[i];
+        if (thread.string_length) {
+            u8 expected = m_bytecode[thread.instruction_position + 5 + thread.string_index];
+            if (auto first_thread = first_thread_by_character[expected]; first_thread.has_value()) {
+                thread.bytes = m_threads[first_thread.value()].bytes;
+                continue;
+            }
+
+            // Mirrors OpCode_Compare::compare_string(), one character at a time.
+            auto to_ascii_lowercase = [](u8 ch) -> u8 { return ch >= 'A' && ch <= 'Z' ? ch | 0x20 : ch; };
+            thread.bytes = {};
+            for (size_t byte = 0; byte < 256; ++byte) {
+                if (byte == expected || (insensitive && to_ascii_lowercase(byte) == to_ascii_lowercase(expected)))
+                    thread.bytes.set(byte);
+            }
+            first_thread_by_character[expected] = i;
+            distinct_threads.append(i);
+            continue;
+        }
+
+        auto* compare = (const char*)&m_bytecode[thread.instruction_position];
+        auto compare_size = (thread.next_instruction_position - thread.instruction_position) * sizeof(ByteCodeValueType);
+        auto hash = string_hash(compare, compare_size);
+        if (auto it = first_thread_by_compare_hash.find(hash); it != first_thread_by_compare_hash.end()) {
+            auto& first_thread = m_threads[it->value];
+            auto first_compare_size = (first_thread.next_instruction_position - first_thread.instruction_position) * sizeof(ByteCodeValueType);
+            if (compare_size == first_compare_size && !memcmp(compare, &m_bytecode[first_thread.instruction_position], compare_size)) {
+                thread.bytes = first_thread.bytes;
+                continue;
+            }
+        }
+
+        thread.bytes = compare_bytes(thread.instruction_position);
+        first_thread_by_compare_hash.set(hash, i);
+        distinct_threads.append(i);
+    }
+
+    // Bytes that no thread tells apart share their transitions.
+    m_byte_classes.span().fill(0);
+    m_byte_class_count = 1;
+    for (auto thread_index : distinct_threads) {
+        auto& bytes = m_threads[thread_index].bytes;
+        Array<i16, 512> refined_classes;
+        refined_classes.span().fill(-1);
+        size_t refined_class_count = 0;
+        for (size_t byte = 0; byte < 256; ++byte) {
+            auto& refined_class = refined_classes[m_byte_classes[byte] * 2 + bytes.contains(byte)];
+            if (refined_class < 0)
+                refined_class = refined_class_count++;
+            m_byte_classes[byte] = refined_class;
+        }
+        m_byte_class_count = refined_class_count;
+    }
+
+    flush_states();
+}
+
+void LazyDFA::flush_states()
+{
+    m_states.clear();
+    m_state_ids.clear();
+    m_start_states.span().fill(-1);
+}
+
+bool LazyDFA::add_closure(size_t instruction_position, bool at_begin, bool at_end, Vector<u32>* threads)
+{
+    // Walks the instructions that don't consume anything in the order the backtracking VM
+    // would try them. Returns true once the end of the bytecode is reached, which makes
+    // everything not visited yet lower priority than that match.
+    m_stack.clear_with_capacity();
+    m_stack.append(instruction_position);
+
+    while (!m_stack.is_empty()) {
+        auto position = m_stack.take_last();
+        if (position >= m_bytecode.size())
+            return true;
+        if (m_visited_instructions[position] == m_generation)
+            continue;
+        m_visited_instructions[position] = m_generation;
+
+        switch ((OpCodeId)m_bytecode[position]) {
+        case OpCodeId::Compare: {
+            auto thread = m_thread_at_instruction[position];
+            if (threads && m_visited_threads[thread] != m_generation) {
+                m_visited_threads[thread] = m_generation;
+                threads->append(thread);
+            }
+            break;
+        }
+        case OpCodeId::Jump:
+            m_stack.append(position + 2 + m_bytecode[position + 1]);
+            break;
+        case OpCodeId::ForkJump:
+            m_stack.append(position + 2);
+            m_stack.append(position + 2 + m_bytecode[position + 1]);
+            break;
+        case OpCodeId::ForkStay:
+            m_stack.append(position + 2 + m_bytecode[position + 1]);
+            m_stack.append(position + 2);
+            break;
+        case OpCodeId::CheckBegin:
+            if (m_check_begin_passes[at_begin])
+                m_stack.append(position + 1);
+            break;
+        case OpCodeId::CheckEnd:
+            if (m_check_end_passes[at_end])
+                m_stack.append(position + 1);
+            break;
+        case OpCodeId::SaveLeftCaptureGroup:
+        case OpCodeId::SaveRightCaptureGroup:
+            m_stack.append(position + 2);
+            break;
+        case OpCodeId::SaveLeftNamedCaptureGroup:
+        case OpCodeId::SaveRightNamedCaptureGroup:
+            m_stack.append(position + 3);
+            break;
+        default:
+            ASSERT_NOT_REACHED();
+        }
+    }
+
+    return false;
+}
+
+u32 LazyDFA::add_state(const Vector<Seed>& seeds, bool at_begin)
+{
+    StateKey key;
+
+    ++m_generation;
+    for (auto& seed : seeds) {
+        if (seed.is_thread) {
+            if (m_visited_threads[seed.value] != m_generation) {
+                m_visited_threads[seed.value] = m_generation;
+                key.threads.append(seed.value);
+            }
+        } else if (add_closure(seed.value, at_begin, false, &key.threads)) {
+            key.is_match = true;
+            break;
+        }
+    }
+
+    // At the end of the input nothing can be consumed anymore, so only the CheckEnds change.
+    ++m_generation;
+    for (auto& seed : seeds) {
+        if (!seed.is_thread && add_closure(seed.value, at_begin, true, nullptr)) {
+            key.is_match_at_end = true;
+            break;
+        }
+    }
+
+    if (auto it = m_state_ids.find(key); it != m_state_ids.end())
+        return it->value;
+
+    if (m_states.size() >= c_max_dfa_states)
+        flush_states();
+
+    u32 id = m_states.size();
+    State state;
+    state.key = key;
+    state.transitions.resize(m_byte_class_count);
+    state.transitions.span().fill(-1);
+    m_states.append(move(state));
+    m_state_ids.set(move(key), id);
+    return id;
+}
+
+u32 LazyDFA::start_state(bool at_begin)
+{
+    if (m_start_states[at_begin] < 0) {
+        Vector<Seed> seeds;
+        seeds.append({ false, 0 });
+        m_start_states[at_begin] = add_state(seeds, at_begin);
+    }
+    return m_start_states[at_begin];
+}
+
+u32 LazyDFA::transition(u32 state, u8 byte)
+{
+    auto byte_class = m_byte_classes[byte];
+    if (auto next_state = m_states[state].transitions[byte_class]; next_state >= 0)
+        return next_state;
+
+    m_seeds.clear_with_capacity();
+    for (auto thread_index : m_states[state].key.threads) {
+        auto& thread = m_threads[thread_index];
+        if (!thread.bytes.contains(byte))
+            continue;
+        if (thread.string_index + 1 < thread.string_length)
+            m_seeds.append({ true, thread_index + 1 });
+        else
+            m_seeds.append({ false, thread.next_instruction_position });
+    }
+
+    auto states_before = m_states.size();
+    auto next_state = add_state(m_seeds, false);
+    // If the cache was flushed to make room, the old state is gone.
+    if (m_states.size() >= states_before)
+        m_states[state].transitions[byte_class] = next_state;
+    return next_state;
+}
+
+Optional<size_t> LazyDFA::match(const MatchInput& input, size_t start_position)
+{
+    set_options(input.regex_options);
+
+    auto view = input.view.u8view();
+    auto state = start_state(start_position == 0);
+    Optional<size_t> end_position;
+
+    for (size_t position = start_position;; ++position) {
+        auto& key = m_states[state].key;
+        if (position == view.length()) {
+            if (key.is_match_at_end)
+                end_position = position;
+            return end_position;
+        }
+
+        // Any thread still alive has a higher priority than the last match.
+        if (key.is_match)
+            end_position = position;
+        if (key.threads.is_empty())
+            return end_position;
+
+        state = transition(state, view[position]);
+    }
+}
+
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "RegexByteCode.h"
+#include "RegexMatch.h"
+#include "RegexOptions.h"
+
+#include <AK/Array.h>
+#include <AK/HashMap.h>
+#include <AK/OwnPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+
+namespace regex {
+
+static const constexpr size_t c_max_dfa_states = 4096;
+
+// A lazily built DFA over the bytecode of patterns that don't need the backtracking VM,
+// i.e. patterns without backreferences, lookarounds and word boundary checks.
+//
+// A DFA state is the priority ordered list of Compare instructions that are alive at the
+// current position, which is the set of threads of a Thompson NFA simulation. Threads are
+// kept in the order the backtracking VM would try them, and threads with a lower priority
+// than a successful match are dropped, so the DFA finds exactly the match the VM would.
+// The exception is loops whose body can match the empty string, see can_pick_match().
+// States and transitions are only built once the input actually needs them.
+//
+// Since match() fills in the state cache, a LazyDFA must not be used by several threads at
+// once. Matcher makes sure of that.
+class LazyDFA {
+public:
+    static OwnPtr<LazyDFA> try_create(const ByteCode&);
+
+    // Returns the end of the match that starts at start_position, if there is one.
+    Optional<size_t> match(const MatchInput&, size_t start_position);
+
+    bool has_capture_groups() const { return m_has_capture_groups; }
+
+    // Whether the end match() returns is the one the VM would pick. If not, match() still
+    // tells reliably whether there is a match at all.
+    bool can_pick_match() const { return m_can_pick_match; }
+
+private:
+    explicit LazyDFA(const ByteCode&);
+
+    struct ByteSet {
+        Array<u64, 4> bits {};
+
+        bool contains(u8 byte) const { return bits[byte / 64] & ((u64)1 << (byte % 64)); }
+        void set(u8 byte) { bits[byte / 64] |= (u64)1 << (byte % 64); }
+    };
+
+    // One input character that a thread can consume: a Compare instruction, or a single
+    // character of a String compare, which is split up so every thread consumes one byte.
+    struct Thread {
+        size_t instruction_position { 0 };
+        size_t next_instruction_position { 0 };
+        size_t string_index { 0 };
+        size_t string_length { 0 };
+        ByteSet bytes;
+    };
+
+    struct StateKey {
+        Vector<u32> threads;
+        bool is_match { false };
+        bool is_match_at_end { false };
+
+        bool operator==(const StateKey& other) const
+        {
+            return is_match == other.is_match && is_match_at_end == other.is_match_at_end && threads == other.threads;
+        }
+    };
+
+    struct StateKeyTraits : public GenericTraits<StateKey> {
+        static unsigned hash(const StateKey&);
+    };
+
+    struct State {
+        StateKey key;
+        Vector<i32> transitions;
+    };
+
+    struct Seed {
+        bool is_thread { false };
+        size_t value { 0 };
+    };
+
+    bool scan_bytecode();
+    bool has_empty_loop() const;
+    void set_options(AllOptions);
+    void flush_states();
+
+    u32 start_state(bool at_begin);
+    u32 transition(u32 state, u8 byte);
+    u32 add_state(const Vector<Seed>&, bool at_begin);
+    bool add_closure(size_t instruction_position, bool at_begin, bool at_end, Vector<u32>* threads);
+
+    ByteSet compare_bytes(size_t instruction_position) const;
+    bool check_passes(size_t instruction_position, size_t string_position) const;
+
+    const ByteCode& m_bytecode;
+    bool m_has_capture_groups { false };
+    bool m_can_pick_match { true };
+    Optional<size_t> m_check_begin_position;
+    Optional<size_t> m_check_end_position;
+
+    Vector<Thread> m_threads;
+    Vector<u32> m_thread_at_instruction;
+
+    Optional<AllOptions> m_options;
+    Array<bool, 2> m_check_begin_passes {};
+    Array<bool, 2> m_check_end_passes {};
+    Array<u8, 256> m_byte_classes {};
+    size_t m_byte_class_count { 0 };
+
+    Vector<State> m_states;
+    HashMap<StateKey, u32, StateKeyTraits> m_state_ids;
+    Array<i32, 2> m_start_states {};
+
+    u64 m_generation { 0 };
+    Vector<u64> m_visited_instructions;
+    Vector<u64> m_visited_threads;
+    Vector<size_t> m_stack;
+    Vector<Seed> m_seeds;
+};
+
+}
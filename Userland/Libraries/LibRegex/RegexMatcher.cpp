@@ -167,7 +167,7 @@ RegexResult Matcher<Parser>::match(const Vector<RegexStringView> views, Optional
             state.string_position = view_index;
             state.instruction_position = 0;
 
-            auto success = execute(input, state, temp_output, 0);
+            auto success = run(input, state, temp_output);
             // This success is acceptable only if it doesn't read anything from the input (input length is 0).
             if (state.string_position <= view_index) {
                 if (success.value()) {
@@ -198,7 +198,7 @@ RegexResult Matcher<Parser>::match(const Vector<RegexStringView> views, Optional
             state.string_position = view_index;
             state.instruction_position = 0;
 
-            auto success = execute(input, state, output, 0);
+            auto success = run(input, state, output);
             if (!success.has_value())
                 return { false, 0, {}, {}, {}, output.operations };
 
@@ -293,6 +293,31 @@ RegexResult Matcher<Parser>::match(const Vector<RegexStringView> views, Optional
     };
 }
 
+template<class Parser>
+Optional<bool> Matcher<Parser>::run(const MatchInput& input, MatchState& state, MatchOutput& output) const
+{
+    // The DFA finds the same match as the VM in linear time. The VM is then only needed
+    // to fill in the capture groups or to pick between matches the DFA can't tell apart,
+    // and only runs where a match is known to exist.
+    if (m_dfa && input.view.is_u8_view() && !m_dfa_in_use.exchange(true, AK::memory_order_acquire)) {
+        auto end_position = m_dfa->match(input, state.string_position);
+        m_dfa_in_use.store(false, AK::memory_order_release);
+
+        if (!end_position.has_value()) {
+            // Like a VM run that exhausted its forks, which stateful matches pick up as start_offset.
+            state.string_position = 0;
+            return false;
+        }
+
+        if (m_dfa->can_pick_match() && (!m_dfa->has_capture_groups() || input.regex_options.has_flag_set(AllFlags::SkipSubExprResults))) {
+            state.string_position = end_position.value();
+            return true;
+        }
+    }
+
+    return execute(input, state, output, 0);
+}
+
 template<class Parser>
 Optional<bool> Matcher<Parser>::execute(const MatchInput& input, MatchState& state, MatchOutput& output, size_t recursion_level) const
 {
@@ -27,10 +27,12 @@
 #pragma once
 
 #include "RegexByteCode.h"
+#include "RegexDFA.h"
 #include "RegexMatch.h"
 #include "RegexOptions.h"
 #include "RegexParser.h"
 
+#include <AK/Atomic.h>
 #include <AK/Forward.h>
 #include <AK/HashMap.h>
 #include <AK/NonnullOwnPtrVector.h>
@@ -67,6 +69,7 @@ public:
     Matcher(const Regex<Parser>& pattern, Optional<typename ParserTraits<Parser>::OptionsType> regex_options = {})
         : m_pattern(pattern)
         , m_regex_options(regex_options.value_or({}))
+        , m_dfa(LazyDFA::try_create(pattern.parser_result.bytecode))
     {
     }
     ~Matcher() = default;
@@ -80,11 +83,15 @@ public:
     }
 
 private:
+    Optional<bool> run(const MatchInput& input, MatchState& state, MatchOutput& output) const;
     Optional<bool> execute(const MatchInput& input, MatchState& state, MatchOutput& output, size_t recursion_level) const;
     ALWAYS_INLINE Optional<bool> execute_low_prio_forks(const MatchInput& input, MatchState& original_state, MatchOutput& output, Vector<MatchState> states, size_t recursion_level) const;
 
     const Regex<Parser>& m_pattern;
     const typename ParserTraits<Parser>::OptionsType m_regex_options;
+    // NOTE: This caches DFA states across calls, so only one thread uses it at a time. The others fall back to the VM.
+    mutable OwnPtr<LazyDFA> m_dfa;
+    mutable Atomic<bool> m_dfa_in_use { false };
 };
 
 template<class Parser>
@@ -544,11 +544,15 @@ ALWAYS_INLINE bool PosixExtendedParser::parse_sub_expression(ByteCode& stack, si
                 }
             }
 
+            // Groups are numbered by their opening parenthesis, so a nested group can't reuse its parent's id.
+            size_t capture_group_index = 0;
             if (!(m_parser_state.regex_options & AllFlags::SkipSubExprResults || prevent_capture_group)) {
-                if (capture_group_name.has_value())
+                if (capture_group_name.has_value()) {
                     bytecode.insert_bytecode_group_capture_left(capture_group_name.value());
-                else
-                    bytecode.insert_bytecode_group_capture_left(m_parser_state.capture_groups_count);
+                } else {
+                    capture_group_index = m_parser_state.capture_groups_count++;
+                    bytecode.insert_bytecode_group_capture_left(capture_group_index);
+                }
             }
 
             ByteCode capture_group_bytecode;
@@ -565,8 +569,7 @@ ALWAYS_INLINE bool PosixExtendedParser::parse_sub_expression(ByteCode& stack, si
                     bytecode.insert_bytecode_group_capture_right(capture_group_name.value());
                     ++m_parser_state.named_capture_groups_count;
                 } else {
-                    bytecode.insert_bytecode_group_capture_right(m_parser_state.capture_groups_count);
-                    ++m_parser_state.capture_groups_count;
+                    bytecode.insert_bytecode_group_capture_right(capture_group_index);
                 }
             }
             should_parse_repetition_symbol = true;
@@ -26,6 +26,7 @@
 
 #include <AK/TestSuite.h> // import first, to prevent warning of ASSERT* redefinition
 
+#include <AK/StringBuilder.h>
 #include <LibRegex/Regex.h>
 #include <stdio.h>
 
@@ -986,6 +987,35 @@ BENCHMARK_CASE(simple_notbol_noteol_benchmark_reference_stdcpp)
 }
 #    endif
 
+#    if defined(REGEX_BENCHMARK_OUR)
+BENCHMARK_CASE(nested_star_benchmark)
+{
+    Regex<PosixExtended> re("(a*)*b");
+    RegexResult m;
+    String haystack = String::repeated('a', 64);
+    for (size_t i = 0; i < BENCHMARK_LOOP_ITERATIONS / 100; ++i) {
+        EXPECT_EQ(re.search(haystack, m), false);
+    }
+}
+#    endif
+
+#    if defined(REGEX_BENCHMARK_OUR)
+BENCHMARK_CASE(large_haystack_search_benchmark)
+{
+    Regex<PosixExtended> re("[[:digit:]]+\\.[[:digit:]]+ (ms|s)");
+    RegexResult m;
+    StringBuilder builder;
+    for (size_t i = 0; i < 1000; ++i)
+        builder.append("The quick brown fox jumps over the lazy dog. ");
+    builder.append("Finished in 12.5 ms");
+    String haystack = builder.build();
+    for (size_t i = 0; i < BENCHMARK_LOOP_ITERATIONS / 100; ++i) {
+        EXPECT(re.search(haystack, m));
+        EXPECT_EQ(m.matches.at(0).view, "12.5 ms");
+    }
+}
+#    endif
+
 #endif
 
 TEST_MAIN(Regex)
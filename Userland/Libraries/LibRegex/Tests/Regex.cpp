@@ -441,6 +441,18 @@ TEST_CASE(named_capture_group)
     EXPECT_EQ(result.named_capture_group_matches.at(1).ensure("Test").view, "0");
 }
 
+TEST_CASE(nested_capture_groups)
+{
+    Regex<PosixExtended> re("(a(b(c)))d");
+    RegexResult result;
+
+    EXPECT_EQ(re.match("abcd", result), true);
+    EXPECT_EQ(result.capture_group_matches.at(0).size(), 3u);
+    EXPECT_EQ(result.capture_group_matches.at(0).at(0).view, "abc");
+    EXPECT_EQ(result.capture_group_matches.at(0).at(1).view, "bc");
+    EXPECT_EQ(result.capture_group_matches.at(0).at(2).view, "c");
+}
+
 TEST_CASE(a_star)
 {
     Regex<PosixExtended> re("a*");
@@ -472,6 +484,46 @@ TEST_CASE(simple_period_end_benchmark)
     EXPECT_EQ(re.search("hello?", m), true);
 }
 
+TEST_CASE(nested_star_does_not_backtrack)
+{
+    // These take exponential time for a backtracking matcher.
+    Regex<PosixExtended> re("(a*)*b");
+    RegexResult m;
+    String haystack = String::repeated('a', 5000);
+    EXPECT_EQ(re.search(haystack, m), false);
+    EXPECT_EQ(re.match(haystack, m), false);
+    EXPECT_EQ(re.search(String::formatted("{}b", haystack), m), true);
+    EXPECT_EQ(m.matches.at(0).view.length(), 5001u);
+
+    Regex<PosixExtended> alternation("(a|a)*b");
+    EXPECT_EQ(alternation.search(haystack, m), false);
+
+    Regex<PosixExtended> empty_loop("(a?)*b");
+    EXPECT_EQ(empty_loop.search(haystack, m), false);
+}
+
+TEST_CASE(search_reports_same_matches_as_backtracking)
+{
+    // The DFA has to pick the same alternative as the backtracking VM does.
+    Regex<PosixExtended> re("ab|abcd|c+");
+    RegexResult m;
+    EXPECT_EQ(re.search("xxabcdccc", m, PosixFlags::Global), true);
+    EXPECT_EQ(m.count, 2u);
+    EXPECT_EQ(m.matches.at(0).view, "abcd");
+    EXPECT_EQ(m.matches.at(0).column, 2u);
+    EXPECT_EQ(m.matches.at(1).view, "ccc");
+    EXPECT_EQ(m.matches.at(1).column, 6u);
+
+    // Loops that can match the empty string leave picking the match to the VM.
+    Regex<ECMA262> empty_loop("a*?(?:c+|b{1,2}a|a?)*", ECMAScriptFlags::Sticky);
+    EXPECT_EQ(empty_loop.search("xcbbab", m), true);
+    EXPECT_EQ(m.count, 4u);
+    EXPECT_EQ(m.matches.at(0).view, "");
+    EXPECT_EQ(m.matches.at(1).view, "c");
+    EXPECT_EQ(m.matches.at(2).view, "bba");
+    EXPECT_EQ(m.matches.at(3).view, "");
+}
+
 TEST_CASE(ECMA262_parse)
 {
     struct _test {
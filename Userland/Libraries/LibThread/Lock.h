@@ -31,6 +31,7 @@
 #    include <AK/Assertions.h>
 #    include <AK/Atomic.h>
 #    include <AK/Types.h>
+#    include <serenity.h>
 #    include <unistd.h>
 
 namespace LibThread {
@@ -44,6 +45,15 @@ public:
     void unlock();
 
 private:
+    enum : u32 {
+        Unlocked = 0,
+        LockedNoWaiters,
+        LockedWithWaiters,
+    };
+
+    void lock_slow(u32 state);
+
+    Atomic<u32> m_state { Unlocked };
     Atomic<pid_t> m_holder { 0 };
     u32 m_level { 0 };
 };
@@ -66,17 +76,34 @@ private:
 ALWAYS_INLINE void Lock::lock()
 {
     pid_t tid = gettid();
-    if (m_holder == tid) {
+    if (m_holder.load(AK::memory_order_relaxed) == tid) {
         ++m_level;
         return;
     }
-    for (;;) {
-        int expected = 0;
-        if (m_holder.compare_exchange_strong(expected, tid, AK::memory_order_acq_rel)) {
-            m_level = 1;
-            return;
+    u32 expected = Unlocked;
+    if (!m_state.compare_exchange_strong(expected, LockedNoWaiters, AK::memory_order_acquire))
+        lock_slow(expected);
+    m_holder.store(tid, AK::memory_order_relaxed);
+    m_level = 1;
+}
+
+inline void Lock::lock_slow(u32 state)
+{
+    // Spin briefly in case the holder is about to let go, then sleep on the
+    // futex. See pthread_mutex_lock() for the details of the state machine.
+    for (int i = 0; i < 100 && state == LockedNoWaiters; ++i) {
+        asm volatile("pause");
+        state = m_state.load(AK::memory_order_relaxed);
+        if (state == Unlocked) {
+            if (m_state.compare_exchange_strong(state, LockedNoWaiters, AK::memory_order_acquire))
+                return;
         }
-        donate(expected);
+    }
+    if (state != LockedWithWaiters)
+        state = m_state.exchange(LockedWithWaiters, AK::memory_order_acquire);
+    while (state != Unlocked) {
+        futex(const_cast<u32*>(m_state.ptr()), FUTEX_WAIT, LockedWithWaiters, nullptr, nullptr, 0);
+        state = m_state.exchange(LockedWithWaiters, AK::memory_order_acquire);
     }
 }
 
@@ -84,10 +111,14 @@ inline void Lock::unlock()
 {
     ASSERT(m_holder == gettid());
     ASSERT(m_level);
-    if (m_level == 1)
-        m_holder.store(0, AK::memory_order_release);
-    else
+    if (m_level > 1) {
         --m_level;
+        return;
+    }
+    m_level = 0;
+    m_holder.store(0, AK::memory_order_relaxed);
+    if (m_state.exchange(Unlocked, AK::memory_order_release) == LockedWithWaiters)
+        futex(const_cast<u32*>(m_state.ptr()), FUTEX_WAKE, 1, nullptr, nullptr, 0);
 }
 
 #    define LOCKER(lock) LibThread::Locker locker(lock)
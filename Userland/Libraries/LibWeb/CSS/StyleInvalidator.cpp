@@ -30,13 +30,14 @@
 
 namespace Web::CSS {
 
-StyleInvalidator::StyleInvalidator(DOM::Document& document)
-    : m_document(document)
+StyleInvalidator::StyleInvalidator(DOM::Element& element)
+    : m_element(element)
+    , m_document(element.document())
 {
     if (!m_document.should_invalidate_styles_on_attribute_changes())
         return;
     auto& style_resolver = m_document.style_resolver();
-    m_document.for_each_in_subtree_of_type<DOM::Element>([&](auto& element) {
+    for_each_affected_element([&](auto& element) {
         m_elements_and_matching_rules_before.set(&element, style_resolver.collect_matching_rules(element));
         return IterationDecision::Continue;
     });
@@ -47,23 +48,24 @@ StyleInvalidator::~StyleInvalidator()
     if (!m_document.should_invalidate_styles_on_attribute_changes())
         return;
     auto& style_resolver = m_document.style_resolver();
-    m_document.for_each_in_subtree_of_type<DOM::Element>([&](auto& element) {
+    for_each_affected_element([&](auto& element) {
         auto maybe_matching_rules_before = m_elements_and_matching_rules_before.get(&element);
         if (!maybe_matching_rules_before.has_value()) {
-            element.set_needs_style_update(true);
+            element.invalidate_style();
             return IterationDecision::Continue;
         }
         auto& matching_rules_before = maybe_matching_rules_before.value();
         auto matching_rules_after = style_resolver.collect_matching_rules(element);
         if (matching_rules_before.size() != matching_rules_after.size()) {
-            element.set_needs_style_update(true);
+            element.invalidate_style();
             return IterationDecision::Continue;
         }
         style_resolver.sort_matching_rules(matching_rules_before);
         style_resolver.sort_matching_rules(matching_rules_after);
         for (size_t i = 0; i < matching_rules_before.size(); ++i) {
             if (matching_rules_before[i].rule != matching_rules_after[i].rule) {
-                element.set_needs_style_update(true);
+                // Descendants inherit from this element, so they have to be restyled along with it.
+                element.invalidate_style();
                 break;
             }
         }
@@ -71,4 +73,15 @@ StyleInvalidator::~StyleInvalidator()
     });
 }
 
+template<typename Callback>
+void StyleInvalidator::for_each_affected_element(Callback callback)
+{
+    if (m_element.for_each_in_subtree_of_type<DOM::Element>(callback) == IterationDecision::Break)
+        return;
+    for (auto* sibling = m_element.next_element_sibling(); sibling; sibling = sibling->next_element_sibling()) {
+        if (sibling->for_each_in_subtree_of_type<DOM::Element>(callback) == IterationDecision::Break)
+            return;
+    }
+}
+
 }
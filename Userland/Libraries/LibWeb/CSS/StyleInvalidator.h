@@ -35,10 +35,16 @@ namespace Web::CSS {
 
 class StyleInvalidator {
 public:
-    explicit StyleInvalidator(DOM::Document&);
+    // Only the element itself, its following siblings and their descendants can be affected
+    // by an attribute change, so those are the only elements we look at.
+    explicit StyleInvalidator(DOM::Element&);
     ~StyleInvalidator();
 
 private:
+    template<typename Callback>
+    void for_each_affected_element(Callback);
+
+    DOM::Element& m_element;
     DOM::Document& m_document;
     HashMap<DOM::Element*, Vector<MatchingRule>> m_elements_and_matching_rules_before;
 };
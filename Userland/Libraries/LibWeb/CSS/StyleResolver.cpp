@@ -32,6 +32,7 @@
 #include <LibWeb/DOM/Document.h>
 #include <LibWeb/DOM/Element.h>
 #include <LibWeb/Dump.h>
+#include <LibWeb/HTML/AttributeNames.h>
 #include <ctype.h>
 #include <stdio.h>
 
@@ -79,9 +80,22 @@ void StyleResolver::for_each_stylesheet(Callback callback) const
     }
 }
 
-Vector<MatchingRule> StyleResolver::collect_matching_rules(const DOM::Element& element) const
+void StyleResolver::invalidate_rule_cache()
 {
-    Vector<MatchingRule> matching_rules;
+    m_rule_cache = nullptr;
+    clear_style_sharing_cache();
+}
+
+const StyleResolver::RuleCache& StyleResolver::rule_cache() const
+{
+    if (!m_rule_cache)
+        build_rule_cache();
+    return *m_rule_cache;
+}
+
+void StyleResolver::build_rule_cache() const
+{
+    m_rule_cache = make<RuleCache>();
 
     size_t style_sheet_index = 0;
     for_each_stylesheet([&](auto& sheet) {
@@ -89,20 +103,91 @@ Vector<MatchingRule> StyleResolver::collect_matching_rules(const DOM::Element& e
         for (auto& rule : sheet.rules()) {
             size_t selector_index = 0;
             for (auto& selector : rule.selectors()) {
-                if (SelectorEngine::matches(selector, element)) {
-                    matching_rules.append({ rule, style_sheet_index, rule_index, selector_index });
-                    break;
+                MatchingRule matching_rule { rule, style_sheet_index, rule_index, selector_index++ };
+
+                const Selector::SimpleSelector* id_selector = nullptr;
+                const Selector::SimpleSelector* class_selector = nullptr;
+                const Selector::SimpleSelector* tag_name_selector = nullptr;
+                bool can_match = true;
+                for (auto& simple_selector : selector.complex_selectors().last().compound_selector) {
+                    // FIXME: Pseudo-elements never match, so don't bother keeping them around until they do.
+                    if (simple_selector.pseudo_element != Selector::SimpleSelector::PseudoElement::None)
+                        can_match = false;
+                    if (simple_selector.type == Selector::SimpleSelector::Type::Id && !id_selector)
+                        id_selector = &simple_selector;
+                    else if (simple_selector.type == Selector::SimpleSelector::Type::Class && !class_selector)
+                        class_selector = &simple_selector;
+                    else if (simple_selector.type == Selector::SimpleSelector::Type::TagName && !tag_name_selector)
+                        tag_name_selector = &simple_selector;
                 }
-                ++selector_index;
+
+                if (!can_match)
+                    continue;
+                if (id_selector)
+                    m_rule_cache->rules_by_id.ensure(id_selector->value).append(move(matching_rule));
+                else if (class_selector)
+                    m_rule_cache->rules_by_class.ensure(class_selector->value).append(move(matching_rule));
+                else if (tag_name_selector)
+                    m_rule_cache->rules_by_tag_name.ensure(tag_name_selector->value).append(move(matching_rule));
+                else
+                    m_rule_cache->other_rules.append(move(matching_rule));
             }
             ++rule_index;
         }
         ++style_sheet_index;
     });
+}
+
+Vector<MatchingRule> StyleResolver::collect_candidate_rules(const DOM::Element& element) const
+{
+    auto& cache = rule_cache();
+    Vector<MatchingRule> candidate_rules;
+
+    auto add_candidates = [&](auto& rules) {
+        candidate_rules.append(rules.data(), rules.size());
+    };
+
+    auto id = element.attribute(HTML::AttributeNames::id);
+    if (!id.is_null()) {
+        if (auto it = cache.rules_by_id.find(id); it != cache.rules_by_id.end())
+            add_candidates(it->value);
+    }
+    for (auto& class_name : element.class_names()) {
+        if (auto it = cache.rules_by_class.find(class_name); it != cache.rules_by_class.end())
+            add_candidates(it->value);
+    }
+    if (auto it = cache.rules_by_tag_name.find(element.local_name()); it != cache.rules_by_tag_name.end())
+        add_candidates(it->value);
+    add_candidates(cache.other_rules);
+
+    // Put the candidates back into style sheet order, so that the first matching selector of each rule wins.
+    quick_sort(candidate_rules, [](auto& a, auto& b) {
+        if (a.style_sheet_index != b.style_sheet_index)
+            return a.style_sheet_index < b.style_sheet_index;
+        if (a.rule_index != b.rule_index)
+            return a.rule_index < b.rule_index;
+        return a.selector_index < b.selector_index;
+    });
+    return candidate_rules;
+}
 
+Vector<MatchingRule> StyleResolver::filter_matching_rules(const DOM::Element& element, const Vector<MatchingRule>& candidate_rules) const
+{
+    Vector<MatchingRule> matching_rules;
+    for (auto& candidate : candidate_rules) {
+        if (!matching_rules.is_empty() && matching_rules.last().rule == candidate.rule)
+            continue;
+        if (SelectorEngine::matches(candidate.rule->selectors()[candidate.selector_index], element))
+            matching_rules.append(candidate);
+    }
     return matching_rules;
 }
 
+Vector<MatchingRule> StyleResolver::collect_matching_rules(const DOM::Element& element) const
+{
+    return filter_matching_rules(element, collect_candidate_rules(element));
+}
+
 void StyleResolver::sort_matching_rules(Vector<MatchingRule>& matching_rules) const
 {
     quick_sort(matching_rules, [&](MatchingRule& a, MatchingRule& b) {
@@ -564,8 +649,106 @@ static void set_property_expanding_shorthands(StyleProperties& style, CSS::Prope
     style.set_property(property_id, value);
 }
 
+void StyleResolver::clear_style_sharing_cache() const
+{
+    m_style_sharing_parent = nullptr;
+    m_style_sharing_parent_style = nullptr;
+    m_style_sharing_candidates.clear();
+}
+
+static bool selector_prevents_style_sharing(const Selector& selector)
+{
+    // Siblings share all of their ancestors, so only the parts of a selector that look at the element
+    // itself or at its siblings can tell two siblings with the same tag name and attributes apart.
+    auto& last_complex_selector = selector.complex_selectors().last();
+    if (last_complex_selector.relation == Selector::ComplexSelector::Relation::AdjacentSibling
+        || last_complex_selector.relation == Selector::ComplexSelector::Relation::GeneralSibling)
+        return true;
+    for (auto& simple_selector : last_complex_selector.compound_selector) {
+        switch (simple_selector.pseudo_class) {
+        case Selector::SimpleSelector::PseudoClass::Hover:
+        case Selector::SimpleSelector::PseudoClass::Focus:
+        case Selector::SimpleSelector::PseudoClass::FirstChild:
+        case Selector::SimpleSelector::PseudoClass::LastChild:
+        case Selector::SimpleSelector::PseudoClass::OnlyChild:
+        case Selector::SimpleSelector::PseudoClass::Empty:
+            return true;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+bool StyleResolver::can_share_style(const DOM::Element& element, const Vector<MatchingRule>& candidate_rules) const
+{
+    if (element.inline_style() || !element.parent_element() || !element.parent_element()->specified_css_values())
+        return false;
+    for (auto& candidate : candidate_rules) {
+        if (selector_prevents_style_sharing(candidate.rule->selectors()[candidate.selector_index]))
+            return false;
+    }
+    return true;
+}
+
+static bool has_same_attributes(const DOM::Element& element, const Vector<Attribute>& attributes)
+{
+    size_t index = 0;
+    bool same = true;
+    element.for_each_attribute([&](auto& name, auto& value) {
+        if (!same)
+            return;
+        if (index >= attributes.size() || attributes[index].name() != name || attributes[index].value() != value)
+            same = false;
+        ++index;
+    });
+    return same && index == attributes.size();
+}
+
+RefPtr<StyleProperties> StyleResolver::find_shared_style(const DOM::Element& element) const
+{
+    auto* parent = element.parent_element();
+    if (parent != m_style_sharing_parent || m_style_sharing_parent_style != parent->specified_css_values()) {
+        clear_style_sharing_cache();
+        return nullptr;
+    }
+    for (auto& candidate : m_style_sharing_candidates) {
+        if (candidate.local_name == element.local_name() && candidate.namespace_ == element.namespace_() && has_same_attributes(element, candidate.attributes))
+            return candidate.style;
+    }
+    return nullptr;
+}
+
+void StyleResolver::add_style_sharing_candidate(const DOM::Element& element, NonnullRefPtr<StyleProperties> style) const
+{
+    static constexpr size_t max_style_sharing_candidates = 8;
+
+    auto* parent = element.parent_element();
+    if (parent != m_style_sharing_parent || m_style_sharing_parent_style != parent->specified_css_values()) {
+        clear_style_sharing_cache();
+        m_style_sharing_parent = parent;
+        m_style_sharing_parent_style = parent->specified_css_values();
+    }
+    if (m_style_sharing_candidates.size() == max_style_sharing_candidates)
+        m_style_sharing_candidates.take_first();
+
+    Vector<Attribute> attributes;
+    element.for_each_attribute([&](auto& name, auto& value) {
+        attributes.empend(name, value);
+    });
+    m_style_sharing_candidates.append({ element.local_name(), element.namespace_(), move(attributes), move(style) });
+}
+
 NonnullRefPtr<StyleProperties> StyleResolver::resolve_style(const DOM::Element& element) const
 {
+    auto candidate_rules = collect_candidate_rules(element);
+
+    bool can_share = can_share_style(element, candidate_rules);
+    if (can_share) {
+        if (auto shared_style = find_shared_style(element))
+            return shared_style.release_nonnull();
+    }
+
     auto style = StyleProperties::create();
 
     if (auto* parent_style = element.parent_element() ? element.parent_element()->specified_css_values() : nullptr) {
@@ -577,7 +760,7 @@ NonnullRefPtr<StyleProperties> StyleResolver::resolve_style(const DOM::Element&
 
     element.apply_presentational_hints(*style);
 
-    auto matching_rules = collect_matching_rules(element);
+    auto matching_rules = filter_matching_rules(element, candidate_rules);
     sort_matching_rules(matching_rules);
 
     for (auto& match : matching_rules) {
@@ -592,6 +775,9 @@ NonnullRefPtr<StyleProperties> StyleResolver::resolve_style(const DOM::Element&
         }
     }
 
+    if (can_share)
+        add_style_sharing_candidate(element, style);
+
     return style;
 }
 
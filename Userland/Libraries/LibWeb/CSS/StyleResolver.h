@@ -26,9 +26,12 @@
 
 #pragma once
 
+#include <AK/FlyString.h>
+#include <AK/HashMap.h>
 #include <AK/NonnullRefPtrVector.h>
 #include <AK/OwnPtr.h>
 #include <LibWeb/CSS/StyleProperties.h>
+#include <LibWeb/DOM/Attribute.h>
 #include <LibWeb/Forward.h>
 
 namespace Web::CSS {
@@ -53,13 +56,51 @@ public:
     Vector<MatchingRule> collect_matching_rules(const DOM::Element&) const;
     void sort_matching_rules(Vector<MatchingRule>&) const;
 
+    // Must be called whenever the set of style sheets that apply to the document changes.
+    void invalidate_rule_cache();
+
+    // Sibling elements may share their computed style within a single style update,
+    // this forgets the styles that have been handed out so far.
+    void clear_style_sharing_cache() const;
+
     static bool is_inherited_property(CSS::PropertyID);
 
 private:
     template<typename Callback>
     void for_each_stylesheet(Callback) const;
 
+    // Every selector of every rule is filed under the most specific part of its rightmost compound
+    // selector, so that only rules that can possibly match an element have to be looked at.
+    struct RuleCache {
+        HashMap<FlyString, Vector<MatchingRule>> rules_by_id;
+        HashMap<FlyString, Vector<MatchingRule>> rules_by_class;
+        HashMap<FlyString, Vector<MatchingRule>> rules_by_tag_name;
+        Vector<MatchingRule> other_rules;
+    };
+
+    const RuleCache& rule_cache() const;
+    void build_rule_cache() const;
+    Vector<MatchingRule> collect_candidate_rules(const DOM::Element&) const;
+    Vector<MatchingRule> filter_matching_rules(const DOM::Element&, const Vector<MatchingRule>& candidate_rules) const;
+
+    struct StyleSharingCandidate {
+        FlyString local_name;
+        FlyString namespace_;
+        Vector<Attribute> attributes;
+        NonnullRefPtr<StyleProperties> style;
+    };
+
+    bool can_share_style(const DOM::Element&, const Vector<MatchingRule>& candidate_rules) const;
+    RefPtr<StyleProperties> find_shared_style(const DOM::Element&) const;
+    void add_style_sharing_candidate(const DOM::Element&, NonnullRefPtr<StyleProperties>) const;
+
     DOM::Document& m_document;
+
+    mutable OwnPtr<RuleCache> m_rule_cache;
+
+    mutable const DOM::Element* m_style_sharing_parent { nullptr };
+    mutable RefPtr<const StyleProperties> m_style_sharing_parent_style;
+    mutable Vector<StyleSharingCandidate> m_style_sharing_candidates;
 };
 
 }
@@ -79,6 +79,10 @@ Document::Document(const URL& url)
         update_style();
     });
 
+    m_layout_update_timer = Core::Timer::create_single_shot(0, [this] {
+        update_layout();
+    });
+
     m_forced_layout_timer = Core::Timer::create_single_shot(0, [this] {
         force_layout();
     });
@@ -160,6 +164,13 @@ void Document::schedule_style_update()
     m_style_update_timer->start();
 }
 
+void Document::schedule_layout_update()
+{
+    if (m_layout_update_timer->is_active())
+        return;
+    m_layout_update_timer->start();
+}
+
 void Document::schedule_forced_layout()
 {
     if (m_forced_layout_timer->is_active())
@@ -365,6 +376,14 @@ URL Document::complete_url(const String& string) const
     return m_url.complete_url(string);
 }
 
+void Document::set_quirks_mode(QuirksMode mode)
+{
+    if (m_quirks_mode == mode)
+        return;
+    m_quirks_mode = mode;
+    style_resolver().invalidate_rule_cache();
+}
+
 void Document::invalidate_layout()
 {
     tear_down_layout_tree();
@@ -384,11 +403,17 @@ void Document::update_layout()
     if (!m_layout_root) {
         Layout::TreeBuilder tree_builder;
         m_layout_root = static_ptr_cast<Layout::InitialContainingBlockBox>(tree_builder.build(*this));
+        style_resolver().clear_style_sharing_cache();
     }
 
+    // Nothing has changed since the last layout pass.
+    if (!m_layout_root->needs_layout() && !m_layout_root->child_needs_layout())
+        return;
+
     Layout::BlockFormattingContext root_formatting_context(*m_layout_root, nullptr);
     root_formatting_context.run(*m_layout_root, Layout::LayoutMode::Default);
 
+    m_layout_root->clear_needs_layout_in_subtree();
     m_layout_root->set_needs_display();
 
     if (frame()->is_main_frame()) {
@@ -401,8 +426,13 @@ static void update_style_recursively(DOM::Node& node)
 {
     node.for_each_child([&](auto& child) {
         if (child.needs_style_update()) {
-            if (is<Element>(child))
+            if (is<Element>(child)) {
                 downcast<Element>(child).recompute_style();
+            } else if (is<Text>(child) && !child.layout_node() && node.layout_node()) {
+                // Text nodes don't have style of their own, but a newly inserted one still needs a layout node.
+                Layout::TreeBuilder tree_builder;
+                tree_builder.build(child);
+            }
             child.set_needs_style_update(false);
         }
         if (child.child_needs_style_update()) {
@@ -416,6 +446,7 @@ static void update_style_recursively(DOM::Node& node)
 void Document::update_style()
 {
     update_style_recursively(*this);
+    style_resolver().clear_style_sharing_cache();
     update_layout();
 }
 
@@ -471,6 +502,17 @@ void Document::set_hovered_node(Node* node)
     RefPtr<Node> old_hovered_node = move(m_hovered_node);
     m_hovered_node = node;
 
+    // Only the ancestors of the old and new hovered nodes below their common ancestor change their
+    // :hover state. Selectors can look down and sideways from those, but never out of the common ancestor.
+    if (old_hovered_node && node) {
+        for (auto* ancestor = old_hovered_node.ptr(); ancestor; ancestor = ancestor->parent()) {
+            if (ancestor == node || ancestor->is_ancestor_of(*node)) {
+                ancestor->invalidate_style();
+                return;
+            }
+        }
+    }
+
     invalidate_style();
 }
 
@@ -534,12 +576,25 @@ Color Document::visited_link_color() const
     return page()->palette().visited_link();
 }
 
-static JS::VM& main_thread_vm()
+JS::VM& Document::main_thread_vm()
 {
     static RefPtr<JS::VM> vm;
+    static RefPtr<Core::Timer> incremental_marking_timer;
     if (!vm) {
         vm = JS::VM::create();
         vm->set_should_log_exceptions(true);
+
+        // Get marking done between events, rather than in the middle of running scripts.
+        incremental_marking_timer = Core::Timer::construct(5, [] {
+            auto& heap = vm->heap();
+            heap.perform_incremental_marking_step(2);
+            if (!heap.is_incremental_marking_in_progress())
+                incremental_marking_timer->stop();
+        });
+        incremental_marking_timer->stop();
+        vm->heap().on_incremental_marking_start = [] {
+            incremental_marking_timer->start();
+        };
     }
     return *vm;
 }
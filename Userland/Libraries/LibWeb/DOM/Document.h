@@ -132,6 +132,7 @@ public:
     Layout::InitialContainingBlockBox* layout_node();
 
     void schedule_style_update();
+    void schedule_layout_update();
     void schedule_forced_layout();
 
     NonnullRefPtrVector<Element> get_elements_by_name(const String&) const;
@@ -142,6 +143,7 @@ public:
     void set_source(const String& source) { m_source = source; }
 
     virtual JS::Interpreter& interpreter() override;
+    static JS::VM& main_thread_vm();
 
     JS::Value run_javascript(const StringView&);
 
@@ -162,7 +164,7 @@ public:
 
     QuirksMode mode() const { return m_quirks_mode; }
     bool in_quirks_mode() const { return m_quirks_mode == QuirksMode::Yes; }
-    void set_quirks_mode(QuirksMode mode) { m_quirks_mode = mode; }
+    void set_quirks_mode(QuirksMode);
 
     void adopt_node(Node&);
 
@@ -263,6 +265,7 @@ private:
     Optional<Color> m_visited_link_color;
 
     RefPtr<Core::Timer> m_style_update_timer;
+    RefPtr<Core::Timer> m_layout_update_timer;
     RefPtr<Core::Timer> m_forced_layout_timer;
 
     String m_source;
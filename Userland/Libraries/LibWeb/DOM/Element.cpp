@@ -85,7 +85,7 @@ String Element::attribute(const FlyString& name) const
 
 void Element::set_attribute(const FlyString& name, const String& value)
 {
-    CSS::StyleInvalidator style_invalidator(document());
+    CSS::StyleInvalidator style_invalidator(*this);
 
     if (auto* attribute = find_attribute(name))
         attribute->set_value(value);
@@ -97,7 +97,7 @@ void Element::set_attribute(const FlyString& name, const String& value)
 
 void Element::remove_attribute(const FlyString& name)
 {
-    CSS::StyleInvalidator style_invalidator(document());
+    CSS::StyleInvalidator style_invalidator(*this);
 
     m_attributes.remove_first_matching([&](auto& attribute) { return attribute.name() == name; });
 }
@@ -171,26 +171,41 @@ enum class StyleDifference {
     None,
     NeedsRepaint,
     NeedsRelayout,
+    NeedsLayoutTreeRebuild,
 };
 
+static bool only_paint_properties_differ(const CSS::StyleProperties& a, const CSS::StyleProperties& b)
+{
+    bool only_paint_properties = true;
+    a.for_each_property([&](auto property_id, auto& value) {
+        if (!only_paint_properties || property_id == CSS::PropertyID::Color || property_id == CSS::PropertyID::BackgroundColor)
+            return;
+        auto other_value = b.property(property_id);
+        if (!other_value.has_value() || other_value.value()->type() != value.type() || *other_value.value() != value)
+            only_paint_properties = false;
+    });
+    return only_paint_properties;
+}
+
 static StyleDifference compute_style_difference(const CSS::StyleProperties& old_style, const CSS::StyleProperties& new_style, const Document& document)
 {
     if (old_style == new_style)
         return StyleDifference::None;
 
-    bool needs_repaint = false;
-    bool needs_relayout = false;
-
+    // The display type decides which kind of layout node we get, so we need a new one.
     if (new_style.display() != old_style.display())
-        needs_relayout = true;
+        return StyleDifference::NeedsLayoutTreeRebuild;
+
+    if (!only_paint_properties_differ(old_style, new_style) || !only_paint_properties_differ(new_style, old_style))
+        return StyleDifference::NeedsRelayout;
+
+    bool needs_repaint = false;
 
     if (new_style.color_or_fallback(CSS::PropertyID::Color, document, Color::Black) != old_style.color_or_fallback(CSS::PropertyID::Color, document, Color::Black))
         needs_repaint = true;
     else if (new_style.color_or_fallback(CSS::PropertyID::BackgroundColor, document, Color::Black) != old_style.color_or_fallback(CSS::PropertyID::BackgroundColor, document, Color::Black))
         needs_repaint = true;
 
-    if (needs_relayout)
-        return StyleDifference::NeedsRelayout;
     if (needs_repaint)
         return StyleDifference::NeedsRepaint;
     return StyleDifference::None;
@@ -216,16 +231,21 @@ void Element::recompute_style()
     if (is<Layout::WidgetBox>(layout_node()))
         return;
 
-    auto diff = StyleDifference::NeedsRelayout;
+    auto diff = StyleDifference::NeedsLayoutTreeRebuild;
     if (old_specified_css_values)
         diff = compute_style_difference(*old_specified_css_values, *new_specified_css_values, document());
     if (diff == StyleDifference::None)
         return;
     layout_node()->apply_style(*new_specified_css_values);
-    if (diff == StyleDifference::NeedsRelayout) {
+    if (diff == StyleDifference::NeedsLayoutTreeRebuild) {
         document().schedule_forced_layout();
         return;
     }
+    if (diff == StyleDifference::NeedsRelayout) {
+        layout_node()->set_needs_layout();
+        document().schedule_layout_update();
+        return;
+    }
     if (diff == StyleDifference::NeedsRepaint) {
         layout_node()->set_needs_display();
     }
@@ -268,7 +288,6 @@ void Element::set_inner_html(StringView markup)
     }
 
     set_needs_style_update(true);
-    document().invalidate_layout();
 }
 
 String Element::inner_html() const
@@ -102,7 +102,6 @@ void Node::set_text_content(const String& content)
     }
 
     set_needs_style_update(true);
-    document().invalidate_layout();
 }
 
 RefPtr<Layout::Node> Node::create_layout_node()
@@ -260,4 +259,11 @@ void Node::inserted_into(Node&)
     set_needs_style_update(true);
 }
 
+void Node::removed_from(Node&)
+{
+    // We're no longer part of the rendered document, so take our part of the layout tree with us.
+    if (auto* layout_node = this->layout_node(); layout_node && layout_node->parent())
+        layout_node->parent()->remove_child(*layout_node);
+}
+
 }
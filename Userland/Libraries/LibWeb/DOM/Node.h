@@ -119,7 +119,7 @@ public:
     const Element* parent_element() const;
 
     virtual void inserted_into(Node&);
-    virtual void removed_from(Node&) { }
+    virtual void removed_from(Node&);
     virtual void children_changed() { }
 
     const Layout::Node* layout_node() const { return m_layout_node; }
@@ -106,7 +106,6 @@ void HTMLElement::set_inner_text(StringView text)
     append_child(document().create_text_node(text));
 
     set_needs_style_update(true);
-    document().invalidate_layout();
 }
 
 String HTMLElement::inner_text()
@@ -114,7 +113,7 @@ String HTMLElement::inner_text()
     StringBuilder builder;
 
     // innerText for element being rendered takes visibility into account, so force a layout and then walk the layout tree.
-    document().update_layout();
+    document().update_style();
     if (!layout_node())
         return text_content();
 
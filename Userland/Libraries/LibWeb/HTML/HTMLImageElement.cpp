@@ -41,12 +41,16 @@ HTMLImageElement::HTMLImageElement(DOM::Document& document, const QualifiedName&
     : HTMLElement(document, qualified_name)
 {
     m_image_loader.on_load = [this] {
+        if (layout_node())
+            layout_node()->set_needs_layout();
         this->document().update_layout();
         dispatch_event(DOM::Event::create(EventNames::load));
     };
 
     m_image_loader.on_fail = [this] {
         dbgln("HTMLImageElement: Resource did fail: {}", src());
+        if (layout_node())
+            layout_node()->set_needs_layout();
         this->document().update_layout();
         dispatch_event(DOM::Event::create(EventNames::error));
     };
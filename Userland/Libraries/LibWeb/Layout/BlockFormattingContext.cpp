@@ -327,19 +327,32 @@ void BlockFormattingContext::layout_block_level_children(Box& box, LayoutMode la
             return IterationDecision::Continue;
         }
 
-        compute_width(child_box);
-        layout_inside(child_box, layout_mode);
-        compute_height(child_box);
-
-        if (is<ReplacedBox>(child_box))
-            place_block_level_replaced_element_in_normal_flow(child_box, box);
-        else if (is<BlockBox>(child_box))
+        if (layout_mode == LayoutMode::Default && can_reuse_layout_of(child_box)) {
+            // Nothing inside this box has changed, it only has to be moved into place.
             place_block_level_non_replaced_element_in_normal_flow(child_box, box);
-
-        // FIXME: This should be factored differently. It's uncool that we mutate the tree *during* layout!
-        //        Instead, we should generate the marker box during the tree build.
-        if (is<ListItemBox>(child_box))
-            downcast<ListItemBox>(child_box).layout_marker();
+        } else {
+            bool had_floating_boxes = has_floating_boxes();
+
+            compute_width(child_box);
+            layout_inside(child_box, layout_mode);
+            compute_height(child_box);
+
+            if (is<ReplacedBox>(child_box))
+                place_block_level_replaced_element_in_normal_flow(child_box, box);
+            else if (is<BlockBox>(child_box))
+                place_block_level_non_replaced_element_in_normal_flow(child_box, box);
+
+            // FIXME: This should be factored differently. It's uncool that we mutate the tree *during* layout!
+            //        Instead, we should generate the marker box during the tree build.
+            if (is<ListItemBox>(child_box))
+                downcast<ListItemBox>(child_box).layout_marker();
+
+            // Floats (ours or the ones inside this box) flow around block boxes, so their layout can't be reused.
+            if (layout_mode == LayoutMode::Default && is<BlockBox>(child_box) && !had_floating_boxes && !has_floating_boxes())
+                child_box.set_containing_block_width_for_reusable_layout(child_box.containing_block()->width());
+            else
+                child_box.set_containing_block_width_for_reusable_layout({});
+        }
 
         content_height = max(content_height, child_box.effective_offset().y() + child_box.height() + child_box.box_model().margin_box().bottom);
         content_width = max(content_width, downcast<Box>(child_box).width());
@@ -355,6 +368,20 @@ void BlockFormattingContext::layout_block_level_children(Box& box, LayoutMode la
     box.set_height(content_height);
 }
 
+bool BlockFormattingContext::can_reuse_layout_of(const Box& box) const
+{
+    if (box.needs_layout() || box.child_needs_layout() || has_floating_boxes())
+        return false;
+
+    // Percentage heights are resolved against the height of the containing block, which is only known after its children.
+    auto& computed_values = box.computed_values();
+    if (computed_values.height().is_percentage() || computed_values.max_height().is_percentage())
+        return false;
+
+    auto& width = box.containing_block_width_for_reusable_layout();
+    return width.has_value() && width.value() == box.containing_block()->width();
+}
+
 void BlockFormattingContext::place_block_level_replaced_element_in_normal_flow(Box& child_box, Box& containing_block)
 {
     ASSERT(!containing_block.is_absolutely_positioned());
@@ -66,6 +66,9 @@ private:
 
     void layout_floating_child(Box&, Box& containing_block);
 
+    bool has_floating_boxes() const { return !m_left_floating_boxes.is_empty() || !m_right_floating_boxes.is_empty(); }
+    bool can_reuse_layout_of(const Box&) const;
+
     Vector<Box*> m_left_floating_boxes;
     Vector<Box*> m_right_floating_boxes;
 };
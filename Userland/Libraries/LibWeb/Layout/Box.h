@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/Optional.h>
 #include <AK/OwnPtr.h>
 #include <LibGfx/Rect.h>
 #include <LibWeb/Layout/LineBox.h>
@@ -119,6 +120,11 @@ public:
 
     virtual float width_of_logical_containing_block() const;
 
+    // The width of the containing block when this box was last laid out in the normal flow of a block
+    // formatting context, if nothing around it could have influenced that layout.
+    const Optional<float>& containing_block_width_for_reusable_layout() const { return m_containing_block_width_for_reusable_layout; }
+    void set_containing_block_width_for_reusable_layout(Optional<float> width) { m_containing_block_width_for_reusable_layout = width; }
+
 protected:
     Box(DOM::Document& document, DOM::Node* node, NonnullRefPtr<CSS::StyleProperties> style)
         : NodeWithStyleAndBoxModelMetrics(document, node, move(style))
@@ -144,6 +150,8 @@ private:
     WeakPtr<LineBoxFragment> m_containing_line_box_fragment;
 
     OwnPtr<StackingContext> m_stacking_context;
+
+    Optional<float> m_containing_block_width_for_reusable_layout;
 };
 
 template<>
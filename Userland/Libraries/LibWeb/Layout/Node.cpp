@@ -158,6 +158,24 @@ void Node::set_needs_display()
     }
 }
 
+void Node::set_needs_layout()
+{
+    m_needs_layout = true;
+    for (auto* ancestor = parent(); ancestor && !ancestor->m_child_needs_layout; ancestor = ancestor->parent())
+        ancestor->m_child_needs_layout = true;
+}
+
+void Node::clear_needs_layout_in_subtree()
+{
+    m_needs_layout = false;
+    if (!m_child_needs_layout)
+        return;
+    m_child_needs_layout = false;
+    for_each_child([](auto& child) {
+        child.clear_needs_layout_in_subtree();
+    });
+}
+
 Gfx::FloatPoint Node::box_type_agnostic_position() const
 {
     if (is<Box>(*this))
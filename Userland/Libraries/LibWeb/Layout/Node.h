@@ -139,9 +139,16 @@ public:
     NodeWithStyle* parent();
     const NodeWithStyle* parent() const;
 
-    void inserted_into(Node&) { }
+    void inserted_into(Node&) { set_needs_layout(); }
     void removed_from(Node&) { }
-    void children_changed() { }
+    void children_changed() { set_needs_layout(); }
+
+    // A node that needs layout has changed since the last layout pass, and so have all nodes
+    // below an ancestor whose child_needs_layout() is set. Everything else can keep its geometry.
+    bool needs_layout() const { return m_needs_layout; }
+    bool child_needs_layout() const { return m_child_needs_layout; }
+    void set_needs_layout();
+    void clear_needs_layout_in_subtree();
 
     virtual void split_into_lines(InlineFormattingContext&, LayoutMode);
 
@@ -198,6 +205,8 @@ private:
     bool m_has_style { false };
     bool m_visible { true };
     bool m_children_are_inline { false };
+    bool m_needs_layout { true };
+    bool m_child_needs_layout { false };
     SelectionState m_selection_state { SelectionState::None };
 };
 
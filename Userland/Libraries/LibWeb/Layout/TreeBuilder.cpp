@@ -89,6 +89,27 @@ static Layout::Node& insertion_parent_for_block_node(Layout::Node& layout_parent
     return layout_parent;
 }
 
+static Layout::Node* next_sibling_in_layout_parent(DOM::Node& dom_node, Layout::Node& layout_parent)
+{
+    for (auto* sibling = dom_node.next_sibling(); sibling; sibling = sibling->next_sibling()) {
+        if (auto* layout_node = sibling->layout_node(); layout_node && layout_node->parent() == &layout_parent)
+            return layout_node;
+    }
+    return nullptr;
+}
+
+void TreeBuilder::insert_node_into_parent(DOM::Node& dom_node, Layout::Node& layout_parent, Layout::Node& layout_node)
+{
+    // When building part of an existing tree, the new node goes in front of the layout node of its next DOM sibling.
+    if (&dom_node == m_partial_build_root) {
+        if (auto* next_sibling = next_sibling_in_layout_parent(dom_node, layout_parent)) {
+            layout_parent.insert_before(layout_node, *next_sibling);
+            return;
+        }
+    }
+    layout_parent.append_child(layout_node);
+}
+
 void TreeBuilder::create_layout_tree(DOM::Node& dom_node)
 {
     // If the parent doesn't have a layout node, we don't need one either.
@@ -105,7 +126,7 @@ void TreeBuilder::create_layout_tree(DOM::Node& dom_node)
         if (layout_node->is_inline()) {
             // Inlines can be inserted into the nearest ancestor.
             auto& insertion_point = insertion_parent_for_inline_node(*m_parent_stack.last());
-            insertion_point.append_child(*layout_node);
+            insert_node_into_parent(dom_node, insertion_point, *layout_node);
             insertion_point.set_children_are_inline(true);
         } else {
             // Non-inlines can't be inserted into an inline parent, so find the nearest non-inline ancestor.
@@ -117,7 +138,7 @@ void TreeBuilder::create_layout_tree(DOM::Node& dom_node)
                 ASSERT_NOT_REACHED();
             }();
             auto& insertion_point = insertion_parent_for_block_node(nearest_non_inline_ancestor, *layout_node);
-            insertion_point.append_child(*layout_node);
+            insert_node_into_parent(dom_node, insertion_point, *layout_node);
             insertion_point.set_children_are_inline(false);
         }
     }
@@ -137,6 +158,7 @@ RefPtr<Node> TreeBuilder::build(DOM::Node& dom_node)
         // We're building a partial layout tree, so start by building up the stack of parent layout nodes.
         for (auto* ancestor = dom_node.parent()->layout_node(); ancestor; ancestor = ancestor->parent())
             m_parent_stack.prepend(downcast<NodeWithStyle>(ancestor));
+        m_partial_build_root = &dom_node;
     }
 
     create_layout_tree(dom_node);
@@ -40,6 +40,7 @@ public:
 
 private:
     void create_layout_tree(DOM::Node&);
+    void insert_node_into_parent(DOM::Node&, Layout::Node& layout_parent, Layout::Node& layout_node);
 
     void push_parent(Layout::NodeWithStyle& node) { m_parent_stack.append(&node); }
     void pop_parent() { m_parent_stack.take_last(); }
@@ -54,6 +55,7 @@ private:
 
     RefPtr<Layout::Node> m_layout_root;
     Vector<Layout::NodeWithStyle*> m_parent_stack;
+    DOM::Node* m_partial_build_root { nullptr };
 };
 
 }
@@ -92,9 +92,8 @@ void EditEventHandler::handle_delete(DOM::Range& range)
         start->parent()->remove_child(*end);
     }
 
-    // FIXME: When nodes are removed from the DOM, the associated layout nodes become stale and still
-    //        remain in the layout tree. This has to be fixed, this just causes everything to be recomputed
-    //        which really hurts performance.
+    // FIXME: Nodes that were moved around above only get their layout nodes back on the next style update,
+    //        so this rebuilds the whole layout tree for now.
     m_frame.document()->force_layout();
 
     m_frame.did_edit({});
@@ -114,10 +113,7 @@ void EditEventHandler::handle_insert(DOM::Position position, u32 code_point)
         node.invalidate_style();
     }
 
-    // FIXME: When nodes are removed from the DOM, the associated layout nodes become stale and still
-    //        remain in the layout tree. This has to be fixed, this just causes everything to be recomputed
-    //        which really hurts performance.
-    m_frame.document()->force_layout();
+    m_frame.document()->update_layout();
 
     m_frame.did_edit({});
 }
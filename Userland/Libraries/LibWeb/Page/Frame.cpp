@@ -110,8 +110,16 @@ void Frame::set_size(const Gfx::IntSize& size)
     if (m_size == size)
         return;
     m_size = size;
-    if (m_document)
+    if (m_document) {
+        // Viewport-relative lengths may resolve differently anywhere in the tree.
+        if (auto* layout_root = m_document->layout_node()) {
+            layout_root->for_each_in_subtree([](auto& layout_node) {
+                layout_node.set_needs_layout();
+                return IterationDecision::Continue;
+            });
+        }
         m_document->update_layout();
+    }
 }
 
 void Frame::set_viewport_scroll_offset(const Gfx::IntPoint& offset)
@@ -167,8 +175,7 @@ void Frame::scroll_to_anchor(const String& fragment)
         }
     }
 
-    // FIXME: This is overly aggressive and should be something more like a "update_layout_if_needed()"
-    document()->force_layout();
+    document()->update_layout();
 
     if (!element || !element->layout_node())
         return;
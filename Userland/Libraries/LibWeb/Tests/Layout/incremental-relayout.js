@@ -0,0 +1,38 @@
+loadPage("file:///res/html/misc/blank.html");
+
+afterInitialPageLoad(() => {
+    test("Relayout after repeated mutations of a large document", () => {
+        const paragraphs = [];
+        for (let i = 0; i < 2000; ++i) {
+            const p = document.createElement("p");
+            p.appendChild(document.createTextNode("Paragraph " + i));
+            document.body.appendChild(p);
+            paragraphs.push(p);
+        }
+        libweb_tester.updateLayout();
+
+        for (let i = 0; i < 500; ++i) {
+            const p = paragraphs[(i * 7) % paragraphs.length];
+            p.setAttribute("style", "width: " + (100 + (i % 50)) + "px");
+            // Long enough to wrap at some of the widths above, so the paragraph's height changes too.
+            p.firstChild.data = "Mutated " + i + " and then some more words to wrap";
+            libweb_tester.updateLayout();
+        }
+
+        expect(paragraphs[0].innerText).toBe("Mutated 0 and then some more words to wrap");
+        expect(paragraphs[1].innerText).toBe("Paragraph 1");
+        expect(paragraphs[1999].innerText).toBe("Paragraph 1999");
+
+        const incrementalRects = paragraphs.map(p => libweb_tester.layoutRect(p));
+        const incrementalBodyRect = libweb_tester.layoutRect(document.body);
+
+        libweb_tester.forceLayout();
+
+        expect(libweb_tester.layoutRect(document.body)).toEqual(incrementalBodyRect);
+        for (let i = 0; i < paragraphs.length; ++i) {
+            const rect = libweb_tester.layoutRect(paragraphs[i]);
+            expect(rect).not.toBeNull();
+            expect(rect).toEqual(incrementalRects[i]);
+        }
+    });
+});
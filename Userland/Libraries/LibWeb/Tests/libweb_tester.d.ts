@@ -6,6 +6,22 @@ interface LibwebTester {
      * @param url Page to load.
      */
     changePage(url: string): void;
+
+    /**
+     * Runs any pending style and layout updates on the current page right away.
+     */
+    updateLayout(): void;
+
+    /**
+     * Throws away the layout tree of the current page and lays it out again from scratch.
+     */
+    forceLayout(): void;
+
+    /**
+     * Returns the absolute rect of a node's layout box, or null if the node has no box.
+     * @param node Node whose box to look at.
+     */
+    layoutRect(node: Node): { x: number; y: number; width: number; height: number } | null;
 }
 
 interface Window {
@@ -24,13 +24,22 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <LibCore/ArgsParser.h>
 #include <LibCore/EventLoop.h>
 #include <LibCore/LocalServer.h>
 #include <LibIPC/ClientConnection.h>
+#include <LibJS/Runtime/VM.h>
+#include <LibWeb/DOM/Document.h>
 #include <WebContent/ClientConnection.h>
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+    bool run_bytecode = false;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(run_bytecode, "Run JavaScript with the bytecode interpreter", "bytecode", 'b');
+    args_parser.parse(argc, argv);
+
     Core::EventLoop event_loop;
     if (pledge("stdio recvfd sendfd accept unix rpath", nullptr) < 0) {
         perror("pledge");
@@ -53,6 +62,8 @@ int main(int, char**)
         return 1;
     }
 
+    Web::DOM::Document::main_thread_vm().set_bytecode_enabled(run_bytecode);
+
     auto socket = Core::LocalSocket::take_over_accepted_socket_from_system_server();
     ASSERT(socket);
     IPC::new_client_connection<WebContent::ClientConnection>(socket.release_nonnull(), 1);
@@ -34,14 +34,23 @@
 #include <LibCore/DirIterator.h>
 #include <LibCore/File.h>
 #include <LibCore/MimeData.h>
+#include <LibCore/Notifier.h>
 #include <LibHTTP/HttpRequest.h>
+#include <errno.h>
 #include <stdio.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 namespace WebServer {
 
+// Connections that sit idle for this long between requests get closed.
+static constexpr int keep_alive_timeout_ms = 15000;
+static constexpr size_t max_request_size = 64 * KiB;
+// How much of a file we hand to the kernel per sendfile() call.
+static constexpr size_t file_chunk_size = 64 * KiB;
+
 Client::Client(NonnullRefPtr<Core::TCPSocket> socket, const String& root, Core::Object* parent)
     : Core::Object(parent)
     , m_socket(socket)
@@ -51,38 +60,123 @@ Client::Client(NonnullRefPtr<Core::TCPSocket> socket, const String& root, Core::
 
 void Client::die()
 {
-    remove_from_parent();
+    if (m_dead)
+        return;
+    m_dead = true;
+    m_socket->on_ready_to_read = nullptr;
+    if (m_write_notifier)
+        m_write_notifier->set_enabled(false);
+    if (m_idle_timer)
+        m_idle_timer->stop();
+    // We may be deep inside one of our own callbacks, so don't go away just yet.
+    deferred_invoke([](auto& object) {
+        object.remove_from_parent();
+    });
 }
 
 void Client::start()
 {
+    m_socket->set_blocking(false);
+
+    m_write_notifier = Core::Notifier::construct(m_socket->fd(), Core::Notifier::Event::Write, this);
+    m_write_notifier->set_enabled(false);
+    m_write_notifier->on_ready_to_write = [this] {
+        send_pending_output();
+    };
+
+    m_idle_timer = Core::Timer::create_single_shot(
+        keep_alive_timeout_ms, [this] {
+            if (!m_response_in_progress)
+                die();
+        },
+        this);
+    m_idle_timer->start();
+
     m_socket->on_ready_to_read = [this] {
-        auto raw_request = m_socket->read_all();
-        if (raw_request.is_null()) {
+        did_receive_data();
+    };
+}
+
+void Client::did_receive_data()
+{
+    for (;;) {
+        u8 buffer[4096];
+        ssize_t nread = read(m_socket->fd(), buffer, sizeof(buffer));
+        if (nread < 0) {
+            if (errno == EAGAIN)
+                break;
+            perror("read");
             die();
             return;
         }
+        if (nread == 0) {
+            // The peer is done sending requests, but it may still be waiting
+            // for responses to the ones it already sent.
+            m_peer_closed = true;
+            m_socket->on_ready_to_read = nullptr;
+            // The socket stays readable at EOF, so stop watching it, or it keeps waking us up.
+            if (auto* notifier = m_socket->read_notifier())
+                notifier->set_enabled(false);
+            break;
+        }
+        m_request_buffer.append(buffer, nread);
+    }
+
+    if (m_request_buffer.size() > max_request_size) {
+        die();
+        return;
+    }
+
+    handle_buffered_requests();
+    if (m_peer_closed && !m_response_in_progress)
+        die();
+}
+
+void Client::handle_buffered_requests()
+{
+    while (!m_dead && !m_response_in_progress) {
+        StringView buffered { m_request_buffer.data(), m_request_buffer.size() };
+        auto end_of_headers = buffered.find("\r\n\r\n");
+        if (!end_of_headers.has_value())
+            return;
+        size_t request_size = end_of_headers.value() + 4;
+
+        auto raw_request = m_request_buffer.slice(0, request_size);
+        m_request_buffer = m_request_buffer.slice(request_size, m_request_buffer.size() - request_size);
 
         dbg() << "Got raw request: '" << String::copy(raw_request) << "'";
 
+        m_idle_timer->stop();
         handle_request(raw_request.bytes());
-        die();
-    };
+    }
 }
 
 void Client::handle_request(ReadonlyBytes raw_request)
 {
     auto request_or_error = HTTP::HttpRequest::from_raw_request(raw_request);
-    if (!request_or_error.has_value())
+    if (!request_or_error.has_value()) {
+        die();
         return;
+    }
     auto& request = request_or_error.value();
 
     dbg() << "Got HTTP request: " << request.method_name() << " " << request.resource();
+
+    // HTTP/1.1 connections are persistent unless the client asks otherwise, older ones only if asked to be.
+    m_keep_alive = request.protocol() == "HTTP/1.1";
     for (auto& header : request.headers()) {
         dbg() << "    " << header.name << " => " << header.value;
+        if (header.name.equals_ignoring_case("Connection")) {
+            if (header.value.equals_ignoring_case("close"))
+                m_keep_alive = false;
+            else if (header.value.equals_ignoring_case("keep-alive"))
+                m_keep_alive = true;
+        }
     }
 
     if (request.method() != HTTP::HttpRequest::Method::GET) {
+        // We don't read request bodies, so we can't tell where the next request would start.
+        m_keep_alive = false;
         send_error_response(403, "Forbidden!", request);
         return;
     }
@@ -125,35 +219,187 @@ void Client::handle_request(ReadonlyBytes raw_request)
         return;
     }
 
-    send_response(file->read_all(), request, Core::guess_mime_type_based_on_filename(real_path));
+    send_file(file, request, Core::guess_mime_type_based_on_filename(real_path));
+}
+
+void Client::append_headers(StringBuilder& builder, unsigned code, const StringView& message)
+{
+    builder.appendf("HTTP/1.1 %u ", code);
+    builder.append(message);
+    builder.append("\r\n");
+    builder.append("Server: WebServer (SerenityOS)\r\n");
+    builder.append(m_keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
 }
 
 void Client::send_response(StringView response, const HTTP::HttpRequest& request, const String& content_type)
 {
     StringBuilder builder;
-    builder.append("HTTP/1.0 200 OK\r\n");
-    builder.append("Server: WebServer (SerenityOS)\r\n");
+    append_headers(builder, 200, "OK");
+    builder.append("Content-Type: ");
+    builder.append(content_type);
+    builder.append("\r\n");
+    builder.appendf("Content-Length: %zu\r\n", response.length());
+    builder.append("\r\n");
+
+    m_response_in_progress = true;
+    queue_output(builder.to_string().bytes());
+    queue_output(response.bytes());
+    send_pending_output();
+
+    log_response(200, request);
+}
+
+void Client::send_file(NonnullRefPtr<Core::File> file, const HTTP::HttpRequest& request, const String& content_type)
+{
+    struct stat st;
+    if (fstat(file->fd(), &st) < 0) {
+        perror("fstat");
+        send_error_response(500, "Internal server error!", request);
+        return;
+    }
+
+    m_file = move(file);
+    m_file_offset = 0;
+    m_file_has_known_size = S_ISREG(st.st_mode);
+    m_file_bytes_left = m_file_has_known_size ? st.st_size : 0;
+    // We don't know up front how much there is to send for anything but regular files.
+    // HTTP/1.1 clients get it in chunks, older ones can only tell that the body is over
+    // when we close the connection.
+    m_file_is_chunked = !m_file_has_known_size && request.protocol() == "HTTP/1.1";
+    if (!m_file_has_known_size && !m_file_is_chunked)
+        m_keep_alive = false;
+
+    StringBuilder builder;
+    append_headers(builder, 200, "OK");
     builder.append("Content-Type: ");
     builder.append(content_type);
     builder.append("\r\n");
+    if (m_file_has_known_size)
+        builder.appendf("Content-Length: %zu\r\n", m_file_bytes_left);
+    else if (m_file_is_chunked)
+        builder.append("Transfer-Encoding: chunked\r\n");
     builder.append("\r\n");
 
-    m_socket->write(builder.to_string());
-    m_socket->write(response);
+    m_response_in_progress = true;
+    queue_output(builder.to_string().bytes());
+    send_pending_output();
 
     log_response(200, request);
 }
 
+void Client::queue_output(ReadonlyBytes bytes)
+{
+    m_output_buffer.append(bytes.data(), bytes.size());
+}
+
+void Client::send_pending_output()
+{
+    while (!m_dead) {
+        if (m_output_offset < m_output_buffer.size()) {
+            ssize_t nwritten = write(m_socket->fd(), m_output_buffer.data() + m_output_offset, m_output_buffer.size() - m_output_offset);
+            if (nwritten < 0) {
+                if (errno == EAGAIN) {
+                    m_write_notifier->set_enabled(true);
+                    return;
+                }
+                perror("write");
+                die();
+                return;
+            }
+            m_output_offset += nwritten;
+            continue;
+        }
+        m_output_buffer.clear();
+        m_output_offset = 0;
+
+        if (m_file) {
+            if (!send_file_data())
+                return;
+            continue;
+        }
+
+        m_write_notifier->set_enabled(false);
+        did_finish_response();
+        return;
+    }
+}
+
+// Returns false if we have to wait for the socket to become writable again.
+bool Client::send_file_data()
+{
+    if (!m_file_has_known_size) {
+        auto data = m_file->read(file_chunk_size);
+        if (m_file->error()) {
+            die();
+            return false;
+        }
+        if (data.is_empty()) {
+            if (m_file_is_chunked)
+                queue_output(StringView("0\r\n\r\n").bytes());
+            m_file = nullptr;
+            return true;
+        }
+        if (!m_file_is_chunked) {
+            queue_output(data.bytes());
+            return true;
+        }
+        auto chunk_header = String::formatted("{:x}\r\n", data.size());
+        queue_output(chunk_header.bytes());
+        queue_output(data.bytes());
+        queue_output(StringView("\r\n").bytes());
+        return true;
+    }
+
+    if (!m_file_bytes_left) {
+        m_file = nullptr;
+        return true;
+    }
+
+    ssize_t nsent = sendfile(m_socket->fd(), m_file->fd(), &m_file_offset, min(m_file_bytes_left, file_chunk_size));
+    if (nsent < 0) {
+        if (errno == EAGAIN) {
+            m_write_notifier->set_enabled(true);
+            return false;
+        }
+        perror("sendfile");
+        die();
+        return false;
+    }
+    if (nsent == 0) {
+        // The file got shorter under us, there's no way to make good on the Content-Length now.
+        die();
+        return false;
+    }
+    m_file_bytes_left -= nsent;
+    return true;
+}
+
+void Client::did_finish_response()
+{
+    m_response_in_progress = false;
+    if (!m_keep_alive) {
+        die();
+        return;
+    }
+    m_idle_timer->restart();
+    handle_buffered_requests();
+    if (m_peer_closed && !m_response_in_progress)
+        die();
+}
+
 void Client::send_redirect(StringView redirect_path, const HTTP::HttpRequest& request)
 {
     StringBuilder builder;
-    builder.append("HTTP/1.0 301 Moved Permanently\r\n");
+    append_headers(builder, 301, "Moved Permanently");
     builder.append("Location: ");
     builder.append(redirect_path);
     builder.append("\r\n");
+    builder.append("Content-Length: 0\r\n");
     builder.append("\r\n");
 
-    m_socket->write(builder.to_string());
+    m_response_in_progress = true;
+    queue_output(builder.to_string().bytes());
+    send_pending_output();
 
     log_response(301, request);
 }
@@ -245,15 +491,23 @@ void Client::handle_directory_listing(const String& requested_path, const String
 
 void Client::send_error_response(unsigned code, const StringView& message, const HTTP::HttpRequest& request)
 {
+    StringBuilder body_builder;
+    body_builder.append("<!DOCTYPE html><html><body><h1>");
+    body_builder.appendf("%u ", code);
+    body_builder.append(message);
+    body_builder.append("</h1></body></html>");
+    auto body = body_builder.to_string();
+
     StringBuilder builder;
-    builder.appendf("HTTP/1.0 %u ", code);
-    builder.append(message);
-    builder.append("\r\n\r\n");
-    builder.append("<!DOCTYPE html><html><body><h1>");
-    builder.appendf("%u ", code);
-    builder.append(message);
-    builder.append("</h1></body></html>");
-    m_socket->write(builder.to_string());
+    append_headers(builder, code, message);
+    builder.append("Content-Type: text/html\r\n");
+    builder.appendf("Content-Length: %zu\r\n", body.length());
+    builder.append("\r\n");
+    builder.append(body);
+
+    m_response_in_progress = true;
+    queue_output(builder.to_string().bytes());
+    send_pending_output();
 
     log_response(code, request);
 }
@@ -26,8 +26,12 @@
 
 #pragma once
 
+#include <AK/ByteBuffer.h>
+#include <LibCore/File.h>
+#include <LibCore/Notifier.h>
 #include <LibCore/Object.h>
 #include <LibCore/TCPSocket.h>
+#include <LibCore/Timer.h>
 #include <LibHTTP/Forward.h>
 
 namespace WebServer {
@@ -41,16 +45,44 @@ public:
 private:
     Client(NonnullRefPtr<Core::TCPSocket>, const String&, Core::Object* parent);
 
+    void did_receive_data();
+    void handle_buffered_requests();
     void handle_request(ReadonlyBytes);
     void send_response(StringView, const HTTP::HttpRequest&, const String& content_type);
+    void send_file(NonnullRefPtr<Core::File>, const HTTP::HttpRequest&, const String& content_type);
     void send_redirect(StringView redirect, const HTTP::HttpRequest& request);
     void send_error_response(unsigned code, const StringView& message, const HTTP::HttpRequest&);
+    void append_headers(StringBuilder&, unsigned code, const StringView& message);
+    void queue_output(ReadonlyBytes);
+    void send_pending_output();
+    bool send_file_data();
+    void did_finish_response();
     void die();
     void log_response(unsigned code, const HTTP::HttpRequest&);
     void handle_directory_listing(const String& requested_path, const String& real_path, const HTTP::HttpRequest&);
 
     NonnullRefPtr<Core::TCPSocket> m_socket;
     String m_root_path;
+
+    ByteBuffer m_request_buffer;
+    bool m_response_in_progress { false };
+    bool m_keep_alive { false };
+    bool m_peer_closed { false };
+    bool m_dead { false };
+
+    // Response data that hasn't made it into the socket yet.
+    ByteBuffer m_output_buffer;
+    size_t m_output_offset { 0 };
+
+    // The file currently being streamed as the response body, if any.
+    RefPtr<Core::File> m_file;
+    off_t m_file_offset { 0 };
+    size_t m_file_bytes_left { 0 };
+    bool m_file_has_known_size { false };
+    bool m_file_is_chunked { false };
+
+    RefPtr<Core::Notifier> m_write_notifier;
+    RefPtr<Core::Timer> m_idle_timer;
 };
 
 }
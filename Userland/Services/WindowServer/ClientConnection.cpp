@@ -879,6 +879,12 @@ OwnPtr<Messages::WindowServer::GetScrollStepSizeResponse> ClientConnection::hand
     return make<Messages::WindowServer::GetScrollStepSizeResponse>(Screen::the().scroll_step_size());
 }
 
+OwnPtr<Messages::WindowServer::GetCompositorStatisticsResponse> ClientConnection::handle(const Messages::WindowServer::GetCompositorStatistics&)
+{
+    auto& compositor = Compositor::the();
+    return make<Messages::WindowServer::GetCompositorStatisticsResponse>(compositor.composed_frame_count(), compositor.total_compose_time_us(), compositor.last_compose_time_us(), compositor.last_dirty_tile_count(), compositor.worker_count());
+}
+
 void ClientConnection::set_unresponsive(bool unresponsive)
 {
     if (m_unresponsive == unresponsive)
@@ -31,19 +31,26 @@
 #include "Screen.h"
 #include "Window.h"
 #include "WindowManager.h"
+#include "WorkerPool.h"
 #include <AK/Memory.h>
 #include <AK/ScopeGuard.h>
+#include <AK/Time.h>
 #include <LibCore/Timer.h>
 #include <LibGfx/Font.h>
 #include <LibGfx/Painter.h>
 #include <LibGfx/StylePainter.h>
 #include <LibThread/BackgroundAction.h>
+#include <time.h>
+#include <unistd.h>
 
 //#define COMPOSE_DEBUG
 //#define OCCLUSIONS_DEBUG
 
 namespace WindowServer {
 
+static constexpr int compose_tile_size = 128;
+static constexpr long max_compose_worker_count = 7;
+
 Compositor& Compositor::the()
 {
     static Compositor s_the;
@@ -87,6 +94,20 @@ Compositor::Compositor()
 
     m_screen_can_set_buffer = Screen::the().can_set_buffer();
     init_bitmaps();
+
+    // The compositing thread paints tiles too, so only spawn workers for the other processors.
+    long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processor_count > 1)
+        m_worker_pool = make<WorkerPool>(min(processor_count - 1, max_compose_worker_count));
+}
+
+Compositor::~Compositor()
+{
+}
+
+size_t Compositor::worker_count() const
+{
+    return m_worker_pool ? m_worker_pool->thread_count() : 0;
 }
 
 void Compositor::init_bitmaps()
@@ -103,9 +124,6 @@ void Compositor::init_bitmaps()
         m_back_bitmap = Gfx::Bitmap::create(Gfx::BitmapFormat::RGB32, physical_size);
     m_back_painter = make<Gfx::Painter>(*m_back_bitmap, screen.scale_factor());
 
-    m_temp_bitmap = Gfx::Bitmap::create(Gfx::BitmapFormat::RGB32, physical_size);
-    m_temp_painter = make<Gfx::Painter>(*m_temp_bitmap, screen.scale_factor());
-
     m_buffers_are_flipped = false;
 
     invalidate_screen();
@@ -138,6 +156,9 @@ void Compositor::compose()
         return;
     }
 
+    struct timespec compose_start;
+    clock_gettime(CLOCK_MONOTONIC, &compose_start);
+
     if (m_occlusions_dirty) {
         m_occlusions_dirty = false;
         recompute_occlusions();
@@ -248,39 +269,17 @@ void Compositor::compose()
         check_restore_cursor_back(cursor_rect);
 
     auto back_painter = *m_back_painter;
-    auto temp_painter = *m_temp_painter;
-
-    auto paint_wallpaper = [&](Gfx::Painter& painter, const Gfx::IntRect& rect) {
-        // FIXME: If the wallpaper is opaque, no need to fill with color!
-        painter.fill_rect(rect, background_color);
-        if (m_wallpaper) {
-            if (m_wallpaper_mode == WallpaperMode::Simple) {
-                painter.blit(rect.location(), *m_wallpaper, rect);
-            } else if (m_wallpaper_mode == WallpaperMode::Center) {
-                Gfx::IntPoint offset { ws.size().width() / 2 - m_wallpaper->size().width() / 2,
-                    ws.size().height() / 2 - m_wallpaper->size().height() / 2 };
-                painter.blit_offset(rect.location(), *m_wallpaper,
-                    rect, offset);
-            } else if (m_wallpaper_mode == WallpaperMode::Tile) {
-                painter.draw_tiled_bitmap(rect, *m_wallpaper);
-            } else if (m_wallpaper_mode == WallpaperMode::Scaled) {
-                float hscale = (float)m_wallpaper->size().width() / (float)ws.size().width();
-                float vscale = (float)m_wallpaper->size().height() / (float)ws.size().height();
-
-                // TODO: this may look ugly, we should scale to a backing bitmap and then blit
-                painter.blit_scaled(rect, *m_wallpaper, rect, hscale, vscale);
-            } else {
-                ASSERT_NOT_REACHED();
-            }
-        }
-    };
+
+    // Nothing is painted while walking the window stack. Instead, every rect that needs
+    // to be painted is recorded in stacking order and the list is replayed per screen tile.
+    m_paint_commands.clear_with_capacity();
 
     m_opaque_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](const Gfx::IntRect& render_rect) {
 #ifdef COMPOSE_DEBUG
         dbg() << "  render wallpaper opaque: " << render_rect;
 #endif
         prepare_rect(render_rect);
-        paint_wallpaper(back_painter, render_rect);
+        m_paint_commands.append({ PaintCommand::Type::Wallpaper, nullptr, render_rect });
         return IterationDecision::Continue;
     });
 
@@ -288,88 +287,11 @@ void Compositor::compose()
         auto frame_rect = window.frame().rect();
         if (!frame_rect.intersects(ws.rect()))
             return IterationDecision::Continue;
-        auto frame_rects = frame_rect.shatter(window.rect());
 
 #ifdef COMPOSE_DEBUG
         dbg() << "  window " << window.title() << " frame rect: " << frame_rect;
 #endif
 
-        RefPtr<Gfx::Bitmap> backing_store = window.backing_store();
-        auto compose_window_rect = [&](Gfx::Painter& painter, const Gfx::IntRect& rect) {
-            if (!window.is_fullscreen()) {
-                rect.for_each_intersected(frame_rects, [&](const Gfx::IntRect& intersected_rect) {
-                    // TODO: Should optimize this to use a backing buffer
-                    Gfx::PainterStateSaver saver(painter);
-                    painter.add_clip_rect(intersected_rect);
-#ifdef COMPOSE_DEBUG
-                    dbg() << "    render frame: " << intersected_rect;
-#endif
-                    window.frame().paint(painter);
-                    return IterationDecision::Continue;
-                });
-            }
-
-            if (!backing_store) {
-                if (window.is_opaque())
-                    painter.fill_rect(window.rect().intersected(rect), wm.palette().window());
-                return;
-            }
-
-            // Decide where we would paint this window's backing store.
-            // This is subtly different from widow.rect(), because window
-            // size may be different from its backing store size. This
-            // happens when the window has been resized and the client
-            // has not yet attached a new backing store. In this case,
-            // we want to try to blit the backing store at the same place
-            // it was previously, and fill the rest of the window with its
-            // background color.
-            Gfx::IntRect backing_rect;
-            backing_rect.set_size(backing_store->size());
-            switch (WindowManager::the().resize_direction_of_window(window)) {
-            case ResizeDirection::None:
-            case ResizeDirection::Right:
-            case ResizeDirection::Down:
-            case ResizeDirection::DownRight:
-                backing_rect.set_location(window.rect().location());
-                break;
-            case ResizeDirection::Left:
-            case ResizeDirection::Up:
-            case ResizeDirection::UpLeft:
-                backing_rect.set_right_without_resize(window.rect().right());
-                backing_rect.set_bottom_without_resize(window.rect().bottom());
-                break;
-            case ResizeDirection::UpRight:
-                backing_rect.set_left(window.rect().left());
-                backing_rect.set_bottom_without_resize(window.rect().bottom());
-                break;
-            case ResizeDirection::DownLeft:
-                backing_rect.set_right_without_resize(window.rect().right());
-                backing_rect.set_top(window.rect().top());
-                break;
-            }
-
-            Gfx::IntRect dirty_rect_in_backing_coordinates = rect.intersected(window.rect())
-                                                                 .intersected(backing_rect)
-                                                                 .translated(-backing_rect.location());
-
-            if (dirty_rect_in_backing_coordinates.is_empty())
-                return;
-            auto dst = backing_rect.location().translated(dirty_rect_in_backing_coordinates.location());
-
-            if (window.client() && window.client()->is_unresponsive()) {
-                painter.blit_filtered(dst, *backing_store, dirty_rect_in_backing_coordinates, [](Color src) {
-                    return src.to_grayscale().darkened(0.75f);
-                });
-            } else {
-                painter.blit(dst, *backing_store, dirty_rect_in_backing_coordinates, window.opacity());
-            }
-
-            if (window.is_opaque()) {
-                for (auto background_rect : window.rect().shatter(backing_rect))
-                    painter.fill_rect(background_rect, wm.palette().window());
-            }
-        };
-
         auto& dirty_rects = window.dirty_rects();
 #ifdef COMPOSE_DEBUG
         for (auto& dirty_rect : dirty_rects.rects())
@@ -380,7 +302,6 @@ void Compositor::compose()
             dbg() << "    transparent: " << r;
 #endif
 
-        // Render opaque portions directly to the back buffer
         auto& opaque_rects = window.opaque_rects();
         if (!opaque_rects.is_empty()) {
             opaque_rects.for_each_intersected(dirty_rects, [&](const Gfx::IntRect& render_rect) {
@@ -388,9 +309,7 @@ void Compositor::compose()
                 dbg() << "    render opaque: " << render_rect;
 #endif
                 prepare_rect(render_rect);
-                Gfx::PainterStateSaver saver(back_painter);
-                back_painter.add_clip_rect(render_rect);
-                compose_window_rect(back_painter, render_rect);
+                m_paint_commands.append({ PaintCommand::Type::Window, &window, render_rect });
                 return IterationDecision::Continue;
             });
         }
@@ -404,10 +323,14 @@ void Compositor::compose()
                 dbg() << "    render wallpaper: " << render_rect;
 #endif
                 prepare_transparency_rect(render_rect);
-                paint_wallpaper(temp_painter, render_rect);
+                m_paint_commands.append({ PaintCommand::Type::Wallpaper, nullptr, render_rect });
                 return IterationDecision::Continue;
             });
         }
+
+        // Transparent portions are painted straight into the back buffer as well. Every
+        // transparent rect is repainted bottom-up, starting with either the wallpaper or
+        // an opaque window, so there is no stale content for it to blend with.
         auto& transparency_rects = window.transparency_rects();
         if (!transparency_rects.is_empty()) {
             transparency_rects.for_each_intersected(dirty_rects, [&](const Gfx::IntRect& render_rect) {
@@ -415,9 +338,7 @@ void Compositor::compose()
                 dbg() << "    render transparent: " << render_rect;
 #endif
                 prepare_transparency_rect(render_rect);
-                Gfx::PainterStateSaver saver(temp_painter);
-                temp_painter.add_clip_rect(render_rect);
-                compose_window_rect(temp_painter, render_rect);
+                m_paint_commands.append({ PaintCommand::Type::Window, &window, render_rect });
                 return IterationDecision::Continue;
             });
         }
@@ -448,22 +369,15 @@ void Compositor::compose()
             }
             return false;
         }());
+    }
 
-        // Copy anything rendered to the temporary buffer to the back buffer
-        {
-            // FIXME: Give Bitmap an intrinsic scale factor and make Painter::blit() do the right thing if both it and the passed bitmap have scale factors:
-            // If a 2x scaled bitmap is blitted on a 2x scaled painter, it should be blitted without scale.
-            Gfx::Painter unscaled_back_painter(*m_back_bitmap, 1);
-            auto scale = Screen::the().scale_factor();
-            for (auto& rect : flush_transparent_rects.rects())
-                unscaled_back_painter.blit(rect.location() * scale, *m_temp_bitmap, rect * scale);
-        }
+    paint_dirty_tiles(background_color);
 
+    if (m_invalidated_window) {
         Gfx::IntRect geometry_label_damage_rect;
         if (draw_geometry_label(geometry_label_damage_rect))
             flush_special_rects.add(geometry_label_damage_rect);
     }
-
     m_invalidated_any = false;
     m_invalidated_window = false;
     m_invalidated_cursor = false;
@@ -529,6 +443,167 @@ void Compositor::compose()
         flush(rect);
     for (auto& rect : flush_special_rects.rects())
         flush(rect);
+
+    struct timespec compose_end;
+    clock_gettime(CLOCK_MONOTONIC, &compose_end);
+    struct timespec compose_time;
+    timespec_sub(compose_end, compose_start, compose_time);
+    m_last_compose_time_us = compose_time.tv_sec * 1'000'000 + compose_time.tv_nsec / 1000;
+    m_total_compose_time_us += m_last_compose_time_us;
+    ++m_composed_frame_count;
+}
+
+void Compositor::paint_wallpaper(Gfx::Painter& painter, const Gfx::IntRect& rect, Color background_color)
+{
+    auto& ws = Screen::the();
+
+    // FIXME: If the wallpaper is opaque, no need to fill with color!
+    painter.fill_rect(rect, background_color);
+    if (m_wallpaper) {
+        if (m_wallpaper_mode == WallpaperMode::Simple) {
+            painter.blit(rect.location(), *m_wallpaper, rect);
+        } else if (m_wallpaper_mode == WallpaperMode::Center) {
+            Gfx::IntPoint offset { ws.size().width() / 2 - m_wallpaper->size().width() / 2,
+                ws.size().height() / 2 - m_wallpaper->size().height() / 2 };
+            painter.blit_offset(rect.location(), *m_wallpaper,
+                rect, offset);
+        } else if (m_wallpaper_mode == WallpaperMode::Tile) {
+            painter.draw_tiled_bitmap(rect, *m_wallpaper);
+        } else if (m_wallpaper_mode == WallpaperMode::Scaled) {
+            float hscale = (float)m_wallpaper->size().width() / (float)ws.size().width();
+            float vscale = (float)m_wallpaper->size().height() / (float)ws.size().height();
+
+            // TODO: this may look ugly, we should scale to a backing bitmap and then blit
+            painter.blit_scaled(rect, *m_wallpaper, rect, hscale, vscale);
+        } else {
+            ASSERT_NOT_REACHED();
+        }
+    }
+}
+
+void Compositor::compose_window_rect(Gfx::Painter& painter, Window& window, const Gfx::IntRect& rect)
+{
+    auto& wm = WindowManager::the();
+
+    if (!window.is_fullscreen()) {
+        auto frame_rects = window.frame().rect().shatter(window.rect());
+        rect.for_each_intersected(frame_rects, [&](const Gfx::IntRect& intersected_rect) {
+            // TODO: Should optimize this to use a backing buffer
+            Gfx::PainterStateSaver saver(painter);
+            painter.add_clip_rect(intersected_rect);
+#ifdef COMPOSE_DEBUG
+            dbg() << "    render frame: " << intersected_rect;
+#endif
+            window.frame().paint(painter);
+            return IterationDecision::Continue;
+        });
+    }
+
+    auto* backing_store = window.backing_store();
+    if (!backing_store) {
+        if (window.is_opaque())
+            painter.fill_rect(window.rect().intersected(rect), wm.palette().window());
+        return;
+    }
+
+    // Decide where we would paint this window's backing store.
+    // This is subtly different from widow.rect(), because window
+    // size may be different from its backing store size. This
+    // happens when the window has been resized and the client
+    // has not yet attached a new backing store. In this case,
+    // we want to try to blit the backing store at the same place
+    // it was previously, and fill the rest of the window with its
+    // background color.
+    Gfx::IntRect backing_rect;
+    backing_rect.set_size(backing_store->size());
+    switch (WindowManager::the().resize_direction_of_window(window)) {
+    case ResizeDirection::None:
+    case ResizeDirection::Right:
+    case ResizeDirection::Down:
+    case ResizeDirection::DownRight:
+        backing_rect.set_location(window.rect().location());
+        break;
+    case ResizeDirection::Left:
+    case ResizeDirection::Up:
+    case ResizeDirection::UpLeft:
+        backing_rect.set_right_without_resize(window.rect().right());
+        backing_rect.set_bottom_without_resize(window.rect().bottom());
+        break;
+    case ResizeDirection::UpRight:
+        backing_rect.set_left(window.rect().left());
+        backing_rect.set_bottom_without_resize(window.rect().bottom());
+        break;
+    case ResizeDirection::DownLeft:
+        backing_rect.set_right_without_resize(window.rect().right());
+        backing_rect.set_top(window.rect().top());
+        break;
+    }
+
+    Gfx::IntRect dirty_rect_in_backing_coordinates = rect.intersected(window.rect())
+                                                         .intersected(backing_rect)
+                                                         .translated(-backing_rect.location());
+
+    if (dirty_rect_in_backing_coordinates.is_empty())
+        return;
+    auto dst = backing_rect.location().translated(dirty_rect_in_backing_coordinates.location());
+
+    if (window.client() && window.client()->is_unresponsive()) {
+        painter.blit_filtered(dst, *backing_store, dirty_rect_in_backing_coordinates, [](Color src) {
+            return src.to_grayscale().darkened(0.75f);
+        });
+    } else {
+        painter.blit(dst, *backing_store, dirty_rect_in_backing_coordinates, window.opacity());
+    }
+
+    if (window.is_opaque()) {
+        for (auto background_rect : window.rect().shatter(backing_rect))
+            painter.fill_rect(background_rect, wm.palette().window());
+    }
+}
+
+void Compositor::paint_dirty_tiles(Color background_color)
+{
+    auto screen_rect = Screen::the().rect();
+
+    m_dirty_tiles.clear_with_capacity();
+    for (int y = 0; y < screen_rect.height(); y += compose_tile_size) {
+        for (int x = 0; x < screen_rect.width(); x += compose_tile_size) {
+            auto tile_rect = Gfx::IntRect { x, y, compose_tile_size, compose_tile_size }.intersected(screen_rect);
+            for (auto& command : m_paint_commands) {
+                if (command.rect.intersects(tile_rect)) {
+                    m_dirty_tiles.append(tile_rect);
+                    break;
+                }
+            }
+        }
+    }
+    m_last_dirty_tile_count = m_dirty_tiles.size();
+
+    // Each tile replays the whole paint command list, clipped to the tile. Since tiles
+    // don't overlap, they can be painted in parallel.
+    Function<void(size_t)> paint_tile = [&](size_t index) {
+        auto& tile_rect = m_dirty_tiles[index];
+        Gfx::Painter painter(*m_back_bitmap, Screen::the().scale_factor());
+        painter.add_clip_rect(tile_rect);
+        for (auto& command : m_paint_commands) {
+            auto rect = command.rect.intersected(tile_rect);
+            if (rect.is_empty())
+                continue;
+            Gfx::PainterStateSaver saver(painter);
+            painter.add_clip_rect(rect);
+            if (command.type == PaintCommand::Type::Wallpaper)
+                paint_wallpaper(painter, rect, background_color);
+            else
+                compose_window_rect(painter, *command.window, rect);
+        }
+    };
+
+    if (m_worker_pool && m_dirty_tiles.size() > 1) {
+        m_worker_pool->run(m_dirty_tiles.size(), paint_tile);
+        return;
+    }
+    for (size_t i = 0; i < m_dirty_tiles.size(); ++i)
+        paint_tile(i);
 }
 
 void Compositor::flush(const Gfx::IntRect& a_rect)
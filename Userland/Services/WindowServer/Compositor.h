@@ -28,6 +28,7 @@
 
 #include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
+#include <AK/Vector.h>
 #include <LibCore/Object.h>
 #include <LibGfx/Color.h>
 #include <LibGfx/DisjointRectSet.h>
@@ -38,6 +39,7 @@ class ClientConnection;
 class Cursor;
 class Window;
 class WindowManager;
+class WorkerPool;
 
 enum class WallpaperMode {
     Simple,
@@ -76,8 +78,25 @@ public:
 
     void did_construct_window_manager(Badge<WindowManager>);
 
+    u64 composed_frame_count() const { return m_composed_frame_count; }
+    u64 total_compose_time_us() const { return m_total_compose_time_us; }
+    u32 last_compose_time_us() const { return m_last_compose_time_us; }
+    u32 last_dirty_tile_count() const { return m_last_dirty_tile_count; }
+    size_t worker_count() const;
+
 private:
+    struct PaintCommand {
+        enum class Type {
+            Wallpaper,
+            Window,
+        };
+        Type type;
+        Window* window { nullptr };
+        Gfx::IntRect rect;
+    };
+
     Compositor();
+    virtual ~Compositor() override;
     void init_bitmaps();
     void flip_buffers();
     void flush(const Gfx::IntRect&);
@@ -91,6 +110,9 @@ private:
     void draw_cursor(const Gfx::IntRect&);
     void restore_cursor_back();
     bool draw_geometry_label(Gfx::IntRect&);
+    void paint_dirty_tiles(Color background_color);
+    void paint_wallpaper(Gfx::Painter&, const Gfx::IntRect&, Color background_color);
+    void compose_window_rect(Gfx::Painter&, Window&, const Gfx::IntRect&);
 
     RefPtr<Core::Timer> m_compose_timer;
     RefPtr<Core::Timer> m_immediate_compose_timer;
@@ -104,10 +126,8 @@ private:
 
     RefPtr<Gfx::Bitmap> m_front_bitmap;
     RefPtr<Gfx::Bitmap> m_back_bitmap;
-    RefPtr<Gfx::Bitmap> m_temp_bitmap;
     OwnPtr<Gfx::Painter> m_back_painter;
     OwnPtr<Gfx::Painter> m_front_painter;
-    OwnPtr<Gfx::Painter> m_temp_painter;
 
     Gfx::DisjointRectSet m_dirty_screen_rects;
     Gfx::DisjointRectSet m_opaque_wallpaper_rects;
@@ -130,6 +150,15 @@ private:
     size_t m_display_link_count { 0 };
 
     Optional<Gfx::Color> m_custom_background_color;
+
+    Vector<PaintCommand> m_paint_commands;
+    Vector<Gfx::IntRect> m_dirty_tiles;
+    OwnPtr<WorkerPool> m_worker_pool;
+
+    u64 m_composed_frame_count { 0 };
+    u64 m_total_compose_time_us { 0 };
+    u32 m_last_compose_time_us { 0 };
+    u32 m_last_dirty_tile_count { 0 };
 };
 
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "WorkerPool.h"
+#include <AK/Assertions.h>
+
+namespace WindowServer {
+
+WorkerPool::WorkerPool(size_t thread_count)
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_work_available, nullptr);
+    pthread_cond_init(&m_work_done, nullptr);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        auto thread = LibThread::Thread::construct(
+            [this] {
+                worker_loop();
+                return 0;
+            },
+            "Compose worker");
+        thread->start();
+        m_threads.append(move(thread));
+        ++m_live_threads;
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_exiting = true;
+    pthread_cond_broadcast(&m_work_available);
+    while (m_live_threads)
+        pthread_cond_wait(&m_work_done, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_cond_destroy(&m_work_done);
+    pthread_cond_destroy(&m_work_available);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void WorkerPool::run(size_t job_count, Function<void(size_t)>& job)
+{
+    pthread_mutex_lock(&m_mutex);
+    ASSERT(!m_job);
+    m_job = &job;
+    m_job_count = job_count;
+    m_next_job = 0;
+    m_busy_threads = m_threads.size();
+    ++m_generation;
+    pthread_cond_broadcast(&m_work_available);
+    pthread_mutex_unlock(&m_mutex);
+
+    run_jobs();
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_busy_threads)
+        pthread_cond_wait(&m_work_done, &m_mutex);
+    m_job = nullptr;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void WorkerPool::run_jobs()
+{
+    for (;;) {
+        size_t index = m_next_job.fetch_add(1);
+        if (index >= m_job_count)
+            return;
+        (*m_job)(index);
+    }
+}
+
+void WorkerPool::worker_loop()
+{
+    u32 last_generation = 0;
+    pthread_mutex_lock(&m_mutex);
+    for (;;) {
+        while (!m_exiting && m_generation == last_generation)
+            pthread_cond_wait(&m_work_available, &m_mutex);
+        if (m_exiting)
+            break;
+        last_generation = m_generation;
+
+        pthread_mutex_unlock(&m_mutex);
+        run_jobs();
+        pthread_mutex_lock(&m_mutex);
+
+        if (--m_busy_threads == 0)
+            pthread_cond_signal(&m_work_done);
+    }
+    --m_live_threads;
+    pthread_cond_signal(&m_work_done);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+}
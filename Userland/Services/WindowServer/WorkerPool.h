@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Function.h>
+#include <AK/NonnullRefPtrVector.h>
+#include <LibThread/Thread.h>
+#include <pthread.h>
+
+namespace WindowServer {
+
+// A fixed set of threads that the compositor hands batches of independent jobs to.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t thread_count);
+    ~WorkerPool();
+
+    size_t thread_count() const { return m_threads.size(); }
+
+    // Calls job(index) for every index in [0, job_count) on the worker threads and the
+    // calling thread, and returns once all of the calls have finished.
+    void run(size_t job_count, Function<void(size_t)>& job);
+
+private:
+    void worker_loop();
+    void run_jobs();
+
+    NonnullRefPtrVector<LibThread::Thread> m_threads;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work_available;
+    pthread_cond_t m_work_done;
+
+    Function<void(size_t)>* m_job { nullptr };
+    size_t m_job_count { 0 };
+    Atomic<size_t> m_next_job { 0 };
+    size_t m_busy_threads { 0 };
+    size_t m_live_threads { 0 };
+    u32 m_generation { 0 };
+    bool m_exiting { false };
+};
+
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+#include <LibCore/ElapsedTimer.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Pushes a bunch of data through a TCP connection over the loopback adapter
+// and reports the throughput.
+
+static constexpr size_t chunk_size = 64 * KiB;
+
+static int run_sender(u16 port, size_t total_size)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("connect");
+        return 1;
+    }
+
+    auto* buffer = (u8*)malloc(chunk_size);
+    memset(buffer, 'A', chunk_size);
+    size_t total_sent = 0;
+    while (total_sent < total_size) {
+        ssize_t nwritten = write(fd, buffer, min(chunk_size, total_size - total_sent));
+        if (nwritten < 0) {
+            perror("write");
+            return 1;
+        }
+        total_sent += nwritten;
+    }
+    free(buffer);
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    size_t total_megabytes = 64;
+    if (argc > 1)
+        total_megabytes = atoi(argv[1]);
+    size_t total_size = total_megabytes * MiB;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    socklen_t address_size = sizeof(address);
+    if (getsockname(listen_fd, (sockaddr*)&address, &address_size) < 0) {
+        perror("getsockname");
+        return 1;
+    }
+    if (listen(listen_fd, 1) < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    pid_t sender_pid = fork();
+    if (sender_pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (sender_pid == 0)
+        return run_sender(ntohs(address.sin_port), total_size);
+
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+        perror("accept");
+        return 1;
+    }
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+
+    auto* buffer = (u8*)malloc(chunk_size);
+    size_t total_received = 0;
+    for (;;) {
+        ssize_t nread = read(fd, buffer, chunk_size);
+        if (nread < 0) {
+            perror("read");
+            return 1;
+        }
+        if (nread == 0)
+            break;
+        total_received += nread;
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    free(buffer);
+    close(fd);
+    close(listen_fd);
+
+    int status = 0;
+    waitpid(sender_pid, &status, 0);
+
+    if (total_received != total_size) {
+        printf("FAIL, received %zu of %zu bytes\n", total_received, total_size);
+        return 1;
+    }
+
+    printf("Received %zu MiB in %d ms (%zu KiB/s)\n", total_megabytes, elapsed_ms, total_size / KiB * 1000 / elapsed_ms);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Vector.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures malloc()/free() throughput as the number of threads allocating
+// concurrently grows. Each thread keeps a small working set of live
+// allocations of mixed sizes and keeps replacing them.
+
+static constexpr int operations_per_thread = 200000;
+static constexpr int working_set_size = 64;
+static constexpr size_t allocation_sizes[] = { 8, 24, 48, 100, 200, 480, 1000 };
+
+static void* worker(void*)
+{
+    void* working_set[working_set_size] = {};
+    unsigned seed = 1;
+    for (int i = 0; i < operations_per_thread; ++i) {
+        seed = seed * 1103515245 + 12345;
+        auto slot = (seed >> 8) % working_set_size;
+        auto size = allocation_sizes[(seed >> 16) % (sizeof(allocation_sizes) / sizeof(allocation_sizes[0]))];
+        free(working_set[slot]);
+        working_set[slot] = malloc(size);
+    }
+    for (auto* ptr : working_set)
+        free(ptr);
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    int max_threads = 8;
+    if (argc > 1)
+        max_threads = atoi(argv[1]);
+
+    for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        Vector<pthread_t> threads;
+        threads.resize(thread_count);
+
+        Core::ElapsedTimer timer;
+        timer.start();
+        for (auto& thread : threads) {
+            if (pthread_create(&thread, nullptr, worker, nullptr) != 0) {
+                perror("pthread_create");
+                return 1;
+            }
+        }
+        for (auto& thread : threads)
+            pthread_join(thread, nullptr);
+        auto ms = max(timer.elapsed(), 1);
+
+        u64 operations = (u64)thread_count * operations_per_thread;
+        printf("%2d threads: %6dms, %8llu malloc+free/s\n", thread_count, ms, operations * 1000 / ms);
+    }
+    return 0;
+}
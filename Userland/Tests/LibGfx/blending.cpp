@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/TestSuite.h>
+
+#include <AK/Function.h>
+#include <AK/Random.h>
+#include <AK/Vector.h>
+#include <LibGfx/Blending.h>
+
+// The scanline kernels promise to produce exactly what the per-pixel Color::blend() loops
+// they replace would. These compare the kernels Painter uses (the SSE2 ones, where the CPU
+// has them) against those loops, for random pixels and for the alpha values that are
+// most likely to be handled specially.
+
+static constexpr u8 interesting_alphas[] = { 0, 1, 2, 127, 128, 129, 253, 254, 255 };
+
+// Long enough to cover several vector iterations, plus every possible scalar tail.
+static constexpr size_t max_scanline_length = 67;
+
+static Gfx::RGBA32 random_pixel()
+{
+    return get_random<Gfx::RGBA32>();
+}
+
+static Gfx::RGBA32 random_pixel_with_alpha(u8 alpha)
+{
+    return (random_pixel() & 0x00ffffff) | ((Gfx::RGBA32)alpha << 24);
+}
+
+static Gfx::RGBA32 random_interesting_pixel()
+{
+    if (get_random<u8>() % 2)
+        return random_pixel();
+    return random_pixel_with_alpha(interesting_alphas[get_random<u8>() % sizeof(interesting_alphas)]);
+}
+
+static Vector<Gfx::RGBA32> make_scanline(size_t length, Function<Gfx::RGBA32()> make_pixel)
+{
+    Vector<Gfx::RGBA32> scanline;
+    for (size_t i = 0; i < length; ++i)
+        scanline.append(make_pixel());
+    return scanline;
+}
+
+static bool scanlines_match(const Vector<Gfx::RGBA32>& actual, const Vector<Gfx::RGBA32>& expected)
+{
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (actual[i] != expected[i]) {
+            warnln("Mismatch at pixel {} of {}: got {:08x}, expected {:08x}", i, actual.size(), actual[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_blend_scanline(const Vector<Gfx::RGBA32>& dst, const Vector<Gfx::RGBA32>& src)
+{
+    auto expected = dst;
+    for (size_t i = 0; i < dst.size(); ++i) {
+        auto source = Color::from_rgba(src[i]);
+        if (source.alpha())
+            expected[i] = Color::from_rgba(dst[i]).blend(source).value();
+    }
+    auto actual = dst;
+    Gfx::blend_scanline(actual.data(), src.data(), src.size());
+    EXPECT(scanlines_match(actual, expected));
+}
+
+static void check_blend_scanline_with_opacity(const Vector<Gfx::RGBA32>& dst, const Vector<Gfx::RGBA32>& src, u8 alpha)
+{
+    auto expected = dst;
+    for (size_t i = 0; i < dst.size(); ++i) {
+        auto source = Color::from_rgb(src[i]);
+        source.set_alpha(alpha);
+        expected[i] = Color::from_rgb(dst[i]).blend(source).value();
+    }
+    auto actual = dst;
+    Gfx::blend_scanline_with_opacity(actual.data(), src.data(), src.size(), alpha);
+    EXPECT(scanlines_match(actual, expected));
+}
+
+static void check_blend_scanline_with_color(const Vector<Gfx::RGBA32>& dst, Color color)
+{
+    auto expected = dst;
+    for (size_t i = 0; i < dst.size(); ++i)
+        expected[i] = Color::from_rgba(dst[i]).blend(color).value();
+    auto actual = dst;
+    Gfx::blend_scanline_with_color(actual.data(), color, dst.size());
+    EXPECT(scanlines_match(actual, expected));
+}
+
+TEST_CASE(blend_scanline_matches_color_blend)
+{
+    for (size_t length = 0; length <= max_scanline_length; ++length) {
+        for (int round = 0; round < 20; ++round) {
+            check_blend_scanline(make_scanline(length, random_interesting_pixel), make_scanline(length, random_interesting_pixel));
+            // An opaque destination is what the vector path is built for.
+            check_blend_scanline(make_scanline(length, [] { return random_pixel_with_alpha(255); }), make_scanline(length, random_interesting_pixel));
+        }
+    }
+
+    for (auto src_alpha : interesting_alphas) {
+        for (auto dst_alpha : interesting_alphas) {
+            auto dst = make_scanline(max_scanline_length, [&] { return random_pixel_with_alpha(dst_alpha); });
+            auto src = make_scanline(max_scanline_length, [&] { return random_pixel_with_alpha(src_alpha); });
+            check_blend_scanline(dst, src);
+        }
+    }
+}
+
+TEST_CASE(blend_scanline_with_opacity_matches_color_blend)
+{
+    for (size_t length = 0; length <= max_scanline_length; ++length) {
+        for (int round = 0; round < 20; ++round)
+            check_blend_scanline_with_opacity(make_scanline(length, random_interesting_pixel), make_scanline(length, random_interesting_pixel), get_random<u8>());
+    }
+
+    for (auto alpha : interesting_alphas) {
+        for (auto dst_alpha : interesting_alphas) {
+            auto dst = make_scanline(max_scanline_length, [&] { return random_pixel_with_alpha(dst_alpha); });
+            check_blend_scanline_with_opacity(dst, make_scanline(max_scanline_length, random_interesting_pixel), alpha);
+        }
+    }
+}
+
+TEST_CASE(blend_scanline_with_color_matches_color_blend)
+{
+    for (size_t length = 0; length <= max_scanline_length; ++length) {
+        for (int round = 0; round < 20; ++round) {
+            auto color = Color::from_rgba(random_interesting_pixel());
+            check_blend_scanline_with_color(make_scanline(length, random_interesting_pixel), color);
+            check_blend_scanline_with_color(make_scanline(length, [] { return random_pixel_with_alpha(255); }), color);
+        }
+    }
+
+    for (auto color_alpha : interesting_alphas) {
+        for (auto dst_alpha : interesting_alphas) {
+            auto dst = make_scanline(max_scanline_length, [&] { return random_pixel_with_alpha(dst_alpha); });
+            check_blend_scanline_with_color(dst, Color::from_rgba(random_pixel_with_alpha(color_alpha)));
+        }
+    }
+}
+
+TEST_MAIN(Blending)
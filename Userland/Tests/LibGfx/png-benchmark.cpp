@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/LexicalPath.h>
+#include <AK/MappedFile.h>
+#include <AK/String.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibGfx/PNGLoader.h>
+#include <stdio.h>
+
+int main(int argc, char** argv)
+{
+    int iterations = 10;
+    Vector<const char*> paths;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure how quickly PNG images are decoded.");
+    args_parser.add_option(iterations, "Number of times to decode each image", "iterations", 'i', "count");
+    args_parser.add_positional_argument(paths, "PNG images to decode", "paths");
+    args_parser.parse(argc, argv);
+
+    u64 total_pixels = 0;
+    u64 total_bytes = 0;
+    i64 total_elapsed_ms = 0;
+
+    for (auto* path : paths) {
+        auto file_or_error = MappedFile::map(path);
+        if (file_or_error.is_error()) {
+            fprintf(stderr, "%s: %s\n", path, file_or_error.error().string());
+            continue;
+        }
+        auto& file = *file_or_error.value();
+
+        // Decode once up front, both to warm up the caches and to find out whether the image is valid.
+        auto bitmap = Gfx::load_png_from_memory((const u8*)file.data(), file.size());
+        if (!bitmap) {
+            fprintf(stderr, "%s: Failed to decode\n", path);
+            continue;
+        }
+
+        Core::ElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            bitmap = Gfx::load_png_from_memory((const u8*)file.data(), file.size());
+        int elapsed_ms = max(timer.elapsed(), 1);
+
+        u64 pixels = (u64)bitmap->width() * bitmap->height() * iterations;
+        printf("%-50s %5dx%-5d %10.1f MP/s\n", LexicalPath(path).basename().characters(), bitmap->width(), bitmap->height(), (double)pixels / 1000 / elapsed_ms);
+
+        total_pixels += pixels;
+        total_bytes += (u64)file.size() * iterations;
+        total_elapsed_ms += elapsed_ms;
+    }
+
+    if (total_elapsed_ms)
+        printf("Total: %.1f MP/s, %.1f MB/s of PNG data\n", (double)total_pixels / 1000 / total_elapsed_ms, (double)total_bytes / 1000 / total_elapsed_ms);
+
+    return 0;
+}
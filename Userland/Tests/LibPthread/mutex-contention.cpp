@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Vector.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibThread/Lock.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures how lock/unlock throughput of pthread_mutex_t and LibThread::Lock
+// behaves as more threads fight over the same lock.
+
+static constexpr int iterations_per_thread = 100000;
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LibThread::Lock s_lock;
+static volatile u64 s_counter;
+
+static void* mutex_worker(void*)
+{
+    for (int i = 0; i < iterations_per_thread; ++i) {
+        pthread_mutex_lock(&s_mutex);
+        s_counter = s_counter + 1;
+        pthread_mutex_unlock(&s_mutex);
+    }
+    return nullptr;
+}
+
+static void* lock_worker(void*)
+{
+    for (int i = 0; i < iterations_per_thread; ++i) {
+        LOCKER(s_lock);
+        s_counter = s_counter + 1;
+    }
+    return nullptr;
+}
+
+static bool run(const char* name, void* (*worker)(void*), int thread_count)
+{
+    s_counter = 0;
+    Vector<pthread_t> threads;
+    threads.resize(thread_count);
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    for (auto& thread : threads) {
+        if (pthread_create(&thread, nullptr, worker, nullptr) != 0) {
+            perror("pthread_create");
+            return false;
+        }
+    }
+    for (auto& thread : threads)
+        pthread_join(thread, nullptr);
+    auto ms = max(timer.elapsed(), 1);
+
+    u64 expected = (u64)thread_count * iterations_per_thread;
+    if (s_counter != expected) {
+        printf("FAIL: %s with %d threads counted %llu, expected %llu\n", name, thread_count, s_counter, expected);
+        return false;
+    }
+
+    printf("%-16s %2d threads: %6dms, %8llu ops/s\n", name, thread_count, ms, expected * 1000 / ms);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int max_threads = 8;
+    if (argc > 1)
+        max_threads = atoi(argv[1]);
+
+    for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        if (!run("pthread_mutex", mutex_worker, thread_count))
+            return 1;
+        if (!run("LibThread::Lock", lock_worker, thread_count))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibCompress/Gzip.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/FileStream.h>
+
+static bool compress_file(Buffered<Core::InputFileStream>& input_stream, Buffered<Core::OutputFileStream>& output_stream, Compress::GzipCompressor::CompressionLevel compression_level)
+{
+    auto gzip_stream = Compress::GzipCompressor { output_stream, compression_level };
+
+    u8 buffer[4096];
+
+    while (!input_stream.unreliable_eof()) {
+        const auto nread = input_stream.read({ buffer, sizeof(buffer) });
+        gzip_stream.write_or_error({ buffer, nread });
+    }
+    gzip_stream.final();
+
+    output_stream.flush();
+
+    bool success = true;
+    if (input_stream.handle_any_error())
+        success = false;
+    if (gzip_stream.handle_any_error())
+        success = false;
+    if (output_stream.handle_any_error())
+        success = false;
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    Vector<const char*> filenames;
+    bool keep_input_files { false };
+    bool write_to_stdout { false };
+    bool fast { false };
+    bool best { false };
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(keep_input_files, "Keep (don't delete) input files", "keep", 'k');
+    args_parser.add_option(write_to_stdout, "Write to stdout, keep original files unchanged", "stdout", 'c');
+    args_parser.add_option(fast, "Compress faster, at the cost of a larger output", "fast", '1');
+    args_parser.add_option(best, "Compress better, at the cost of more time", "best", '9');
+    args_parser.add_positional_argument(filenames, "File to compress", "FILE");
+    args_parser.parse(argc, argv);
+
+    if (write_to_stdout)
+        keep_input_files = true;
+
+    auto compression_level = Compress::GzipCompressor::CompressionLevel::Good;
+    if (fast)
+        compression_level = Compress::GzipCompressor::CompressionLevel::Fast;
+    if (best)
+        compression_level = Compress::GzipCompressor::CompressionLevel::Best;
+
+    int status = 0;
+    for (String input_filename : filenames) {
+        if (input_filename.ends_with(".gz")) {
+            warnln("{}: already has .gz suffix", input_filename);
+            status = 1;
+            continue;
+        }
+
+        const auto output_filename = String::formatted("{}.gz", input_filename);
+
+        auto input_stream_result = Core::InputFileStream::open_buffered(input_filename);
+        if (input_stream_result.is_error()) {
+            warnln("{}: {}", input_filename, input_stream_result.error());
+            status = 1;
+            continue;
+        }
+
+        bool success;
+        if (write_to_stdout) {
+            auto stdout = Core::OutputFileStream::stdout_buffered();
+            success = compress_file(input_stream_result.value(), stdout, compression_level);
+        } else {
+            auto output_stream_result = Core::OutputFileStream::open_buffered(output_filename);
+            if (output_stream_result.is_error()) {
+                warnln("{}: {}", output_filename, output_stream_result.error());
+                status = 1;
+                continue;
+            }
+            success = compress_file(input_stream_result.value(), output_stream_result.value(), compression_level);
+        }
+
+        if (!success) {
+            warnln("{}: Failed to compress", input_filename);
+            status = 1;
+            continue;
+        }
+
+        if (!keep_input_files) {
+            const auto retval = unlink(input_filename.characters());
+            ASSERT(retval == 0);
+        }
+    }
+
+    return status;
+}
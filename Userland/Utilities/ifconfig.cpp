@@ -79,6 +79,7 @@ int main(int argc, char** argv)
             auto bytes_in = if_object.get("bytes_in").to_u32();
             auto packets_out = if_object.get("packets_out").to_u32();
             auto bytes_out = if_object.get("bytes_out").to_u32();
+            auto packets_dropped = if_object.get("packets_dropped").to_u32();
             auto mtu = if_object.get("mtu").to_u32();
 
             printf("%s:\n", name.characters());
@@ -87,7 +88,7 @@ int main(int argc, char** argv)
             printf("\tnetmask: %s\n", netmask.characters());
             printf("\tgateway: %s\n", gateway.characters());
             printf("\tclass: %s\n", class_name.characters());
-            printf("\tRX: %u packets %u bytes (%s)\n", packets_in, bytes_in, human_readable_size(bytes_in).characters());
+            printf("\tRX: %u packets %u bytes (%s), %u dropped\n", packets_in, bytes_in, human_readable_size(bytes_in).characters(), packets_dropped);
             printf("\tTX: %u packets %u bytes (%s)\n", packets_out, bytes_out, human_readable_size(bytes_out).characters());
             printf("\tMTU: %u\n", mtu);
             printf("\n");
@@ -79,6 +79,9 @@ private:
 
 static bool s_dump_ast = false;
 static bool s_print_last_result = false;
+static bool s_run_bytecode = false;
+static bool s_dump_bytecode = false;
+static bool s_print_property_cache_statistics = false;
 static RefPtr<Line::Editor> s_editor;
 static String s_history_path = String::formatted("{}/.js-history", Core::StandardPaths::home_directory());
 static int s_repl_line_level = 0;
@@ -406,6 +409,36 @@ static void print(JS::Value value)
     outln();
 }
 
+static void print_property_cache_statistics()
+{
+    auto& statistics = vm->property_cache_statistics();
+    outln("Property cache: get {} hits / {} misses, put {} hits / {} misses",
+        statistics.get_hits, statistics.get_misses, statistics.put_hits, statistics.put_misses);
+}
+
+static void print_pause_time_histogram(const char* name, const JS::Heap::PauseTimeHistogram& histogram)
+{
+    using Histogram = JS::Heap::PauseTimeHistogram;
+    outln("{}: {} pauses, {} us total, {} us longest", name, histogram.pause_count, histogram.total_microseconds, histogram.longest_microseconds);
+    if (!histogram.pause_count)
+        return;
+    for (size_t i = 0; i < Histogram::bucket_count; ++i) {
+        if (i < Histogram::bucket_count - 1)
+            out("  < {:>6} us", Histogram::bucket_limits_in_microseconds[i]);
+        else
+            out("  >={:>6} us", Histogram::bucket_limits_in_microseconds[i - 1]);
+        outln(": {}", histogram.buckets[i]);
+    }
+}
+
+static void print_gc_statistics(const JS::Heap& heap)
+{
+    auto& statistics = heap.statistics();
+    print_pause_time_histogram("Young generation collections", statistics.young_generation_collections);
+    print_pause_time_histogram("Incremental marking steps", statistics.incremental_marking_steps);
+    print_pause_time_histogram("Full collections", statistics.full_collections);
+}
+
 static bool file_has_shebang(AK::ByteBuffer file_contents)
 {
     if (file_contents.size() >= 2 && file_contents[0] == '#' && file_contents[1] == '!')
@@ -457,6 +490,13 @@ static bool parse_and_run(JS::Interpreter& interpreter, const StringView& source
     if (s_dump_ast)
         program->dump(0);
 
+    if (s_dump_bytecode && !parser.has_errors()) {
+        if (auto* block = program->bytecode_block(JS::Bytecode::Generator::Kind::Program))
+            block->dump();
+        else
+            outln("Can't generate bytecode for this program, it will run in the AST interpreter");
+    }
+
     if (parser.has_errors()) {
         auto error = parser.errors()[0];
         auto hint = error.source_location_hint(source);
@@ -669,6 +709,9 @@ int main(int argc, char** argv)
     args_parser.set_general_help("This is a JavaScript interpreter.");
     args_parser.add_option(s_dump_ast, "Dump the AST", "dump-ast", 'A');
     args_parser.add_option(s_print_last_result, "Print last result", "print-last-result", 'l');
+    args_parser.add_option(s_run_bytecode, "Run with the bytecode interpreter", "bytecode", 'b');
+    args_parser.add_option(s_dump_bytecode, "Dump the bytecode", "dump-bytecode", 'd');
+    args_parser.add_option(s_print_property_cache_statistics, "Print property cache statistics after running the script", "property-cache-stats", 'S');
     args_parser.add_option(gc_on_every_allocation, "GC on every allocation", "gc-on-every-allocation", 'g');
     args_parser.add_option(disable_syntax_highlight, "Disable live syntax highlighting", "no-syntax-highlight", 's');
     args_parser.add_positional_argument(script_path, "Path to script file", "script", Core::ArgsParser::Required::No);
@@ -677,6 +720,7 @@ int main(int argc, char** argv)
     bool syntax_highlight = !disable_syntax_highlight;
 
     vm = JS::VM::create();
+    vm->set_bytecode_enabled(s_run_bytecode);
     OwnPtr<JS::Interpreter> interpreter;
 
     interrupt_interpreter = [&] {
@@ -911,7 +955,12 @@ int main(int argc, char** argv)
             source = file_contents;
         }
 
-        if (!parse_and_run(*interpreter, source))
+        bool success = parse_and_run(*interpreter, source);
+        if (s_print_property_cache_statistics)
+            print_property_cache_statistics();
+        if (gc_on_every_allocation)
+            print_gc_statistics(interpreter->heap());
+        if (!success)
             return 1;
     }
 
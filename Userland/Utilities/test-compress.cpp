@@ -31,6 +31,7 @@
 #include <LibCompress/Deflate.h>
 #include <LibCompress/Gzip.h>
 #include <LibCompress/Zlib.h>
+#include <time.h>
 
 TEST_CASE(canonical_code_simple)
 {
@@ -131,6 +132,17 @@ TEST_CASE(deflate_decompress_zeroes)
     EXPECT(uncompressed == decompressed.value().bytes());
 }
 
+TEST_CASE(deflate_decompress_truncated)
+{
+    const Array<u8, 20> compressed {
+        0x0B, 0xC9, 0xC8, 0x2C, 0x56, 0x00, 0xA2, 0x44, 0x85, 0xE2, 0xCC, 0xDC,
+        0x82, 0x9C, 0x54, 0x85, 0x92, 0xD4, 0x8A, 0x12
+    };
+
+    const auto decompressed = Compress::DeflateDecompressor::decompress_all(compressed);
+    EXPECT(!decompressed.has_value());
+}
+
 TEST_CASE(zlib_decompress_simple)
 {
     const Array<u8, 40> compressed {
@@ -146,6 +158,43 @@ TEST_CASE(zlib_decompress_simple)
     EXPECT(decompressed.value().bytes() == (ReadonlyBytes { uncompressed, sizeof(uncompressed) - 1 }));
 }
 
+TEST_CASE(zlib_decompressor_stream)
+{
+    const Array<u8, 40> compressed {
+        0x78, 0x01, 0x01, 0x1D, 0x00, 0xE2, 0xFF, 0x54, 0x68, 0x69, 0x73, 0x20,
+        0x69, 0x73, 0x20, 0x61, 0x20, 0x73, 0x69, 0x6D, 0x70, 0x6C, 0x65, 0x20,
+        0x74, 0x65, 0x78, 0x74, 0x20, 0x66, 0x69, 0x6C, 0x65, 0x20, 0x3A, 0x29,
+        0x99, 0x5E, 0x09, 0xE8
+    };
+
+    const u8 uncompressed[] = "This is a simple text file :)";
+
+    InputMemoryStream memory_stream { compressed };
+    Compress::ZlibDecompressor zlib_stream { memory_stream };
+
+    u8 buffer[sizeof(uncompressed) - 1];
+    for (size_t i = 0; i < sizeof(buffer); i += 7)
+        EXPECT(zlib_stream.read_or_error({ buffer + i, min<size_t>(7, sizeof(buffer) - i) }));
+    EXPECT(ReadonlyBytes(buffer, sizeof(buffer)) == (ReadonlyBytes { uncompressed, sizeof(uncompressed) - 1 }));
+
+    EXPECT_EQ(zlib_stream.read({ buffer, sizeof(buffer) }), 0u);
+    EXPECT(zlib_stream.unreliable_eof());
+    EXPECT(!zlib_stream.handle_any_error());
+}
+
+TEST_CASE(zlib_decompressor_bad_checksum)
+{
+    const Array<u8, 40> compressed {
+        0x78, 0x01, 0x01, 0x1D, 0x00, 0xE2, 0xFF, 0x54, 0x68, 0x69, 0x73, 0x20,
+        0x69, 0x73, 0x20, 0x61, 0x20, 0x73, 0x69, 0x6D, 0x70, 0x6C, 0x65, 0x20,
+        0x74, 0x65, 0x78, 0x74, 0x20, 0x66, 0x69, 0x6C, 0x65, 0x20, 0x3A, 0x29,
+        0x99, 0x5E, 0x09, 0xE9
+    };
+
+    const auto decompressed = Compress::ZlibDecompressor::decompress_all(compressed);
+    EXPECT(!decompressed.has_value());
+}
+
 TEST_CASE(gzip_decompress_simple)
 {
     const Array<u8, 33> compressed {
@@ -221,4 +270,258 @@ TEST_CASE(gzip_decompress_repeat_around_buffer)
     EXPECT(uncompressed == decompressed.value().bytes());
 }
 
+// Text-like data with plenty of short and long repeats, generated deterministically.
+static ByteBuffer make_compressible_data(size_t size, u32 seed = 1)
+{
+    static const char* words[] = { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "Serenity", "OS ", "deflate ", "\n", "0123456789", "{}, ", "window " };
+
+    auto buffer = ByteBuffer::create_uninitialized(size);
+    size_t offset = 0;
+    u32 state = seed;
+    while (offset < size) {
+        state = state * 1103515245 + 12345;
+        auto* word = words[(state >> 16) % (sizeof(words) / sizeof(words[0]))];
+        for (size_t i = 0; word[i] && offset < size; ++i)
+            buffer[offset++] = word[i];
+    }
+    return buffer;
+}
+
+static ByteBuffer make_random_data(size_t size, u32 seed = 1)
+{
+    auto buffer = ByteBuffer::create_uninitialized(size);
+    u32 state = seed;
+    for (size_t i = 0; i < size; ++i) {
+        state = state * 1103515245 + 12345;
+        buffer[i] = state >> 24;
+    }
+    return buffer;
+}
+
+static constexpr Compress::DeflateCompressor::CompressionLevel all_compression_levels[] = {
+    Compress::DeflateCompressor::CompressionLevel::Store,
+    Compress::DeflateCompressor::CompressionLevel::Fast,
+    Compress::DeflateCompressor::CompressionLevel::Good,
+    Compress::DeflateCompressor::CompressionLevel::Best,
+};
+
+TEST_CASE(deflate_round_trip)
+{
+    const auto compressible = make_compressible_data(300 * 1024);
+    const auto random = make_random_data(100 * 1024);
+    const auto zeroes = ByteBuffer::create_zeroed(200 * 1024);
+    const ReadonlyBytes inputs[] = { {}, compressible.bytes().trim(1), compressible.bytes().trim(1000), compressible, random, zeroes };
+
+    for (auto level : all_compression_levels) {
+        for (auto& input : inputs) {
+            const auto compressed = Compress::DeflateCompressor::compress_all(input, level);
+            EXPECT(compressed.has_value());
+            const auto decompressed = Compress::DeflateDecompressor::decompress_all(compressed.value());
+            EXPECT(decompressed.has_value());
+            EXPECT(decompressed.value().bytes() == input);
+        }
+    }
+}
+
+TEST_CASE(deflate_compress_ratio)
+{
+    const auto compressible = make_compressible_data(300 * 1024);
+    const auto zeroes = ByteBuffer::create_zeroed(200 * 1024);
+    const auto random = make_random_data(100 * 1024);
+
+    const auto fast = Compress::DeflateCompressor::compress_all(compressible, Compress::DeflateCompressor::CompressionLevel::Fast);
+    const auto good = Compress::DeflateCompressor::compress_all(compressible, Compress::DeflateCompressor::CompressionLevel::Good);
+    const auto best = Compress::DeflateCompressor::compress_all(compressible, Compress::DeflateCompressor::CompressionLevel::Best);
+    EXPECT(fast.value().size() < compressible.size() / 2);
+    EXPECT(good.value().size() < fast.value().size());
+    EXPECT(best.value().size() <= good.value().size());
+
+    EXPECT(Compress::DeflateCompressor::compress_all(zeroes).value().size() < 1024);
+
+    // Incompressible data falls back to stored blocks, which only add a few bytes per block.
+    EXPECT(Compress::DeflateCompressor::compress_all(random).value().size() < random.size() + 32);
+}
+
+TEST_CASE(deflate_compressor_stream)
+{
+    const auto input = make_compressible_data(200 * 1024, 7);
+
+    DuplexMemoryStream output_stream;
+    Compress::DeflateCompressor deflate_stream { output_stream };
+
+    // Odd-sized writes that straddle the compressor's internal blocks.
+    size_t offset = 0;
+    for (size_t chunk_size = 1; offset < input.size(); chunk_size = chunk_size * 3 + 1) {
+        auto chunk = input.bytes().slice(offset, min(chunk_size, input.size() - offset));
+        EXPECT(deflate_stream.write_or_error(chunk));
+        offset += chunk.size();
+    }
+    deflate_stream.final();
+    EXPECT(!deflate_stream.handle_any_error());
+
+    const auto decompressed = Compress::DeflateDecompressor::decompress_all(output_stream.copy_into_contiguous_buffer());
+    EXPECT(decompressed.value().bytes() == input.bytes());
+}
+
+TEST_CASE(zlib_compress_round_trip)
+{
+    const auto input = make_compressible_data(100 * 1024, 3);
+
+    for (auto level : all_compression_levels) {
+        const auto compressed = Compress::ZlibCompressor::compress_all(input, level);
+        EXPECT(compressed.has_value());
+        EXPECT((compressed.value()[0] * 256 + compressed.value()[1]) % 31 == 0);
+
+        const auto decompressed = Compress::ZlibDecompressor::decompress_all(compressed.value());
+        EXPECT(decompressed.value().bytes() == input.bytes());
+    }
+}
+
+TEST_CASE(gzip_compress_round_trip)
+{
+    const auto input = make_compressible_data(100 * 1024, 5);
+
+    for (auto level : all_compression_levels) {
+        const auto compressed = Compress::GzipCompressor::compress_all(input, level);
+        EXPECT(compressed.has_value());
+
+        const auto decompressed = Compress::GzipDecompressor::decompress_all(compressed.value());
+        EXPECT(decompressed.value().bytes() == input.bytes());
+    }
+
+    const auto empty = Compress::GzipCompressor::compress_all({});
+    EXPECT(Compress::GzipDecompressor::decompress_all(empty.value()).value().is_empty());
+}
+
+TEST_CASE(deflate_decompressor_small_reads)
+{
+    const auto input = make_compressible_data(150 * 1024, 11);
+    const auto compressed = Compress::DeflateCompressor::compress_all(input);
+
+    InputMemoryStream memory_stream { compressed.value() };
+    Compress::DeflateDecompressor deflate_stream { memory_stream };
+
+    auto output = ByteBuffer::create_zeroed(input.size());
+    size_t offset = 0;
+    for (size_t chunk_size = 1; offset < output.size(); chunk_size = chunk_size * 5 + 1) {
+        auto nread = deflate_stream.read(output.bytes().slice(offset, min(chunk_size, output.size() - offset)));
+        EXPECT(nread > 0);
+        offset += nread;
+    }
+
+    u8 byte;
+    EXPECT_EQ(deflate_stream.read({ &byte, sizeof(byte) }), 0u);
+    EXPECT(deflate_stream.unreliable_eof());
+    EXPECT(!deflate_stream.handle_any_error());
+    EXPECT(output == input);
+}
+
+TEST_CASE(deflate_decompress_trailing_data)
+{
+    const auto input = make_compressible_data(20 * 1024, 13);
+    auto compressed = Compress::DeflateCompressor::compress_all(input).value();
+    const Array<u8, 4> trailer { 0xde, 0xad, 0xbe, 0xef };
+    compressed.append(trailer.data(), trailer.size());
+
+    InputMemoryStream memory_stream { compressed };
+    InputBitStream bit_stream { memory_stream };
+    {
+        Compress::DeflateDecompressor deflate_stream { bit_stream };
+        auto output = ByteBuffer::create_zeroed(input.size());
+        EXPECT(deflate_stream.read_or_error(output));
+        EXPECT(output == input);
+    }
+
+    // Whatever the decompressor read ahead is still available from the bit stream.
+    Array<u8, 4> read_trailer;
+    EXPECT(bit_stream.read_or_error(read_trailer));
+    EXPECT(read_trailer == trailer);
+}
+
+TEST_CASE(gzip_decompress_large_members)
+{
+    const auto first = make_compressible_data(100 * 1024, 17);
+    const auto second = make_random_data(50 * 1024, 19);
+
+    auto compressed = Compress::GzipCompressor::compress_all(first).value();
+    const auto second_compressed = Compress::GzipCompressor::compress_all(second).value();
+    compressed.append(second_compressed.data(), second_compressed.size());
+
+    auto expected = first;
+    expected.append(second.data(), second.size());
+
+    const auto decompressed = Compress::GzipDecompressor::decompress_all(compressed);
+    EXPECT(decompressed.value() == expected);
+}
+
+TEST_CASE(gzip_decompress_truncated)
+{
+    const auto input = make_compressible_data(20 * 1024, 23);
+    const auto compressed = Compress::GzipCompressor::compress_all(input).value();
+
+    for (size_t size = 1; size < compressed.size(); size += size < 64 ? 1 : 97)
+        EXPECT(!Compress::GzipDecompressor::decompress_all(compressed.bytes().trim(size)).has_value());
+}
+
+TEST_CASE(gzip_decompress_corrupted)
+{
+    const auto input = make_compressible_data(20 * 1024, 29);
+    const auto compressed = Compress::GzipCompressor::compress_all(input).value();
+
+    u32 state = 31;
+    for (size_t i = 0; i < 300; ++i) {
+        auto corrupted = ByteBuffer::copy(compressed.data(), compressed.size());
+        for (size_t j = 0; j < 1 + i % 4; ++j) {
+            state = state * 1103515245 + 12345;
+            auto offset = (state >> 8) % corrupted.size();
+            corrupted[offset] ^= 1 << ((state >> 4) % 8);
+        }
+        // Whatever comes out, this must neither crash nor return something that isn't the original.
+        const auto decompressed = Compress::GzipDecompressor::decompress_all(corrupted);
+        if (decompressed.has_value())
+            EXPECT(decompressed.value() == input);
+    }
+}
+
+static double seconds_since(const timespec& start)
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+BENCHMARK_CASE(deflate_compress_throughput)
+{
+    const auto input = make_compressible_data(8 * MiB);
+    const char* level_names[] = { "store", "fast", "good", "best" };
+
+    for (size_t i = 0; i < sizeof(all_compression_levels) / sizeof(all_compression_levels[0]); ++i) {
+        timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const auto compressed = Compress::DeflateCompressor::compress_all(input, all_compression_levels[i]);
+        auto seconds = seconds_since(start);
+
+        EXPECT(compressed.has_value());
+        printf("%-5s: %7.1f MB/s, ratio %.3f\n", level_names[i], input.size() / seconds / MiB, (double)compressed.value().size() / input.size());
+    }
+}
+
+BENCHMARK_CASE(deflate_decompress_throughput)
+{
+    const auto input = make_compressible_data(8 * MiB);
+    const char* level_names[] = { "store", "fast", "good", "best" };
+
+    for (size_t i = 0; i < sizeof(all_compression_levels) / sizeof(all_compression_levels[0]); ++i) {
+        const auto compressed = Compress::DeflateCompressor::compress_all(input, all_compression_levels[i]).value();
+
+        timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const auto decompressed = Compress::DeflateDecompressor::decompress_all(compressed);
+        auto seconds = seconds_since(start);
+
+        EXPECT(decompressed.value() == input);
+        printf("%-5s: %7.1f MB/s\n", level_names[i], input.size() / seconds / MiB);
+    }
+}
+
 TEST_MAIN(Compress)
@@ -41,8 +41,13 @@
 #include <LibJS/Parser.h>
 #include <LibJS/Runtime/Array.h>
 #include <LibJS/Runtime/JSONObject.h>
+#include <LibWeb/Bindings/NodeWrapper.h>
+#include <LibWeb/Bindings/WindowObject.h>
+#include <LibWeb/DOM/Document.h>
+#include <LibWeb/DOM/Window.h>
 #include <LibWeb/HTML/Parser/HTMLDocumentParser.h>
 #include <LibWeb/InProcessWebView.h>
+#include <LibWeb/Layout/Box.h>
 #include <LibWeb/Loader/ResourceLoader.h>
 #include <signal.h>
 #include <sys/time.h>
@@ -106,6 +111,9 @@ public:
 
 private:
     JS_DECLARE_NATIVE_FUNCTION(change_page);
+    JS_DECLARE_NATIVE_FUNCTION(update_layout);
+    JS_DECLARE_NATIVE_FUNCTION(force_layout);
+    JS_DECLARE_NATIVE_FUNCTION(layout_rect);
 };
 
 TestRunnerObject::TestRunnerObject(JS::GlobalObject& global_object)
@@ -117,6 +125,9 @@ void TestRunnerObject::initialize(JS::GlobalObject& global_object)
 {
     Object::initialize(global_object);
     define_native_function("changePage", change_page, 1);
+    define_native_function("updateLayout", update_layout, 0);
+    define_native_function("forceLayout", force_layout, 0);
+    define_native_function("layoutRect", layout_rect, 1);
 }
 
 TestRunnerObject::~TestRunnerObject()
@@ -135,6 +146,45 @@ JS_DEFINE_NATIVE_FUNCTION(TestRunnerObject::change_page)
     return JS::js_undefined();
 }
 
+JS_DEFINE_NATIVE_FUNCTION(TestRunnerObject::update_layout)
+{
+    auto& document = static_cast<Web::Bindings::WindowObject&>(global_object).impl().document();
+    document.update_style();
+    return JS::js_undefined();
+}
+
+JS_DEFINE_NATIVE_FUNCTION(TestRunnerObject::force_layout)
+{
+    auto& document = static_cast<Web::Bindings::WindowObject&>(global_object).impl().document();
+    document.update_style();
+    document.force_layout();
+    return JS::js_undefined();
+}
+
+JS_DEFINE_NATIVE_FUNCTION(TestRunnerObject::layout_rect)
+{
+    auto* object = vm.argument(0).to_object(global_object);
+    if (vm.exception())
+        return {};
+
+    if (!is<Web::Bindings::NodeWrapper>(object)) {
+        vm.throw_exception<JS::TypeError>(global_object, JS::ErrorType::NotA, "Node");
+        return {};
+    }
+
+    auto* layout_node = static_cast<Web::Bindings::NodeWrapper*>(object)->impl().layout_node();
+    if (!layout_node || !is<Web::Layout::Box>(*layout_node))
+        return JS::js_null();
+
+    auto rect = downcast<Web::Layout::Box>(*layout_node).absolute_rect();
+    auto* result = JS::Object::create_empty(global_object);
+    result->put("x", JS::Value(rect.x()));
+    result->put("y", JS::Value(rect.y()));
+    result->put("width", JS::Value(rect.width()));
+    result->put("height", JS::Value(rect.height()));
+    return result;
+}
+
 class TestRunner {
 public:
     TestRunner(String web_test_root, String js_test_root, Web::InProcessWebView& page_view, bool print_times)